@@ -18,9 +18,11 @@
 #include "postgres.h"
 #include "catalog/pg_type.h"
 #include "fmgr.h"
+#include "libpq/pqformat.h"
 #include "utils/array.h"
 #include "utils/builtins.h"
 #include "utils/cash.h"
+#include "utils/datum.h"
 #include "utils/numeric.h"
 #include <math.h>
 #include "pg_strom.h"
@@ -45,15 +47,26 @@ Datum gpupreagg_corr_psum_y2(PG_FUNCTION_ARGS);
 Datum gpupreagg_corr_psum_xy(PG_FUNCTION_ARGS);
 
 Datum pgstrom_avg_int8_accum(PG_FUNCTION_ARGS);	/* name confusing? */
+Datum pgstrom_avg_int8_combine(PG_FUNCTION_ARGS);
 Datum pgstrom_sum_int8_accum(PG_FUNCTION_ARGS);	/* name confusing? */
 Datum pgstrom_sum_int8_final(PG_FUNCTION_ARGS);	/* name confusing? */
 Datum pgstrom_sum_float8_accum(PG_FUNCTION_ARGS);
 Datum pgstrom_variance_float8_accum(PG_FUNCTION_ARGS);
 Datum pgstrom_covariance_float8_accum(PG_FUNCTION_ARGS);
+Datum pgstrom_float8_combine(PG_FUNCTION_ARGS);
 
 Datum pgstrom_int8_avg_accum(PG_FUNCTION_ARGS);
 Datum pgstrom_numeric_avg_accum(PG_FUNCTION_ARGS);
 Datum pgstrom_numeric_avg_final(PG_FUNCTION_ARGS);
+Datum pgstrom_numeric_agg_combine(PG_FUNCTION_ARGS);
+Datum pgstrom_numeric_agg_serialize(PG_FUNCTION_ARGS);
+Datum pgstrom_numeric_agg_deserialize(PG_FUNCTION_ARGS);
+Datum pgstrom_numeric_fixed_accum(PG_FUNCTION_ARGS);
+Datum pgstrom_numeric_fixed_sum_final(PG_FUNCTION_ARGS);
+Datum pgstrom_numeric_fixed_avg_final(PG_FUNCTION_ARGS);
+Datum pgstrom_numeric_fixed_combine(PG_FUNCTION_ARGS);
+Datum pgstrom_numeric_fixed_serialize(PG_FUNCTION_ARGS);
+Datum pgstrom_numeric_fixed_deserialize(PG_FUNCTION_ARGS);
 Datum pgstrom_numeric_var_accum(PG_FUNCTION_ARGS);
 Datum pgstrom_numeric_var_samp(PG_FUNCTION_ARGS);
 Datum pgstrom_numeric_var_pop(PG_FUNCTION_ARGS);
@@ -323,6 +336,48 @@ pgstrom_sum_int8_accum(PG_FUNCTION_ARGS)
 }
 PG_FUNCTION_INFO_V1(pgstrom_sum_int8_accum);
 
+/*
+ * pgstrom_avg_int8_combine - combine function of the partial aggregates
+ * that track nrows and psum(X) on int8[] transition state.
+ */
+Datum
+pgstrom_avg_int8_combine(PG_FUNCTION_ARGS)
+{
+	ArrayType  *transarray1 = PG_GETARG_ARRAYTYPE_P(0);
+	ArrayType  *transarray2 = PG_GETARG_ARRAYTYPE_P(1);
+	int64	   *transvalues1;
+	int64	   *transvalues2;
+	int64		newN;
+	int64		newSumX;
+
+	transvalues1 = check_int64_array(transarray1, 2);
+	transvalues2 = check_int64_array(transarray2, 2);
+	newN = transvalues1[0] + transvalues2[0];
+	newSumX = transvalues1[1] + transvalues2[1];
+
+	if (AggCheckCallContext(fcinfo, NULL))
+	{
+		transvalues1[0] = newN;
+		transvalues1[1] = newSumX;
+
+		PG_RETURN_ARRAYTYPE_P(transarray1);
+	}
+	else
+	{
+		Datum		transdatums[2];
+		ArrayType  *result;
+
+		transdatums[0] = Int64GetDatumFast(newN);
+		transdatums[1] = Int64GetDatumFast(newSumX);
+
+		result = construct_array(transdatums, 2,
+								 INT8OID,
+								 sizeof(int64), FLOAT8PASSBYVAL, 'd');
+		PG_RETURN_ARRAYTYPE_P(result);
+	}
+}
+PG_FUNCTION_INFO_V1(pgstrom_avg_int8_combine);
+
 /*
  * numeric_agg_state - self version of aggregation internal state; that
  * can keep N, sum(X) and sum(X*X) in numeric data-type.
@@ -441,6 +496,373 @@ pgstrom_numeric_avg_final(PG_FUNCTION_ARGS)
 }
 PG_FUNCTION_INFO_V1(pgstrom_numeric_avg_final);
 
+/*
+ * pgstrom_numeric_agg_combine - combine function of numeric_agg_state.
+ * Note that sumX2 is not initialized by the state of avg.
+ */
+Datum
+pgstrom_numeric_agg_combine(PG_FUNCTION_ARGS)
+{
+	numeric_agg_state *state1;
+	numeric_agg_state *state2;
+	MemoryContext	aggcxt;
+	MemoryContext	oldcxt;
+
+	if (!AggCheckCallContext(fcinfo, &aggcxt))
+		elog(ERROR, "aggregate function called in non-aggregate context");
+
+	state1 = PG_ARGISNULL(0) ? NULL : (numeric_agg_state *)PG_GETARG_POINTER(0);
+	state2 = PG_ARGISNULL(1) ? NULL : (numeric_agg_state *)PG_GETARG_POINTER(1);
+	if (!state2)
+	{
+		if (!state1)
+			PG_RETURN_NULL();
+		PG_RETURN_POINTER(state1);
+	}
+
+	oldcxt = MemoryContextSwitchTo(aggcxt);
+	if (!state1)
+	{
+		state1 = palloc0(sizeof(numeric_agg_state));
+		state1->N = state2->N;
+		state1->sumX = datumCopy(state2->sumX, false, -1);
+		if (state2->sumX2)
+			state1->sumX2 = datumCopy(state2->sumX2, false, -1);
+	}
+	else
+	{
+		state1->N += state2->N;
+		state1->sumX = DirectFunctionCall2(numeric_add,
+										   state1->sumX,
+										   state2->sumX);
+		if (!state2->sumX2)
+			;	/* nothing to do */
+		else if (!state1->sumX2)
+			state1->sumX2 = datumCopy(state2->sumX2, false, -1);
+		else
+			state1->sumX2 = DirectFunctionCall2(numeric_add,
+												state1->sumX2,
+												state2->sumX2);
+	}
+	MemoryContextSwitchTo(oldcxt);
+
+	PG_RETURN_POINTER(state1);
+}
+PG_FUNCTION_INFO_V1(pgstrom_numeric_agg_combine);
+
+static void
+numeric_agg_send_numeric(StringInfo buf, Datum value)
+{
+	bytea	   *temp = DatumGetByteaP(DirectFunctionCall1(numeric_send, value));
+
+	pq_sendint(buf, VARSIZE(temp) - VARHDRSZ, 4);
+	pq_sendbytes(buf, VARDATA(temp), VARSIZE(temp) - VARHDRSZ);
+}
+
+static Datum
+numeric_agg_recv_numeric(StringInfo buf)
+{
+	StringInfoData	temp;
+	int				len = pq_getmsgint(buf, 4);
+
+	temp.data = (char *) pq_getmsgbytes(buf, len);
+	temp.len = len;
+	temp.maxlen = len;
+	temp.cursor = 0;
+
+	return DirectFunctionCall3(numeric_recv,
+							   PointerGetDatum(&temp),
+							   ObjectIdGetDatum(InvalidOid),
+							   Int32GetDatum(-1));
+}
+
+/*
+ * pgstrom_numeric_agg_serialize / pgstrom_numeric_agg_deserialize
+ *
+ * serialization of numeric_agg_state; to be exchanged between the parallel
+ * workers and the master process.
+ */
+Datum
+pgstrom_numeric_agg_serialize(PG_FUNCTION_ARGS)
+{
+	numeric_agg_state *state;
+	StringInfoData	buf;
+
+	if (!AggCheckCallContext(fcinfo, NULL))
+		elog(ERROR, "aggregate function called in non-aggregate context");
+
+	state = (numeric_agg_state *)PG_GETARG_POINTER(0);
+	pq_begintypsend(&buf);
+	pq_sendint64(&buf, state->N);
+	numeric_agg_send_numeric(&buf, state->sumX);
+	pq_sendbyte(&buf, state->sumX2 != 0);
+	if (state->sumX2)
+		numeric_agg_send_numeric(&buf, state->sumX2);
+
+	PG_RETURN_BYTEA_P(pq_endtypsend(&buf));
+}
+PG_FUNCTION_INFO_V1(pgstrom_numeric_agg_serialize);
+
+Datum
+pgstrom_numeric_agg_deserialize(PG_FUNCTION_ARGS)
+{
+	bytea	   *sstate = PG_GETARG_BYTEA_P(0);
+	numeric_agg_state *state;
+	StringInfoData	buf;
+
+	if (!AggCheckCallContext(fcinfo, NULL))
+		elog(ERROR, "aggregate function called in non-aggregate context");
+
+	buf.data = VARDATA(sstate);
+	buf.len = VARSIZE(sstate) - VARHDRSZ;
+	buf.maxlen = buf.len;
+	buf.cursor = 0;
+
+	state = palloc0(sizeof(numeric_agg_state));
+	state->N = pq_getmsgint64(&buf);
+	state->sumX = numeric_agg_recv_numeric(&buf);
+	if (pq_getmsgbyte(&buf) != 0)
+		state->sumX2 = numeric_agg_recv_numeric(&buf);
+	pq_getmsgend(&buf);
+
+	PG_RETURN_POINTER(state);
+}
+PG_FUNCTION_INFO_V1(pgstrom_numeric_agg_deserialize);
+
+/*
+ * numeric_fixed_state - aggregation internal state of sum/avg on numeric
+ * with typmod bounded scale. Partial sums are given as int8 value scaled
+ * by 10^scale, then accumulated on the 128-bit integer (sum_hi:sum_lo)
+ * without arbitrary-precision numeric operations.
+ */
+typedef struct
+{
+	int64	N;
+	uint64	sum_lo;
+	int64	sum_hi;
+	int32	scale;
+} numeric_fixed_state;
+
+static inline void
+numeric_fixed_add(numeric_fixed_state *state, int64 ival)
+{
+	uint64	newval = state->sum_lo + (uint64) ival;
+
+	/* sign extension of ival and carry of the lower 64bit */
+	state->sum_hi += (ival < 0 ? -1 : 0) + (newval < state->sum_lo ? 1 : 0);
+	state->sum_lo = newval;
+}
+
+/*
+ * numeric_fixed_to_numeric - transforms the 128-bit fixed-scale integer
+ * to numeric datum.
+ */
+static Datum
+numeric_fixed_to_numeric(numeric_fixed_state *state)
+{
+	uint64		lo = state->sum_lo;
+	uint64		hi = (uint64) state->sum_hi;
+	bool		negative = (state->sum_hi < 0);
+	uint32		limbs[4];
+	char		buf[64];
+	char	   *pos = buf + sizeof(buf);
+	int			ndigits = 0;
+	bool		nonzero;
+	int			i;
+
+	if (negative)
+	{
+		lo = ~lo + 1;
+		hi = ~hi + (lo == 0 ? 1 : 0);
+	}
+	limbs[0] = (uint32)(hi >> 32);
+	limbs[1] = (uint32)(hi & 0xffffffffUL);
+	limbs[2] = (uint32)(lo >> 32);
+	limbs[3] = (uint32)(lo & 0xffffffffUL);
+
+	*--pos = '\0';
+	do {
+		uint64	rem = 0;
+
+		nonzero = false;
+		for (i=0; i < lengthof(limbs); i++)
+		{
+			uint64	curr = (rem << 32) | (uint64) limbs[i];
+
+			limbs[i] = (uint32)(curr / 10);
+			rem = curr % 10;
+			if (limbs[i] != 0)
+				nonzero = true;
+		}
+		*--pos = '0' + rem;
+		if (++ndigits == state->scale)
+			*--pos = '.';
+	} while (nonzero || ndigits <= state->scale);
+
+	if (negative)
+		*--pos = '-';
+
+	return DirectFunctionCall3(numeric_in,
+							   CStringGetDatum(pos),
+							   ObjectIdGetDatum(InvalidOid),
+							   Int32GetDatum(-1));
+}
+
+Datum
+pgstrom_numeric_fixed_accum(PG_FUNCTION_ARGS)
+{
+	int32			nrows = PG_GETARG_INT32(1);
+	int32			scale = PG_GETARG_INT32(3);
+	MemoryContext	aggcxt;
+	numeric_fixed_state *state;
+
+	if (!AggCheckCallContext(fcinfo, &aggcxt))
+		elog(ERROR, "aggregate function called in non-aggregate context");
+
+	if (PG_ARGISNULL(1))
+		nrows = 0;
+	else if (nrows < 0)
+		elog(ERROR, "Bug? negative nrows were given");
+
+	state = PG_ARGISNULL(0) ? NULL : (numeric_fixed_state *)PG_GETARG_POINTER(0);
+	if (!state)
+	{
+		if (PG_ARGISNULL(3) || scale < 0)
+			elog(ERROR, "Bug? invalid scale of fixed-scale numeric");
+		state = MemoryContextAllocZero(aggcxt, sizeof(numeric_fixed_state));
+		state->scale = scale;
+	}
+	else if (state->scale != scale)
+		elog(ERROR, "Bug? scale of fixed-scale numeric was changed");
+
+	if (nrows > 0 && !PG_ARGISNULL(2))
+	{
+		state->N += nrows;
+		numeric_fixed_add(state, PG_GETARG_INT64(2));
+	}
+	PG_RETURN_POINTER(state);
+}
+PG_FUNCTION_INFO_V1(pgstrom_numeric_fixed_accum);
+
+Datum
+pgstrom_numeric_fixed_sum_final(PG_FUNCTION_ARGS)
+{
+	numeric_fixed_state *state;
+
+	state = PG_ARGISNULL(0) ? NULL : (numeric_fixed_state *)PG_GETARG_POINTER(0);
+
+	/* If there were no non-null inputs, return NULL */
+	if (state == NULL || state->N == 0)
+		PG_RETURN_NULL();
+
+	PG_RETURN_DATUM(numeric_fixed_to_numeric(state));
+}
+PG_FUNCTION_INFO_V1(pgstrom_numeric_fixed_sum_final);
+
+Datum
+pgstrom_numeric_fixed_avg_final(PG_FUNCTION_ARGS)
+{
+	numeric_fixed_state *state;
+	Datum		vN;
+	Datum		result;
+
+	state = PG_ARGISNULL(0) ? NULL : (numeric_fixed_state *)PG_GETARG_POINTER(0);
+
+	/* If there were no non-null inputs, return NULL */
+	if (state == NULL || state->N == 0)
+		PG_RETURN_NULL();
+
+	vN = DirectFunctionCall1(int8_numeric, Int64GetDatum(state->N));
+	result = DirectFunctionCall2(numeric_div,
+								 numeric_fixed_to_numeric(state), vN);
+	PG_RETURN_NUMERIC(result);
+}
+PG_FUNCTION_INFO_V1(pgstrom_numeric_fixed_avg_final);
+
+Datum
+pgstrom_numeric_fixed_combine(PG_FUNCTION_ARGS)
+{
+	numeric_fixed_state *state1;
+	numeric_fixed_state *state2;
+	MemoryContext	aggcxt;
+	uint64			newlo;
+
+	if (!AggCheckCallContext(fcinfo, &aggcxt))
+		elog(ERROR, "aggregate function called in non-aggregate context");
+
+	state1 = PG_ARGISNULL(0) ? NULL : (numeric_fixed_state *)PG_GETARG_POINTER(0);
+	state2 = PG_ARGISNULL(1) ? NULL : (numeric_fixed_state *)PG_GETARG_POINTER(1);
+	if (!state2)
+	{
+		if (!state1)
+			PG_RETURN_NULL();
+		PG_RETURN_POINTER(state1);
+	}
+
+	if (!state1)
+	{
+		state1 = MemoryContextAlloc(aggcxt, sizeof(numeric_fixed_state));
+		memcpy(state1, state2, sizeof(numeric_fixed_state));
+	}
+	else
+	{
+		if (state1->scale != state2->scale)
+			elog(ERROR, "Bug? scale of fixed-scale numeric was changed");
+		newlo = state1->sum_lo + state2->sum_lo;
+		state1->sum_hi += state2->sum_hi + (newlo < state1->sum_lo ? 1 : 0);
+		state1->sum_lo = newlo;
+		state1->N += state2->N;
+	}
+	PG_RETURN_POINTER(state1);
+}
+PG_FUNCTION_INFO_V1(pgstrom_numeric_fixed_combine);
+
+Datum
+pgstrom_numeric_fixed_serialize(PG_FUNCTION_ARGS)
+{
+	numeric_fixed_state *state;
+	StringInfoData	buf;
+
+	if (!AggCheckCallContext(fcinfo, NULL))
+		elog(ERROR, "aggregate function called in non-aggregate context");
+
+	state = (numeric_fixed_state *)PG_GETARG_POINTER(0);
+	pq_begintypsend(&buf);
+	pq_sendint64(&buf, state->N);
+	pq_sendint64(&buf, (int64) state->sum_lo);
+	pq_sendint64(&buf, state->sum_hi);
+	pq_sendint(&buf, state->scale, 4);
+
+	PG_RETURN_BYTEA_P(pq_endtypsend(&buf));
+}
+PG_FUNCTION_INFO_V1(pgstrom_numeric_fixed_serialize);
+
+Datum
+pgstrom_numeric_fixed_deserialize(PG_FUNCTION_ARGS)
+{
+	bytea	   *sstate = PG_GETARG_BYTEA_P(0);
+	numeric_fixed_state *state;
+	StringInfoData	buf;
+
+	if (!AggCheckCallContext(fcinfo, NULL))
+		elog(ERROR, "aggregate function called in non-aggregate context");
+
+	buf.data = VARDATA(sstate);
+	buf.len = VARSIZE(sstate) - VARHDRSZ;
+	buf.maxlen = buf.len;
+	buf.cursor = 0;
+
+	state = palloc0(sizeof(numeric_fixed_state));
+	state->N = pq_getmsgint64(&buf);
+	state->sum_lo = (uint64) pq_getmsgint64(&buf);
+	state->sum_hi = pq_getmsgint64(&buf);
+	state->scale = pq_getmsgint(&buf, 4);
+	pq_getmsgend(&buf);
+
+	PG_RETURN_POINTER(state);
+}
+PG_FUNCTION_INFO_V1(pgstrom_numeric_fixed_deserialize);
+
 /* logic copied from utils/adt/float.c */
 static inline float8 *
 check_float8_array(ArrayType *transarray, int nitems)
@@ -805,3 +1227,52 @@ pgstrom_covariance_float8_accum(PG_FUNCTION_ARGS)
 	}
 }
 PG_FUNCTION_INFO_V1(pgstrom_covariance_float8_accum);
+
+/*
+ * pgstrom_float8_combine - combine function of the partial aggregates
+ * on float8[] transition state; nrows and partial sums are simply added.
+ */
+Datum
+pgstrom_float8_combine(PG_FUNCTION_ARGS)
+{
+	ArrayType  *transarray1 = PG_GETARG_ARRAYTYPE_P(0);
+	ArrayType  *transarray2 = PG_GETARG_ARRAYTYPE_P(1);
+	float8	   *transvalues1;
+	float8	   *transvalues2;
+	float8		newvalues[6];
+	int			i, nitems;
+
+	nitems = (ARR_NDIM(transarray1) == 1 ? ARR_DIMS(transarray1)[0] : 0);
+	if (nitems != 3 && nitems != 6)
+		elog(ERROR, "3 or 6 elements float8 array is expected");
+	transvalues1 = check_float8_array(transarray1, nitems);
+	transvalues2 = check_float8_array(transarray2, nitems);
+	for (i=0; i < nitems; i++)
+	{
+		newvalues[i] = transvalues1[i] + transvalues2[i];
+		check_float8_valid(newvalues[i],
+						   isinf(transvalues1[i]) || isinf(transvalues2[i]),
+						   true);
+	}
+
+	if (AggCheckCallContext(fcinfo, NULL))
+	{
+		memcpy(transvalues1, newvalues, sizeof(float8) * nitems);
+
+		PG_RETURN_ARRAYTYPE_P(transarray1);
+	}
+	else
+	{
+		Datum		transdatums[6];
+		ArrayType  *result;
+
+		for (i=0; i < nitems; i++)
+			transdatums[i] = Float8GetDatumFast(newvalues[i]);
+
+		result = construct_array(transdatums, nitems,
+								 FLOAT8OID,
+								 sizeof(float8), FLOAT8PASSBYVAL, 'd');
+		PG_RETURN_ARRAYTYPE_P(result);
+	}
+}
+PG_FUNCTION_INFO_V1(pgstrom_float8_combine);
@@ -22,9 +22,13 @@
 #include "catalog/pg_namespace.h"
 #include "catalog/pg_proc.h"
 #include "catalog/pg_type.h"
+#include "executor/executor.h"
+#include "mb/pg_wchar.h"
+#include "nodes/makefuncs.h"
 #include "nodes/nodeFuncs.h"
 #include "nodes/pg_list.h"
 #include "optimizer/clauses.h"
+#include "utils/array.h"
 #include "utils/builtins.h"
 #include "utils/fmgroids.h"
 #include "utils/inval.h"
@@ -1362,6 +1366,9 @@ static void codegen_minmax_expression(MinMaxExpr *minmax,
 									  codegen_context *context);
 static void codegen_scalar_array_op_expression(ScalarArrayOpExpr *opexpr,
 											   codegen_context *context);
+static bool codegen_common_subexpr(Node *node, codegen_context *context);
+static bool codegen_textlike_expression(devfunc_info *dfunc, List *args,
+										codegen_context *context);
 
 static void
 codegen_expression_walker(Node *node, codegen_context *context)
@@ -1373,6 +1380,10 @@ codegen_expression_walker(Node *node, codegen_context *context)
 	if (node == NULL)
 		return;
 
+	/* reference to KEXP_n, if common sub-expression */
+	if (context->cse_exprs != NIL && codegen_common_subexpr(node, context))
+		return;
+
 	if (IsA(node, Const))
 	{
 		Const  *con = (Const *) node;
@@ -1394,8 +1405,9 @@ codegen_expression_walker(Node *node, codegen_context *context)
 		Param  *param = (Param *) node;
 		int		index = 0;
 
-		if (param->paramkind != PARAM_EXTERN)
-			elog(ERROR, "codegen: ParamKind is not PARAM_EXTERN: %d",
+		if (param->paramkind != PARAM_EXTERN &&
+			param->paramkind != PARAM_EXEC)
+			elog(ERROR, "codegen: ParamKind is neither PARAM_EXTERN nor PARAM_EXEC: %d",
 				 (int)param->paramkind);
 
 		if (!pgstrom_devtype_lookup_and_track(param->paramtype, context))
@@ -1476,6 +1488,8 @@ codegen_expression_walker(Node *node, codegen_context *context)
 		if (!dfunc)
 			elog(ERROR, "codegen: failed to lookup device function: %s",
 				 format_procedure(func->funcid));
+		if (codegen_textlike_expression(dfunc, func->args, context))
+			return;
 
 		appendStringInfo(&context->str,
 						 "pgfn_%s(kcxt", dfunc->func_devname);
@@ -1499,6 +1513,8 @@ codegen_expression_walker(Node *node, codegen_context *context)
 		if (!dfunc)
 			elog(ERROR, "codegen: failed to lookup device function: %s",
                  format_procedure(op_funcid));
+		if (codegen_textlike_expression(dfunc, op->args, context))
+			return;
 
 		appendStringInfo(&context->str,
 						 "pgfn_%s(kcxt", dfunc->func_devname);
@@ -2036,6 +2052,346 @@ codegen_minmax_expression(MinMaxExpr *minmax, codegen_context *context)
 	appendStringInfo(&context->str, ")");
 }
 
+/*
+ * like_pattern_shape
+ *
+ * It classifies the shape of LIKE pattern, if it is a constant that
+ * consists of literal bytes and '%' only. Byte-wise match is safe on
+ * single-byte encodings and UTF-8, like PostgreSQL itself.
+ */
+#define LIKE_SHAPE_GENERIC		0	/* GenericMatchText */
+#define LIKE_SHAPE_EXACT		1	/* 'abc' */
+#define LIKE_SHAPE_PREFIX		2	/* 'abc%' */
+#define LIKE_SHAPE_SUFFIX		3	/* '%abc' */
+#define LIKE_SHAPE_INFIX		4	/* '%abc%' */
+#define LIKE_SHAPE_SEGMENTS		5	/* 'ab%cd%ef' */
+
+static int
+like_pattern_shape(Node *node)
+{
+	Const	   *con = (Const *) node;
+	text	   *pattern;
+	char	   *p;
+	int			plen;
+	int			i, nwild = 0;
+
+	if (!IsA(con, Const) || con->constisnull)
+		return LIKE_SHAPE_GENERIC;
+	if (pg_database_encoding_max_length() > 1 &&
+		GetDatabaseEncoding() != PG_UTF8)
+		return LIKE_SHAPE_GENERIC;
+
+	pattern = DatumGetTextPP(con->constvalue);
+	p = VARDATA_ANY(pattern);
+	plen = VARSIZE_ANY_EXHDR(pattern);
+	for (i=0; i < plen; i++)
+	{
+		if (p[i] == '_' || p[i] == '\\')
+			return LIKE_SHAPE_GENERIC;
+		if (p[i] == '%')
+			nwild++;
+	}
+	if (nwild == 0)
+		return LIKE_SHAPE_EXACT;
+	if (nwild == 1 && p[plen-1] == '%')
+		return LIKE_SHAPE_PREFIX;
+	if (nwild == 1 && p[0] == '%')
+		return LIKE_SHAPE_SUFFIX;
+	if (nwild == 2 && plen >= 2 && p[0] == '%' && p[plen-1] == '%')
+		return LIKE_SHAPE_INFIX;
+	return LIKE_SHAPE_SEGMENTS;
+}
+
+static const char *
+like_pattern_shape_name(int shape)
+{
+	switch (shape)
+	{
+		case LIKE_SHAPE_EXACT:
+			return "exact";
+		case LIKE_SHAPE_PREFIX:
+			return "prefix";
+		case LIKE_SHAPE_SUFFIX:
+			return "suffix";
+		case LIKE_SHAPE_INFIX:
+			return "infix";
+		case LIKE_SHAPE_SEGMENTS:
+			return "segments";
+		default:
+			elog(ERROR, "unexpected LIKE pattern shape: %d", shape);
+	}
+	return NULL;	/* be compiler quiet */
+}
+
+/*
+ * codegen_textlike_expression
+ *
+ * It writes out a specialized LIKE matcher instead of textlike/textnlike,
+ * if the pattern is a constant with a simple shape.
+ */
+static bool
+codegen_textlike_expression(devfunc_info *dfunc, List *args,
+							codegen_context *context)
+{
+	bool	negative;
+	int		shape;
+
+	if (strcmp(dfunc->func_devname, "textlike") == 0)
+		negative = false;
+	else if (strcmp(dfunc->func_devname, "textnlike") == 0)
+		negative = true;
+	else
+		return false;
+
+	Assert(list_length(args) == 2);
+	shape = like_pattern_shape(lsecond(args));
+	if (shape == LIKE_SHAPE_GENERIC)
+		return false;
+
+	appendStringInfo(&context->str, "%spgfn_textlike_%s(kcxt, ",
+					 negative ? "(!" : "",
+					 like_pattern_shape_name(shape));
+	codegen_expression_walker(linitial(args), context);
+	appendStringInfo(&context->str, ", ");
+	codegen_expression_walker(lsecond(args), context);
+	appendStringInfo(&context->str, ")%s", negative ? ")" : "");
+
+	return true;
+}
+
+/*
+ * make_array_lookup_key
+ *
+ * It checks whether the supplied ScalarArrayOpExpr can be evaluated by
+ * binary search on a sorted array built on the host side once per query,
+ * instead of the linear walk for each row. If OK, it returns a FuncExpr
+ * of the btree comparison function on the array argument; it is put on
+ * the used_params as a key of the kern_array_lookup in kern_parambuf.
+ * Both of the code generator and CPU fallback use this function, so they
+ * can identify the same lookup from the same expression.
+ */
+#define ARRAY_LOOKUP_MIN_NITEMS		16
+
+static FuncExpr *
+make_array_lookup_key(ScalarArrayOpExpr *opexpr)
+{
+	devtype_info   *dtype;
+	Node		   *expr;
+	Oid				type_oid;
+	Oid				eq_opno;
+
+	if (list_length(opexpr->args) != 2)
+		return NULL;
+	type_oid = exprType(linitial(opexpr->args));
+	expr = lsecond(opexpr->args);
+	if (get_element_type(exprType(expr)) != type_oid)
+		return NULL;
+
+	/* array must be a constant or an external parameter */
+	if (IsA(expr, Const))
+	{
+		Const	   *con = (Const *) expr;
+		ArrayType  *array;
+
+		/* linear walk is cheap enough for short array */
+		if (con->constisnull)
+			return NULL;
+		array = DatumGetArrayTypeP(con->constvalue);
+		if (ArrayGetNItems(ARR_NDIM(array),
+						   ARR_DIMS(array)) < ARRAY_LOOKUP_MIN_NITEMS)
+			return NULL;
+	}
+	else if (!IsA(expr, Param) ||
+			 ((Param *) expr)->paramkind != PARAM_EXTERN)
+		return NULL;
+
+	/* only fixed-length, pass-by-value type with comparison function */
+	dtype = pgstrom_devtype_lookup(type_oid);
+	if (!dtype || dtype->type_element ||
+		dtype->type_length <= 0 || !dtype->type_byval ||
+		!OidIsValid(dtype->type_eqfunc) ||
+		!OidIsValid(dtype->type_cmpfunc))
+		return NULL;
+
+	/* operator must be equality for ANY, or its negator for ALL */
+	eq_opno = (opexpr->useOr ? opexpr->opno : get_negator(opexpr->opno));
+	if (!OidIsValid(eq_opno) || get_opcode(eq_opno) != dtype->type_eqfunc)
+		return NULL;
+
+	return makeFuncExpr(dtype->type_cmpfunc,
+						INT4OID,
+						list_make1(copyObject(expr)),
+						InvalidOid,
+						opexpr->inputcollid,
+						COERCE_EXPLICIT_CALL);
+}
+
+/*
+ * codegen_array_lookup_expression
+ *
+ * It generates a device function that probes the kern_array_lookup by
+ * binary search, if ScalarArrayOpExpr is eligible. Elements are sorted
+ * by the btree comparison function of the type, thus, it is consistent
+ * to the equality operator of the type.
+ */
+static bool
+codegen_array_lookup_expression(ScalarArrayOpExpr *opexpr,
+								codegen_context *context)
+{
+	FuncExpr	   *lookup_key;
+	devexpr_info	devexpr;
+	devtype_info   *dtype;
+	devfunc_info   *dfunc;
+	devfunc_info   *dfunc_eq;
+	ListCell	   *cell;
+	StringInfoData	decl;
+	cl_uint			index = 0;
+
+	lookup_key = make_array_lookup_key(opexpr);
+	if (!lookup_key)
+		return false;
+
+	dtype = pgstrom_devtype_lookup(exprType(linitial(opexpr->args)));
+	dfunc_eq = pgstrom_devfunc_lookup(dtype->type_eqfunc,
+									  opexpr->inputcollid);
+	if (!dfunc_eq || !dfunc_eq->func_is_strict)
+		return false;
+	dfunc = pgstrom_devfunc_lookup_and_track(dtype->type_cmpfunc,
+											 opexpr->inputcollid,
+											 context);
+	if (!dfunc)
+		return false;
+	if (!pgstrom_devtype_lookup_and_track(dtype->type_oid, context))
+		elog(ERROR, "codegen: failed to lookup device type: %s",
+			 format_type_be(dtype->type_oid));
+
+	/* find out identical predefined device ScalarArrayOpExpr */
+	foreach (cell, context->expr_defs)
+	{
+		deform_devexpr_info(&devexpr, (List *)lfirst(cell));
+
+		if (devexpr.expr_tag == T_ScalarArrayOpExpr &&
+			devexpr.expr_rettype->type_oid == BOOLOID &&
+			devexpr.expr_collid == opexpr->inputcollid &&
+			list_length(devexpr.expr_args) == 2 &&
+			((devtype_info *)lsecond(devexpr.expr_args))->type_oid
+				== INT4OID &&
+			devexpr.expr_extra1 == ObjectIdGetDatum(opexpr->opno) &&
+			devexpr.expr_extra2 == BoolGetDatum(opexpr->useOr))
+			break;		/* OK, found a predefined one */
+	}
+
+	if (!cell)
+	{
+		memset(&devexpr, 0, sizeof(devexpr_info));
+		devexpr.expr_tag = T_ScalarArrayOpExpr;
+		devexpr.expr_collid = opexpr->inputcollid;
+		devexpr.expr_args = list_make2(dtype,
+									   pgstrom_devtype_lookup(INT4OID));
+		devexpr.expr_rettype = pgstrom_devtype_lookup(BOOLOID);
+		if (!lsecond(devexpr.expr_args) || !devexpr.expr_rettype)
+			elog(ERROR, "codegen: failed to lookup int4 or bool device type");
+		devexpr.expr_extra1 = ObjectIdGetDatum(opexpr->opno);
+		devexpr.expr_extra2 = BoolGetDatum(opexpr->useOr);
+		/* device function name */
+		devexpr.expr_name = psprintf("%s_%s_lookup",
+									 get_func_name(get_opcode(opexpr->opno)),
+									 opexpr->useOr ? "any" : "all");
+		/* device function declaration */
+		initStringInfo(&decl);
+		appendStringInfo(
+			&decl,
+			"STATIC_INLINE(pg_bool_t)\n"
+			"pgfn_%s(kern_context *kcxt, pg_%s_t scalar, cl_uint lookup_id)\n"
+			"{\n"
+			"  kern_array_lookup *alookup = (kern_array_lookup *)\n"
+			"    kparam_get_value(kcxt->kparams, lookup_id);\n"
+			"  pg_bool_t  result;\n"
+			"  pg_%s_t    temp;\n"
+			"  pg_int4_t  rv;\n"
+			"  cl_uint    l, r, m;\n"
+			"\n"
+			"  /* NULL result to NULL array or NULL scalar */\n"
+			"  result.isnull = true;\n"
+			"  result.value  = false;\n"
+			"  if (!alookup)\n"
+			"    return result;\n"
+			"  /* empty array makes a constant result, even if NULL scalar */\n"
+			"  if (alookup->nitems == 0 && !alookup->has_null)\n"
+			"  {\n"
+			"    result.isnull = false;\n"
+			"    result.value  = %s;\n"
+			"    return result;\n"
+			"  }\n"
+			"  if (scalar.isnull)\n"
+			"    return result;\n"
+			"\n"
+			"  /* binary search on the sorted elements */\n"
+			"  l = 0;\n"
+			"  r = alookup->nitems;\n"
+			"  while (l < r)\n"
+			"  {\n"
+			"    m = l + (r - l) / 2;\n"
+			"    temp = pg_%s_datum_ref(kcxt, alookup->values + %u * m, false);\n"
+			"    rv = pgfn_%s(kcxt, temp, scalar);\n"
+			"    if (rv.isnull)\n"
+			"      return result;\n"
+			"    if (rv.value == 0)\n"
+			"    {\n"
+			"      result.isnull = false;\n"
+			"      result.value  = %s;\n"
+			"      return result;\n"
+			"    }\n"
+			"    if (rv.value < 0)\n"
+			"      l = m + 1;\n"
+			"    else\n"
+			"      r = m;\n"
+			"  }\n"
+			"  /* not found, but NULL element makes the result unknown */\n"
+			"  if (!alookup->has_null)\n"
+			"  {\n"
+			"    result.isnull = false;\n"
+			"    result.value  = %s;\n"
+			"  }\n"
+			"  return result;\n"
+			"}\n",
+			devexpr.expr_name,
+			dtype->type_name,
+			dtype->type_name,
+			opexpr->useOr ? "false" : "true",
+			dtype->type_name,
+			(cl_uint) TYPEALIGN(dtype->type_align, dtype->type_length),
+			dfunc->func_devname,
+			opexpr->useOr ? "true" : "false",
+			opexpr->useOr ? "false" : "true");
+		devexpr.expr_decl = decl.data;
+
+		/* remember this special device function */
+		context->expr_defs = lappend(context->expr_defs,
+									 form_devexpr_info(&devexpr));
+	}
+
+	/*
+	 * The lookup key is not referenced as KPARAM_n, so it is not added
+	 * to the param_refs.
+	 */
+	foreach (cell, context->used_params)
+	{
+		if (equal(lookup_key, lfirst(cell)))
+			break;
+		index++;
+	}
+	if (!cell)
+		context->used_params = lappend(context->used_params, lookup_key);
+
+	/* write out this special expression */
+	appendStringInfo(&context->str, "pgfn_%s(kcxt, ", devexpr.expr_name);
+	codegen_expression_walker(linitial(opexpr->args), context);
+	appendStringInfo(&context->str, ", %u)", index);
+
+	return true;
+}
+
 static void
 codegen_scalar_array_op_expression(ScalarArrayOpExpr *opexpr,
 								   codegen_context *context)
@@ -2049,6 +2405,10 @@ codegen_scalar_array_op_expression(ScalarArrayOpExpr *opexpr,
 	ListCell	   *cell;
 	StringInfoData	decl;
 
+	/* large constant array can be probed by binary search */
+	if (codegen_array_lookup_expression(opexpr, context))
+		return;
+
 	/* find out identical predefined device ScalarArrayOpExpr */
 	foreach (cell, context->expr_defs)
 	{
@@ -2058,6 +2418,7 @@ codegen_scalar_array_op_expression(ScalarArrayOpExpr *opexpr,
 			devexpr.expr_rettype->type_oid == BOOLOID &&
 			devexpr.expr_collid == opexpr->inputcollid &&
 			list_length(devexpr.expr_args) == 2 &&
+			((devtype_info *)lsecond(devexpr.expr_args))->type_element &&
 			devexpr.expr_extra1 == ObjectIdGetDatum(opexpr->opno) &&
 			devexpr.expr_extra2 == BoolGetDatum(opexpr->useOr))
 			goto found;		/* OK, found a predefined one */
@@ -2243,6 +2604,177 @@ found:
 	appendStringInfo(&context->str, ")");
 }
 
+/*
+ * Common sub-expression elimination
+ *
+ * A device function evaluates the expressions for each row, but the same
+ * sub-expression may appear multiple times, like 'price * qty' in both of
+ * qualifier and projection. pgstrom_codegen_cse_prepare() picks up these
+ * sub-expressions from the expressions to be evaluated in a particular
+ * device function, then the code generator replaces them by references
+ * to KEXP_n; declared and initialized by pgstrom_codegen_cse_declarations()
+ * once per row, prior to the evaluation.
+ *
+ * Sub-expressions under the conditional branches of CaseExpr are not
+ * picked up, because they might not be evaluated at all. Volatile
+ * functions are also not, of course.
+ */
+typedef struct
+{
+	List	   *exprs;		/* candidate sub-expressions */
+	List	   *counts;		/* number of appearance of the candidate */
+} cse_collect_context;
+
+static bool
+cse_collect_walker(Node *node, cse_collect_context *context)
+{
+	if (node == NULL)
+		return false;
+
+	if ((IsA(node, FuncExpr) ||
+		 IsA(node, OpExpr) ||
+		 IsA(node, DistinctExpr) ||
+		 IsA(node, CoalesceExpr) ||
+		 IsA(node, MinMaxExpr) ||
+		 IsA(node, CaseExpr) ||
+		 IsA(node, ScalarArrayOpExpr)) &&
+		!contain_volatile_functions(node))
+	{
+		ListCell   *lc1;
+		ListCell   *lc2;
+
+		forboth (lc1, context->exprs, lc2, context->counts)
+		{
+			if (equal(node, lfirst(lc1)))
+			{
+				/* its sub-expressions are already counted */
+				lfirst_int(lc2)++;
+				return false;
+			}
+		}
+		context->exprs = lappend(context->exprs, node);
+		context->counts = lappend_int(context->counts, 1);
+	}
+
+	if (IsA(node, CaseExpr))
+	{
+		CaseExpr   *caseexpr = (CaseExpr *) node;
+		CaseWhen   *casewhen;
+
+		/* only the first condition is always evaluated */
+		if (cse_collect_walker((Node *) caseexpr->arg, context))
+			return true;
+		if (caseexpr->args == NIL)
+			return false;
+		casewhen = (CaseWhen *) linitial(caseexpr->args);
+		Assert(IsA(casewhen, CaseWhen));
+		return cse_collect_walker((Node *) casewhen->expr, context);
+	}
+	return expression_tree_walker(node, cse_collect_walker, context);
+}
+
+void
+pgstrom_codegen_cse_prepare(codegen_context *context, List *exprs)
+{
+	cse_collect_context	cse_context;
+	ListCell   *lc1;
+	ListCell   *lc2;
+
+	context->cse_exprs = NIL;
+	context->cse_decls = NIL;
+	context->cse_refs = NULL;
+	context->cse_bypass = NULL;
+
+	memset(&cse_context, 0, sizeof(cse_collect_context));
+	cse_collect_walker((Node *) exprs, &cse_context);
+
+	forboth (lc1, cse_context.exprs, lc2, cse_context.counts)
+	{
+		if (lfirst_int(lc2) > 1)
+			context->cse_exprs = lappend(context->cse_exprs,
+										 copyObject(lfirst(lc1)));
+	}
+}
+
+/*
+ * codegen_common_subexpr
+ *
+ * It writes out a reference to KEXP_n if the supplied node is one of the
+ * common sub-expressions. Code to initialize KEXP_n is generated on the
+ * first reference, so KEXP_n referenced by others is always declared
+ * prior to them.
+ */
+static bool
+codegen_common_subexpr(Node *node, codegen_context *context)
+{
+	ListCell   *lc;
+	cl_uint		index = 0;
+
+	if (node == context->cse_bypass)
+	{
+		context->cse_bypass = NULL;
+		return false;
+	}
+
+	foreach (lc, context->cse_exprs)
+	{
+		if (equal(node, lfirst(lc)))
+			break;
+		index++;
+	}
+	if (!lc)
+		return false;
+
+	if (!bms_is_member(index, context->cse_refs))
+	{
+		StringInfoData	str_saved = context->str;
+		devtype_info   *dtype;
+		Oid				type_oid = exprType(node);
+
+		dtype = pgstrom_devtype_lookup_and_track(type_oid, context);
+		if (!dtype)
+			elog(ERROR, "codegen: faied to lookup device type: %s",
+				 format_type_be(type_oid));
+
+		initStringInfo(&context->str);
+		context->cse_bypass = node;
+		codegen_expression_walker(node, context);
+		context->cse_decls =
+			lappend(context->cse_decls,
+					makeString(psprintf("  pg_%s_t KEXP_%u = %s;\n",
+										dtype->type_name,
+										index,
+										context->str.data)));
+		pfree(context->str.data);
+		context->str = str_saved;
+		context->cse_refs = bms_add_member(context->cse_refs, index);
+	}
+	appendStringInfo(&context->str, "KEXP_%u", index);
+
+	return true;
+}
+
+/*
+ * pgstrom_codegen_cse_declarations
+ *
+ * It declares KEXP_n referenced in the current device function, then
+ * resets the common sub-expressions, because KEXP_n is a local variable
+ * of the device function.
+ */
+void
+pgstrom_codegen_cse_declarations(StringInfo buf, codegen_context *context)
+{
+	ListCell   *lc;
+
+	foreach (lc, context->cse_decls)
+		appendStringInfoString(buf, strVal(lfirst(lc)));
+
+	context->cse_exprs = NIL;
+	context->cse_decls = NIL;
+	context->cse_refs = NULL;
+	context->cse_bypass = NULL;
+}
+
 char *
 pgstrom_codegen_expression(Node *expr, codegen_context *context)
 {
@@ -2260,6 +2792,10 @@ pgstrom_codegen_expression(Node *expr, codegen_context *context)
 	walker_context.kds_index_label = context->kds_index_label;
 	walker_context.extra_flags = context->extra_flags;
 	walker_context.pseudo_tlist = context->pseudo_tlist;
+	walker_context.cse_exprs = context->cse_exprs;
+	walker_context.cse_decls = list_copy(context->cse_decls);
+	walker_context.cse_refs = bms_copy(context->cse_refs);
+	walker_context.cse_bypass = NULL;
 
 	if (IsA(expr, List))
 	{
@@ -2276,6 +2812,8 @@ pgstrom_codegen_expression(Node *expr, codegen_context *context)
 	context->used_params = walker_context.used_params;
 	context->used_vars = walker_context.used_vars;
 	context->param_refs = walker_context.param_refs;
+	context->cse_decls = walker_context.cse_decls;
+	context->cse_refs = walker_context.cse_refs;
 	/* no need to write back xxx_label fields because read-only */
 	context->extra_flags = walker_context.extra_flags;
 
@@ -2482,8 +3020,12 @@ pgstrom_device_expression(Expr *expr)
 	{
 		Param		   *param = (Param *) expr;
 
-		/* only PARAM_EXTERN, right now */
-		if (param->paramkind != PARAM_EXTERN)
+		/*
+		 * PARAM_EXTERN, or PARAM_EXEC (e.g. result of InitPlan); being
+		 * evaluated once on the first fetch after startup or rescan.
+		 */
+		if (param->paramkind != PARAM_EXTERN &&
+			param->paramkind != PARAM_EXEC)
 			goto unable_node;
 
 		/* supported types only */
@@ -2690,6 +3232,346 @@ unable_node:
 	return false;
 }
 
+/*
+ * pgstrom_fixup_cpu_fallback
+ *
+ * CPU fallback also uses the optimized evaluation chosen by the code
+ * generator. It walks on the top-level qualifiers and boolean expressions,
+ * then replaces the eligible expression states:
+ *
+ * - ScalarArrayOpExprState by ArrayLookupExprState, that probes the
+ *   kern_array_lookup on the kern_parambuf, instead of the linear walk
+ *   by ExecEvalScalarArrayOp.
+ * - FuncExprState of LIKE/NOT LIKE by TextLikeExprState, that runs the
+ *   specialized matcher according to the shape of the constant pattern.
+ */
+typedef struct
+{
+	ScalarArrayOpExprState sstate;	/* must be the first field */
+	GpuTaskState   *gts;		/* kern_params is referenced on run-time */
+	cl_uint			lookup_id;	/* index of the kern_array_lookup */
+	int16			typlen;		/* length of element type */
+	Size			stride;		/* TYPEALIGN(typalign, typlen) */
+	FmgrInfo		cmp_finfo;	/* btree comparison function */
+} ArrayLookupExprState;
+
+static Datum
+ExecEvalArrayLookup(ArrayLookupExprState *astate,
+					ExprContext *econtext,
+					bool *isNull,
+					ExprDoneCond *isDone)
+{
+	ScalarArrayOpExpr  *opexpr = (ScalarArrayOpExpr *)
+		astate->sstate.fxprstate.xprstate.expr;
+	ExprState		   *scalar_state = linitial(astate->sstate.fxprstate.args);
+	kern_array_lookup  *alookup;
+	Datum				scalar;
+	bool				scalar_isnull;
+	cl_uint				l, r, m;
+
+	if (isDone)
+		*isDone = ExprSingleResult;
+	*isNull = true;
+
+	/* NULL result to NULL array or NULL scalar */
+	scalar = ExecEvalExpr(scalar_state, econtext, &scalar_isnull, NULL);
+	alookup = kparam_get_value(astate->gts->kern_params, astate->lookup_id);
+	if (!alookup)
+		return BoolGetDatum(false);
+	/* empty array makes a constant result, even if NULL scalar */
+	if (alookup->nitems == 0 && !alookup->has_null)
+	{
+		*isNull = false;
+		return BoolGetDatum(!opexpr->useOr);
+	}
+	if (scalar_isnull)
+		return BoolGetDatum(false);
+
+	/* binary search on the sorted elements */
+	l = 0;
+	r = alookup->nitems;
+	while (l < r)
+	{
+		Datum	value;
+		int32	rv;
+
+		m = l + (r - l) / 2;
+		value = fetch_att(alookup->values + astate->stride * m,
+						  true, astate->typlen);
+		rv = DatumGetInt32(FunctionCall2Coll(&astate->cmp_finfo,
+											 opexpr->inputcollid,
+											 value, scalar));
+		if (rv == 0)
+		{
+			*isNull = false;
+			return BoolGetDatum(opexpr->useOr);
+		}
+		if (rv < 0)
+			l = m + 1;
+		else
+			r = m;
+	}
+	/* not found, but NULL element makes the result unknown */
+	if (alookup->has_null)
+		return BoolGetDatum(false);
+	*isNull = false;
+	return BoolGetDatum(!opexpr->useOr);
+}
+
+typedef struct
+{
+	FuncExprState	fstate;		/* must be the first field */
+	int				shape;		/* one of LIKE_SHAPE_* */
+	bool			negative;	/* true, if NOT LIKE */
+	text		   *pattern;	/* detoasted pattern */
+} TextLikeExprState;
+
+/* returns offset of the first occurrence of p in s, or -1 if not found */
+static int
+like_find_substring(const char *s, int slen, const char *p, int plen)
+{
+	const char *pos = s;
+	const char *tail;
+
+	if (plen == 0)
+		return 0;
+	if (slen < plen)
+		return -1;
+	tail = s + slen - plen;
+	while (pos <= tail)
+	{
+		pos = memchr(pos, p[0], tail - pos + 1);
+		if (!pos)
+			break;
+		if (memcmp(pos, p, plen) == 0)
+			return pos - s;
+		pos++;
+	}
+	return -1;
+}
+
+/* same logic as __like_match_segments in cuda_textlib.h */
+static bool
+like_match_segments(const char *s, int slen, const char *p, int plen)
+{
+	int		i, k, len, off;
+
+	/* leading segment has to match at the head */
+	for (k=0; k < plen && p[k] != '%'; k++);
+	if (k == plen)
+		return (slen == plen && memcmp(s, p, plen) == 0);
+	if (slen < k || memcmp(s, p, k) != 0)
+		return false;
+	s += k;
+	slen -= k;
+	p += k;
+	plen -= k;
+
+	/* trailing segment has to match at the tail; p[0] is '%' here */
+	for (k=plen; p[k-1] != '%'; k--);
+	len = plen - k;
+	if (slen < len || memcmp(s + slen - len, p + k, len) != 0)
+		return false;
+	slen -= len;
+	plen = k;
+
+	/* middle segments in order; p[plen-1] is '%' here */
+	i = 0;
+	while (i < plen)
+	{
+		if (p[i] == '%')
+		{
+			i++;
+			continue;
+		}
+		for (k=i; p[k] != '%'; k++);
+		len = k - i;
+		off = like_find_substring(s, slen, p + i, len);
+		if (off < 0)
+			return false;
+		s += off + len;
+		slen -= off + len;
+		i = k;
+	}
+	return true;
+}
+
+static Datum
+ExecEvalTextLike(TextLikeExprState *tstate,
+				 ExprContext *econtext,
+				 bool *isNull,
+				 ExprDoneCond *isDone)
+{
+	ExprState  *arg_state = linitial(tstate->fstate.args);
+	Datum		value;
+	text	   *t;
+	char	   *s;
+	char	   *p;
+	int			slen;
+	int			plen;
+	bool		result;
+
+	if (isDone)
+		*isDone = ExprSingleResult;
+	value = ExecEvalExpr(arg_state, econtext, isNull, NULL);
+	if (*isNull)
+		return BoolGetDatum(false);
+
+	t = DatumGetTextPP(value);
+	s = VARDATA_ANY(t);
+	slen = VARSIZE_ANY_EXHDR(t);
+	p = VARDATA_ANY(tstate->pattern);
+	plen = VARSIZE_ANY_EXHDR(tstate->pattern);
+	switch (tstate->shape)
+	{
+		case LIKE_SHAPE_EXACT:
+			result = (slen == plen && memcmp(s, p, plen) == 0);
+			break;
+		case LIKE_SHAPE_PREFIX:
+			result = (slen >= plen - 1 && memcmp(s, p, plen - 1) == 0);
+			break;
+		case LIKE_SHAPE_SUFFIX:
+			result = (slen >= plen - 1 &&
+					  memcmp(s + slen - (plen - 1), p + 1, plen - 1) == 0);
+			break;
+		case LIKE_SHAPE_INFIX:
+			result = (like_find_substring(s, slen, p + 1, plen - 2) >= 0);
+			break;
+		case LIKE_SHAPE_SEGMENTS:
+			result = like_match_segments(s, slen, p, plen);
+			break;
+		default:
+			elog(ERROR, "unexpected LIKE pattern shape: %d", tstate->shape);
+	}
+	return BoolGetDatum(result != tstate->negative);
+}
+
+static Node *
+fixup_cpu_fallback_walker(Node *node, GpuTaskState *gts, List *used_params)
+{
+	if (node == NULL)
+		return NULL;
+
+	if (IsA(node, List))
+	{
+		ListCell   *lc;
+
+		foreach (lc, (List *) node)
+			lfirst(lc) = fixup_cpu_fallback_walker(lfirst(lc),
+												   gts, used_params);
+	}
+	else if (IsA(node, BoolExprState))
+	{
+		BoolExprState  *bstate = (BoolExprState *) node;
+
+		fixup_cpu_fallback_walker((Node *) bstate->args, gts, used_params);
+	}
+	else if (IsA(node, FuncExprState))
+	{
+		FuncExprState  *fstate = (FuncExprState *) node;
+		Expr		   *expr = fstate->xprstate.expr;
+		TextLikeExprState *tstate;
+		devfunc_info   *dfunc;
+		List		   *args;
+		Const		   *pattern;
+		bool			negative;
+		int				shape;
+
+		if (IsA(expr, OpExpr))
+		{
+			OpExpr	   *op = (OpExpr *) expr;
+
+			dfunc = pgstrom_devfunc_lookup(get_opcode(op->opno),
+										   op->inputcollid);
+			args = op->args;
+		}
+		else if (IsA(expr, FuncExpr))
+		{
+			FuncExpr   *func = (FuncExpr *) expr;
+
+			dfunc = pgstrom_devfunc_lookup(func->funcid,
+										   func->inputcollid);
+			args = func->args;
+		}
+		else
+			return node;
+
+		if (!dfunc)
+			return node;
+		if (strcmp(dfunc->func_devname, "textlike") == 0)
+			negative = false;
+		else if (strcmp(dfunc->func_devname, "textnlike") == 0)
+			negative = true;
+		else
+			return node;
+		shape = like_pattern_shape(lsecond(args));
+		if (shape == LIKE_SHAPE_GENERIC)
+			return node;
+		pattern = (Const *) lsecond(args);
+
+		tstate = palloc0(sizeof(TextLikeExprState));
+		memcpy(&tstate->fstate, fstate, sizeof(FuncExprState));
+		tstate->fstate.xprstate.evalfunc =
+			(ExprStateEvalFunc) ExecEvalTextLike;
+		tstate->shape = shape;
+		tstate->negative = negative;
+		tstate->pattern = DatumGetTextPP(pattern->constvalue);
+
+		return (Node *) tstate;
+	}
+	else if (IsA(node, ScalarArrayOpExprState))
+	{
+		ScalarArrayOpExprState *sstate = (ScalarArrayOpExprState *) node;
+		ScalarArrayOpExpr  *opexpr = (ScalarArrayOpExpr *)
+			sstate->fxprstate.xprstate.expr;
+		ArrayLookupExprState *astate;
+		FuncExpr		   *lookup_key;
+		ListCell		   *lc;
+		cl_uint				index = 0;
+		int16				typlen;
+		bool				typbyval;
+		char				typalign;
+
+		lookup_key = make_array_lookup_key(opexpr);
+		if (!lookup_key)
+			return node;
+		foreach (lc, used_params)
+		{
+			if (equal(lookup_key, lfirst(lc)))
+				break;
+			index++;
+		}
+		if (!lc)
+			return node;	/* device code walks on the array linearly */
+
+		get_typlenbyvalalign(exprType(linitial(opexpr->args)),
+							 &typlen, &typbyval, &typalign);
+		Assert(typlen > 0 && typbyval);
+
+		astate = palloc0(sizeof(ArrayLookupExprState));
+		memcpy(&astate->sstate, sstate, sizeof(ScalarArrayOpExprState));
+		astate->sstate.fxprstate.xprstate.evalfunc =
+			(ExprStateEvalFunc) ExecEvalArrayLookup;
+		astate->gts = gts;
+		astate->lookup_id = index;
+		astate->typlen = typlen;
+		astate->stride = att_align_nominal(typlen, typalign);
+		fmgr_info(lookup_key->funcid, &astate->cmp_finfo);
+
+		return (Node *) astate;
+	}
+	return node;
+}
+
+List *
+pgstrom_fixup_cpu_fallback(List *exprstates,
+						   GpuTaskState *gts,
+						   List *used_params)
+{
+	return (List *) fixup_cpu_fallback_walker((Node *) exprstates,
+											  gts, used_params);
+}
+
 static void
 codegen_cache_invalidator(Datum arg, int cacheid, uint32 hashvalue)
 {
@@ -845,6 +845,23 @@ pointer_on_kparams(void *ptr, kern_parambuf *kparams)
 					   (char *)ptr <  (char *)kparams + kparams->length);
 }
 
+/*
+ * kern_array_lookup
+ *
+ * A sorted and de-duplicated set of array elements, built on the host side
+ * once per query from a Const/Param array of ScalarArrayOpExpr, and put on
+ * the kern_parambuf. Non-NULL elements of fixed-length and pass-by-value
+ * type are stored with TYPEALIGN(typalign, typlen) stride, so device code
+ * and CPU fallback can probe it by binary search.
+ */
+typedef struct kern_array_lookup
+{
+	cl_uint		nitems;		/* number of non-NULL unique elements */
+	cl_bool		has_null;	/* true, if source array contains NULL */
+	cl_char		__padding__[3];
+	cl_char		values[FLEXIBLE_ARRAY_MEMBER];
+} kern_array_lookup;
+
 /*
  * kern_resultbuf
  *
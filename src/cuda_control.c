@@ -28,8 +28,8 @@
 #include "storage/procsignal.h"
 #include "utils/builtins.h"
 #include "utils/guc.h"
+#include "utils/hsearch.h"
 #include "utils/memutils.h"
-#include "utils/pg_crc.h"
 #include "utils/resowner.h"
 #include <math.h>
 #include "pg_strom.h"
@@ -61,17 +61,36 @@ static shmem_startup_hook_type shmem_startup_next;
  *
  * ----------------------------------------------------------------
  */
+#define GPUSCHED_CLASS_INTERACTIVE		0
+#define GPUSCHED_CLASS_BATCH			1
+#define GPUSCHED_NUM_CLASSES			2
+#define GPUSCHED_MAX_WAITERS			64
+
 typedef struct {
 	cl_uint				num_devices;	/* never updated */
 	pg_atomic_uint32	num_gcontext;	/* total number of GpuContext */
+	/* device scheduler; fields below are protected by sched_lock */
+	slock_t				sched_lock;
+	cl_uint				sched_num_gcontext[GPUSCHED_NUM_CLASSES];
+	cl_ulong			sched_total_weight;
+	/* backends waiting for release of device resources */
+	pg_atomic_uint32	sched_release_gen;	/* bumped on every release */
+	pg_atomic_uint32	sched_num_waiters;
+	cl_int				sched_waiters[GPUSCHED_MAX_WAITERS]; /* pgprocno+1,
+															  * or 0 */
 	struct {
 		cl_ulong			gmem_size;	/* never updated */
 		pg_atomic_uint64	gmem_used;	/* total amount of DRAM usage */
+		pg_atomic_uint64	gmem_active; /* total size of active chunks */
+		cl_uint				num_tasks;	/* number of admitted tasks */
+		cl_uint				num_batch_tasks; /* ...by batch class */
 	} gpu[FLEXIBLE_ARRAY_MEMBER];
 } GpuScoreBoard;
 
 static GpuScoreBoard	   *gpuScoreBoard;
 
+static void gpusched_wakeup_waiters(void);
+
 #define GpuScoreCurrNumContext()				\
 	pg_atomic_read_u32(&gpuScoreBoard->num_gcontext)
 #define GpuScoreCurrMemUsage(cuda_index)		\
@@ -87,57 +106,634 @@ static GpuScoreBoard	   *gpuScoreBoard;
 		pg_atomic_fetch_sub_u64(&gpuScoreBoard->gpu[(cuda_index)].gmem_used, \
 								(size));					\
 		(gcontext)->gpu[(cuda_index)].gmem_used -= (size);	\
+		gpusched_wakeup_waiters();							\
 	} while(0)
 
+/* ----------------------------------------------------------------
+ *
+ * Routines of the device scheduler shared by all the backends
+ *
+ * Each GpuTask has to be admitted prior to its launch on a device.
+ * A GpuContext is guaranteed to have its share of the device queues,
+ * in proportion to pg_strom.device_weight, and it can use the queue
+ * slots more than the share unless the device queue is saturated.
+ * The slots reserved for the interactive class are not available to
+ * the batch class while any interactive GpuContext exists.
+ * Per-database or per-role weights and classes are configured using
+ * ALTER DATABASE/ROLE ... SET.
+ *
+ * ----------------------------------------------------------------
+ */
+static const struct config_enum_entry gpusched_class_options[] = {
+	{"interactive",	GPUSCHED_CLASS_INTERACTIVE,	false},
+	{"batch",		GPUSCHED_CLASS_BATCH,		false},
+	{NULL, 0, false}
+};
+static int		gpusched_device_queue_depth;	/* GUC */
+static int		gpusched_interactive_reserve;	/* GUC */
+static int		gpusched_device_weight;			/* GUC */
+static int		gpusched_device_priority;		/* GUC */
+static int		gpusched_waiter_slot = -1;		/* my slot in sched_waiters */
+
+static void
+gpusched_register_gpucontext(GpuContext *gcontext)
+{
+	gcontext->sched_class = gpusched_device_priority;
+	gcontext->sched_weight = gpusched_device_weight;
+
+	SpinLockAcquire(&gpuScoreBoard->sched_lock);
+	gpuScoreBoard->sched_num_gcontext[gcontext->sched_class]++;
+	gpuScoreBoard->sched_total_weight += gcontext->sched_weight;
+	SpinLockRelease(&gpuScoreBoard->sched_lock);
+}
+
+static void
+gpusched_unregister_gpucontext(GpuContext *gcontext)
+{
+	int		i;
+
+	SpinLockAcquire(&gpuScoreBoard->sched_lock);
+	gpuScoreBoard->sched_num_gcontext[gcontext->sched_class]--;
+	gpuScoreBoard->sched_total_weight -= gcontext->sched_weight;
+	/* admission by orphan tasks, if any */
+	for (i=0; i < gcontext->num_context; i++)
+	{
+		cl_uint		num_admitted = gcontext->gpu[i].num_admitted;
+
+		Assert(gpuScoreBoard->gpu[i].num_tasks >= num_admitted);
+		gpuScoreBoard->gpu[i].num_tasks -= num_admitted;
+		if (gcontext->sched_class == GPUSCHED_CLASS_BATCH)
+			gpuScoreBoard->gpu[i].num_batch_tasks -= num_admitted;
+		gcontext->gpu[i].num_admitted = 0;
+	}
+	SpinLockRelease(&gpuScoreBoard->sched_lock);
+}
+
+/*
+ * gpusched_admit_task
+ *
+ * It admits a GpuTask to run on the least loaded device (or on the device
+ * given by cuda_index, if not UINT_MAX), then returns the index of the
+ * device. If device queues are saturated and the GpuContext already
+ * consumes its fair share, it returns -1; caller has to keep the task
+ * pending and retry later.
+ */
+static int
+gpusched_admit_task(GpuContext *gcontext, cl_uint cuda_index)
+{
+	cl_uint		num_devices = gcontext->num_context;
+	cl_uint		queue_depth = gpusched_device_queue_depth;
+	cl_uint		num_admitted = 0;
+	cl_uint		fair_share;
+	cl_uint		limit;
+	int			i, j, index = -1;
+
+	for (i=0; i < num_devices; i++)
+		num_admitted += gcontext->gpu[i].num_admitted;
+
+	SpinLockAcquire(&gpuScoreBoard->sched_lock);
+	fair_share = (((cl_ulong) queue_depth * num_devices *
+				   gcontext->sched_weight) /
+				  Max(gpuScoreBoard->sched_total_weight, 1));
+	fair_share = Max(fair_share, 1);
+	limit = queue_depth;
+	if (gcontext->sched_class == GPUSCHED_CLASS_BATCH &&
+		gpuScoreBoard->sched_num_gcontext[GPUSCHED_CLASS_INTERACTIVE] > 0)
+		limit -= (queue_depth * gpusched_interactive_reserve) / 100;
+
+	for (j=0; j < num_devices; j++)
+	{
+		cl_uint		num_tasks;
+
+		i = (gcontext->next_context + j) % num_devices;
+		if (cuda_index != UINT_MAX && i != cuda_index)
+			continue;
+		num_tasks = gpuScoreBoard->gpu[i].num_tasks;
+		if (num_tasks >= limit && num_admitted >= fair_share)
+			continue;	/* saturated, and no guaranteed share */
+
+		if (index < 0 ||
+			gpuScoreBoard->gpu[i].num_tasks <
+			gpuScoreBoard->gpu[index].num_tasks ||
+			(gpuScoreBoard->gpu[i].num_tasks ==
+			 gpuScoreBoard->gpu[index].num_tasks &&
+			 GpuScoreCurrMemUsage(i) < GpuScoreCurrMemUsage(index)))
+			index = i;
+	}
+	if (index >= 0)
+	{
+		gpuScoreBoard->gpu[index].num_tasks++;
+		if (gcontext->sched_class == GPUSCHED_CLASS_BATCH)
+			gpuScoreBoard->gpu[index].num_batch_tasks++;
+	}
+	SpinLockRelease(&gpuScoreBoard->sched_lock);
+
+	if (index >= 0)
+	{
+		gcontext->gpu[index].num_admitted++;
+		gcontext->next_context = index + 1;
+	}
+	return index;
+}
+
+/*
+ * gpusched_release_task
+ *
+ * It returns the queue slot of the device admitted to the GpuTask
+ */
+static void
+gpusched_release_task(GpuTask *gtask)
+{
+	GpuContext *gcontext = gtask->gts->gcontext;
+	int			index = gtask->sched_index;
+
+	if (index < 0)
+		return;
+	Assert(gcontext && index < gcontext->num_context);
+
+	SpinLockAcquire(&gpuScoreBoard->sched_lock);
+	Assert(gpuScoreBoard->gpu[index].num_tasks > 0);
+	gpuScoreBoard->gpu[index].num_tasks--;
+	if (gcontext->sched_class == GPUSCHED_CLASS_BATCH)
+		gpuScoreBoard->gpu[index].num_batch_tasks--;
+	SpinLockRelease(&gpuScoreBoard->sched_lock);
+
+	Assert(gcontext->gpu[index].num_admitted > 0);
+	gcontext->gpu[index].num_admitted--;
+	gtask->sched_index = -1;
+
+	gpusched_wakeup_waiters();
+}
+
+/*
+ * gpusched_release_generation
+ *
+ * It returns the generation of resource release events. Caller saves it
+ * prior to the attempt to launch tasks, then gives it to the wait routine
+ * not to miss the release events in between.
+ */
+static inline cl_uint
+gpusched_release_generation(void)
+{
+	return pg_atomic_read_u32(&gpuScoreBoard->sched_release_gen);
+}
+
+/*
+ * gpusched_(register|unregister)_waiter
+ *
+ * A backend that keeps tasks pending due to lack of device resources
+ * registers itself, to be woken up by the backend which releases them.
+ * If no slot is available, caller falls back to the timeout polling.
+ */
+static bool
+gpusched_register_waiter(void)
+{
+	int		i;
+
+	if (gpusched_waiter_slot >= 0)
+		return true;
+
+	SpinLockAcquire(&gpuScoreBoard->sched_lock);
+	for (i=0; i < GPUSCHED_MAX_WAITERS; i++)
+	{
+		if (gpuScoreBoard->sched_waiters[i] == 0)
+		{
+			gpuScoreBoard->sched_waiters[i] = MyProc->pgprocno + 1;
+			pg_atomic_fetch_add_u32(&gpuScoreBoard->sched_num_waiters, 1);
+			gpusched_waiter_slot = i;
+			break;
+		}
+	}
+	SpinLockRelease(&gpuScoreBoard->sched_lock);
+
+	return (gpusched_waiter_slot >= 0);
+}
+
+static void
+gpusched_unregister_waiter(void)
+{
+	if (gpusched_waiter_slot < 0)
+		return;
+
+	SpinLockAcquire(&gpuScoreBoard->sched_lock);
+	Assert(gpuScoreBoard->sched_waiters[gpusched_waiter_slot] ==
+		   MyProc->pgprocno + 1);
+	gpuScoreBoard->sched_waiters[gpusched_waiter_slot] = 0;
+	pg_atomic_fetch_sub_u32(&gpuScoreBoard->sched_num_waiters, 1);
+	SpinLockRelease(&gpuScoreBoard->sched_lock);
+	gpusched_waiter_slot = -1;
+}
+
+/*
+ * gpusched_wakeup_waiters
+ *
+ * It notifies the waiters that device resources were released.
+ */
+static void
+gpusched_wakeup_waiters(void)
+{
+	cl_int		procnos[GPUSCHED_MAX_WAITERS];
+	int			i, nitems = 0;
+
+	pg_atomic_fetch_add_u32(&gpuScoreBoard->sched_release_gen, 1);
+	if (pg_atomic_read_u32(&gpuScoreBoard->sched_num_waiters) == 0)
+		return;
+
+	SpinLockAcquire(&gpuScoreBoard->sched_lock);
+	for (i=0; i < GPUSCHED_MAX_WAITERS; i++)
+	{
+		if (gpuScoreBoard->sched_waiters[i] != 0)
+			procnos[nitems++] = gpuScoreBoard->sched_waiters[i] - 1;
+	}
+	SpinLockRelease(&gpuScoreBoard->sched_lock);
+
+	for (i=0; i < nitems; i++)
+	{
+		if (procnos[i] != MyProc->pgprocno)
+			SetLatch(&ProcGlobal->allProcs[procnos[i]].procLatch);
+	}
+}
+
 /* ----------------------------------------------------------------
  *
  * Routines to support lightwight userspace device memory allocator
  *
  * ----------------------------------------------------------------
  */
+/*
+ * The device memory allocator is a two-level segregated fit (TLSF) on
+ * the device memory blocks acquired by cuMemAlloc(). The first level
+ * of free lists is classified by power of two of the chunk size, and the
+ * second level splits each class into GPUMEM_SL_COUNT ranges. Both of
+ * allocation and release are O(1) with immediate coalescing of the
+ * neighbor free chunks.
+ *
+ * The core routines (gpuMemCore*) handle device address as a plain
+ * integer and never call CUDA API. Even though, they are static and
+ * depend on elog(), dynahash and MemoryContext of the backend, so no unit
+ * test or benchmark drives them apart from the regression test by SQL.
+ */
 typedef struct GpuMemBlock
 {
 	dlist_node		chain;			/* link to active/unused_blocks */
 	CUdeviceptr		block_addr;		/* head of device address */
 	size_t			block_size;		/* length of the block */
-	size_t			max_free_size;	/* max available space in this block */
 	dlist_head		addr_chunks;	/* chunks in order of address */
-	dlist_head		free_chunks;	/* free chunks */
 } GpuMemBlock;
 
 typedef struct GpuMemChunk
 {
 	GpuMemBlock	   *gm_block;	/* memory block this chunk belong to */
 	dlist_node		addr_chain;	/* link to addr_chunks */
-	dlist_node		free_chain;	/* link to free_chunks, or zero if active */
-	dlist_node		hash_chain;	/* link to hash_table, or zero if free  */
+	dlist_node		free_chain;	/* link to free_lists, or zero if active */
 	CUdeviceptr		chunk_addr;
 	size_t			chunk_size;
 } GpuMemChunk;
 
+typedef struct
+{
+	CUdeviceptr		chunk_addr;	/* hash key */
+	GpuMemChunk	   *gm_chunk;
+} GpuMemChunkEntry;
+
+#define GPUMEM_MIN_SHIFT	10		/* 1KB; unit of allocation */
+
 static inline void
 gpuMemHeadInit(GpuMemHead *gm_head)
 {
-	int		i;
+	int		i, j;
 
+	memset(gm_head, 0, sizeof(GpuMemHead));
 	gm_head->empty_block = NULL;
 	dlist_init(&gm_head->active_blocks);
 	dlist_init(&gm_head->unused_chunks);
 	dlist_init(&gm_head->unused_blocks);
-	for (i=0; i < lengthof(gm_head->hash_slots); i++)
-		dlist_init(&gm_head->hash_slots[i]);
+	for (i=0; i < GPUMEM_FL_COUNT; i++)
+	{
+		for (j=0; j < GPUMEM_SL_COUNT; j++)
+			dlist_init(&gm_head->free_lists[i][j]);
+	}
+}
+
+/*
+ * gpuMemCoreMapping
+ *
+ * It maps the chunk size onto the index of free lists. If round_up,
+ * size is rounded up to the next class, so any chunk in the list is
+ * large enough to the request. It returns false if the size is beyond
+ * the largest class.
+ */
+static inline bool
+gpuMemCoreMapping(size_t chunk_size, bool round_up, int *p_fl, int *p_sl)
+{
+	size_t		units = chunk_size >> GPUMEM_MIN_SHIFT;
+	int			shift;
+
+	Assert(units > 0);
+	if (units < GPUMEM_SL_COUNT)
+	{
+		*p_fl = 0;
+		*p_sl = units;
+		return true;
+	}
+	shift = (sizeof(size_t) * BITS_PER_BYTE - 1 - __builtin_clzl(units));
+	if (round_up)
+	{
+		units += (1UL << (shift - GPUMEM_SL_SHIFT)) - 1;
+		shift = (sizeof(size_t) * BITS_PER_BYTE - 1 - __builtin_clzl(units));
+	}
+	*p_fl = shift - GPUMEM_SL_SHIFT + 1;
+	*p_sl = (units >> (shift - GPUMEM_SL_SHIFT)) - GPUMEM_SL_COUNT;
+
+	return (*p_fl < GPUMEM_FL_COUNT);
+}
+
+static void
+gpuMemCoreInsertFree(GpuMemHead *gm_head, GpuMemChunk *gm_chunk)
+{
+	int		fl, sl;
+
+	if (!gpuMemCoreMapping(gm_chunk->chunk_size, false, &fl, &sl))
+		elog(ERROR, "Bug? GpuMemChunk is too large (%zu)",
+			 gm_chunk->chunk_size);
+	dlist_push_head(&gm_head->free_lists[fl][sl], &gm_chunk->free_chain);
+	gm_head->fl_bitmap |= (1U << fl);
+	gm_head->sl_bitmap[fl] |= (1U << sl);
+	gm_head->num_free_chunks++;
+}
+
+static void
+gpuMemCoreRemoveFree(GpuMemHead *gm_head, GpuMemChunk *gm_chunk)
+{
+	int		fl, sl;
+
+	if (!gpuMemCoreMapping(gm_chunk->chunk_size, false, &fl, &sl))
+		elog(ERROR, "Bug? GpuMemChunk is too large (%zu)",
+			 gm_chunk->chunk_size);
+	dlist_delete(&gm_chunk->free_chain);
+	memset(&gm_chunk->free_chain, 0, sizeof(dlist_node));
+	if (dlist_is_empty(&gm_head->free_lists[fl][sl]))
+	{
+		gm_head->sl_bitmap[fl] &= ~(1U << sl);
+		if (gm_head->sl_bitmap[fl] == 0)
+			gm_head->fl_bitmap &= ~(1U << fl);
+	}
+	gm_head->num_free_chunks--;
+}
+
+static GpuMemChunk *
+gpuMemCoreNewChunk(GpuMemHead *gm_head, MemoryContext memcxt)
+{
+	GpuMemChunk	   *gm_chunk;
+	dlist_node	   *dnode;
+
+	if (dlist_is_empty(&gm_head->unused_chunks))
+		gm_chunk = MemoryContextAlloc(memcxt, sizeof(GpuMemChunk));
+	else
+	{
+		dnode = dlist_pop_head_node(&gm_head->unused_chunks);
+		gm_chunk = dlist_container(GpuMemChunk, addr_chain, dnode);
+	}
+	memset(gm_chunk, 0, sizeof(GpuMemChunk));
+	return gm_chunk;
+}
+
+/*
+ * gpuMemCoreAddBlock
+ *
+ * It makes a memory block (newly allocated, or cached empty one) available
+ * for the allocation.
+ */
+static void
+gpuMemCoreAddBlock(GpuMemHead *gm_head, MemoryContext memcxt,
+				   GpuMemBlock *gm_block)
+{
+	GpuMemChunk	   *gm_chunk = gpuMemCoreNewChunk(gm_head, memcxt);
+
+	Assert(gm_block->block_size >= (1UL << GPUMEM_MIN_SHIFT));
+	dlist_init(&gm_block->addr_chunks);
+	gm_chunk->gm_block = gm_block;
+	gm_chunk->chunk_addr = gm_block->block_addr;
+	gm_chunk->chunk_size = gm_block->block_size;
+	dlist_push_head(&gm_block->addr_chunks, &gm_chunk->addr_chain);
+	gpuMemCoreInsertFree(gm_head, gm_chunk);
+
+	dlist_push_head(&gm_head->active_blocks, &gm_block->chain);
+	gm_head->total_size += gm_block->block_size;
+}
+
+/*
+ * gpuMemCoreFindFree
+ *
+ * It looks up a free chunk large enough to the request. Any chunk in the
+ * class of the rounded up size is large enough, but a chunk in the class
+ * of the request itself may also be; e.g, a block sized exactly to the
+ * request. So, the list of the request class is scanned by first-fit if
+ * no larger classes have free chunks.
+ */
+static GpuMemChunk *
+gpuMemCoreFindFree(GpuMemHead *gm_head, size_t bytesize)
+{
+	GpuMemChunk	   *gm_chunk;
+	dlist_node	   *dnode;
+	dlist_iter		iter;
+	cl_uint			bitmap;
+	int				fl, sl;
+
+	if (gpuMemCoreMapping(bytesize, true, &fl, &sl))
+	{
+		/* find a non-empty list at (fl, sl) or later */
+		bitmap = gm_head->sl_bitmap[fl] & (~0U << sl);
+		if (bitmap == 0)
+		{
+			bitmap = (fl + 1 < GPUMEM_FL_COUNT
+					  ? gm_head->fl_bitmap & (~0U << (fl + 1)) : 0);
+			if (bitmap != 0)
+			{
+				fl = __builtin_ctz(bitmap);
+				bitmap = gm_head->sl_bitmap[fl];
+				Assert(bitmap != 0);
+			}
+		}
+		if (bitmap != 0)
+		{
+			sl = __builtin_ctz(bitmap);
+			Assert(!dlist_is_empty(&gm_head->free_lists[fl][sl]));
+			dnode = dlist_head_node(&gm_head->free_lists[fl][sl]);
+			gm_chunk = dlist_container(GpuMemChunk, free_chain, dnode);
+			Assert(gm_chunk->chunk_size >= bytesize);
+			return gm_chunk;
+		}
+	}
+
+	/* first-fit on the list of the request class */
+	if (!gpuMemCoreMapping(bytesize, false, &fl, &sl))
+		return NULL;
+	dlist_foreach(iter, &gm_head->free_lists[fl][sl])
+	{
+		gm_chunk = dlist_container(GpuMemChunk, free_chain, iter.cur);
+		if (gm_chunk->chunk_size >= bytesize)
+			return gm_chunk;
+	}
+	return NULL;
 }
 
-static inline int
-gpuMemHashIndex(GpuMemHead *gm_head, CUdeviceptr chunk_addr)
+/*
+ * gpuMemCoreAlloc
+ *
+ * It allocates a chunk from the free lists, or returns 0 if no free chunk
+ * is large enough. bytesize must be aligned to the allocation unit.
+ */
+static CUdeviceptr
+gpuMemCoreAlloc(GpuMemHead *gm_head, MemoryContext memcxt, size_t bytesize)
 {
-	pg_crc32    crc;
+	GpuMemChunk	   *gm_chunk;
+	GpuMemChunkEntry *entry;
+	bool			found;
+
+	Assert(bytesize == TYPEALIGN(1UL << GPUMEM_MIN_SHIFT, bytesize));
+	gm_chunk = gpuMemCoreFindFree(gm_head, bytesize);
+	if (!gm_chunk)
+		return 0UL;
+	gpuMemCoreRemoveFree(gm_head, gm_chunk);
+
+	/* split the remaining portion, if any */
+	if (gm_chunk->chunk_size > bytesize)
+	{
+		GpuMemChunk	   *new_chunk = gpuMemCoreNewChunk(gm_head, memcxt);
+
+		new_chunk->gm_block = gm_chunk->gm_block;
+		new_chunk->chunk_addr = gm_chunk->chunk_addr + bytesize;
+		new_chunk->chunk_size = gm_chunk->chunk_size - bytesize;
+		gm_chunk->chunk_size = bytesize;
+		dlist_insert_after(&gm_chunk->addr_chain, &new_chunk->addr_chain);
+		gpuMemCoreInsertFree(gm_head, new_chunk);
+	}
 
-	INIT_LEGACY_CRC32(crc);
-	COMP_LEGACY_CRC32(crc, &chunk_addr, sizeof(CUdeviceptr));
-	FIN_LEGACY_CRC32(crc);
+	/* track the active chunk by its address */
+	if (!gm_head->chunk_htab)
+	{
+		HASHCTL		hctl;
 
-	return crc % lengthof(gm_head->hash_slots);
+		memset(&hctl, 0, sizeof(HASHCTL));
+		hctl.keysize = sizeof(CUdeviceptr);
+		hctl.entrysize = sizeof(GpuMemChunkEntry);
+		hctl.hcxt = memcxt;
+		gm_head->chunk_htab = hash_create("GpuMemChunk", 1024, &hctl,
+										  HASH_ELEM | HASH_BLOBS |
+										  HASH_CONTEXT);
+	}
+	entry = hash_search(gm_head->chunk_htab,
+						&gm_chunk->chunk_addr,
+						HASH_ENTER, &found);
+	Assert(!found);
+	entry->gm_chunk = gm_chunk;
+	gm_head->active_size += gm_chunk->chunk_size;
+	gm_head->num_active_chunks++;
+
+	return gm_chunk->chunk_addr;
+}
+
+/*
+ * gpuMemCoreFree
+ *
+ * It releases a chunk and merges it with the neighbor free chunks. If the
+ * memory block becomes empty, it is detached and returned to the caller.
+ * *p_size is set to the size of the released chunk, or 0 if unknown.
+ */
+static GpuMemBlock *
+gpuMemCoreFree(GpuMemHead *gm_head, CUdeviceptr chunk_addr, size_t *p_size)
+{
+	GpuMemChunkEntry *entry = NULL;
+	GpuMemBlock	   *gm_block;
+	GpuMemChunk	   *gm_chunk;
+	GpuMemChunk	   *gm_temp;
+	dlist_node	   *dnode;
+
+	*p_size = 0;
+	if (gm_head->chunk_htab)
+		entry = hash_search(gm_head->chunk_htab,
+							&chunk_addr,
+							HASH_FIND, NULL);
+	if (!entry)
+	{
+		elog(WARNING, "Bug? device address %p was not tracked",
+			 (void *)chunk_addr);
+		return NULL;
+	}
+	gm_chunk = entry->gm_chunk;
+	hash_search(gm_head->chunk_htab, &chunk_addr, HASH_REMOVE, NULL);
+	Assert(!gm_chunk->free_chain.prev && !gm_chunk->free_chain.next);
+	gm_head->active_size -= gm_chunk->chunk_size;
+	gm_head->num_active_chunks--;
+	*p_size = gm_chunk->chunk_size;
+
+	/* sanity check; chunks should be within block */
+	gm_block = gm_chunk->gm_block;
+	Assert(gm_chunk->chunk_addr >= gm_block->block_addr &&
+		   (gm_chunk->chunk_addr + gm_chunk->chunk_size) <=
+		   (gm_block->block_addr + gm_block->block_size));
+
+	/* merge with the previous chunk, if free */
+	if (dlist_has_prev(&gm_block->addr_chunks, &gm_chunk->addr_chain))
+	{
+		dnode = dlist_prev_node(&gm_block->addr_chunks,
+								&gm_chunk->addr_chain);
+		gm_temp = dlist_container(GpuMemChunk, addr_chain, dnode);
+		Assert(gm_temp->chunk_addr +
+			   gm_temp->chunk_size == gm_chunk->chunk_addr);
+		if (gm_temp->free_chain.prev && gm_temp->free_chain.next)
+		{
+			gpuMemCoreRemoveFree(gm_head, gm_temp);
+			gm_temp->chunk_size += gm_chunk->chunk_size;
+			dlist_delete(&gm_chunk->addr_chain);
+			/* GpuMemChunk entry may be reused soon */
+			memset(gm_chunk, 0, sizeof(GpuMemChunk));
+			dlist_push_head(&gm_head->unused_chunks, &gm_chunk->addr_chain);
+			gm_chunk = gm_temp;
+		}
+	}
+
+	/* merge with the next chunk, if free */
+	if (dlist_has_next(&gm_block->addr_chunks, &gm_chunk->addr_chain))
+	{
+		dnode = dlist_next_node(&gm_block->addr_chunks,
+								&gm_chunk->addr_chain);
+		gm_temp = dlist_container(GpuMemChunk, addr_chain, dnode);
+		Assert(gm_chunk->chunk_addr +
+			   gm_chunk->chunk_size == gm_temp->chunk_addr);
+		if (gm_temp->free_chain.prev && gm_temp->free_chain.next)
+		{
+			gpuMemCoreRemoveFree(gm_head, gm_temp);
+			gm_chunk->chunk_size += gm_temp->chunk_size;
+			dlist_delete(&gm_temp->addr_chain);
+			/* GpuMemChunk entry may be reused soon */
+			memset(gm_temp, 0, sizeof(GpuMemChunk));
+			dlist_push_head(&gm_head->unused_chunks, &gm_temp->addr_chain);
+		}
+	}
+
+	/*
+	 * If the merged chunk covers the whole block, the block is detached
+	 * from the allocator. Elsewhere, the chunk goes back to the free list.
+	 */
+	if (!dlist_has_prev(&gm_block->addr_chunks, &gm_chunk->addr_chain) &&
+		!dlist_has_next(&gm_block->addr_chunks, &gm_chunk->addr_chain))
+	{
+		Assert(gm_block->block_addr == gm_chunk->chunk_addr &&
+			   gm_block->block_size == gm_chunk->chunk_size);
+		dlist_delete(&gm_chunk->addr_chain);
+		memset(gm_chunk, 0, sizeof(GpuMemChunk));
+		dlist_push_head(&gm_head->unused_chunks, &gm_chunk->addr_chain);
+
+		dlist_delete(&gm_block->chain);
+		memset(&gm_block->chain, 0, sizeof(dlist_node));
+		gm_head->total_size -= gm_block->block_size;
+		return gm_block;
+	}
+	gpuMemCoreInsertFree(gm_head, gm_chunk);
+
+	return NULL;
 }
 
 /*
@@ -158,17 +754,15 @@ gpuMemMaxAllocSize(void)
  * For debug, it dumps all the device memory chunks
  */
 static void
-__gpuMemDump(GpuMemBlock *gm_block, bool is_active)
+__gpuMemDump(GpuMemBlock *gm_block)
 {
 	GpuMemChunk	   *gm_chunk;
 	dlist_iter		iter;
 
-	elog(INFO, "GpuMemBlock: %p - %p (size: %zu, free: %zu, %s)",
+	elog(INFO, "GpuMemBlock: %p - %p (size: %zu)",
 		 (char *)(gm_block->block_addr),
 		 (char *)(gm_block->block_addr + gm_block->block_size),
-		 gm_block->block_size,
-		 gm_block->max_free_size,
-		 is_active ? "active" : "unused");
+		 gm_block->block_size);
 
 	dlist_foreach (iter, &gm_block->addr_chunks)
 	{
@@ -191,144 +785,116 @@ gpuMemDump(GpuContext *gcontext, int cuda_index)
 	GpuMemBlock	   *gm_block;
 	dlist_iter		iter;
 
+	elog(INFO, "GpuMemHead: total %zu, active %zu (%u chunks), %u free chunks",
+		 gm_head->total_size,
+		 gm_head->active_size,
+		 gm_head->num_active_chunks,
+		 gm_head->num_free_chunks);
 	dlist_foreach (iter, &gm_head->active_blocks)
 	{
 		gm_block = dlist_container(GpuMemBlock, chain, iter.cur);
-		__gpuMemDump(gm_block, true);
+		__gpuMemDump(gm_block);
 	}
 	if (gm_head->empty_block)
-		__gpuMemDump(gm_head->empty_block, false);
+		elog(INFO, "GpuMemBlock: %p - %p (size: %zu, cached)",
+			 (char *)(gm_head->empty_block->block_addr),
+			 (char *)(gm_head->empty_block->block_addr +
+					  gm_head->empty_block->block_size),
+			 gm_head->empty_block->block_size);
 }
 
-#ifdef NOT_USED
+/*
+ * __gpuMemReleaseBlock
+ *
+ * It releases a device memory block by cuMemFree.
+ */
 static void
-__gpuMemSanityCheck(GpuMemHead *gm_head, GpuMemBlock *gm_block)
+__gpuMemReleaseBlock(GpuContext *gcontext, int cuda_index,
+					 GpuMemBlock *gm_block)
 {
-	GpuMemChunk	   *gm_chunk;
-	GpuMemChunk	   *gm_temp;
-	dlist_iter		iter;
-	dlist_iter		hiter;
-	CUdeviceptr		curr_addr = gm_block->block_addr;
+	GpuMemHead	   *gm_head = &gcontext->gpu[cuda_index].cuda_memory;
+	CUresult		rc;
+	struct timeval	tv1, tv2;
 
-	dlist_foreach (iter, &gm_block->addr_chunks)
-	{
-		gm_chunk = dlist_container(GpuMemChunk, addr_chain, iter.cur);
-		Assert(gm_chunk->chunk_addr == curr_addr);
-		curr_addr += gm_chunk->chunk_size;
-		Assert(curr_addr <= gm_block->block_addr + gm_block->block_size);
+	gettimeofday(&tv1, NULL);
 
-		if (gm_chunk->hash_chain.prev && gm_chunk->hash_chain.next)
-		{
-			int		index = gpuMemHashIndex(gm_head, gm_chunk->chunk_addr);
-			bool	found = false;
+	rc = cuCtxPushCurrent(gcontext->gpu[cuda_index].cuda_context);
+	if (rc != CUDA_SUCCESS)
+		elog(ERROR, "failed on cuCtxPushCurrent: %s", errorText(rc));
 
-			Assert(!gm_chunk->free_chain.prev && !gm_chunk->free_chain.next);
-			dlist_foreach (hiter, &gm_head->hash_slots[index])
-			{
-				gm_temp = dlist_container(GpuMemChunk, hash_chain, hiter.cur);
-				if (gm_temp->chunk_addr == gm_chunk->chunk_addr)
-				{
-					found = true;
-					break;
-				}
-			}
-			Assert(found);
-			elog(INFO, "sanity %zx - %zx (active)",
-				 (Size)(gm_chunk->chunk_addr),
-				 (Size)(gm_chunk->chunk_addr + gm_chunk->chunk_size));
-		}
-		else if (gm_chunk->free_chain.prev && gm_chunk->free_chain.next)
-		{
-			bool	found = false;
+	rc = cuMemFree(gm_block->block_addr);
+	if (rc != CUDA_SUCCESS)
+		elog(ERROR, "failed on cuMemFree: %s", errorText(rc));
 
-			Assert(!gm_chunk->hash_chain.prev && !gm_chunk->hash_chain.next);
-			dlist_foreach (hiter, &gm_block->free_chunks)
-			{
-				gm_temp = dlist_container(GpuMemChunk, free_chain, hiter.cur);
-				if (gm_temp->chunk_addr == gm_chunk->chunk_addr)
-				{
-					found = true;
-					break;
-				}
-			}
-			Assert(found);
-			elog(INFO, "sanity %zx - %zx (free)",
-				 (Size)(gm_chunk->chunk_addr),
-				 (Size)(gm_chunk->chunk_addr + gm_chunk->chunk_size));
-		}
-		else
-			Assert(false);	/* neither active nor free */
-	}
-	Assert(curr_addr == gm_block->block_addr + gm_block->block_size);
-}
+	rc = cuCtxPopCurrent(NULL);
+	if (rc != CUDA_SUCCESS)
+		elog(WARNING, "failed on cuCtxPopCurrent: %s", errorText(rc));
 
-static void
-gpuMemSanityCheck(GpuContext *gcontext, int cuda_index)
-{
-	GpuMemHead	   *gm_head = &gcontext->gpu[cuda_index].cuda_memory;
-	GpuMemBlock	   *gm_block;
-	dlist_iter		iter;
+	/* update performance statistics */
+	gettimeofday(&tv2, NULL);
+	gcontext->num_dev_mfree++;
+	PFMON_ADD_TIMEVAL(&gcontext->tv_dev_mfree, &tv1, &tv2);
 
-	dlist_foreach (iter, &gm_head->active_blocks)
-	{
-		gm_block = dlist_container(GpuMemBlock, chain, iter.cur);
-		__gpuMemSanityCheck(gm_head, gm_block);
-	}
-	if (gm_head->empty_block)
-		__gpuMemSanityCheck(gm_head, gm_head->empty_block);
-	elog(INFO, "looks to sanity...");
+	/* update scoreboard for resource control */
+	GpuScoreDeclMemUsage(gcontext, cuda_index, gm_block->block_size);
+
+	elog(DEBUG1, "cuMemFree(%08zx - %08zx, size=%zuMB)",
+		 (size_t)gm_block->block_addr,
+		 ((size_t)gm_block->block_addr + gm_block->block_size),
+		 ((size_t)gm_block->block_size) >> 20);
+
+	memset(gm_block, 0, sizeof(GpuMemBlock));
+	dlist_push_head(&gm_head->unused_blocks, &gm_block->chain);
 }
-#endif
 
 CUdeviceptr
 __gpuMemAlloc(GpuContext *gcontext, int cuda_index, size_t bytesize)
 {
 	GpuMemHead	   *gm_head;
 	GpuMemBlock	   *gm_block;
-	GpuMemChunk	   *gm_chunk;
-	GpuMemChunk	   *new_chunk;
 	dlist_node	   *dnode;
-	dlist_iter		iter;
 	CUdeviceptr		block_addr;
+	CUdeviceptr		chunk_addr;
 	CUresult		rc;
-	int				index;
 	uint32			curr_numcxt;
 	size_t			curr_limit;
 	size_t			required;
 	struct timeval	tv1, tv2;
 
 	/* round up to 1KB align */
-	bytesize = TYPEALIGN(1024, bytesize);
+	bytesize = TYPEALIGN(1UL << GPUMEM_MIN_SHIFT, bytesize);
 
-	/* try to find out preliminary allocated block */
+	/* try to find out a free chunk on the preliminary allocated blocks */
 	Assert(cuda_index < gcontext->num_context);
 	gm_head = &gcontext->gpu[cuda_index].cuda_memory;
 
-	dlist_foreach(iter, &gm_head->active_blocks)
-	{
-		gm_block = dlist_container(GpuMemBlock, chain, iter.cur);
-		if (gm_block->max_free_size > bytesize)
-			goto found;
-	}
+	chunk_addr = gpuMemCoreAlloc(gm_head, gcontext->memcxt, bytesize);
+	if (chunk_addr != 0UL)
+		goto found;
 
-#ifdef NOT_USED
 	/*
-	 * MEMO: Device memory reuse seems doubtful; that may cause unexpected
-	 * allocation on a different context, then it will lead memory access
-	 * violation. So, we tentatively disable the feature.
+	 * The cached empty block is reused if it is large enough. It is safe
+	 * because GpuMemHead is per CUDA context of a particular GpuContext,
+	 * so the block is never handed to other CUDA contexts, and all the
+	 * blocks including the cached one are released by gpuMemFreeAll()
+	 * prior to the release (or cache) of the CUDA context.
+	 * Elsewhere, the cached block is released prior to allocation of
+	 * a larger one, not to overconsume the device memory.
 	 */
 	if (gm_head->empty_block)
 	{
 		gm_block = gm_head->empty_block;
-		if (gm_block->max_free_size > bytesize)
+		gm_head->empty_block = NULL;
+		if (gm_block->block_size >= bytesize)
 		{
-			Assert(!gm_block->chain.prev && !gm_block->chain.next);
-			gm_head->empty_block = NULL;
-			dlist_push_head(&gm_head->active_blocks, &gm_block->chain);
+			gpuMemCoreAddBlock(gm_head, gcontext->memcxt, gm_block);
+			chunk_addr = gpuMemCoreAlloc(gm_head, gcontext->memcxt, bytesize);
+			Assert(chunk_addr != 0UL);
 			goto found;
 		}
+		__gpuMemReleaseBlock(gcontext, cuda_index, gm_block);
 	}
-#endif
+
 	/*
 	 * no space available on the preliminary allocated block,
 	 * so we try to allocate device memory in advance.
@@ -418,103 +984,19 @@ __gpuMemAlloc(GpuContext *gcontext, int cuda_index, size_t bytesize)
 	memset(gm_block, 0, sizeof(GpuMemBlock));
 	gm_block->block_addr = block_addr;
 	gm_block->block_size = required;
-	gm_block->max_free_size = required;
-	dlist_init(&gm_block->addr_chunks);
-	dlist_init(&gm_block->free_chunks);
+	gpuMemCoreAddBlock(gm_head, gcontext->memcxt, gm_block);
 
-	if (dlist_is_empty(&gm_head->unused_chunks))
-		gm_chunk = MemoryContextAlloc(gcontext->memcxt, sizeof(GpuMemChunk));
-	else
+	chunk_addr = gpuMemCoreAlloc(gm_head, gcontext->memcxt, bytesize);
+	if (chunk_addr == 0UL)
 	{
-		dnode = dlist_pop_head_node(&gm_head->unused_chunks);
-		gm_chunk = dlist_container(GpuMemChunk, addr_chain, dnode);
+		gpuMemDump(gcontext, cuda_index);
+		elog(ERROR, "Bug? we could not find a free chunk in GpuMemBlock (%zu)",
+			 bytesize);
 	}
-	memset(gm_chunk, 0, sizeof(GpuMemChunk));
-	gm_chunk->gm_block = gm_block;
-	dlist_push_head(&gm_block->addr_chunks, &gm_chunk->addr_chain);
-	dlist_push_head(&gm_block->free_chunks, &gm_chunk->free_chain);
-	memset(&gm_chunk->hash_chain, 0, sizeof(dlist_node));
-	gm_chunk->chunk_addr = block_addr;
-	gm_chunk->chunk_size = required;
-
-	dlist_push_head(&gm_head->active_blocks, &gm_block->chain);
-
 found:
-	dlist_foreach(iter, &gm_block->free_chunks)
-	{
-		gm_chunk = dlist_container(GpuMemChunk, free_chain, iter.cur);
-
-		Assert(!gm_chunk->hash_chain.prev && !gm_chunk->hash_chain.next);
-		if (gm_chunk->chunk_size < bytesize)
-			continue;
-
-		/* no need to split, just replace free chunk */
-		if (gm_chunk->chunk_size == bytesize)
-		{
-			dlist_delete(&gm_chunk->free_chain);
-			memset(&gm_chunk->free_chain, 0, sizeof(dlist_node));
-
-			index = gpuMemHashIndex(gm_head, gm_chunk->chunk_addr);
-			dlist_push_tail(&gm_head->hash_slots[index],
-							&gm_chunk->hash_chain);
-			if (gm_block->max_free_size == gm_chunk->chunk_size)
-			{
-				gm_block->max_free_size = 0;
-				dlist_foreach(iter, &gm_block->free_chunks)
-				{
-					GpuMemChunk	   *temp = dlist_container(GpuMemChunk,
-														   free_chain,
-														   iter.cur);
-					gm_block->max_free_size = Max(gm_block->max_free_size,
-												  temp->chunk_size);
-				}
-			}
-			return gm_chunk->chunk_addr;
-		}
-
-		/* larger free chunk found, so let's split it */
-		if (dlist_is_empty(&gm_head->unused_chunks))
-			new_chunk = MemoryContextAlloc(gcontext->memcxt,
-										   sizeof(GpuMemChunk));
-		else
-		{
-			dnode = dlist_pop_head_node(&gm_head->unused_chunks);
-			new_chunk = dlist_container(GpuMemChunk, addr_chain, dnode);
-		}
-		memset(new_chunk, 0, sizeof(GpuMemChunk));
-		new_chunk->gm_block = gm_block;
-		new_chunk->chunk_addr = gm_chunk->chunk_addr + bytesize;
-		new_chunk->chunk_size = gm_chunk->chunk_size - bytesize;
-		gm_chunk->chunk_size = bytesize;
-
-		/* add new one just after the old one */
-		dlist_insert_after(&gm_chunk->addr_chain, &new_chunk->addr_chain);
-		/* remove old one from the free list */
-		dlist_delete(&gm_chunk->free_chain);
-		memset(&gm_chunk->free_chain, 0, sizeof(dlist_node));
-		/* add new one to the free list */
-		dlist_push_tail(&gm_block->free_chunks, &new_chunk->free_chain);
-
-		/* add active portion to the hash table */
-		index = gpuMemHashIndex(gm_head, gm_chunk->chunk_addr);
-		dlist_push_tail(&gm_head->hash_slots[index],
-						&gm_chunk->hash_chain);
-		if (gm_block->max_free_size == new_chunk->chunk_size + bytesize)
-		{
-			gm_block->max_free_size = 0;
-			dlist_foreach(iter, &gm_block->free_chunks)
-			{
-				GpuMemChunk    *temp = dlist_container(GpuMemChunk,
-													   free_chain,
-													   iter.cur);
-				gm_block->max_free_size = Max(gm_block->max_free_size,
-											  temp->chunk_size);
-			}
-		}
-		return gm_chunk->chunk_addr;
-	}
-	gpuMemDump(gcontext, cuda_index);
-	elog(ERROR, "Bug? we could not find a free chunk in GpuMemBlock (%zu)", bytesize);
+	pg_atomic_fetch_add_u64(&gpuScoreBoard->gpu[cuda_index].gmem_active,
+							bytesize);
+	return chunk_addr;
 }
 
 CUdeviceptr
@@ -533,162 +1015,24 @@ __gpuMemFree(GpuContext *gcontext, int cuda_index, CUdeviceptr chunk_addr)
 {
 	GpuMemHead	   *gm_head;
 	GpuMemBlock	   *gm_block;
-	GpuMemChunk	   *gm_chunk;
-	GpuMemChunk	   *gm_prev;
-	GpuMemChunk	   *gm_next;
-	dlist_node	   *dnode;
-	dlist_iter		iter;
-	CUresult		rc;
-	int				index;
-	struct timeval	tv1, tv2;
+	size_t			chunk_size;
 
 	/* find out the cuda-context */
 	Assert(cuda_index < gcontext->num_context);
 	gm_head = &gcontext->gpu[cuda_index].cuda_memory;
 
-	index = gpuMemHashIndex(gm_head, chunk_addr);
-	dlist_foreach(iter, &gm_head->hash_slots[index])
-	{
-		gm_chunk = dlist_container(GpuMemChunk, hash_chain, iter.cur);
-		if (gm_chunk->chunk_addr == chunk_addr)
-			goto found;
-	}
-	elog(WARNING, "Bug? device address %p was not tracked",
-		 (void *)chunk_addr);
-	return;
-
-found:
-	/* unlink from the hash */
-	dlist_delete(&gm_chunk->hash_chain);
-	memset(&gm_chunk->hash_chain, 0, sizeof(dlist_node));
-
-	/* sanity check; chunks should be within block */
-	gm_block = gm_chunk->gm_block;
-	Assert(gm_chunk->chunk_addr >= gm_block->block_addr &&
-		   (gm_chunk->chunk_addr + gm_chunk->chunk_size) <=
-		   (gm_block->block_addr + gm_block->block_size));
-	gm_block->max_free_size = Max(gm_block->max_free_size,
-								  gm_chunk->chunk_size);
-
-	/* back to the free_list */
-	Assert(!gm_chunk->free_chain.prev && !gm_chunk->free_chain.next);
-	dlist_push_head(&gm_block->free_chunks, &gm_chunk->free_chain);
-
-	if (dlist_has_prev(&gm_block->addr_chunks,
-					   &gm_chunk->addr_chain))
-	{
-		dnode = dlist_prev_node(&gm_block->addr_chunks,
-								&gm_chunk->addr_chain);
-		gm_prev = dlist_container(GpuMemChunk, addr_chain, dnode);
-		Assert(gm_prev->chunk_addr +
-			   gm_prev->chunk_size == gm_chunk->chunk_addr);
-		if (gm_prev->free_chain.prev && gm_prev->free_chain.next)
-		{
-			Assert(!gm_prev->hash_chain.prev &&
-				   !gm_prev->hash_chain.next);
-			/* OK, it can be merged */
-			dlist_delete(&gm_chunk->addr_chain);
-			dlist_delete(&gm_chunk->free_chain);
-			gm_prev->chunk_size += gm_chunk->chunk_size;
-
-			/* update max_free_size if needed */
-			gm_block->max_free_size = Max(gm_block->max_free_size,
-										  gm_prev->chunk_size);
-
-			/* GpuMemChunk entry may be reused soon */
-			memset(gm_chunk, 0, sizeof(GpuMemChunk));
-			dlist_push_head(&gm_head->unused_chunks, &gm_chunk->addr_chain);
-
-			gm_chunk = gm_prev;
-		}
-		else
-			Assert(!gm_prev->free_chain.prev && !gm_prev->free_chain.next);
-	}
-
-	if (dlist_has_next(&gm_block->addr_chunks,
-					   &gm_chunk->addr_chain))
-	{
-		dnode = dlist_next_node(&gm_block->addr_chunks,
-								&gm_chunk->addr_chain);
-		gm_next = dlist_container(GpuMemChunk, addr_chain, dnode);
-		Assert(gm_chunk->chunk_addr +
-			   gm_chunk->chunk_size == gm_next->chunk_addr);
-		if (gm_next->free_chain.prev && gm_next->free_chain.next)
-		{
-			Assert(!gm_next->hash_chain.prev &&
-				   !gm_next->hash_chain.next);
-			/* OK, it can be merged */
-			dlist_delete(&gm_next->addr_chain);
-			dlist_delete(&gm_next->free_chain);
-			gm_chunk->chunk_size += gm_next->chunk_size;
-
-			/* update max_free_size if needed */
-			gm_block->max_free_size = Max(gm_block->max_free_size,
-										  gm_chunk->chunk_size);
-
-			/* GpuMemChunk entry may be reused soon */
-			memset(gm_next, 0, sizeof(GpuMemChunk));
-			dlist_push_head(&gm_head->unused_chunks, &gm_next->addr_chain);
-		}
-		else
-			Assert(!gm_next->free_chain.prev && !gm_next->free_chain.next);
-	}
-
-	/*
-	 * Try to check GpuMemBlock is still active or not
-	 */
-	if (!dlist_has_prev(&gm_block->addr_chunks, &gm_chunk->addr_chain) &&
-		!dlist_has_next(&gm_block->addr_chunks, &gm_chunk->addr_chain))
-	{
-		Assert(gm_chunk->free_chain.prev && gm_chunk->free_chain.next);
-		Assert(!gm_chunk->hash_chain.prev && !gm_chunk->hash_chain.next);
-		Assert(gm_block->block_addr == gm_chunk->chunk_addr &&
-			   gm_block->block_size == gm_chunk->chunk_size);
-		Assert(gm_block->max_free_size == gm_block->block_size);
-		/* OK, it looks to up an empty block */
-		dlist_delete(&gm_block->chain);
-		memset(&gm_block->chain, 0, sizeof(dlist_node));
-
-#ifdef NOT_USED
-		/* One empty block shall be kept, but no more */
-		if (!gm_head->empty_block)
-			gm_head->empty_block = gm_block;
-		else
-#endif
-		{
-			gettimeofday(&tv1, NULL);
-
-			rc = cuCtxPushCurrent(gcontext->gpu[cuda_index].cuda_context);
-			if (rc != CUDA_SUCCESS)
-				elog(ERROR, "failed on cuCtxPushCurrent: %s", errorText(rc));
-
-			rc = cuMemFree(gm_block->block_addr);
-			if (rc != CUDA_SUCCESS)
-				elog(ERROR, "failed on cuMemFree: %s", errorText(rc));
-
-			rc = cuCtxPopCurrent(NULL);
-			if (rc != CUDA_SUCCESS)
-				elog(WARNING, "failed on cuCtxPopCurrent: %s", errorText(rc));
-
-			/* update performance statistics */
-			gettimeofday(&tv2, NULL);
-			gcontext->num_dev_mfree++;
-			PFMON_ADD_TIMEVAL(&gcontext->tv_dev_mfree, &tv1, &tv2);
-
-			/* update scoreboard for resource control */
-			GpuScoreDeclMemUsage(gcontext, cuda_index, gm_block->block_size);
-
-			elog(DEBUG1, "cuMemFree(%08zx - %08zx, size=%zuMB)",
-				 (size_t)gm_block->block_addr,
-				 ((size_t)gm_block->block_addr + gm_block->block_size),
-				 ((size_t)gm_block->block_size) >> 20);
+	gm_block = gpuMemCoreFree(gm_head, chunk_addr, &chunk_size);
+	if (chunk_size > 0)
+		pg_atomic_fetch_sub_u64(&gpuScoreBoard->gpu[cuda_index].gmem_active,
+								chunk_size);
+	if (!gm_block)
+		return;
 
-			memset(gm_chunk, 0, sizeof(GpuMemChunk));
-			dlist_push_head(&gm_head->unused_chunks, &gm_chunk->addr_chain);
-			memset(gm_block, 0, sizeof(GpuMemBlock));
-			dlist_push_head(&gm_head->unused_blocks, &gm_block->chain);
-		}
-	}
+	/* One empty block shall be kept, but no more */
+	if (!gm_head->empty_block)
+		gm_head->empty_block = gm_block;
+	else
+		__gpuMemReleaseBlock(gcontext, cuda_index, gm_block);
 }
 
 void
@@ -719,7 +1063,6 @@ gpuMemFreeAll(GpuContext *gcontext)
 			elog(WARNING, "failed on cuCtxPushCurrent: %s", errorText(rc));
 
 		gm_head = &gcontext->gpu[index].cuda_memory;
-#ifdef NOT_USED
 		if (gm_head->empty_block)
 		{
 			gm_block = gm_head->empty_block;
@@ -729,7 +1072,6 @@ gpuMemFreeAll(GpuContext *gcontext)
 			GpuScoreDeclMemUsage(gcontext, index, gm_block->block_size);
 			gm_head->empty_block = NULL;
 		}
-#endif
 		while (!dlist_is_empty(&gm_head->active_blocks))
 		{
 			dnode = dlist_pop_head_node(&gm_head->active_blocks);
@@ -740,6 +1082,11 @@ gpuMemFreeAll(GpuContext *gcontext)
 				elog(ERROR, "failed on cuMemFree: %s", errorText(rc));
 			GpuScoreDeclMemUsage(gcontext, index, gm_block->block_size);
 		}
+		/* orphan chunks, if any */
+		pg_atomic_fetch_sub_u64(&gpuScoreBoard->gpu[index].gmem_active,
+								gm_head->active_size);
+		gm_head->active_size = 0;
+		gm_head->num_active_chunks = 0;
 
 		rc = cuCtxPopCurrent(NULL);
 		if (rc != CUDA_SUCCESS)
@@ -781,6 +1128,36 @@ pgstrom_init_cuda(void)
 												cuda_num_devices);
 }
 
+/*
+ * lookup_alive_cuda_context
+ *
+ * It returns a CUDA context still alive, except for the 'exclude', to take
+ * over the host pinned memory pool; NULL if nothing.
+ */
+static CUcontext
+lookup_alive_cuda_context(CUcontext exclude)
+{
+	dlist_iter	iter;
+	int			i;
+
+	dlist_foreach(iter, &gcontext_list)
+	{
+		GpuContext *gcontext = dlist_container(GpuContext, chain, iter.cur);
+
+		for (i=0; i < gcontext->num_context; i++)
+		{
+			if (gcontext->gpu[i].cuda_context != exclude)
+				return gcontext->gpu[i].cuda_context;
+		}
+	}
+	for (i=0; cuda_last_contexts && i < cuda_num_devices; i++)
+	{
+		if (cuda_last_contexts[i] && cuda_last_contexts[i] != exclude)
+			return cuda_last_contexts[i];
+	}
+	return NULL;
+}
+
 /*
  * pgstrom_cleanup_cuda
  *
@@ -820,6 +1197,8 @@ pgstrom_cleanup_cuda(int code, Datum arg)
 
 			Assert(context != NULL);
 			cuda_last_contexts[i] = NULL;
+			HostPinMemPoolUnpin(context,
+								lookup_alive_cuda_context(context));
 			rc = cuCtxDestroy(context);
 			if (rc != CUDA_SUCCESS)
 				elog(WARNING, "failed on cuCtxDestroy: %s", errorText(rc));
@@ -922,6 +1301,7 @@ pgstrom_create_gpucontext(ResourceOwner resowner, bool *context_reused)
 		gcontext->resowner = resowner;
 		gcontext->memcxt = memcxt;
 		dlist_init(&gcontext->pds_list);
+		dlist_init(&gcontext->gts_list);
 		for (index=0; index < cuda_num_devices; index++)
 		{
 			gcontext->gpu[index].cuda_context = cuda_context_temp[index];
@@ -933,6 +1313,7 @@ pgstrom_create_gpucontext(ResourceOwner resowner, bool *context_reused)
 
 		/* Update the scoreboard of GPU usage */
 		pg_atomic_fetch_add_u32(&gpuScoreBoard->num_gcontext, 1);
+		gpusched_register_gpucontext(gcontext);
 	}
 	PG_CATCH();
 	{
@@ -943,6 +1324,10 @@ pgstrom_create_gpucontext(ResourceOwner resowner, bool *context_reused)
 		{
 			if (cuda_context_temp[index])
 			{
+				HostPinMemPoolUnpin(cuda_context_temp[index],
+									index + 1 < cuda_num_devices
+									? cuda_context_temp[index + 1]
+									: lookup_alive_cuda_context(NULL));
 				rc = cuCtxDestroy(cuda_context_temp[index]);
 				if (rc != CUDA_SUCCESS)
                     elog(WARNING, "failed on cuCtxDestroy: %s", errorText(rc));
@@ -1002,6 +1387,15 @@ pgstrom_release_gpucontext(GpuContext *gcontext, bool sanity_release)
 	dlist_delete(&gcontext->chain);
 	memset(&gcontext->chain, 0, sizeof(dlist_node));
 
+	/*
+	 * On abort, GpuTaskState is not released individually, and it may be
+	 * already freed with the per-query memory context. So, we tell the
+	 * build workers we no longer wait for any programs here. On the sanity
+	 * release, each GpuTaskState already cancelled its own request.
+	 */
+	if (!sanity_release)
+		pgstrom_cancel_all_cuda_programs();
+
 	/* Any GpuTaskState is still active? */
 	if (*gcontext->p_keep_freemem > 0)
 		elog(sanity_release ? NOTICE : DEBUG1,
@@ -1067,6 +1461,9 @@ pgstrom_release_gpucontext(GpuContext *gcontext, bool sanity_release)
 	 * Also, decrement number of GpuContext
 	 */
 	pg_atomic_fetch_sub_u32(&gpuScoreBoard->num_gcontext, 1);
+	gpusched_unregister_gpucontext(gcontext);
+	gpusched_unregister_waiter();
+	gpusched_wakeup_waiters();
 
 	/*
 	 * If a series of queries are successfully executed, we keep cuContext
@@ -1098,6 +1495,7 @@ pgstrom_release_gpucontext(GpuContext *gcontext, bool sanity_release)
 	cuda_context = gcontext->gpu[0].cuda_context;
 	for (i = gcontext->num_context - 1; i > 0; i--)
 	{
+		HostPinMemPoolUnpin(gcontext->gpu[i].cuda_context, cuda_context);
 		rc = cuCtxDestroy(gcontext->gpu[i].cuda_context);
 		if (rc != CUDA_SUCCESS)
 			elog(WARNING, "failed on cuCtxDestroy: %s", errorText(rc));
@@ -1105,7 +1503,9 @@ pgstrom_release_gpucontext(GpuContext *gcontext, bool sanity_release)
 	/* release host pinned memory context */
 	MemoryContextDelete(gcontext->memcxt);
 
-	/* Drop the primary CUDA context */
+	/* Drop the primary CUDA context, with unpinning the memory pool */
+	HostPinMemPoolUnpin(cuda_context,
+						lookup_alive_cuda_context(cuda_context));
 	rc = cuCtxDestroy(cuda_context);
 	if (rc != CUDA_SUCCESS)
 		elog(WARNING, "failed on cuCtxDestroy: %s", errorText(rc));
@@ -1168,6 +1568,7 @@ pgstrom_cleanup_gputaskstate(GpuTaskState *gts)
 		gtask = dlist_container(GpuTask, tracker, dnode);
 		SpinLockRelease(&gts->lock);
 
+		gpusched_release_task(gtask);
 		gts->cb_task_release(gtask);
 
 		SpinLockAcquire(&gts->lock);
@@ -1183,6 +1584,8 @@ pgstrom_cleanup_gputaskstate(GpuTaskState *gts)
 
 	gts->curr_task = NULL;
 	gts->curr_index = 0;
+	/* PARAM_EXEC may be changed on rescan */
+	gts->kern_params_pending = gts->kern_params_exec;
 }
 
 void
@@ -1215,7 +1618,14 @@ pgstrom_release_gputaskstate(GpuTaskState *gts)
 			}
 			gts->cuda_modules = NULL;
 		}
-		/* put reference to the GpuContext */
+		else if (gts->kern_source)
+		{
+			/* cancel the build request, if nobody else waits for */
+			pgstrom_cancel_cuda_program(gts);
+		}
+		/* detach from the GpuContext, then put reference */
+		dlist_delete(&gts->gts_chain);
+		memset(&gts->gts_chain, 0, sizeof(dlist_node));
 		pgstrom_put_gpucontext(gts->gcontext);
 		gts->gcontext = NULL;
 	}
@@ -1232,7 +1642,10 @@ pgstrom_init_gputaskstate(GpuContext *gcontext,
 	gts->cuda_modules = NULL;
 	gts->scan_done = false;
 	if (gcontext)
+	{
 		(*gcontext->p_keep_freemem)++;
+		dlist_push_tail(&gcontext->gts_list, &gts->gts_chain);
+	}
 	gts->be_row_format = false;
 	gts->outer_bulk_exec = false;
 #if PG_VERSION_NUM >= 90600
@@ -1262,6 +1675,10 @@ pgstrom_init_gputaskstate(GpuContext *gcontext,
 	gts->num_running_tasks = 0;
 	gts->num_pending_tasks = 0;
 	gts->num_ready_tasks = 0;
+	/* NOTE: caller has to set speculative_exec if supported */
+	gts->speculative_exec = false;
+	gts->num_device_tasks = 0;
+	gts->num_speculative_tasks = 0;
 	/* NOTE: caller has to set callbacks */
 	gts->cb_task_process = NULL;
 	gts->cb_task_complete = NULL;
@@ -1358,6 +1775,35 @@ check_completed_tasks(GpuTaskState *gts)
 	}
 }
 
+/*
+ * speculative_pending_tasks
+ *
+ * It moves the pending tasks to the completed list with cpu_fallback,
+ * without device execution, while the kernel build is in-progress.
+ * Once the kernel gets ready, subsequent tasks are launched on the device
+ * as usual. Caller must hold gts->lock.
+ */
+static void
+speculative_pending_tasks(GpuTaskState *gts)
+{
+	GpuTask		   *gtask;
+	dlist_node	   *dnode;
+
+	while (!dlist_is_empty(&gts->pending_tasks))
+	{
+		dnode = dlist_pop_head_node(&gts->pending_tasks);
+		gtask = dlist_container(GpuTask, chain, dnode);
+		gts->num_pending_tasks--;
+		Assert(!gtask->cuda_stream);
+
+		gtask->cpu_fallback = true;
+		dlist_push_tail(&gts->completed_tasks, &gtask->chain);
+		gts->num_completed_tasks++;
+		gts->num_speculative_tasks++;
+	}
+	check_completed_tasks(gts);
+}
+
 /*
  *
  *
@@ -1378,7 +1824,12 @@ launch_pending_tasks(GpuTaskState *gts)
 	if (!gts->cuda_modules)
 	{
 		if (!pgstrom_load_cuda_program(gts, false))
+		{
+			/* run the pending tasks by CPU, if supported */
+			if (gts->speculative_exec && pgstrom_speculative_exec_enabled)
+				speculative_pending_tasks(gts);
 			return;
+		}
 	}
 
 	PERFMON_BEGIN(&gts->pfm, &tv1);
@@ -1404,10 +1855,19 @@ launch_pending_tasks(GpuTaskState *gts)
 
 			Assert(gtask->cuda_index == UINT_MAX ||
 				   gtask->cuda_index < gcontext->num_context);
-			if (gtask->cuda_index == UINT_MAX)
-				index = (gcontext->next_context++ % gcontext->num_context);
-			else
-				index = gtask->cuda_index;
+			index = gpusched_admit_task(gcontext, gtask->cuda_index);
+			if (index < 0)
+			{
+				/*
+				 * Device queues are saturated by other backends. Keep
+				 * the task pending, then retry on the next polling.
+				 */
+				SpinLockAcquire(&gts->lock);
+				dlist_push_head(&gts->pending_tasks, &gtask->chain);
+				gts->num_pending_tasks++;
+				break;
+			}
+			gtask->sched_index = index;
 
 			cuda_device = gcontext->gpu[index].cuda_device;
 			cuda_context = gcontext->gpu[index].cuda_context;
@@ -1442,6 +1902,8 @@ launch_pending_tasks(GpuTaskState *gts)
 		 * linked to the completed list at this moment.
 		 */
 		SpinLockAcquire(&gts->lock);
+		if (launch)
+			gts->num_device_tasks++;
 		if (!gtask->chain.prev && !gtask->chain.next)
 		{
 			if (launch)
@@ -1475,11 +1937,12 @@ launch_pending_tasks(GpuTaskState *gts)
  *
  */
 static bool
-__waitfor_ready_tasks(GpuTaskState *gts)
+__waitfor_ready_tasks(GpuTaskState *gts, cl_uint release_gen,
+					  bool *p_timeout)
 {
 	bool	retry_next = true;
 	bool	wait_latch = true;
-	bool	short_timeout = false;
+	bool	wait_resource = false;
 	int		rc;
 
 	/*
@@ -1512,10 +1975,11 @@ __waitfor_ready_tasks(GpuTaskState *gts)
 		{
 			/*
 			 * Existence of pending tasks implies lack of device
-			 * resources (like memory). Shorter blocking may allow
-			 * to device resource polling. :-)
+			 * resources (like memory or device queue). We shall be
+			 * woken up by the backend that releases them, or our
+			 * own running tasks on completion.
 			 */
-			short_timeout = true;
+			wait_resource = true;
 		}
 		else if (!dlist_is_empty(&gts->running_tasks))
 		{
@@ -1543,6 +2007,33 @@ __waitfor_ready_tasks(GpuTaskState *gts)
 		}
 		SpinLockRelease(&gts->lock);
 	}
+	else if (gts->speculative_exec && pgstrom_speculative_exec_enabled)
+	{
+		/*
+		 * Kernel build is still in-progress, but chunks are processed by
+		 * CPU in the meantime. So, we don't need to wait for the build
+		 * unless all the chunks are already processed.
+		 */
+		SpinLockAcquire(&gts->lock);
+		if (!dlist_is_empty(&gts->ready_tasks))
+		{
+			wait_latch = false;
+			retry_next = false;
+		}
+		else if (!gts->scan_done ||
+				 !dlist_is_empty(&gts->completed_tasks) ||
+				 !dlist_is_empty(&gts->pending_tasks))
+		{
+			wait_latch = false;
+			retry_next = true;
+		}
+		else
+		{
+			wait_latch = false;
+			retry_next = false;
+		}
+		SpinLockRelease(&gts->lock);
+	}
 
 	if (wait_latch)
 	{
@@ -1550,12 +2041,39 @@ __waitfor_ready_tasks(GpuTaskState *gts)
 
 		PERFMON_BEGIN(&gts->pfm, &tv1);
 
-		rc = WaitLatch(&MyProc->procLatch,
-					   WL_LATCH_SET | WL_TIMEOUT | WL_POSTMASTER_DEATH,
-					   !short_timeout ? 5000 : 200);
+		/*
+		 * If we have to wait for the device resources, register this
+		 * backend to the waiters. Unless we have enough slots, it falls
+		 * back to the shorter timeout polling.
+		 * Also, release event might happen after the last trial to launch
+		 * the pending tasks, so we don't sleep in this case.
+		 */
+		if (!wait_resource)
+			rc = WaitLatch(&MyProc->procLatch,
+						   WL_LATCH_SET | WL_TIMEOUT | WL_POSTMASTER_DEATH,
+						   5000);
+		else if (!gpusched_register_waiter())
+			rc = WaitLatch(&MyProc->procLatch,
+						   WL_LATCH_SET | WL_TIMEOUT | WL_POSTMASTER_DEATH,
+						   200);
+		else if (gpusched_release_generation() == release_gen)
+		{
+			rc = WaitLatch(&MyProc->procLatch,
+						   WL_LATCH_SET | WL_TIMEOUT | WL_POSTMASTER_DEATH,
+						   5000);
+			gpusched_unregister_waiter();
+		}
+		else
+		{
+			rc = WL_LATCH_SET;
+			gpusched_unregister_waiter();
+		}
 		ResetLatch(&MyProc->procLatch);
 		if (rc & WL_POSTMASTER_DEATH)
 			elog(ERROR, "Emergency bail out because of Postmaster crash");
+		/* no state change was notified, CUDA context may be broken */
+		if ((rc & WL_LATCH_SET) == 0)
+			*p_timeout = true;
 
 		PERFMON_END(&gts->pfm, time_sync_tasks, &tv1, &tv2);
 	}
@@ -1563,7 +2081,7 @@ __waitfor_ready_tasks(GpuTaskState *gts)
 }
 
 static bool
-waitfor_ready_tasks(GpuTaskState *gts)
+waitfor_ready_tasks(GpuTaskState *gts, cl_uint release_gen, bool *p_timeout)
 {
 #if PG_VERSION_NUM < 90600
 	/*
@@ -1578,7 +2096,7 @@ waitfor_ready_tasks(GpuTaskState *gts)
 	set_latch_on_sigusr1 = true;
 	PG_TRY();
 	{
-		status = __waitfor_ready_tasks(gts);
+		status = __waitfor_ready_tasks(gts, release_gen, p_timeout);
 	}
 	PG_CATCH();
 	{
@@ -1590,10 +2108,68 @@ waitfor_ready_tasks(GpuTaskState *gts)
 
 	return status;
 #else
-	return __waitfor_ready_tasks(gts);
+	return __waitfor_ready_tasks(gts, release_gen, p_timeout);
 #endif
 }
 
+/*
+ * pgstrom_async_task_limit
+ *
+ * It determines the number of asynchronous tasks that a GpuTaskState,
+ * whose output is being consumed right now, can keep in flight.
+ * pg_strom.max_async_tasks is the budget of the whole GpuContext, so the
+ * consumer can take the slots unused by other GpuTaskStates. Also, it is
+ * guaranteed to have its fair share (and at least one slot) even if other
+ * nodes still retain the ready tasks not consumed yet, not to starve.
+ *
+ * NOTE: it depends on nothing but the arguments, so it is available to
+ * drive with synthetic numbers without CUDA devices.
+ */
+cl_uint
+pgstrom_async_task_limit(cl_uint budget,
+						 cl_uint num_others,
+						 cl_uint num_active)
+{
+	cl_uint		fair_share = budget / Max(num_active, 1);
+
+	return Max(budget > num_others ? budget - num_others : 0,
+			   Max(fair_share, 1));
+}
+
+/*
+ * gpucontext_async_task_limit
+ *
+ * It counts up the asynchronous tasks in flight by other GpuTaskStates
+ * on the same GpuContext, then returns the limit of the supplied one.
+ *
+ * NOTE: caller must not hold gts->lock
+ */
+static cl_uint
+gpucontext_async_task_limit(GpuTaskState *gts)
+{
+	GpuContext	   *gcontext = gts->gcontext;
+	cl_uint			num_others = 0;
+	cl_uint			num_active = 1;
+	dlist_iter		iter;
+
+	dlist_foreach(iter, &gcontext->gts_list)
+	{
+		GpuTaskState   *temp = dlist_container(GpuTaskState,
+											   gts_chain, iter.cur);
+		if (temp == gts)
+			continue;
+		SpinLockAcquire(&temp->lock);
+		num_others += (temp->num_running_tasks +
+					   temp->num_pending_tasks +
+					   temp->num_ready_tasks);
+		if (!temp->scan_done && temp->kern_source)
+			num_active++;
+		SpinLockRelease(&temp->lock);
+	}
+	return pgstrom_async_task_limit((cl_uint) pgstrom_max_async_tasks,
+									num_others, num_active);
+}
+
 /*
  * gpucontext_health_check
  *
@@ -1643,7 +2219,13 @@ pgstrom_fetch_gputask(GpuTaskState *gts)
 {
 	GpuTask		   *gtask;
 	dlist_node	   *dnode;
-	bool			is_first_loop = false;
+	cl_uint			num_limit;
+	cl_uint			release_gen;
+	bool			need_health_check = false;
+
+	/* PARAM_EXEC has to be evaluated prior to the first GpuTask */
+	if (gts->kern_params_pending)
+		pgstrom_setup_kern_params(gts);
 
 	/*
 	 * In case when no device code will be executed, we do not need to have
@@ -1659,17 +2241,24 @@ pgstrom_fetch_gputask(GpuTaskState *gts)
 
 	/*
 	 * We try to keep multiple GpuTask requests being enqueued, unless
-	 * it does not reach to pgstrom_max_async_tasks.
-	 *
-	 * TODO: number of requests should be controled by GpuContext, not
-	 * GpuTaskState granuality. Needs more investigation.
+	 * it does not reach to the limit given by the GpuContext. Because
+	 * this GpuTaskState is the one whose output is consumed right now,
+	 * it can take the slots of pgstrom_max_async_tasks not in use by
+	 * other nodes on the same GpuContext.
 	 */
 	do {
 		CHECK_FOR_INTERRUPTS();
 
-		/* Health check of CUDA context */
-		if (!is_first_loop)
+		/*
+		 * Health check of CUDA context, only if the last wait was timed
+		 * out without any notification of the state change.
+		 */
+		if (need_health_check)
 			gpucontext_health_check(gts->gcontext);
+		need_health_check = false;
+
+		num_limit = gpucontext_async_task_limit(gts);
+		release_gen = gpusched_release_generation();
 
 		SpinLockAcquire(&gts->lock);
 		check_completed_tasks(gts);
@@ -1677,9 +2266,9 @@ pgstrom_fetch_gputask(GpuTaskState *gts)
 
 		if (!gts->scan_done)
 		{
-			while (pgstrom_max_async_tasks > (gts->num_running_tasks +
-											  gts->num_pending_tasks +
-											  gts->num_ready_tasks))
+			while (num_limit > (gts->num_running_tasks +
+								gts->num_pending_tasks +
+								gts->num_ready_tasks))
 			{
 				/*
 				 * NOTE: We like to keep a particular number of asynchronous
@@ -1727,8 +2316,7 @@ pgstrom_fetch_gputask(GpuTaskState *gts)
 			}
 		}
 		SpinLockRelease(&gts->lock);
-		is_first_loop = false;
-	} while (waitfor_ready_tasks(gts));
+	} while (waitfor_ready_tasks(gts, release_gen, &need_health_check));
 
 	/*
 	 * Picks up next available chunk if any
@@ -1883,6 +2471,7 @@ pgstrom_init_gputask(GpuTaskState *gts, GpuTask *gtask)
 	memset(gtask, 0, sizeof(GpuTask));
 	gtask->gts = gts;
 	gtask->cuda_index = UINT_MAX;	/* assign automatically */
+	gtask->sched_index = -1;		/* not admitted yet */
 	/* to be tracked by GpuTaskState */
 	SpinLockAcquire(&gts->lock);
 	dlist_push_tail(&gts->tracked_tasks, &gtask->tracker);
@@ -1899,6 +2488,9 @@ pgstrom_release_gputask(GpuTask *gtask)
 	dlist_delete(&gtask->tracker);
 	SpinLockRelease(&gts->lock);
 
+	/* return the device queue slot, if still admitted */
+	gpusched_release_task(gtask);
+
 	/* per task cleanup */
 	gts->cb_task_release(gtask);
 }
@@ -1913,6 +2505,7 @@ pgstrom_cleanup_gputask_cuda_resources(GpuTask *gtask)
 {
 	CUresult	rc;
 
+	gpusched_release_task(gtask);
 	if (gtask->cuda_stream)
 	{
 		rc = cuStreamDestroy(gtask->cuda_stream);
@@ -2332,6 +2925,7 @@ pgstrom_startup_cuda_control(void)
 	memset(gpuScoreBoard, 0, offsetof(GpuScoreBoard, gpu[num_devices]));
 	i = 0;
 	gpuScoreBoard->num_devices = num_devices;
+	SpinLockInit(&gpuScoreBoard->sched_lock);
 	foreach (lc, cuda_device_mem_sizes)
 	{
 		gpuScoreBoard->gpu[i].gmem_size = ((size_t)lfirst_int(lc) << 20);
@@ -2362,6 +2956,49 @@ pgstrom_init_cuda_control(void)
 			elog(ERROR, "failed to set CUDA_VISIBLE_DEVICES");
 	}
 
+	/*
+	 * GPU variables related to the device scheduler
+	 */
+	DefineCustomIntVariable("pg_strom.device_queue_depth",
+							"Number of tasks to be admitted per device",
+							"Backends can run tasks more than this number only within their fair share",
+							&gpusched_device_queue_depth,
+							64,
+							1,
+							INT_MAX / 2,
+							PGC_SIGHUP,
+							GUC_NOT_IN_SAMPLE,
+							NULL, NULL, NULL);
+	DefineCustomIntVariable("pg_strom.device_interactive_reserve",
+							"Percentage of the device queue reserved for interactive class",
+							NULL,
+							&gpusched_interactive_reserve,
+							25,
+							0,
+							100,
+							PGC_SIGHUP,
+							GUC_NOT_IN_SAMPLE,
+							NULL, NULL, NULL);
+	DefineCustomIntVariable("pg_strom.device_weight",
+							"Weight of fair share on the device scheduler",
+							NULL,
+							&gpusched_device_weight,
+							100,
+							1,
+							10000,
+							PGC_SUSET,
+							GUC_NOT_IN_SAMPLE,
+							NULL, NULL, NULL);
+	DefineCustomEnumVariable("pg_strom.device_priority",
+							 "Priority class on the device scheduler",
+							 NULL,
+							 &gpusched_device_priority,
+							 GPUSCHED_CLASS_INTERACTIVE,
+							 gpusched_class_options,
+							 PGC_SUSET,
+							 GUC_NOT_IN_SAMPLE,
+							 NULL, NULL, NULL);
+
 	/*
 	 * Picks up target CUDA devices
 	 */
@@ -2559,11 +3196,14 @@ pgstrom_scoreboard_info(PG_FUNCTION_ARGS)
 		att_name = "num contexts";
 		att_value = psprintf("%u", GpuScoreCurrNumContext());
 	}
-	else if (fncxt->call_cntr < 2 + 2 * gpuScoreBoard->num_devices)
+	else if (fncxt->call_cntr < 2 + 4 * gpuScoreBoard->num_devices)
 	{
-		int		cuda_index = (fncxt->call_cntr - 2) / 2;
-		int		attr_index = (fncxt->call_cntr - 2) % 2;
+		int		cuda_index = (fncxt->call_cntr - 2) / 4;
+		int		attr_index = (fncxt->call_cntr - 2) % 4;
 		size_t	length;
+		size_t	active;
+		cl_uint	num_tasks;
+		cl_uint	num_batch_tasks;
 
 		switch (attr_index)
 		{
@@ -2577,6 +3217,29 @@ pgstrom_scoreboard_info(PG_FUNCTION_ARGS)
 				att_name = psprintf("GPU RAM usage %u", cuda_index);
 				att_value = psprintf("%zu MB", length >> 20);
 				break;
+			case 2:
+				/*
+				 * Fragmentation is the portion of the reserved device
+				 * memory not used by active chunks.
+				 */
+				length = GpuScoreCurrMemUsage(cuda_index);
+				active = pg_atomic_read_u64(&gpuScoreBoard->gpu[cuda_index].gmem_active);
+				att_name = psprintf("GPU RAM active %u", cuda_index);
+				att_value = psprintf("%zu MB (fragmentation: %.1f%%)",
+									 active >> 20,
+									 length == 0 ? 0.0 :
+									 100.0 * (double)(length - Min(active, length)) /
+									 (double)length);
+				break;
+			case 3:
+				SpinLockAcquire(&gpuScoreBoard->sched_lock);
+				num_tasks = gpuScoreBoard->gpu[cuda_index].num_tasks;
+				num_batch_tasks = gpuScoreBoard->gpu[cuda_index].num_batch_tasks;
+				SpinLockRelease(&gpuScoreBoard->sched_lock);
+				att_name = psprintf("GPU tasks %u", cuda_index);
+				att_value = psprintf("%u (batch: %u)",
+									 num_tasks, num_batch_tasks);
+				break;
 			default:
 				elog(ERROR, "unexpected attribute of pgstrom_scoreboard_info");
 				break;
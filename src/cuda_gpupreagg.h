@@ -26,6 +26,7 @@
 #define GPUPREAGG_LOCAL_REDUCTION		2
 #define GPUPREAGG_GLOBAL_REDUCTION		3
 #define GPUPREAGG_FINAL_REDUCTION		4
+#define GPUPREAGG_SORTED_REDUCTION		5
 #define GPUPREAGG_ONLY_TERMINATION		99	/* used to urgent termination */
 
 /*
@@ -1488,6 +1489,194 @@ out:
 	kern_writeback_error_status(&kgpreagg->kerror, kcxt.e);
 }
 
+/*
+ * gpupreagg_sorted_reduction
+ *
+ * It makes reduction on the input stream already sorted by the grouping
+ * keys. A run of rows with same grouping keys is detected by comparison
+ * of the adjacent rows, then reduced within a workgroup by segmented
+ * reduction, without any hash table. Each run produces one row on the
+ * kds_final per workgroup, so a run across workgroup or chunk boundary
+ * produces multiple partial results. Upper Agg node consolidates them.
+ *
+ * NOTE: gpupreagg_preparation keeps the order of rows within a workgroup,
+ * but not across workgroups. It is harmless for correctness, because rows
+ * reduced together always have same grouping keys.
+ */
+KERNEL_FUNCTION_MAXTHREADS(void)
+gpupreagg_sorted_reduction(kern_gpupreagg *kgpreagg,
+						   kern_data_store *kds_slot,
+						   kern_data_store *kds_final)
+{
+	kern_parambuf  *kparams = KERN_GPUPREAGG_PARAMBUF(kgpreagg);
+	kern_context	kcxt;
+	varlena		   *kparam_0 = (varlena *)kparam_get_value(kparams, 0);
+	cl_char		   *gpagg_atts = (cl_char *)VARDATA(kparam_0);
+	pagg_datum	   *l_datum = SHARED_WORKMEM(pagg_datum);
+	cl_uint		   *l_head = (cl_uint *)(l_datum + get_local_size());
+	cl_uint		   *l_final = l_head + get_local_size();
+	cl_uint			i, ncols = kds_slot->ncols;
+	cl_uint			nvalids;
+	cl_uint			kds_index = get_global_id();
+	cl_uint			owner_index;
+	cl_uint			lowbit;
+	cl_uint			dist;
+	cl_uint			count;
+	cl_uint			allocated = 0;
+	cl_bool			is_valid;
+	cl_bool			is_root = false;
+	cl_bool			is_head = false;
+
+	INIT_KERNEL_CONTEXT(&kcxt, gpupreagg_sorted_reduction, kparams);
+
+	/* scope of this block */
+	if (get_global_base() < kds_slot->nitems)
+		nvalids = min(kds_slot->nitems - get_global_base(),
+					  get_local_size());
+	else
+		goto out;	/* should not happen */
+	is_valid = (get_local_id() < nvalids);
+
+	/*
+	 * Detection of the run boundary. l_head[] shall be the local index
+	 * of the first row of the run, using inclusive max-scan.
+	 */
+	if (is_valid)
+	{
+		if (get_local_id() == 0 ||
+			!gpupreagg_keymatch(&kcxt,
+								kds_slot, kds_index,
+								kds_slot, kds_index - 1))
+		{
+			l_head[get_local_id()] = get_local_id();
+			is_head = true;
+		}
+		else
+			l_head[get_local_id()] = 0;
+	}
+	__syncthreads();
+
+	for (dist = 1; dist < nvalids; dist *= 2)
+	{
+		cl_uint		temp = 0;
+
+		if (is_valid && get_local_id() >= dist)
+			temp = l_head[get_local_id() - dist];
+		__syncthreads();
+		if (is_valid && temp > l_head[get_local_id()])
+			l_head[get_local_id()] = temp;
+		__syncthreads();
+	}
+
+	/*
+	 * Segmented reduction; the tree reduction below merges the partner
+	 * only if both belong to the same run. Row that is not merged to
+	 * the left one (root) holds partial result of the run.
+	 */
+	if (is_valid)
+	{
+		lowbit = (get_local_id() & (~get_local_id() + 1));
+		is_root = (get_local_id() == 0 ||
+				   l_head[get_local_id() - lowbit] != l_head[get_local_id()]);
+	}
+
+	for (i=0; i < ncols; i++)
+	{
+		/* if not GPUPREAGG_FIELD_IS_AGGFUNC, do nothing */
+		if (gpagg_atts[i] != GPUPREAGG_FIELD_IS_AGGFUNC)
+			continue;
+
+		/* load this value from kds_slot onto pagg_datum */
+		if (is_valid)
+		{
+			gpupreagg_data_load(l_datum + get_local_id(),
+								&kcxt, kds_slot, i, kds_index);
+		}
+		__syncthreads();
+
+		/* do reduction */
+		for (dist = 2; dist < 2 * nvalids; dist *= 2)
+		{
+			if ((get_local_id() % dist) == 0 &&
+				(get_local_id() + dist / 2) < nvalids &&
+				l_head[get_local_id()] == l_head[get_local_id() + dist / 2])
+			{
+				gpupreagg_nogroup_calc(&kcxt,
+									   i,
+									   l_datum + get_local_id(),
+									   l_datum + get_local_id() + dist / 2);
+			}
+			__syncthreads();
+		}
+
+		/* write back the partial result of the root */
+		if (is_root)
+		{
+			gpupreagg_data_store(l_datum + get_local_id(),
+								 &kcxt, kds_slot, i, kds_index);
+		}
+		__syncthreads();
+	}
+
+	/*
+	 * The head of run moves its partial result to the kds_final
+	 */
+	if (is_head)
+	{
+		owner_index = atomicAdd(&kds_final->nitems, 1);
+		if (owner_index < kds_final->nrooms)
+		{
+			allocated += gpupreagg_final_data_move(&kcxt,
+												   kds_slot,
+												   kds_index,
+												   kds_final,
+												   owner_index);
+		}
+		else
+		{
+			STROM_SET_ERROR(&kcxt.e, StromError_DataStoreNoSpace);
+		}
+		l_final[get_local_id()] = owner_index;
+	}
+	__syncthreads();
+
+	/*
+	 * Other roots (not head) of the run accumulate its partial result
+	 * to the row of the head.
+	 */
+	if (is_root && !is_head)
+	{
+		owner_index = l_final[l_head[get_local_id()]];
+		if (owner_index < Min(kds_final->nitems,
+							  kds_final->nrooms))
+		{
+			for (i=0; i < ncols; i++)
+			{
+				if (gpagg_atts[i] != GPUPREAGG_FIELD_IS_AGGFUNC)
+					continue;
+				gpupreagg_global_calc(&kcxt,
+									  i,
+									  kds_final, owner_index,
+									  kds_slot, kds_index);
+			}
+		}
+	}
+
+	/* update run-time statistics */
+	pgstromStairlikeSum(is_head ? 1 : 0, &count);
+	if (count > 0 && get_local_id() == 0)
+		atomicAdd(&kgpreagg->num_groups, count);
+	__syncthreads();
+
+	pgstromStairlikeSum(allocated, &count);
+	if (count > 0 && get_local_id() == 0)
+		atomicAdd(&kgpreagg->varlena_usage, count);
+	__syncthreads();
+out:
+	/* write-back execution status into host-side */
+	kern_writeback_error_status(&kgpreagg->kerror, kcxt.e);
+}
+
 /*
  * gpupreagg_fixup_varlena
  *
@@ -1691,7 +1880,69 @@ gpupreagg_main(kern_gpupreagg *kgpreagg,
 
 	TIMEVAL_RECORD(kgpreagg,kern_prep,tv_start);
 
-	if (kgpreagg->reduction_mode == GPUPREAGG_NOGROUP_REDUCTION)
+	if (kgpreagg->reduction_mode == GPUPREAGG_SORTED_REDUCTION)
+	{
+		size_t		dynamic_shmem_unitsz = Max(sizeof(kern_errorbuf),
+											   sizeof(pagg_datum) +
+											   2 * sizeof(cl_uint));
+		/*
+		 * Launch:
+		 * KERNEL_FUNCTION_MAXTHREADS(void)
+		 * gpupreagg_sorted_reduction(kern_gpupreagg *kgpreagg,
+		 *                            kern_data_store *kds_slot,
+		 *                            kern_data_store *kds_final)
+		 *
+		 * NOTE: it writes out the results to kds_final directly, so
+		 * neither global nor final hash table is needed.
+		 */
+		tv_start = GlobalTimer();
+		kern_args = (void **)cudaGetParameterBuffer(sizeof(void *),
+													sizeof(void *) * 3);
+		if (!kern_args)
+		{
+			STROM_SET_ERROR(&kcxt.e, StromError_OutOfKernelArgs);
+			goto out;
+		}
+		kern_args[0] = kgpreagg;
+		kern_args[1] = kds_slot;
+		kern_args[2] = kds_final;
+		status = largest_workgroup_size(&grid_sz,
+										&block_sz,
+										(const void *)
+										gpupreagg_sorted_reduction,
+										kds_slot->nitems,
+										0, dynamic_shmem_unitsz);
+		if (status != cudaSuccess)
+		{
+			STROM_SET_RUNTIME_ERROR(&kcxt.e, status);
+			goto out;
+		}
+
+		status = cudaLaunchDevice((void *)gpupreagg_sorted_reduction,
+								  kern_args,
+								  grid_sz,
+								  block_sz,
+								  dynamic_shmem_unitsz * block_sz.x,
+								  NULL);
+		if (status != cudaSuccess)
+		{
+			STROM_SET_RUNTIME_ERROR(&kcxt.e, status);
+			goto out;
+		}
+
+		status = cudaDeviceSynchronize();
+		if (status != cudaSuccess)
+		{
+			STROM_SET_RUNTIME_ERROR(&kcxt.e, status);
+			goto out;
+		}
+		else if (kgpreagg->kerror.errcode != StromError_Success)
+			return;
+		/* sorted reduction is accounted as a final reduction */
+		TIMEVAL_RECORD(kgpreagg,kern_fagg,tv_start);
+		goto out;
+	}
+	else if (kgpreagg->reduction_mode == GPUPREAGG_NOGROUP_REDUCTION)
 	{
 		/* Launch:
 		 * KERNEL_FUNCTION(void)
@@ -17,8 +17,11 @@
  */
 #include "postgres.h"
 
+#include "lib/ilist.h"
+#include "utils/guc.h"
 #include "utils/memdebug.h"
 #include "utils/memutils.h"
+#include <sys/mman.h>
 
 #include "pg_strom.h"
 
@@ -57,6 +60,8 @@ typedef struct cudaHostMemBlock
 	dlist_node			chain;			/* link to active_blocks */
 	dlist_head			addr_chunks;	/* list of chunks in address order, or
 										 * zero if external block. */
+	bool				pooled;			/* true, if carved from the process
+										 * local pinned memory pool */
 	cudaHostMemChunk	first_chunk;	/* first chunk of this block */
 } cudaHostMemBlock;
 
@@ -77,6 +82,334 @@ typedef struct
 	Size				block_size_max;		/* max block size */
 } cudaHostMemHead;
 
+/*
+ * Process local pool of host pinned memory
+ *
+ * cuMemAllocHost() is expensive because the driver has to fault in and
+ * lock the pages, and HostPinMemContext is created and deleted for each
+ * GpuContext. So, short queries often spend more time to pin DMA buffers
+ * than to run the kernels.
+ * If pg_strom.host_pinned_pool_size is configured, we reserve a memory
+ * region (backed by huge pages if available) on the first use, fault in
+ * all the pages and pin them once. Then, blocks of HostPinMemContext are
+ * carved from the pool and returned to the pool on free or reset, instead
+ * of cuMemFreeHost(). Unlike chunks in a block, blocks are less frequently
+ * allocated and have various length, so the pool is managed by a simple
+ * best-fit segment list.
+ */
+#define HOSTMEM_POOL_HUGEPAGE_SIZE	(2UL << 20)		/* 2MB */
+#define HOSTMEM_POOL_ALIGN_SIZE		(64UL << 10)	/* 64kB */
+
+typedef struct
+{
+	dlist_node		addr_chain;	/* link to hostmem_pool_segments */
+	dlist_node		free_chain;	/* link to hostmem_pool_free, or zero if
+								 * segment is in use */
+	char		   *addr;		/* head of the segment */
+	Size			size;		/* length of the segment */
+} hostMemPoolSegment;
+
+static int			hostmem_pool_size;		/* GUC (kB) */
+static char		   *hostmem_pool_base = NULL;
+static Size			hostmem_pool_length = 0;
+static bool			hostmem_pool_hugetlb = false;
+static bool			hostmem_pool_broken = false;
+static CUcontext	hostmem_pool_context = NULL;	/* context which pinned
+													 * the pool, if any */
+static dlist_head	hostmem_pool_segments;		/* segments in address order */
+static dlist_head	hostmem_pool_free;			/* free segments */
+
+static bool
+hostMemPoolPin(void *addr, Size length, CUcontext cuda_context)
+{
+	CUresult	rc;
+
+	rc = cuCtxPushCurrent(cuda_context);
+	if (rc != CUDA_SUCCESS)
+	{
+		elog(LOG, "failed on cuCtxPushCurrent: %s", errorText(rc));
+		return false;
+	}
+
+	/*
+	 * CU_MEMHOSTREGISTER_PORTABLE makes the pool pinned memory for all
+	 * the CUDA contexts, not only the one which registered it.
+	 */
+	rc = cuMemHostRegister(addr, length, CU_MEMHOSTREGISTER_PORTABLE);
+	if (rc != CUDA_SUCCESS)
+		elog(LOG, "failed on cuMemHostRegister: %s", errorText(rc));
+
+	if (cuCtxPopCurrent(NULL) != CUDA_SUCCESS)
+		elog(ERROR, "failed on cuCtxPopCurrent");
+
+	return (rc == CUDA_SUCCESS);
+}
+
+static void
+hostMemPoolUnpin(void *addr, CUcontext cuda_context)
+{
+	CUresult	rc;
+
+	rc = cuCtxPushCurrent(cuda_context);
+	if (rc != CUDA_SUCCESS)
+	{
+		elog(WARNING, "failed on cuCtxPushCurrent: %s", errorText(rc));
+		return;
+	}
+	rc = cuMemHostUnregister(addr);
+	if (rc != CUDA_SUCCESS)
+		elog(WARNING, "failed on cuMemHostUnregister: %s", errorText(rc));
+
+	rc = cuCtxPopCurrent(NULL);
+	if (rc != CUDA_SUCCESS)
+		elog(WARNING, "failed on cuCtxPopCurrent: %s", errorText(rc));
+}
+
+/*
+ * hostMemPoolIsIdle - true, if no segment of the pool is in use
+ */
+static inline bool
+hostMemPoolIsIdle(void)
+{
+	return (dlist_head_node(&hostmem_pool_segments) ==
+			dlist_tail_node(&hostmem_pool_segments) &&
+			!dlist_is_empty(&hostmem_pool_free));
+}
+
+/*
+ * hostMemPoolReserve - reserve and pre-fault the pool region
+ */
+static bool
+hostMemPoolReserve(void)
+{
+	hostMemPoolSegment *segment;
+	Size		length;
+	char	   *addr = MAP_FAILED;
+
+	Assert(hostmem_pool_base == NULL);
+	if (hostmem_pool_size <= 0 || hostmem_pool_broken)
+		return false;
+
+	length = TYPEALIGN(HOSTMEM_POOL_HUGEPAGE_SIZE,
+					   (Size)hostmem_pool_size * 1024L);
+#ifdef MAP_HUGETLB
+	addr = mmap(NULL, length, PROT_READ | PROT_WRITE,
+				MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+	hostmem_pool_hugetlb = (addr != MAP_FAILED);
+#endif
+	if (addr == MAP_FAILED)
+	{
+		addr = mmap(NULL, length, PROT_READ | PROT_WRITE,
+					MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		if (addr == MAP_FAILED)
+		{
+			elog(LOG, "failed to reserve host pinned memory pool (%zu bytes): %m",
+				 length);
+			hostmem_pool_broken = true;
+			return false;
+		}
+#ifdef MADV_HUGEPAGE
+		/* transparent huge page, if possible */
+		madvise(addr, length, MADV_HUGEPAGE);
+#endif
+	}
+	/* fault in all the pages prior to pinning */
+	memset(addr, 0, length);
+
+	segment = MemoryContextAllocZero(TopMemoryContext,
+									 sizeof(hostMemPoolSegment));
+	segment->addr = addr;
+	segment->size = length;
+	dlist_init(&hostmem_pool_segments);
+	dlist_init(&hostmem_pool_free);
+	dlist_push_tail(&hostmem_pool_segments, &segment->addr_chain);
+	dlist_push_tail(&hostmem_pool_free, &segment->free_chain);
+
+	hostmem_pool_base = addr;
+	hostmem_pool_length = length;
+
+	elog(DEBUG1, "host pinned memory pool %zu bytes was reserved%s",
+		 length, hostmem_pool_hugetlb ? " on huge pages" : "");
+	return true;
+}
+
+/*
+ * hostMemPoolRelease - drop the pool region; all segments must be free
+ */
+static void
+hostMemPoolRelease(void)
+{
+	hostMemPoolSegment *segment;
+
+	Assert(hostmem_pool_base != NULL && hostmem_pool_context == NULL);
+	Assert(hostMemPoolIsIdle());
+	while (!dlist_is_empty(&hostmem_pool_segments))
+	{
+		segment = dlist_container(hostMemPoolSegment, addr_chain,
+							dlist_pop_head_node(&hostmem_pool_segments));
+		pfree(segment);
+	}
+	dlist_init(&hostmem_pool_free);
+	if (munmap(hostmem_pool_base, hostmem_pool_length) != 0)
+		elog(WARNING, "failed on munmap: %m");
+	hostmem_pool_base = NULL;
+	hostmem_pool_length = 0;
+	hostmem_pool_hugetlb = false;
+}
+
+/*
+ * hostMemPoolAlloc - carve a pinned segment from the pool; it returns NULL
+ * if pool is not available or has no free segment large enough.
+ */
+static void *
+hostMemPoolAlloc(CUcontext cuda_context, Size required)
+{
+	hostMemPoolSegment *segment = NULL;
+	hostMemPoolSegment *remain;
+	dlist_iter	iter;
+	Size		length = TYPEALIGN(HOSTMEM_POOL_ALIGN_SIZE, required);
+
+	if (hostmem_pool_broken)
+		return NULL;
+	if (!hostmem_pool_base && !hostMemPoolReserve())
+		return NULL;
+	if (length > hostmem_pool_length)
+		return NULL;
+
+	/* pin the pool on the first use, or after the owner context gone */
+	if (!hostmem_pool_context)
+	{
+		if (!hostMemPoolPin(hostmem_pool_base,
+							hostmem_pool_length,
+							cuda_context))
+		{
+			/*
+			 * unable to pin; e.g, ulimit -l. Don't try it again, and drop
+			 * the region unless someone still uses a segment of the pool.
+			 */
+			hostmem_pool_broken = true;
+			if (hostMemPoolIsIdle())
+				hostMemPoolRelease();
+			return NULL;
+		}
+		hostmem_pool_context = cuda_context;
+	}
+
+	/* best fit */
+	dlist_foreach(iter, &hostmem_pool_free)
+	{
+		hostMemPoolSegment *curr
+			= dlist_container(hostMemPoolSegment, free_chain, iter.cur);
+
+		if (curr->size >= length &&
+			(!segment || curr->size < segment->size))
+			segment = curr;
+	}
+	if (!segment)
+		return NULL;
+
+	/* split the segment, if remaining portion is available */
+	if (segment->size > length)
+	{
+		remain = MemoryContextAllocZero(TopMemoryContext,
+										sizeof(hostMemPoolSegment));
+		remain->addr = segment->addr + length;
+		remain->size = segment->size - length;
+		dlist_insert_after(&segment->addr_chain, &remain->addr_chain);
+		dlist_insert_after(&segment->free_chain, &remain->free_chain);
+		segment->size = length;
+	}
+	dlist_delete(&segment->free_chain);
+	memset(&segment->free_chain, 0, sizeof(dlist_node));
+
+	return segment->addr;
+}
+
+/*
+ * hostMemPoolFree - give back a segment to the pool
+ */
+static void
+hostMemPoolFree(void *addr)
+{
+	hostMemPoolSegment *segment = NULL;
+	hostMemPoolSegment *buddy;
+	dlist_iter	iter;
+	dlist_node *dnode;
+
+	dlist_foreach(iter, &hostmem_pool_segments)
+	{
+		hostMemPoolSegment *curr
+			= dlist_container(hostMemPoolSegment, addr_chain, iter.cur);
+
+		if (curr->addr == (char *)addr)
+		{
+			segment = curr;
+			break;
+		}
+	}
+	if (!segment || segment->free_chain.prev || segment->free_chain.next)
+		elog(ERROR, "pinned memory pool: %p is not an active segment", addr);
+
+	/* merge with the next segment, if free */
+	if (dlist_has_next(&hostmem_pool_segments, &segment->addr_chain))
+	{
+		dnode = dlist_next_node(&hostmem_pool_segments, &segment->addr_chain);
+		buddy = dlist_container(hostMemPoolSegment, addr_chain, dnode);
+		if (buddy->free_chain.prev && buddy->free_chain.next)
+		{
+			Assert(segment->addr + segment->size == buddy->addr);
+			dlist_delete(&buddy->addr_chain);
+			dlist_delete(&buddy->free_chain);
+			segment->size += buddy->size;
+			pfree(buddy);
+		}
+	}
+
+	/* merge with the previous segment, if free */
+	if (dlist_has_prev(&hostmem_pool_segments, &segment->addr_chain))
+	{
+		dnode = dlist_prev_node(&hostmem_pool_segments, &segment->addr_chain);
+		buddy = dlist_container(hostMemPoolSegment, addr_chain, dnode);
+		if (buddy->free_chain.prev && buddy->free_chain.next)
+		{
+			Assert(buddy->addr + buddy->size == segment->addr);
+			dlist_delete(&segment->addr_chain);
+			buddy->size += segment->size;
+			pfree(segment);
+			return;
+		}
+	}
+	dlist_push_head(&hostmem_pool_free, &segment->free_chain);
+}
+
+/*
+ * HostPinMemPoolUnpin
+ *
+ * It has to be called prior to destroy of a CUDA context, because
+ * registration of the host memory shall be invalidated with the context
+ * which pinned it. If no segment is in use, the pool region is kept
+ * unpinned, then pinned again on the next use. Elsewhere, the pool is
+ * pinned on the 'alt_context' (another live CUDA context, if any) to keep
+ * the segments in use being pinned memory.
+ */
+void
+HostPinMemPoolUnpin(CUcontext cuda_context, CUcontext alt_context)
+{
+	if (!hostmem_pool_context || hostmem_pool_context != cuda_context)
+		return;
+	hostMemPoolUnpin(hostmem_pool_base, cuda_context);
+	hostmem_pool_context = NULL;
+
+	if (!hostMemPoolIsIdle() && alt_context != NULL)
+	{
+		Assert(alt_context != cuda_context);
+		if (hostMemPoolPin(hostmem_pool_base,
+						   hostmem_pool_length,
+						   alt_context))
+			hostmem_pool_context = alt_context;
+	}
+}
+
 void
 cudaHostMemAssert(void *pointer)
 {
@@ -130,6 +463,7 @@ cudaHostMemAllocBlock(cudaHostMemHead *chm_head, int least_class)
 	cudaHostMemChunk *chm_chunk;
 	Size		block_size = chm_head->block_size_next;
 	Size		least_size = (1UL << least_class);
+	Size		pool_size;
 	int			index;
 	CUresult	rc;
 	struct timeval tv1, tv2;
@@ -141,6 +475,26 @@ cudaHostMemAllocBlock(cudaHostMemHead *chm_head, int least_class)
 									chm_head->block_size_max);
 	Assert((block_size & (block_size - 1)) == 0);
 
+	/*
+	 * Try to carve a block from the pinned memory pool first. If pool has
+	 * no room for the standard block size, smaller one is also acceptable
+	 * as long as it can hold the least_class.
+	 */
+	for (pool_size = block_size; pool_size >= least_size; pool_size /= 2)
+	{
+		chm_block = hostMemPoolAlloc(chm_head->cuda_context,
+									 offsetof(cudaHostMemBlock,
+											  first_chunk) + pool_size);
+		if (chm_block)
+		{
+			block_size = pool_size;
+			chm_block->pooled = true;
+			goto init_block;
+		}
+		if (!hostmem_pool_base)
+			break;		/* pool is not available */
+	}
+
 	/*
 	 * Allocation of the host pinned memory
 	 */
@@ -160,7 +514,9 @@ cudaHostMemAllocBlock(cudaHostMemHead *chm_head, int least_class)
 	gettimeofday(&tv2, NULL);
 	chm_head->num_host_malloc++;
 	PFMON_ADD_TIMEVAL(&chm_head->tv_host_malloc, &tv1, &tv2);
+	chm_block->pooled = false;
 
+init_block:
 	/* init block */
 	dlist_init(&chm_block->addr_chunks);
 	dlist_push_tail(&chm_head->blocks, &chm_block->chain);
@@ -179,6 +535,32 @@ cudaHostMemAllocBlock(cudaHostMemHead *chm_head, int least_class)
 	dlist_push_tail(&chm_head->free_chunks[index], &chm_chunk->free_chain);
 }
 
+/*
+ * cudaHostMemFreeBlock - release a block; pooled block is returned to
+ * the pool with keeping it pinned.
+ */
+static void
+cudaHostMemFreeBlock(cudaHostMemHead *chm_head, cudaHostMemBlock *chm_block)
+{
+	CUresult	rc;
+	struct timeval tv1, tv2;
+
+	if (chm_block->pooled)
+	{
+		hostMemPoolFree(chm_block);
+		return;
+	}
+	gettimeofday(&tv1, NULL);
+
+	rc = cuMemFreeHost(chm_block);
+	if (rc != CUDA_SUCCESS)
+		elog(ERROR, "failed on cuMemFreeHost: %s", errorText(rc));
+
+	gettimeofday(&tv2, NULL);
+	chm_head->num_host_mfree++;
+	PFMON_ADD_TIMEVAL(&chm_head->tv_host_mfree, &tv1, &tv2);
+}
+
 static void *
 cudaHostMemAlloc(MemoryContext context, Size required)
 {
@@ -233,8 +615,6 @@ cudaHostMemFree(MemoryContext context, void *pointer)
 	dlist_node		   *dnode;
 	uintptr_t			offset;
 	int					index;
-	CUresult			rc;
-	struct timeval		tv1, tv2;
 
 	chunk = HOSTMEM_CHUNK_BY_POINTER(pointer);
 	Assert(HOSTMEM_CHUNK_MAGIC(chunk) == HOSTMEM_CHUNK_MAGIC_CODE);
@@ -319,17 +699,7 @@ cudaHostMemFree(MemoryContext context, void *pointer)
 	{
 		Assert(!chunk->free_chain.prev && !chunk->free_chain.next);
 		dlist_delete(&chm_block->chain);
-
-		gettimeofday(&tv1, NULL);
-
-		rc = cuMemFreeHost(chm_block);
-		if (rc != CUDA_SUCCESS)
-			elog(ERROR, "failed on cuMemFreeHost: %s", errorText(rc));
-
-		gettimeofday(&tv2, NULL);
-		chm_head->num_host_mfree++;
-		PFMON_ADD_TIMEVAL(&chm_head->tv_host_mfree, &tv1, &tv2);
-
+		cudaHostMemFreeBlock(chm_head, chm_block);
 		return;
 	}
 
@@ -384,17 +754,13 @@ cudaHostMemReset(MemoryContext context)
 	cudaHostMemHead	   *chm_head = (cudaHostMemHead *) context;
 	cudaHostMemBlock   *chm_block;
 	dlist_mutable_iter	miter;
-	CUresult			rc;
 	int					i;
 
 	dlist_foreach_modify(miter, &chm_head->blocks)
 	{
 		chm_block = dlist_container(cudaHostMemBlock, chain, miter.cur);
 		dlist_delete(&chm_block->chain);
-
-		rc = cuMemFreeHost(chm_block);
-		if (rc != CUDA_SUCCESS)
-			elog(ERROR, "failed on cuMemFreeHost: %s", errorText(rc));
+		cudaHostMemFreeBlock(chm_head, chm_block);
 	}
 	Assert(dlist_is_empty(&chm_head->blocks));
 	for (i=0; i <= HOSTMEM_CHUNKSZ_MAX_BIT; i++)
@@ -618,3 +984,21 @@ HostPinMemContextCreate(MemoryContext parent,
 
 	return &chm_head->header;
 }
+
+/*
+ * pgstrom_init_cuda_mmgr
+ */
+void
+pgstrom_init_cuda_mmgr(void)
+{
+	DefineCustomIntVariable("pg_strom.host_pinned_pool_size",
+							"Size of host pinned memory pool per backend",
+							"It is reserved on the first use, then kept until exit of the backend. 0 disables the pool.",
+							&hostmem_pool_size,
+							0,
+							0,
+							INT_MAX,
+							PGC_SIGHUP,
+							GUC_NOT_IN_SAMPLE | GUC_UNIT_KB,
+							NULL, NULL, NULL);
+}
@@ -16,63 +16,96 @@
  * GNU General Public License for more details.
  */
 #include "postgres.h"
+#include "access/hash.h"
+#include "access/tupmacs.h"
 #include "access/twophase.h"
 #include "access/xact.h"
 #include "catalog/catalog.h"
 #include "catalog/pg_tablespace.h"
 #include "catalog/pg_type.h"
+#include "executor/executor.h"
 #include "funcapi.h"
+#include "port/atomics.h"
 #include "postmaster/bgworker.h"
 #include "storage/ipc.h"
 #include "storage/proc.h"
 #include "storage/shmem.h"
+#include "utils/array.h"
 #include "utils/builtins.h"
 #include "utils/guc.h"
+#include "utils/hsearch.h"
 #include "utils/lsyscache.h"
 #include "utils/memutils.h"
 #include "utils/pg_crc.h"
 #include <nvrtc.h>
 #include <sys/stat.h>
 #include <sys/types.h>
+#include <utime.h>
 #include "pg_strom.h"
 #include "cuda_money.h"
 #include "cuda_timelib.h"
 #include "cuda_textlib.h"
 
+/*
+ * Program cache
+ *
+ * Entries of the program cache are allocated from a buddy allocator on
+ * the shared memory segment, protected by pgcache_head->lock. Lookup of
+ * the entries is partitioned into PGCACHE_NUM_SHARDS shards by 64bit hash
+ * of the program, each with its own spinlock and hash slots, so concurrent
+ * backends looking up different programs don't contend on a single lock.
+ * Full comparison of the source is needed only when 64bit hash matches.
+ *
+ * Eviction is CLOCK; a hit just sets the reference bit of the entry, then
+ * pgstrom_program_cache_reclaim() sweeps the entries in address order and
+ * detaches the first one whose reference bit is already cleared.
+ *
+ * The lock ordering is pgcache_head->lock -> shard->lock, so nobody can
+ * acquire pgcache_head->lock while holding any shard->lock.
+ * refcnt is an atomic counter; the hash slot holds a reference while the
+ * entry is attached, and only a backend holding the shard->lock can take
+ * a new reference of attached entries. The entry is released by whoever
+ * decrements refcnt to zero, after it was detached.
+ */
 typedef struct
 {
-	dlist_node		hash_chain;
-	dlist_node		lru_chain;
+	dlist_node		hash_chain;	/* link to hash slot, or free_list */
 	int				shift;	/* block class of this entry */
-	int				refcnt;	/* 0 means free entry */
+	int				state;	/* one of PGCACHE_STATE_* */
+	pg_atomic_uint32 refcnt;
+	bool			refbit;	/* reference bit for CLOCK */
+	bool			manifested;	/* already recorded to the manifest */
+	bool			warmup;	/* built for warm-up; never cancelled */
+	cl_uint			nhits;	/* number of the cache hits */
+	uint64			hash;	/* hash value of the program */
 	pg_crc32		crc;	/* hash value by extra_flags + kern_source */
 	struct timeval	tv_build_end;	/* timestamp when build end */
 	Bitmapset	   *waiting_backends;
 	Oid				database_oid;
 	Oid				user_oid;
 	int				extra_flags;
+	Size			source_len;
+	Size			define_len;
 	char		   *kern_define;
 	char		   *kern_source;
+	char		   *kern_typeoids;	/* type oid declarations for the build */
 	char		   *bin_image;
 	size_t			bin_length;
 	char		   *error_msg;
 	char			data[FLEXIBLE_ARRAY_MEMBER];
 } program_cache_entry;
 
-#define PGCACHE_ACTIVE_ENTRY(entry)				\
-	((entry)->lru_chain.prev && (entry)->lru_chain.next)
-#define PGCACHE_FREE_ENTRY(entry)				\
-	(!(entry)->lru_chain.prev && !(entry)->lru_chain.next)
+#define PGCACHE_STATE_FREE			0	/* linked to free_list */
+#define PGCACHE_STATE_ALLOCATED		1	/* allocated, but not attached yet */
+#define PGCACHE_STATE_ACTIVE		2	/* attached to the hash slot */
+#define PGCACHE_STATE_DETACHED		3	/* detached, but still referenced */
+
 #define PGCACHE_MAGIC					0xabadcafe
 #define PGCACHE_MAGIC_CODE(entry)				\
 	*((cl_uint *)((char *)(entry) + (1UL << (entry)->shift) - sizeof(cl_uint)))
-#define PGCACHE_CHECK_ACTIVE(entry)				\
-	Assert(PGCACHE_ACTIVE_ENTRY(entry) &&		\
-		   (entry)->refcnt > 0 &&				\
-		   PGCACHE_MAGIC_CODE(entry) == PGCACHE_MAGIC)
 #define PGCACHE_CHECK_FREE(entry)				\
-	Assert(PGCACHE_FREE_ENTRY(entry) &&			\
-		   (entry)->refcnt == 0 &&				\
+	Assert((entry)->state == PGCACHE_STATE_FREE &&		\
+		   pg_atomic_read_u32(&(entry)->refcnt) == 0 &&	\
 		   PGCACHE_MAGIC_CODE(entry) == PGCACHE_MAGIC)
 #define PGCACHE_MIN_ERRORMSG_BUFSIZE	256
 #define PGCACHE_ERRORMSG_LEN(entry)				\
@@ -84,39 +117,174 @@ typedef struct
 
 #define PGCACHE_MIN_BITS		10		/* 1KB */
 #define PGCACHE_MAX_BITS		24		/* 16MB */	
-#define PGCACHE_HASH_SIZE		1024
+#define PGCACHE_NUM_SHARDS		32
+#define PGCACHE_SHARD_NSLOTS	64
 
 #define WORDNUM(x)		((x) / BITS_PER_BITMAPWORD)
 #define BITNUM(x)		((x) % BITS_PER_BITMAPWORD)
 
 typedef struct
 {
-	volatile slock_t lock;
+	slock_t		lock;
+	dlist_head	hash_slots[PGCACHE_SHARD_NSLOTS];
+} program_cache_shard;
+
+#define PGCACHE_SHARD(hash)						\
+	(&pgcache_head->shards[(hash) % PGCACHE_NUM_SHARDS])
+#define PGCACHE_HASH_SLOT(shard,hash)			\
+	(&(shard)->hash_slots[((hash) / PGCACHE_NUM_SHARDS) %	\
+						  PGCACHE_SHARD_NSLOTS])
+
+/*
+ * Build queue
+ *
+ * Programs to be built are queued to the build queue, then a fixed number
+ * of build workers pick up the request with the highest priority. Priority
+ * is the device priority class of the requester (interactive first), then
+ * FIFO order. Requests are deduplicated by the hash of the program; if a
+ * higher priority backend joins to wait for the queued program, the request
+ * inherits the priority.
+ * A request shall be cancelled if all the waiting backends have gone when
+ * a build worker picks it up. In-progress build cannot be interrupted.
+ *
+ * build_lock may be acquired under shard->lock, but not in reverse.
+ */
+#define PGCACHE_BUILD_QUEUE_SIZE	256
+#define PGCACHE_MAX_BUILD_WORKERS	32
+
+typedef struct
+{
+	program_cache_entry *entry;
+	uint64		hash;		/* hash of the program, for deduplication */
+	int			priority;	/* smaller is higher */
+	cl_ulong	seqno;		/* FIFO order within the same priority */
+} program_build_request;
+
+typedef struct
+{
+	slock_t		lock;		/* lock of the allocator */
 	dlist_head	free_list[PGCACHE_MAX_BITS + 1];
-	dlist_head	active_list[PGCACHE_HASH_SIZE];
-	dlist_head	lru_list;
+	program_cache_entry *clock_hand;	/* next entry to be swept */
 	program_cache_entry *entry_begin;	/* start address of entries */
 	program_cache_entry *entry_end;		/* end address of entries */
+	program_cache_shard	shards[PGCACHE_NUM_SHARDS];
+	/* build queue */
+	slock_t		build_lock;
+	cl_uint		build_nitems;
+	cl_ulong	build_seqno;
+	int			build_workers[PGCACHE_MAX_BUILD_WORKERS];	/* pgprocno + 1,
+															 * or 0 if none */
+	program_build_request build_queue[PGCACHE_BUILD_QUEUE_SIZE];
+	bool		manifest_replayed;	/* warm-up is already kicked */
 	char		data[FLEXIBLE_ARRAY_MEMBER];
 } program_cache_head;
 
+/*
+ * On-disk cache of the built programs
+ *
+ * Built images are also written to PGCACHE_DISK_DIR, so the program cache
+ * survives restart of the postmaster. Images are kept in a subdirectory per
+ * toolchain; its name contains version of NVRTC, device capability and
+ * checksum of the PG-Strom version and device code libraries, because
+ * images are not compatible once any of them gets changed.
+ * Each file is named by the CRC of extra_flags + kern_source and the CRC of
+ * kern_define, and contains the full source and definition to be compared,
+ * then the image. Modification time of the file works as LRU hint; it is
+ * touched on load, and the oldest ones are removed when total size of the
+ * directory exceeds pg_strom.program_disk_cache_size.
+ */
+#define PGCACHE_DISK_DIR		"pg_strom_cache"
+#define PGCACHE_DISK_MAGIC		0x50475343		/* "PGSC" */
+
+typedef struct
+{
+	cl_uint		magic;			/* PGCACHE_DISK_MAGIC */
+	cl_uint		extra_flags;
+	pg_crc32	crc;			/* checksum of the payload */
+	Size		source_len;		/* length of kern_source, without '\0' */
+	Size		define_len;		/* length of kern_define, without '\0' */
+	Size		bin_length;		/* length of the image */
+} program_disk_cache_header;
+
+typedef struct
+{
+	char		filename[NAMEDATALEN];
+	time_t		mtime;
+	off_t		size;
+} program_disk_cache_file;
+
+/*
+ * Manifest of the frequently used programs
+ *
+ * Programs which hit on the program cache pg_strom.program_manifest_threshold
+ * times are recorded to PGCACHE_MANIFEST_FILE, with the type oid declarations
+ * to be built without database connection. The first build worker replays
+ * the manifest on startup of the postmaster; programs are loaded from the
+ * on-disk cache or queued with the lowest priority, so the first execution
+ * of the query shapes does not stall on the kernel build.
+ * Records are appended by backends with O_APPEND, then the file is compacted
+ * on the replay. A record appended during the compaction may be lost, but
+ * it is recorded again later.
+ * Warmed-up programs are recorded again once they hit the threshold, so the
+ * compaction keeps the latest record of each program, and evicts the least
+ * recently recorded ones beyond PGCACHE_MANIFEST_MAX_ITEMS. Warm-up requests
+ * never occupy the last PGCACHE_BUILD_QUEUE_RESERVED slots of the build
+ * queue, to keep room for the requests by backends.
+ */
+#define PGCACHE_MANIFEST_FILE		PGCACHE_DISK_DIR "/manifest"
+#define PGCACHE_MANIFEST_MAGIC		0x5047534d		/* "PGSM" */
+#define PGCACHE_MANIFEST_MAX_ITEMS	1000
+#define PGCACHE_PRIORITY_WARMUP		2	/* lower than any scheduler class */
+#define PGCACHE_BUILD_QUEUE_RESERVED	(PGCACHE_BUILD_QUEUE_SIZE / 2)
+
+typedef struct
+{
+	cl_uint		magic;			/* PGCACHE_MANIFEST_MAGIC */
+	cl_uint		extra_flags;
+	pg_crc32	crc;			/* checksum of the payload */
+	cl_uint		source_len;		/* length of kern_source, without '\0' */
+	cl_uint		define_len;		/* length of kern_define, without '\0' */
+	cl_uint		typeoids_len;	/* length of kern_typeoids, without '\0' */
+} program_manifest_record;
+
+typedef struct
+{
+	uint64		hash;
+	cl_uint		extra_flags;
+	const char *kern_source;
+	const char *kern_define;
+	const char *kern_typeoids;
+} program_manifest_item;
+
 /* ---- GUC variables ---- */
 static Size		program_cache_size;
+static int		program_disk_cache_size;	/* kB, 0 = disabled */
+static int		program_build_workers;
+static char	   *program_build_command;
+static int		program_manifest_threshold;	/* 0 = disabled */
 static bool		pgstrom_enable_cuda_coredump;
 
 /* ---- static variables ---- */
 static shmem_startup_hook_type shmem_startup_next;
 static program_cache_head *pgcache_head = NULL;
+static int		nvrtc_version_major;
+static int		nvrtc_version_minor;
+static volatile sig_atomic_t build_worker_got_sigterm = false;
+
+/* ---- hook for the build step ---- */
+pgstrom_build_program_hook_type pgstrom_build_program_hook = NULL;
 
 /* ---- static functions ---- */
-static program_cache_entry *pgstrom_program_cache_alloc(Size required);
+static program_cache_entry *pgstrom_program_cache_alloc(Size required,
+														uint64 hash);
 static void pgstrom_program_cache_free(program_cache_entry *entry);
+static void pgstrom_program_cache_detach(program_cache_entry *entry);
 
 /*
  * pgstrom_wakeup_backends
  *
  * wake up the backends that may be blocked for kernel build.
- * we expects caller already hold pgcache_head->lock
+ * we expects caller already hold the lock of the shard
  */
 static void
 pgstrom_wakeup_backends(Bitmapset *waiting_backends)
@@ -146,26 +314,57 @@ pgstrom_wakeup_backends(Bitmapset *waiting_backends)
  * pgstrom_program_cache_reclaim
  *
  * it tries to reclaim the shared memory if highly memory presure.
+ * caller must hold pgcache_head->lock.
  */
 static bool
 pgstrom_program_cache_reclaim(int shift_min)
 {
 	program_cache_entry *entry;
+	program_cache_shard *shard;
+	Size		total_size;
+	Size		scan_size = 0;
+	int			shift;
 
-	while (!dlist_is_empty(&pgcache_head->lru_list))
+	/* at most two rounds; 1st one may clear the reference bits only */
+	total_size = ((uintptr_t)pgcache_head->entry_end -
+				  (uintptr_t)pgcache_head->entry_begin);
+	while (scan_size < 2 * total_size)
 	{
-		dlist_node *dnode = dlist_tail_node(&pgcache_head->lru_list);
-		int			shift;
+		entry = pgcache_head->clock_hand;
+		if (entry >= pgcache_head->entry_end)
+			entry = pgcache_head->entry_begin;
+		pgcache_head->clock_hand = (program_cache_entry *)
+			((char *)entry + (1UL << entry->shift));
+		scan_size += (1UL << entry->shift);
+
+		/*
+		 * state of free or allocated entry is stable under the allocator
+		 * lock, and others are never released without this lock.
+		 */
+		if (entry->state == PGCACHE_STATE_FREE ||
+			entry->state == PGCACHE_STATE_ALLOCATED)
+			continue;
 
-		entry = dlist_container(program_cache_entry, lru_chain, dnode);
-		PGCACHE_CHECK_ACTIVE(entry);
-		/* remove from the list not to be reclaimed again */
-		dlist_delete(&entry->hash_chain);
-		dlist_delete(&entry->lru_chain);
-		memset(&entry->hash_chain, 0, sizeof(dlist_node));
-		memset(&entry->lru_chain, 0, sizeof(dlist_node));
+		shard = PGCACHE_SHARD(entry->hash);
+		SpinLockAcquire(&shard->lock);
+		/* in-progress entry shall be released by the builder */
+		if (entry->state != PGCACHE_STATE_ACTIVE || !entry->bin_image)
+		{
+			SpinLockRelease(&shard->lock);
+			continue;
+		}
+		/* give a second chance, if recently referenced */
+		if (entry->refbit)
+		{
+			entry->refbit = false;
+			SpinLockRelease(&shard->lock);
+			continue;
+		}
+		/* detach the entry not to be looked up any more */
+		pgstrom_program_cache_detach(entry);
+		SpinLockRelease(&shard->lock);
 
-		if (--entry->refcnt == 0)
+		if (pg_atomic_sub_fetch_u32(&entry->refcnt, 1) == 0)
 		{
 			pgstrom_program_cache_free(entry);
 
@@ -211,7 +410,8 @@ pgstrom_program_cache_split(int shift)
 	/* earlier half */
 	memset(entry, 0, offsetof(program_cache_entry, data[0]));
 	entry->shift = shift;
-	entry->refcnt = 0;
+	entry->state = PGCACHE_STATE_FREE;
+	pg_atomic_init_u32(&entry->refcnt, 0);
 	PGCACHE_MAGIC_CODE(entry) = PGCACHE_MAGIC;
 	dlist_push_tail(&pgcache_head->free_list[shift], &entry->hash_chain);
 
@@ -219,15 +419,23 @@ pgstrom_program_cache_split(int shift)
 	entry = (program_cache_entry *)((char *)entry + (1UL << shift));
 	memset(entry, 0, offsetof(program_cache_entry, data[0]));
 	entry->shift = shift;
-	entry->refcnt = 0;
+	entry->state = PGCACHE_STATE_FREE;
+	pg_atomic_init_u32(&entry->refcnt, 0);
 	PGCACHE_MAGIC_CODE(entry) = PGCACHE_MAGIC;
 	dlist_push_tail(&pgcache_head->free_list[shift], &entry->hash_chain);
 
 	return true;
 }
 
+/*
+ * pgstrom_program_cache_alloc
+ *
+ * It allocates a new entry with refcnt = 1, for the program of the supplied
+ * hash value. It acquires pgcache_head->lock by itself, so caller must not
+ * hold any shard->lock.
+ */
 static program_cache_entry *
-pgstrom_program_cache_alloc(Size required)
+pgstrom_program_cache_alloc(Size required, uint64 hash)
 {
 	program_cache_entry *entry;
 	dlist_node *dnode;
@@ -247,18 +455,22 @@ pgstrom_program_cache_alloc(Size required)
 	if (shift < PGCACHE_MIN_BITS)
 		shift = PGCACHE_MIN_BITS;
 
+	SpinLockAcquire(&pgcache_head->lock);
 	if (dlist_is_empty(&pgcache_head->free_list[shift]))
 	{
 		/*
 		 * If no entries are free in the suitable class,
 		 * we try to split larger blocks first, then try
-		 * to reclaim entries according to LRU.
+		 * to reclaim entries according to CLOCK.
 		 * If both of them make no sense, we give up!
 		 */
 		while (!pgstrom_program_cache_split(shift + 1))
 		{
 			if (!pgstrom_program_cache_reclaim(shift))
+			{
+				SpinLockRelease(&pgcache_head->lock);
 				return NULL;
+			}
 		}
 	}
 	Assert(!dlist_is_empty(&pgcache_head->free_list[shift]));
@@ -269,24 +481,34 @@ pgstrom_program_cache_alloc(Size required)
 
 	memset(entry, 0, sizeof(program_cache_entry));
 	entry->shift = shift;
-	entry->refcnt = 1;
+	entry->state = PGCACHE_STATE_ALLOCATED;
+	pg_atomic_init_u32(&entry->refcnt, 1);
+	entry->hash = hash;
 	PGCACHE_MAGIC_CODE(entry) = PGCACHE_MAGIC;
+	SpinLockRelease(&pgcache_head->lock);
 
 	return entry;
 }
 
+/*
+ * pgstrom_program_cache_free
+ *
+ * caller must hold pgcache_head->lock.
+ */
 static void
 pgstrom_program_cache_free(program_cache_entry *entry)
 {
 	int			shift = entry->shift;
 	Size		offset;
 
-	Assert(entry->refcnt == 0);
+	Assert(pg_atomic_read_u32(&entry->refcnt) == 0);
+	Assert(entry->state == PGCACHE_STATE_ALLOCATED ||
+		   entry->state == PGCACHE_STATE_DETACHED);
 	Assert(!entry->hash_chain.next && !entry->hash_chain.prev);
-	Assert(!entry->lru_chain.next && !entry->lru_chain.prev);
 
 	offset = (uintptr_t)entry - (uintptr_t)pgcache_head->entry_begin;
 	Assert((offset & ((1UL << shift) - 1)) == 0);
+	entry->state = PGCACHE_STATE_FREE;
 
 	/* try to merge buddy entry, if it is also free */
 	while (shift < PGCACHE_MAX_BITS)
@@ -301,29 +523,8 @@ pgstrom_program_cache_free(program_cache_entry *entry)
 
 		if (buddy >= pgcache_head->entry_end ||		/* out of range? */
 			buddy->shift != shift ||				/* same size? */
-			PGCACHE_ACTIVE_ENTRY(buddy))			/* and free entry? */
+			buddy->state != PGCACHE_STATE_FREE)		/* and free entry? */
 			break;
-#ifdef NOT_USED
-		/* Sanity check - buddy should be in free list */
-		do {
-			dlist_head	   *free_list = pgcache_head->free_list + shift;
-			dlist_iter		iter;
-			bool			found = false;
-
-			dlist_foreach (iter, free_list)
-			{
-				program_cache_entry *temp
-					= dlist_container(program_cache_entry,
-									  hash_chain, iter.cur);
-				if (temp == buddy)
-				{
-					found = true;
-					break;
-				}
-			}
-			Assert(found);
-		} while(0);
-#endif
 		/* OK, chunk and buddy can be merged */
 		PGCACHE_CHECK_FREE(buddy);
 		dlist_delete(&buddy->hash_chain);	/* remove from free_list */
@@ -335,24 +536,203 @@ pgstrom_program_cache_free(program_cache_entry *entry)
 	}
 	PGCACHE_CHECK_FREE(entry);
 	dlist_push_head(&pgcache_head->free_list[shift], &entry->hash_chain);
+
+	/* clock hand must not point the middle of merged entry */
+	if (pgcache_head->clock_hand > entry &&
+		(char *)pgcache_head->clock_hand < (char *)entry + (1UL << shift))
+		pgcache_head->clock_hand = entry;
 }
 
 static void
 pgstrom_put_cuda_program(program_cache_entry *entry)
 {
-	SpinLockAcquire(&pgcache_head->lock);
-	if (--entry->refcnt == 0)
+	if (pg_atomic_sub_fetch_u32(&entry->refcnt, 1) == 0)
 	{
 		/*
 		 * NOTE: unless either pgstrom_program_cache_reclaim() or
-		 * __build_cuda_program() don't detach entry from active
-		 * entries hash, it never goes to refcnt == 0.
+		 * __build_cuda_program() don't detach entry from the hash
+		 * slot, it never goes to refcnt == 0.
 		 */
-		Assert(!entry->hash_chain.next && !entry->hash_chain.prev);
-		Assert(!entry->lru_chain.next && !entry->lru_chain.prev);
+		SpinLockAcquire(&pgcache_head->lock);
 		pgstrom_program_cache_free(entry);
+		SpinLockRelease(&pgcache_head->lock);
 	}
-	SpinLockRelease(&pgcache_head->lock);
+}
+
+/*
+ * pgstrom_program_cache_hash
+ *
+ * 64bit hash of the program; hash_any() of the source and CRC32 are
+ * independent, so false match by the hash value is very rare.
+ */
+static uint64
+pgstrom_program_cache_hash(pg_crc32 crc,
+						   const char *kern_source, Size source_len,
+						   const char *kern_define, Size define_len)
+{
+	uint64		hash;
+
+	hash = ((uint64)DatumGetUInt32(hash_any((const unsigned char *)kern_source,
+											source_len)) << 32) | (uint64)crc;
+	if (define_len > 0)
+		hash ^= ((uint64)DatumGetUInt32(hash_any((const unsigned char *)
+												 kern_define,
+												 define_len))
+				 * UINT64CONST(0x9e3779b97f4a7c15));
+	return hash;
+}
+
+/*
+ * pgstrom_program_cache_lookup
+ *
+ * It looks up the entry in the hash slot. Caller must hold the lock of
+ * the shard.
+ */
+static program_cache_entry *
+pgstrom_program_cache_lookup(dlist_head *hash_slot, uint64 hash,
+							 cl_uint extra_flags,
+							 const char *kern_source, Size source_len,
+							 const char *kern_define, Size define_len)
+{
+	dlist_iter	iter;
+
+	dlist_foreach (iter, hash_slot)
+	{
+		program_cache_entry *entry
+			= dlist_container(program_cache_entry, hash_chain, iter.cur);
+
+		Assert(entry->state == PGCACHE_STATE_ACTIVE);
+		if (entry->hash == hash &&
+			entry->extra_flags == extra_flags &&
+			entry->source_len == source_len &&
+			entry->define_len == define_len &&
+			memcmp(entry->kern_source, kern_source, source_len) == 0 &&
+			memcmp(entry->kern_define, kern_define, define_len) == 0)
+			return entry;
+	}
+	return NULL;
+}
+
+/*
+ * pgstrom_program_cache_attach
+ *
+ * It attaches an allocated entry to the hash slot; the reference
+ * counter is inherited by the hash slot. Caller must hold the lock of
+ * the shard.
+ */
+static void
+pgstrom_program_cache_attach(program_cache_entry *entry)
+{
+	program_cache_shard *shard = PGCACHE_SHARD(entry->hash);
+
+	Assert(entry->state == PGCACHE_STATE_ALLOCATED);
+	entry->state = PGCACHE_STATE_ACTIVE;
+	entry->refbit = true;
+	dlist_push_head(PGCACHE_HASH_SLOT(shard, entry->hash),
+					&entry->hash_chain);
+}
+
+/*
+ * pgstrom_program_cache_detach
+ *
+ * It detaches an entry from the hash slot, then caller has to release
+ * the reference counter of the hash slot. Caller must hold the lock of
+ * the shard.
+ */
+static void
+pgstrom_program_cache_detach(program_cache_entry *entry)
+{
+	Assert(entry->state == PGCACHE_STATE_ACTIVE);
+	dlist_delete(&entry->hash_chain);
+	memset(&entry->hash_chain, 0, sizeof(dlist_node));
+	entry->state = PGCACHE_STATE_DETACHED;
+}
+
+/*
+ * pgstrom_program_cache_create
+ *
+ * It allocates a new entry for the program to be built, but not attached
+ * to the hash slot yet. Nobody waits for the build at this point.
+ */
+static program_cache_entry *
+pgstrom_program_cache_create(pg_crc32 crc, uint64 hash,
+							 cl_uint extra_flags,
+							 const char *kern_source,
+							 const char *kern_define,
+							 const char *kern_typeoids)
+{
+	program_cache_entry *entry;
+	Size		kern_source_len = strlen(kern_source);
+	Size		kern_define_len = strlen(kern_define);
+	Size		kern_typeoids_len = strlen(kern_typeoids);
+	Size		required;
+	Size		usage;
+	int			nwords;
+
+	required = offsetof(program_cache_entry, data[0]);
+	nwords = (ProcGlobal->allProcCount +
+			  BITS_PER_BITMAPWORD - 1) / BITS_PER_BITMAPWORD;
+	required += MAXALIGN(offsetof(Bitmapset, words[nwords]));
+	required += MAXALIGN(kern_source_len + 1);
+	required += MAXALIGN(kern_define_len + 1);
+	required += MAXALIGN(kern_typeoids_len + 1);
+	required += 512;	/* margin for error message */
+	usage = 0;
+
+	entry = pgstrom_program_cache_alloc(required, hash);
+	if (!entry)
+		elog(ERROR, "out of shared memory");
+	entry->manifested = false;
+	entry->warmup = false;
+	entry->nhits = 0;
+	entry->crc = crc;
+	memset(&entry->tv_build_end, 0, sizeof(struct timeval));
+	/* bitmap for waiting backends */
+	entry->waiting_backends = (Bitmapset *) entry->data;
+	entry->waiting_backends->nwords = nwords;
+	memset(entry->waiting_backends->words, 0, sizeof(bitmapword) * nwords);
+	usage += MAXALIGN(offsetof(Bitmapset, words[nwords]));
+	/* session info who tries to build the program, if any */
+	entry->database_oid = MyDatabaseId;
+	entry->user_oid = (OidIsValid(MyDatabaseId) ? GetUserId() : InvalidOid);
+	/* device kernel source */
+	entry->extra_flags = extra_flags;
+	entry->source_len = kern_source_len;
+	entry->define_len = kern_define_len;
+	entry->kern_source = (char *)(entry->data + usage);
+	memcpy(entry->kern_source, kern_source, kern_source_len + 1);
+	usage += MAXALIGN(kern_source_len + 1);
+	entry->kern_define = (char *)(entry->data + usage);
+	memcpy(entry->kern_define, kern_define, kern_define_len + 1);
+	usage += MAXALIGN(kern_define_len + 1);
+	entry->kern_typeoids = (char *)(entry->data + usage);
+	memcpy(entry->kern_typeoids, kern_typeoids, kern_typeoids_len + 1);
+	usage += MAXALIGN(kern_typeoids_len + 1);
+	/* no cuda binary yet */
+	entry->bin_image = NULL;
+	entry->bin_length = 0;
+	/* remaining are for error message */
+	entry->error_msg = (char *)(entry->data + usage);
+
+	return entry;
+}
+
+/*
+ * construct_kern_typeoids
+ *
+ * It makes declarations of the device type oids. Because it needs catalog
+ * access of the current database, requester has to make it prior to the
+ * build by the build workers.
+ */
+static char *
+construct_kern_typeoids(void)
+{
+	StringInfoData	buf;
+
+	initStringInfo(&buf);
+	pgstrom_codegen_typeoid_declarations(&buf);
+
+	return buf.data;
 }
 
 /*
@@ -362,7 +742,9 @@ pgstrom_put_cuda_program(program_cache_entry *entry)
  */
 static char *
 construct_flat_cuda_source(const char *kern_source,
-						   const char *kern_define, uint32 extra_flags)
+						   const char *kern_define,
+						   const char *kern_typeoids,
+						   uint32 extra_flags)
 {
 	StringInfoData		source;
 
@@ -390,7 +772,7 @@ construct_flat_cuda_source(const char *kern_source,
 					 "extern \"C\" {\n"
 					 "#endif	/* __cplusplus */\n");
 	/* Declaration of device type oids */
-	pgstrom_codegen_typeoid_declarations(&source);
+	appendStringInfoString(&source, kern_typeoids);
 
 	/* Common PG-Strom device routine */
 	appendStringInfoString(&source, pgstrom_cuda_common_code);
@@ -624,101 +1006,551 @@ pgstrom_cuda_source_file(GpuTaskState *gts)
 {
 	char   *cuda_source = construct_flat_cuda_source(gts->kern_source,
 													 gts->kern_define,
+													 construct_kern_typeoids(),
 													 gts->extra_flags);
 	return writeout_cuda_source_file(cuda_source);
 }
 
-static void
-__build_cuda_program(program_cache_entry *old_entry)
+/*
+ * program_disk_cache_dirname
+ *
+ * It returns the directory of the on-disk cache for the current toolchain.
+ */
+static const char *
+program_disk_cache_dirname(void)
 {
-	char		   *source;
-	const char	   *source_pathname = NULL;
-	nvrtcProgram	program;
-	nvrtcResult		rc;
-	const char	   *options[10];
-	int				opt_index = 0;
-	void		   *bin_image;
-	size_t			bin_length;
-	char		   *build_log;
-	size_t			length;
-	Size			required;
-	Size			usage;
-	int				hindex;
-	bool			build_failure = false;
-	program_cache_entry *new_entry;
-
-	/*
-	 * Make a nvrtcProgram object
-	 */
-	source = construct_flat_cuda_source(old_entry->kern_source,
-										old_entry->kern_define,
-										old_entry->extra_flags);
-	rc = nvrtcCreateProgram(&program,
-							source,
-							"pg_strom",
-							0,
-							NULL,
-							NULL);
-	if (rc != NVRTC_SUCCESS)
-		elog(ERROR, "failed on nvrtcCreateProgram: %s",
-			 nvrtcGetErrorString(rc));
+	static char	dirname[MAXPGPATH] = "";
 
-	/*
-	 * Put command line options
-	 */
-	options[opt_index++] = "-I " CUDA_INCLUDE_PATH;
-	options[opt_index++] =
-		psprintf("--gpu-architecture=compute_%lu",
-				 pgstrom_baseline_cuda_capability());
+	if (dirname[0] == '\0')
+	{
+		const char *libs[] = {
+			pgstrom_cuda_common_code,
+			pgstrom_cuda_dynpara_code,
+			pgstrom_cuda_matrix_code,
+			pgstrom_cuda_gpuscan_code,
+			pgstrom_cuda_gpujoin_code,
+			pgstrom_cuda_gpupreagg_code,
+			pgstrom_cuda_gpusort_code,
+			pgstrom_cuda_mathlib_code,
+			pgstrom_cuda_textlib_code,
+			pgstrom_cuda_timelib_code,
+			pgstrom_cuda_numeric_code,
+			pgstrom_cuda_money_code,
+			pgstrom_cuda_plcuda_code,
+			pgstrom_cuda_terminal_code,
+		};
+		char		toolchain[NAMEDATALEN];
+		pg_crc32	crc;
+		int			i;
+
+		INIT_LEGACY_CRC32(crc);
+		COMP_LEGACY_CRC32(crc, PGSTROM_VERSION, strlen(PGSTROM_VERSION));
 #ifdef PGSTROM_DEBUG
-	options[opt_index++] = "--device-debug";
-	options[opt_index++] = "--generate-line-info";
+		COMP_LEGACY_CRC32(crc, "debug", 5);
 #endif
-	options[opt_index++] = "--use_fast_math";
-	/* library linkage needs relocatable PTX */
-	if (old_entry->extra_flags & DEVKERNEL_NEEDS_DYNPARA)
-		options[opt_index++] = "--relocatable-device-code=true";
+		for (i=0; i < lengthof(libs); i++)
+			COMP_LEGACY_CRC32(crc, libs[i], strlen(libs[i]));
+		FIN_LEGACY_CRC32(crc);
 
-	/*
-	 * Kick runtime compiler
-	 */
-	rc = nvrtcCompileProgram(program, opt_index, options);
-	if (rc != NVRTC_SUCCESS)
-	{
-		if (rc == NVRTC_ERROR_COMPILATION)
-			build_failure = true;
+		if (pgstrom_build_program_hook ||
+			(program_build_command && *program_build_command))
+			snprintf(toolchain, sizeof(toolchain), "custom");
 		else
-			elog(ERROR, "failed on nvrtcCompileProgram: %s",
-				 nvrtcGetErrorString(rc));
+			snprintf(toolchain, sizeof(toolchain), "nvrtc%d.%d",
+					 nvrtc_version_major, nvrtc_version_minor);
+		snprintf(dirname, sizeof(dirname), "%s/%s_sm%lu_%08x",
+				 PGCACHE_DISK_DIR, toolchain,
+				 pgstrom_baseline_cuda_capability(), crc);
 	}
+	return dirname;
+}
 
-	/*
-	 * Save the source file, if required or build failure
-	 */
-	if (build_failure)
-		source_pathname = writeout_cuda_source_file(source);
+static void
+program_disk_cache_filename(char *path, pg_crc32 crc, const char *kern_define)
+{
+	pg_crc32	crc_define;
 
-	/*
-	 * Read PTX Binary
-	 */
-	if (build_failure)
+	INIT_LEGACY_CRC32(crc_define);
+	COMP_LEGACY_CRC32(crc_define, kern_define, strlen(kern_define));
+	FIN_LEGACY_CRC32(crc_define);
+
+	snprintf(path, MAXPGPATH, "%s/%08x%08x.bin",
+			 program_disk_cache_dirname(), crc, crc_define);
+}
+
+static bool
+__program_disk_cache_read(int fdesc, void *buffer, size_t length)
+{
+	ssize_t		nbytes;
+
+	while (length > 0)
 	{
-		bin_image = NULL;
-		bin_length = 0;
+		nbytes = read(fdesc, buffer, length);
+		if (nbytes < 0 && errno == EINTR)
+			continue;
+		if (nbytes <= 0)
+			return false;
+		buffer = (char *)buffer + nbytes;
+		length -= nbytes;
 	}
-	else
-	{
-		char	   *ptx_image;
-		size_t		ptx_length;
+	return true;
+}
 
-		rc = nvrtcGetPTXSize(program, &ptx_length);
-		if (rc != NVRTC_SUCCESS)
-			elog(ERROR, "failed on nvrtcGetPTXSize: %s",
-				 nvrtcGetErrorString(rc));
-		ptx_image = palloc(ptx_length + 1);
+static bool
+__program_disk_cache_write(int fdesc, const void *buffer, size_t length)
+{
+	ssize_t		nbytes;
 
-		rc = nvrtcGetPTX(program, ptx_image);
-		if (rc != NVRTC_SUCCESS)
+	while (length > 0)
+	{
+		nbytes = write(fdesc, buffer, length);
+		if (nbytes < 0 && errno == EINTR)
+			continue;
+		if (nbytes <= 0)
+			return false;
+		buffer = (const char *)buffer + nbytes;
+		length -= nbytes;
+	}
+	return true;
+}
+
+static int
+program_disk_cache_file_cmp(const void *a, const void *b)
+{
+	const program_disk_cache_file *file_a = a;
+	const program_disk_cache_file *file_b = b;
+
+	if (file_a->mtime < file_b->mtime)
+		return -1;
+	if (file_a->mtime > file_b->mtime)
+		return 1;
+	return 0;
+}
+
+/*
+ * program_disk_cache_evict
+ *
+ * It removes the least recently used files until total size of the
+ * directory fits pg_strom.program_disk_cache_size.
+ */
+static void
+program_disk_cache_evict(const char *dirname)
+{
+	program_disk_cache_file *files;
+	int			nitems = 0;
+	int			nrooms = 100;
+	Size		total = 0;
+	Size		limit = (Size)program_disk_cache_size * 1024L;
+	char		path[MAXPGPATH];
+	DIR		   *dir;
+	struct dirent *dent;
+	struct stat	st_buf;
+	int			i;
+
+	dir = AllocateDir(dirname);
+	if (!dir)
+		return;
+	files = palloc(sizeof(program_disk_cache_file) * nrooms);
+	while ((dent = ReadDir(dir, dirname)) != NULL)
+	{
+		size_t	len = strlen(dent->d_name);
+
+		if (len < 4 || len >= NAMEDATALEN ||
+			strcmp(dent->d_name + len - 4, ".bin") != 0)
+			continue;
+		snprintf(path, sizeof(path), "%s/%s", dirname, dent->d_name);
+		if (stat(path, &st_buf) != 0)
+			continue;	/* concurrently removed */
+
+		if (nitems == nrooms)
+		{
+			nrooms *= 2;
+			files = repalloc(files, sizeof(program_disk_cache_file) * nrooms);
+		}
+		strcpy(files[nitems].filename, dent->d_name);
+		files[nitems].mtime = st_buf.st_mtime;
+		files[nitems].size = st_buf.st_size;
+		total += st_buf.st_size;
+		nitems++;
+	}
+	FreeDir(dir);
+
+	if (total > limit)
+	{
+		qsort(files, nitems, sizeof(program_disk_cache_file),
+			  program_disk_cache_file_cmp);
+		for (i=0; i < nitems && total > limit; i++)
+		{
+			snprintf(path, sizeof(path), "%s/%s", dirname, files[i].filename);
+			if (unlink(path) != 0 && errno != ENOENT)
+				elog(LOG, "could not remove file \"%s\": %m", path);
+			total -= files[i].size;
+		}
+	}
+	pfree(files);
+}
+
+/*
+ * program_disk_cache_write
+ *
+ * It writes out the built image to the on-disk cache. Any errors are not
+ * critical here, so we just report them to the log.
+ * The file is written to a temporary file then renamed, so readers never
+ * see a partial image. We don't fsync it; a file broken by system crash
+ * shall be detected by the checksum, then built again.
+ */
+static void
+program_disk_cache_write(pg_crc32 crc, cl_uint extra_flags,
+						 const char *kern_source, const char *kern_define,
+						 const void *bin_image, size_t bin_length)
+{
+	program_disk_cache_header hdr;
+	const char *dirname;
+	char		path[MAXPGPATH];
+	char		temp[MAXPGPATH];
+	int			fdesc;
+
+	if (program_disk_cache_size <= 0)
+		return;
+
+	dirname = program_disk_cache_dirname();
+	if ((mkdir(PGCACHE_DISK_DIR, S_IRWXU) != 0 && errno != EEXIST) ||
+		(mkdir(dirname, S_IRWXU) != 0 && errno != EEXIST))
+	{
+		elog(LOG, "could not create directory \"%s\": %m", dirname);
+		return;
+	}
+
+	memset(&hdr, 0, sizeof(program_disk_cache_header));
+	hdr.magic = PGCACHE_DISK_MAGIC;
+	hdr.extra_flags = extra_flags;
+	hdr.source_len = strlen(kern_source);
+	hdr.define_len = strlen(kern_define);
+	hdr.bin_length = bin_length;
+	INIT_LEGACY_CRC32(hdr.crc);
+	COMP_LEGACY_CRC32(hdr.crc, kern_source, hdr.source_len + 1);
+	COMP_LEGACY_CRC32(hdr.crc, kern_define, hdr.define_len + 1);
+	COMP_LEGACY_CRC32(hdr.crc, bin_image, bin_length);
+	FIN_LEGACY_CRC32(hdr.crc);
+
+	program_disk_cache_filename(path, crc, kern_define);
+	snprintf(temp, sizeof(temp), "%s.tmp.%d", path, MyProcPid);
+	fdesc = OpenTransientFile(temp,
+							  O_WRONLY | O_CREAT | O_TRUNC | PG_BINARY,
+							  S_IRUSR | S_IWUSR);
+	if (fdesc < 0)
+	{
+		elog(LOG, "could not create file \"%s\": %m", temp);
+		return;
+	}
+
+	if (!__program_disk_cache_write(fdesc, &hdr, sizeof(hdr)) ||
+		!__program_disk_cache_write(fdesc, kern_source, hdr.source_len + 1) ||
+		!__program_disk_cache_write(fdesc, kern_define, hdr.define_len + 1) ||
+		!__program_disk_cache_write(fdesc, bin_image, bin_length))
+	{
+		elog(LOG, "could not write file \"%s\": %m", temp);
+		CloseTransientFile(fdesc);
+		unlink(temp);
+		return;
+	}
+	if (CloseTransientFile(fdesc) != 0 || rename(temp, path) != 0)
+	{
+		elog(LOG, "could not write file \"%s\": %m", path);
+		unlink(temp);
+		return;
+	}
+	program_disk_cache_evict(dirname);
+}
+
+/*
+ * program_disk_cache_load
+ *
+ * It tries to load the built image from the on-disk cache, then inserts
+ * a program cache entry with the image. It returns true, if an entry for
+ * the program is in the program cache.
+ */
+static bool
+program_disk_cache_load(pg_crc32 crc, uint64 hash, cl_uint extra_flags,
+						const char *kern_source, const char *kern_define)
+{
+	program_disk_cache_header hdr;
+	program_cache_entry *entry;
+	program_cache_shard *shard;
+	Size		source_len = strlen(kern_source);
+	Size		define_len = strlen(kern_define);
+	Size		length;
+	Size		required;
+	Size		usage;
+	char		path[MAXPGPATH];
+	char	   *buffer;
+	char	   *bin_image;
+	pg_crc32	checksum;
+	int			fdesc;
+	struct stat	st_buf;
+
+	if (program_disk_cache_size <= 0)
+		return false;
+
+	program_disk_cache_filename(path, crc, kern_define);
+	fdesc = OpenTransientFile(path, O_RDONLY | PG_BINARY, 0);
+	if (fdesc < 0)
+	{
+		if (errno != ENOENT)
+			elog(LOG, "could not open file \"%s\": %m", path);
+		return false;
+	}
+
+	if (fstat(fdesc, &st_buf) != 0 ||
+		st_buf.st_size < sizeof(program_disk_cache_header) ||
+		!__program_disk_cache_read(fdesc, &hdr, sizeof(hdr)) ||
+		hdr.magic != PGCACHE_DISK_MAGIC ||
+		hdr.extra_flags != extra_flags ||
+		hdr.source_len != source_len ||
+		hdr.define_len != define_len ||
+		hdr.bin_length >= (1UL << PGCACHE_MAX_BITS) ||
+		st_buf.st_size != (sizeof(program_disk_cache_header) +
+						   source_len + 1 +
+						   define_len + 1 +
+						   hdr.bin_length))
+	{
+		/* likely, a different program with same crc */
+		CloseTransientFile(fdesc);
+		return false;
+	}
+	length = st_buf.st_size - sizeof(program_disk_cache_header);
+	buffer = palloc(length);
+	if (!__program_disk_cache_read(fdesc, buffer, length))
+	{
+		elog(LOG, "could not read file \"%s\": %m", path);
+		CloseTransientFile(fdesc);
+		pfree(buffer);
+		return false;
+	}
+	CloseTransientFile(fdesc);
+
+	INIT_LEGACY_CRC32(checksum);
+	COMP_LEGACY_CRC32(checksum, buffer, length);
+	FIN_LEGACY_CRC32(checksum);
+	if (!EQ_LEGACY_CRC32(checksum, hdr.crc))
+	{
+		elog(LOG, "program cache \"%s\" is corrupted, removed", path);
+		unlink(path);
+		pfree(buffer);
+		return false;
+	}
+	if (memcmp(buffer, kern_source, source_len + 1) != 0 ||
+		memcmp(buffer + source_len + 1, kern_define, define_len + 1) != 0)
+	{
+		pfree(buffer);
+		return false;
+	}
+	bin_image = buffer + source_len + 1 + define_len + 1;
+
+	/* touch the file; modification time is a hint of LRU */
+	if (utime(path, NULL) != 0)
+		elog(DEBUG1, "could not touch file \"%s\": %m", path);
+
+	/*
+	 * Makes a new entry with the image, unless someone concurrent already
+	 * made an entry for the same program.
+	 */
+	required = MAXALIGN(source_len + 1);
+	required += MAXALIGN(define_len + 1);
+	required += MAXALIGN(hdr.bin_length);
+	required += 512;	/* margin for error message */
+
+	entry = pgstrom_program_cache_alloc(required, hash);
+	if (!entry)
+	{
+		pfree(buffer);
+		return false;
+	}
+	usage = 0;
+	entry->manifested = false;
+	entry->warmup = false;
+	entry->nhits = 0;
+	entry->crc = crc;
+	entry->waiting_backends = NULL;		/* no need to set latch */
+	entry->database_oid = MyDatabaseId;
+	entry->user_oid = (OidIsValid(MyDatabaseId) ? GetUserId() : InvalidOid);
+	entry->extra_flags = extra_flags;
+	entry->source_len = source_len;
+	entry->define_len = define_len;
+
+	entry->kern_source = entry->data + usage;
+	memcpy(entry->kern_source, kern_source, source_len + 1);
+	usage += MAXALIGN(source_len + 1);
+
+	entry->kern_define = entry->data + usage;
+	memcpy(entry->kern_define, kern_define, define_len + 1);
+	usage += MAXALIGN(define_len + 1);
+	entry->kern_typeoids = NULL;		/* already built */
+
+	entry->bin_image = entry->data + usage;
+	entry->bin_length = hdr.bin_length;
+	memcpy(entry->bin_image, bin_image, hdr.bin_length);
+	usage += MAXALIGN(hdr.bin_length);
+
+	entry->error_msg = entry->data + usage;
+	snprintf(entry->error_msg, PGCACHE_ERRORMSG_LEN(entry),
+			 "build: success\nloaded from %s\n", path);
+	gettimeofday(&entry->tv_build_end, NULL);
+
+	shard = PGCACHE_SHARD(hash);
+	SpinLockAcquire(&shard->lock);
+	if (pgstrom_program_cache_lookup(PGCACHE_HASH_SLOT(shard, hash), hash,
+									 extra_flags,
+									 kern_source, source_len,
+									 kern_define, define_len))
+	{
+		SpinLockRelease(&shard->lock);
+		pgstrom_put_cuda_program(entry);
+	}
+	else
+	{
+		pgstrom_program_cache_attach(entry);
+		SpinLockRelease(&shard->lock);
+	}
+	pfree(buffer);
+
+	return true;
+}
+
+/*
+ * program_disk_cache_cleanup
+ *
+ * It removes the directories for obsolete toolchains and temporary files
+ * left by crashed builders. The manifest is independent from toolchains,
+ * so it is kept. Called on startup of the postmaster.
+ */
+static void
+program_disk_cache_cleanup(void)
+{
+	const char *dirname = program_disk_cache_dirname();
+	const char *basename = dirname + strlen(PGCACHE_DISK_DIR) + 1;
+	char		path[MAXPGPATH];
+	DIR		   *dir;
+	struct dirent *dent;
+	struct stat	st_buf;
+
+	dir = AllocateDir(PGCACHE_DISK_DIR);
+	if (!dir)
+		return;		/* not exists yet */
+	while ((dent = ReadDir(dir, PGCACHE_DISK_DIR)) != NULL)
+	{
+		if (strcmp(dent->d_name, ".") == 0 ||
+			strcmp(dent->d_name, "..") == 0 ||
+			strcmp(dent->d_name, basename) == 0 ||
+			strcmp(dent->d_name, "manifest") == 0)
+			continue;
+		snprintf(path, sizeof(path), "%s/%s", PGCACHE_DISK_DIR, dent->d_name);
+		if (lstat(path, &st_buf) != 0)
+			continue;
+		if (S_ISDIR(st_buf.st_mode) ? !rmtree(path, true) : unlink(path) != 0)
+			elog(LOG, "could not remove obsolete program cache \"%s\"", path);
+	}
+	FreeDir(dir);
+
+	dir = AllocateDir(dirname);
+	if (!dir)
+		return;
+	while ((dent = ReadDir(dir, dirname)) != NULL)
+	{
+		if (strstr(dent->d_name, ".tmp.") == NULL)
+			continue;
+		snprintf(path, sizeof(path), "%s/%s", dirname, dent->d_name);
+		if (unlink(path) != 0)
+			elog(LOG, "could not remove file \"%s\": %m", path);
+	}
+	FreeDir(dir);
+}
+
+/*
+ * __nvrtc_build_program
+ *
+ * It builds the flat source using NVRTC, then links the run-time libraries
+ * if any. It returns false on compile error of the source; build log shall
+ * be returned regardless of the result.
+ */
+static bool
+__nvrtc_build_program(const char *source, cl_uint extra_flags,
+					  void **p_bin_image, size_t *p_bin_length,
+					  char **p_build_log)
+{
+	nvrtcProgram	program;
+	nvrtcResult		rc;
+	const char	   *options[10];
+	int				opt_index = 0;
+	void		   *bin_image;
+	size_t			bin_length;
+	char		   *build_log;
+	size_t			length;
+	bool			build_failure = false;
+
+	/*
+	 * Make a nvrtcProgram object
+	 */
+	rc = nvrtcCreateProgram(&program,
+							source,
+							"pg_strom",
+							0,
+							NULL,
+							NULL);
+	if (rc != NVRTC_SUCCESS)
+		elog(ERROR, "failed on nvrtcCreateProgram: %s",
+			 nvrtcGetErrorString(rc));
+
+	/*
+	 * Put command line options
+	 */
+	options[opt_index++] = "-I " CUDA_INCLUDE_PATH;
+	options[opt_index++] =
+		psprintf("--gpu-architecture=compute_%lu",
+				 pgstrom_baseline_cuda_capability());
+#ifdef PGSTROM_DEBUG
+	options[opt_index++] = "--device-debug";
+	options[opt_index++] = "--generate-line-info";
+#endif
+	options[opt_index++] = "--use_fast_math";
+	/* library linkage needs relocatable PTX */
+	if (extra_flags & DEVKERNEL_NEEDS_DYNPARA)
+		options[opt_index++] = "--relocatable-device-code=true";
+
+	/*
+	 * Kick runtime compiler
+	 */
+	rc = nvrtcCompileProgram(program, opt_index, options);
+	if (rc != NVRTC_SUCCESS)
+	{
+		if (rc == NVRTC_ERROR_COMPILATION)
+			build_failure = true;
+		else
+			elog(ERROR, "failed on nvrtcCompileProgram: %s",
+				 nvrtcGetErrorString(rc));
+	}
+
+	/*
+	 * Read PTX Binary
+	 */
+	if (build_failure)
+	{
+		bin_image = NULL;
+		bin_length = 0;
+	}
+	else
+	{
+		char	   *ptx_image;
+		size_t		ptx_length;
+
+		rc = nvrtcGetPTXSize(program, &ptx_length);
+		if (rc != NVRTC_SUCCESS)
+			elog(ERROR, "failed on nvrtcGetPTXSize: %s",
+				 nvrtcGetErrorString(rc));
+		ptx_image = palloc(ptx_length + 1);
+
+		rc = nvrtcGetPTX(program, ptx_image);
+		if (rc != NVRTC_SUCCESS)
 			elog(ERROR, "failed on nvrtcGetPTX: %s",
 				 nvrtcGetErrorString(rc));
 		ptx_image[ptx_length++] = '\0';	/* may not be necessary */
@@ -726,10 +1558,10 @@ __build_cuda_program(program_cache_entry *old_entry)
 		/*
 		 * Link the required run-time libraries, if any
 		 */
-		if (old_entry->extra_flags & DEVKERNEL_NEEDS_DYNPARA)
+		if (extra_flags & DEVKERNEL_NEEDS_DYNPARA)
 		{
 			link_cuda_libraries(ptx_image, ptx_length,
-								old_entry->extra_flags,
+								extra_flags,
 								&bin_image, &bin_length);
 			pfree(ptx_image);
 		}
@@ -755,6 +1587,151 @@ __build_cuda_program(program_cache_entry *old_entry)
 			 nvrtcGetErrorString(rc));
 	build_log[length] = '\0';	/* may not be necessary? */
 
+	*p_bin_image = bin_image;
+	*p_bin_length = bin_length;
+	*p_build_log = build_log;
+
+	return !build_failure;
+}
+
+/*
+ * __command_build_program
+ *
+ * It builds the flat source using pg_strom.debug_program_build_command,
+ * instead of NVRTC; a stand-in compiler to test the build queue and the
+ * program cache without GPU devices. The command is invoked with path of
+ * the source file and path of the image to be written, and exit status
+ * zero means success.
+ */
+static char *
+__shell_quote_path(const char *path)
+{
+	StringInfoData	buf;
+	const char	   *pos;
+
+	initStringInfo(&buf);
+	appendStringInfoChar(&buf, '\'');
+	for (pos = path; *pos != '\0'; pos++)
+	{
+		if (*pos == '\'')
+			appendStringInfoString(&buf, "'\\''");
+		else
+			appendStringInfoChar(&buf, *pos);
+	}
+	appendStringInfoChar(&buf, '\'');
+
+	return buf.data;
+}
+
+static bool
+__command_build_program(const char *source, cl_uint extra_flags,
+						void **p_bin_image, size_t *p_bin_length,
+						char **p_build_log)
+{
+	char	   *source_path;
+	char	   *image_path;
+	char	   *command;
+	char	   *bin_image = NULL;
+	size_t		bin_length = 0;
+	int			status;
+	int			fdesc;
+	struct stat	st_buf;
+
+	source_path = pstrdup(writeout_cuda_source_file((char *)source));
+	image_path = psprintf("%s.image", source_path);
+	/* paths are quoted, but the command itself may contain arguments */
+	command = psprintf("%s %s %s", program_build_command,
+					   __shell_quote_path(source_path),
+					   __shell_quote_path(image_path));
+	status = system(command);
+	if (status != 0)
+	{
+		*p_build_log = psprintf("\"%s\": %s",
+								command, wait_result_to_str(status));
+		unlink(source_path);
+		unlink(image_path);
+		return false;
+	}
+
+	fdesc = OpenTransientFile(image_path, O_RDONLY | PG_BINARY, 0);
+	if (fdesc < 0)
+		elog(ERROR, "could not open file \"%s\": %m", image_path);
+	if (fstat(fdesc, &st_buf) != 0)
+		elog(ERROR, "could not stat file \"%s\": %m", image_path);
+	bin_length = st_buf.st_size;
+	bin_image = palloc(bin_length + 1);
+	if (!__program_disk_cache_read(fdesc, bin_image, bin_length))
+		elog(ERROR, "could not read file \"%s\": %m", image_path);
+	bin_image[bin_length] = '\0';
+	CloseTransientFile(fdesc);
+
+	unlink(source_path);
+	unlink(image_path);
+
+	*p_bin_image = bin_image;
+	*p_bin_length = bin_length;
+	*p_build_log = psprintf("\"%s\": success", command);
+
+	return true;
+}
+
+static void
+__build_cuda_program(program_cache_entry *old_entry)
+{
+	char		   *source;
+	const char	   *source_pathname = NULL;
+	void		   *bin_image;
+	size_t			bin_length;
+	char		   *build_log;
+	size_t			length;
+	Size			required;
+	Size			usage;
+	bool			build_success;
+	program_cache_shard *shard;
+	program_cache_entry *new_entry;
+
+	/*
+	 * Build the flat source, using the stand-in compiler if any
+	 */
+	source = construct_flat_cuda_source(old_entry->kern_source,
+										old_entry->kern_define,
+										old_entry->kern_typeoids,
+										old_entry->extra_flags);
+	if (pgstrom_build_program_hook)
+		build_success = pgstrom_build_program_hook(source,
+												   old_entry->extra_flags,
+												   &bin_image,
+												   &bin_length,
+												   &build_log);
+	else if (program_build_command && *program_build_command)
+		build_success = __command_build_program(source,
+												old_entry->extra_flags,
+												&bin_image,
+												&bin_length,
+												&build_log);
+	else
+		build_success = __nvrtc_build_program(source,
+											  old_entry->extra_flags,
+											  &bin_image,
+											  &bin_length,
+											  &build_log);
+	if (!build_success)
+	{
+		/* Save the source file on build failure */
+		source_pathname = writeout_cuda_source_file(source);
+		bin_image = NULL;
+		bin_length = 0;
+	}
+	else
+	{
+		/* Write out the image to the on-disk cache */
+		program_disk_cache_write(old_entry->crc,
+								 old_entry->extra_flags,
+								 old_entry->kern_source,
+								 old_entry->kern_define,
+								 bin_image, bin_length);
+	}
+
 	/*
 	 * Make a new entry, instead of the old one
 	 */
@@ -765,19 +1742,20 @@ __build_cuda_program(program_cache_entry *old_entry)
 	required += MAXALIGN(strlen(build_log) + 1);
 	required += 512;	/* margin for error message */
 
-	SpinLockAcquire(&pgcache_head->lock);
-	new_entry = pgstrom_program_cache_alloc(required);
+	new_entry = pgstrom_program_cache_alloc(required, old_entry->hash);
 	if (!new_entry)
-	{
-		SpinLockRelease(&pgcache_head->lock);
 		elog(ERROR, "out of shared memory");
-	}
 	usage = 0;
+	new_entry->manifested = old_entry->manifested;
+	new_entry->warmup = false;
+	new_entry->nhits = 0;
 	new_entry->crc = old_entry->crc;
 	new_entry->waiting_backends = NULL;		/* no need to set latch */
 	new_entry->database_oid = old_entry->database_oid;
 	new_entry->user_oid = old_entry->user_oid;
 	new_entry->extra_flags = old_entry->extra_flags;
+	new_entry->source_len = old_entry->source_len;
+	new_entry->define_len = old_entry->define_len;
 
 	new_entry->kern_source = new_entry->data + usage;
 	length = strlen(old_entry->kern_source);
@@ -790,6 +1768,7 @@ __build_cuda_program(program_cache_entry *old_entry)
 	memcpy(new_entry->kern_define,
 		   old_entry->kern_define, length + 1);
 	usage += MAXALIGN(length + 1);
+	new_entry->kern_typeoids = NULL;	/* already built */
 
 	if (!bin_image)
 	{
@@ -823,15 +1802,13 @@ __build_cuda_program(program_cache_entry *old_entry)
 	/*
 	 * Add new_entry to the hash slot
 	 */
-	hindex = new_entry->crc % PGCACHE_HASH_SIZE;
-	dlist_push_head(&pgcache_head->active_list[hindex],
-					&new_entry->hash_chain);
-	dlist_push_head(&pgcache_head->lru_list,
-					&new_entry->lru_chain);
+	shard = PGCACHE_SHARD(old_entry->hash);
+	SpinLockAcquire(&shard->lock);
+	pgstrom_program_cache_attach(new_entry);
 
 	/*
 	 * Waking up blocking tasks, and detach old_entry from
-	 * the hash/lru list to ensure nobody will grab it.
+	 * the hash slot to ensure nobody will grab it.
 	 */
 	pgstrom_wakeup_backends(old_entry->waiting_backends);
 
@@ -841,11 +1818,8 @@ __build_cuda_program(program_cache_entry *old_entry)
 	 * we detach old_entry instead. pgstrom_put_cuda_program() will release
 	 * shared memory segment.
 	 */
-	dlist_delete(&old_entry->hash_chain);
-	dlist_delete(&old_entry->lru_chain);
-	memset(&old_entry->hash_chain, 0, sizeof(dlist_node));
-	memset(&old_entry->lru_chain, 0, sizeof(dlist_node));
-	SpinLockRelease(&pgcache_head->lock);
+	pgstrom_program_cache_detach(old_entry);
+	SpinLockRelease(&shard->lock);
 
 	pgstrom_put_cuda_program(old_entry);
 }
@@ -855,6 +1829,7 @@ pgstrom_build_cuda_program(program_cache_entry *entry)
 {
 	MemoryContext	memcxt = CurrentMemoryContext;
 	MemoryContext	oldcxt;
+	program_cache_shard *shard;
 
 	Assert(entry->bin_image == NULL);
 
@@ -869,7 +1844,8 @@ pgstrom_build_cuda_program(program_cache_entry *entry)
 		oldcxt = MemoryContextSwitchTo(memcxt);
 		errdata = CopyErrorData();
 
-		SpinLockAcquire(&pgcache_head->lock);
+		shard = PGCACHE_SHARD(entry->hash);
+		SpinLockAcquire(&shard->lock);
 		if (!entry->bin_image)
 		{
 			snprintf(entry->error_msg, PGCACHE_ERRORMSG_LEN(entry),
@@ -881,37 +1857,852 @@ pgstrom_build_cuda_program(program_cache_entry *entry)
 			entry->bin_image = CUDA_PROGRAM_BUILD_FAILURE;
 		}
 		pgstrom_wakeup_backends(entry->waiting_backends);
-		SpinLockRelease(&pgcache_head->lock);
+		SpinLockRelease(&shard->lock);
 		MemoryContextSwitchTo(oldcxt);
 		PG_RE_THROW();
 	}
-	PG_END_TRY();
+	PG_END_TRY();
+}
+
+/*
+ * program_build_request_is_prior
+ *
+ * It checks whether the request 'a' shall be built prior to the 'b'.
+ */
+static inline bool
+program_build_request_is_prior(program_build_request *a,
+							   program_build_request *b)
+{
+	if (a->priority != b->priority)
+		return a->priority < b->priority;
+	return a->seqno < b->seqno;
+}
+
+/*
+ * program_build_queue_sift_up / sift_down
+ *
+ * Build queue is a binary heap; the top is the next one to be built.
+ * Caller must hold the build_lock.
+ */
+static void
+program_build_queue_sift_up(int index)
+{
+	program_build_request *queue = pgcache_head->build_queue;
+	program_build_request temp;
+
+	while (index > 0)
+	{
+		int		parent = (index - 1) / 2;
+
+		if (!program_build_request_is_prior(&queue[index], &queue[parent]))
+			break;
+		temp = queue[parent];
+		queue[parent] = queue[index];
+		queue[index] = temp;
+		index = parent;
+	}
+}
+
+static void
+program_build_queue_sift_down(int index)
+{
+	program_build_request *queue = pgcache_head->build_queue;
+	program_build_request temp;
+	int		nitems = pgcache_head->build_nitems;
+
+	for (;;)
+	{
+		int		left = 2 * index + 1;
+		int		right = 2 * index + 2;
+		int		prior = index;
+
+		if (left < nitems &&
+			program_build_request_is_prior(&queue[left], &queue[prior]))
+			prior = left;
+		if (right < nitems &&
+			program_build_request_is_prior(&queue[right], &queue[prior]))
+			prior = right;
+		if (prior == index)
+			break;
+		temp = queue[prior];
+		queue[prior] = queue[index];
+		queue[index] = temp;
+		index = prior;
+	}
+}
+
+/*
+ * program_build_queue_boost
+ *
+ * It raises priority of the queued request, if a backend with higher
+ * priority joins to wait for the program. Caller must hold the shard lock.
+ */
+static void
+program_build_queue_boost(program_cache_entry *entry, int priority)
+{
+	program_build_request *queue = pgcache_head->build_queue;
+	int			i;
+
+	SpinLockAcquire(&pgcache_head->build_lock);
+	for (i=0; i < pgcache_head->build_nitems; i++)
+	{
+		if (queue[i].hash == entry->hash &&
+			queue[i].entry == entry)
+		{
+			if (priority < queue[i].priority)
+			{
+				queue[i].priority = priority;
+				program_build_queue_sift_up(i);
+			}
+			break;
+		}
+	}
+	SpinLockRelease(&pgcache_head->build_lock);
+}
+
+/*
+ * program_build_queue_push
+ *
+ * It enqueues a build request of the supplied entry, or raises priority of
+ * the request already queued. It returns false if the queue is full.
+ * Requests for warm-up are rejected earlier, to keep the reserved slots for
+ * the requests by backends. Caller must hold the shard lock, and has to wake
+ * up the build workers by program_build_queue_wakeup() after the release of
+ * the shard lock.
+ */
+static bool
+program_build_queue_push(program_cache_entry *entry, int priority)
+{
+	program_build_request *queue = pgcache_head->build_queue;
+	int			index;
+	int			i;
+
+	SpinLockAcquire(&pgcache_head->build_lock);
+	/* deduplication by the hash of the program */
+	for (i=0; i < pgcache_head->build_nitems; i++)
+	{
+		if (queue[i].hash == entry->hash &&
+			queue[i].entry == entry)
+		{
+			if (priority < queue[i].priority)
+			{
+				queue[i].priority = priority;
+				program_build_queue_sift_up(i);
+			}
+			SpinLockRelease(&pgcache_head->build_lock);
+			return true;
+		}
+	}
+
+	if (pgcache_head->build_nitems >= PGCACHE_BUILD_QUEUE_SIZE ||
+		(priority >= PGCACHE_PRIORITY_WARMUP &&
+		 pgcache_head->build_nitems >= (PGCACHE_BUILD_QUEUE_SIZE -
+										PGCACHE_BUILD_QUEUE_RESERVED)))
+	{
+		SpinLockRelease(&pgcache_head->build_lock);
+		return false;
+	}
+	index = pgcache_head->build_nitems++;
+	queue[index].entry = entry;
+	queue[index].hash = entry->hash;
+	queue[index].priority = priority;
+	queue[index].seqno = pgcache_head->build_seqno++;
+	program_build_queue_sift_up(index);
+	SpinLockRelease(&pgcache_head->build_lock);
+
+	return true;
+}
+
+/*
+ * program_build_queue_wakeup
+ *
+ * It wakes up the build workers. Workers being busy will check the queue
+ * when they complete the current build.
+ */
+static void
+program_build_queue_wakeup(void)
+{
+	int			procnos[PGCACHE_MAX_BUILD_WORKERS];
+	int			i, n = 0;
+
+	SpinLockAcquire(&pgcache_head->build_lock);
+	for (i=0; i < PGCACHE_MAX_BUILD_WORKERS; i++)
+	{
+		if (pgcache_head->build_workers[i] > 0)
+			procnos[n++] = pgcache_head->build_workers[i] - 1;
+	}
+	SpinLockRelease(&pgcache_head->build_lock);
+
+	for (i=0; i < n; i++)
+		SetLatch(&ProcGlobal->allProcs[procnos[i]].procLatch);
+}
+
+/*
+ * program_build_queue_pop
+ *
+ * It dequeues the request with the highest priority, or NULL if empty.
+ */
+static program_cache_entry *
+program_build_queue_pop(void)
+{
+	program_build_request *queue = pgcache_head->build_queue;
+	program_cache_entry *entry = NULL;
+
+	SpinLockAcquire(&pgcache_head->build_lock);
+	if (pgcache_head->build_nitems > 0)
+	{
+		entry = queue[0].entry;
+		queue[0] = queue[--pgcache_head->build_nitems];
+		program_build_queue_sift_down(0);
+	}
+	SpinLockRelease(&pgcache_head->build_lock);
+
+	return entry;
+}
+
+/*
+ * pgstrom_program_cache_checksum
+ *
+ * It returns the hash value of the program, and its crc by *p_crc.
+ */
+static uint64
+pgstrom_program_cache_checksum(cl_uint extra_flags,
+							   const char *kern_source,
+							   const char *kern_define,
+							   pg_crc32 *p_crc)
+{
+	Size		kern_source_len = strlen(kern_source);
+	Size		kern_define_len = strlen(kern_define);
+	pg_crc32	crc;
+
+	INIT_LEGACY_CRC32(crc);
+	COMP_LEGACY_CRC32(crc, &extra_flags, sizeof(int32));
+	COMP_LEGACY_CRC32(crc, kern_source, kern_source_len);
+	FIN_LEGACY_CRC32(crc);
+	*p_crc = crc;
+
+	return pgstrom_program_cache_hash(crc,
+									  kern_source, kern_source_len,
+									  kern_define, kern_define_len);
+}
+
+/*
+ * program_manifest_make_record
+ *
+ * It appends a manifest record of the program to the buffer.
+ */
+static void
+program_manifest_make_record(StringInfo buf, cl_uint extra_flags,
+							 const char *kern_source,
+							 const char *kern_define,
+							 const char *kern_typeoids)
+{
+	program_manifest_record rec;
+	int			offset = buf->len;
+
+	memset(&rec, 0, sizeof(program_manifest_record));
+	rec.magic = PGCACHE_MANIFEST_MAGIC;
+	rec.extra_flags = extra_flags;
+	rec.source_len = strlen(kern_source);
+	rec.define_len = strlen(kern_define);
+	rec.typeoids_len = strlen(kern_typeoids);
+	appendBinaryStringInfo(buf, (char *)&rec, sizeof(rec));
+	appendBinaryStringInfo(buf, kern_source, rec.source_len + 1);
+	appendBinaryStringInfo(buf, kern_define, rec.define_len + 1);
+	appendBinaryStringInfo(buf, kern_typeoids, rec.typeoids_len + 1);
+
+	INIT_LEGACY_CRC32(rec.crc);
+	COMP_LEGACY_CRC32(rec.crc, buf->data + offset + sizeof(rec),
+					  buf->len - offset - sizeof(rec));
+	FIN_LEGACY_CRC32(rec.crc);
+	memcpy(buf->data + offset, &rec, sizeof(rec));
+}
+
+/*
+ * program_manifest_next
+ *
+ * It fetches the next record from the image of manifest. It returns false
+ * on the end of image or a broken record.
+ */
+static bool
+program_manifest_next(const char **p_pos, const char *end,
+					  cl_uint *p_extra_flags,
+					  const char **p_kern_source,
+					  const char **p_kern_define,
+					  const char **p_kern_typeoids)
+{
+	const char *pos = *p_pos;
+	program_manifest_record rec;
+	Size		length;
+	pg_crc32	crc;
+
+	if (end - pos < sizeof(program_manifest_record))
+		return false;
+	memcpy(&rec, pos, sizeof(program_manifest_record));
+	pos += sizeof(program_manifest_record);
+	length = ((Size)rec.source_len + 1 +
+			  (Size)rec.define_len + 1 +
+			  (Size)rec.typeoids_len + 1);
+	if (rec.magic != PGCACHE_MANIFEST_MAGIC || end - pos < length)
+		return false;
+
+	INIT_LEGACY_CRC32(crc);
+	COMP_LEGACY_CRC32(crc, pos, length);
+	FIN_LEGACY_CRC32(crc);
+	if (!EQ_LEGACY_CRC32(crc, rec.crc))
+		return false;
+	if (strnlen(pos, length) != rec.source_len ||
+		strnlen(pos + rec.source_len + 1,
+				length - rec.source_len - 1) != rec.define_len ||
+		strnlen(pos + rec.source_len + 1 + rec.define_len + 1,
+				rec.typeoids_len + 1) != rec.typeoids_len)
+		return false;
+
+	*p_extra_flags = rec.extra_flags;
+	*p_kern_source = pos;
+	*p_kern_define = pos + rec.source_len + 1;
+	*p_kern_typeoids = pos + rec.source_len + 1 + rec.define_len + 1;
+	*p_pos = pos + length;
+
+	return true;
+}
+
+/*
+ * program_manifest_read
+ *
+ * It reads the whole manifest file, or returns NULL if not exists.
+ */
+static char *
+program_manifest_read(Size *p_length)
+{
+	char	   *image;
+	int			fdesc;
+	struct stat	st_buf;
+
+	fdesc = OpenTransientFile(PGCACHE_MANIFEST_FILE, O_RDONLY | PG_BINARY, 0);
+	if (fdesc < 0)
+	{
+		if (errno != ENOENT)
+			elog(LOG, "could not open file \"%s\": %m",
+				 PGCACHE_MANIFEST_FILE);
+		return NULL;
+	}
+	if (fstat(fdesc, &st_buf) != 0)
+	{
+		elog(LOG, "could not stat file \"%s\": %m", PGCACHE_MANIFEST_FILE);
+		CloseTransientFile(fdesc);
+		return NULL;
+	}
+	if (st_buf.st_size >= MaxAllocSize)
+	{
+		elog(LOG, "manifest \"%s\" is too large, ignored",
+			 PGCACHE_MANIFEST_FILE);
+		CloseTransientFile(fdesc);
+		return NULL;
+	}
+	image = palloc(st_buf.st_size + 1);
+	if (!__program_disk_cache_read(fdesc, image, st_buf.st_size))
+	{
+		elog(LOG, "could not read file \"%s\": %m", PGCACHE_MANIFEST_FILE);
+		CloseTransientFile(fdesc);
+		pfree(image);
+		return NULL;
+	}
+	CloseTransientFile(fdesc);
+	*p_length = st_buf.st_size;
+
+	return image;
+}
+
+/*
+ * program_manifest_write
+ *
+ * It appends the records to the manifest file. Any errors are not critical
+ * here, so we just report them to the log.
+ */
+static void
+program_manifest_write(const char *data, Size length)
+{
+	int			fdesc;
+
+	if (length == 0)
+		return;
+	if (mkdir(PGCACHE_DISK_DIR, S_IRWXU) != 0 && errno != EEXIST)
+	{
+		elog(LOG, "could not create directory \"%s\": %m", PGCACHE_DISK_DIR);
+		return;
+	}
+	fdesc = OpenTransientFile(PGCACHE_MANIFEST_FILE,
+							  O_WRONLY | O_CREAT | O_APPEND | PG_BINARY,
+							  S_IRUSR | S_IWUSR);
+	if (fdesc < 0)
+	{
+		elog(LOG, "could not open file \"%s\": %m", PGCACHE_MANIFEST_FILE);
+		return;
+	}
+	if (!__program_disk_cache_write(fdesc, data, length))
+		elog(LOG, "could not write file \"%s\": %m", PGCACHE_MANIFEST_FILE);
+	CloseTransientFile(fdesc);
+}
+
+/*
+ * program_manifest_append
+ *
+ * It records a frequently used program to the manifest.
+ */
+static void
+program_manifest_append(cl_uint extra_flags,
+						const char *kern_source,
+						const char *kern_define,
+						const char *kern_typeoids)
+{
+	StringInfoData	buf;
+
+	initStringInfo(&buf);
+	program_manifest_make_record(&buf, extra_flags,
+								 kern_source, kern_define, kern_typeoids);
+	program_manifest_write(buf.data, buf.len);
+	pfree(buf.data);
+}
+
+/*
+ * program_manifest_warmup
+ *
+ * It loads the program from the on-disk cache, or enqueues a build request
+ * with the lowest priority, unless the program is already in the program
+ * cache. It returns false if the build queue has no room for warm-up.
+ * The program is not marked as manifested, so it is recorded again if it is
+ * still used frequently; it keeps the program from the eviction on the next
+ * compaction.
+ */
+static bool
+program_manifest_warmup(cl_uint extra_flags,
+						const char *kern_source,
+						const char *kern_define,
+						const char *kern_typeoids)
+{
+	program_cache_entry *entry;
+	program_cache_shard *shard;
+	dlist_head	   *hash_slot;
+	Size			kern_source_len = strlen(kern_source);
+	Size			kern_define_len = strlen(kern_define);
+	pg_crc32		crc;
+	uint64			hash;
+	bool			queued = false;
+
+	hash = pgstrom_program_cache_checksum(extra_flags,
+										  kern_source,
+										  kern_define, &crc);
+	shard = PGCACHE_SHARD(hash);
+	hash_slot = PGCACHE_HASH_SLOT(shard, hash);
+
+	SpinLockAcquire(&shard->lock);
+	entry = pgstrom_program_cache_lookup(hash_slot, hash, extra_flags,
+										 kern_source, kern_source_len,
+										 kern_define, kern_define_len);
+	SpinLockRelease(&shard->lock);
+	if (entry)
+		return true;
+
+	if (program_disk_cache_load(crc, hash, extra_flags,
+								kern_source, kern_define))
+		return true;
+
+	entry = pgstrom_program_cache_create(crc, hash, extra_flags,
+										 kern_source, kern_define,
+										 kern_typeoids);
+	entry->warmup = true;
+
+	SpinLockAcquire(&shard->lock);
+	if (pgstrom_program_cache_lookup(hash_slot, hash, extra_flags,
+									 kern_source, kern_source_len,
+									 kern_define, kern_define_len))
+	{
+		SpinLockRelease(&shard->lock);
+		pgstrom_put_cuda_program(entry);
+		return true;
+	}
+	pgstrom_program_cache_attach(entry);
+	queued = program_build_queue_push(entry, PGCACHE_PRIORITY_WARMUP);
+	if (!queued)
+		pgstrom_program_cache_detach(entry);
+	SpinLockRelease(&shard->lock);
+
+	if (!queued)
+	{
+		pgstrom_put_cuda_program(entry);
+		return false;
+	}
+	program_build_queue_wakeup();
+
+	return true;
+}
+
+typedef struct
+{
+	uint64		hash;
+	int			index;		/* index of the latest record */
+} program_manifest_hentry;
+
+/*
+ * program_manifest_hashtable
+ *
+ * It makes a hash table to deduplicate the manifest records by the hash
+ * value of programs.
+ */
+static HTAB *
+program_manifest_hashtable(void)
+{
+	HASHCTL		hctl;
+
+	memset(&hctl, 0, sizeof(HASHCTL));
+	hctl.keysize = sizeof(uint64);
+	hctl.entrysize = sizeof(program_manifest_hentry);
+	hctl.hcxt = CurrentMemoryContext;
+
+	return hash_create("CUDA program manifest", 1024, &hctl,
+					   HASH_ELEM | HASH_BLOBS | HASH_CONTEXT);
+}
+
+/*
+ * pgstrom_build_worker_process
+ *
+ * It builds the program of the dequeued request, unless all the waiting
+ * backends have gone. Requests for warm-up are never cancelled.
+ */
+static void
+pgstrom_build_worker_process(program_cache_entry *entry)
+{
+	program_cache_shard *shard = PGCACHE_SHARD(entry->hash);
+	Bitmapset  *waiting_backends;
+	bool		has_waiter = false;
+	int			i;
+
+	/*
+	 * Cancel the request if nobody is waiting for the program any more.
+	 * It is detached from the hash slot, so the next request will make
+	 * a new entry.
+	 */
+	SpinLockAcquire(&shard->lock);
+	waiting_backends = entry->waiting_backends;
+	for (i=0; i < waiting_backends->nwords; i++)
+	{
+		if (waiting_backends->words[i] != 0)
+		{
+			has_waiter = true;
+			break;
+		}
+	}
+	if (!has_waiter && !entry->warmup)
+	{
+		pgstrom_program_cache_detach(entry);
+		SpinLockRelease(&shard->lock);
+
+		elog(DEBUG1, "CUDA program build (crc %08x) was cancelled",
+			 entry->crc);
+		pgstrom_put_cuda_program(entry);
+		return;
+	}
+	SpinLockRelease(&shard->lock);
+
+	pgstrom_build_cuda_program(entry);
+}
+
+/*
+ * program_manifest_replay
+ *
+ * It compacts the manifest file, then warms up the program cache by the
+ * programs in the manifest. The compaction keeps the latest record of each
+ * program, then evicts the oldest ones beyond PGCACHE_MANIFEST_MAX_ITEMS.
+ * If the build queue has no room for warm-up, this worker builds the queued
+ * programs by itself to make a room.
+ */
+static void
+program_manifest_replay(void)
+{
+	char	   *image;
+	Size		length;
+	const char *pos;
+	const char *end;
+	char		temp[MAXPGPATH];
+	int			fdesc;
+	HTAB	   *htab;
+	List	   *records = NIL;
+	List	   *items = NIL;
+	ListCell   *lc;
+	StringInfoData buf;
+	program_manifest_item item;
+	program_manifest_item *curr;
+	program_manifest_hentry *hentry;
+	program_cache_entry *entry;
+	pg_crc32	crc;
+	long		nevicts;
+	int			index;
+
+	image = program_manifest_read(&length);
+	if (!image)
+		return;
+
+	htab = program_manifest_hashtable();
+	initStringInfo(&buf);
+	pos = image;
+	end = image + length;
+	while (program_manifest_next(&pos, end,
+								 &item.extra_flags,
+								 &item.kern_source,
+								 &item.kern_define,
+								 &item.kern_typeoids))
+	{
+		item.hash = pgstrom_program_cache_checksum(item.extra_flags,
+												   item.kern_source,
+												   item.kern_define, &crc);
+		hentry = hash_search(htab, &item.hash, HASH_ENTER, NULL);
+		hentry->index = list_length(records);
+		curr = palloc(sizeof(program_manifest_item));
+		memcpy(curr, &item, sizeof(program_manifest_item));
+		records = lappend(records, curr);
+	}
+	if (pos != end)
+		elog(LOG, "manifest \"%s\" has broken records, truncated",
+			 PGCACHE_MANIFEST_FILE);
+
+	/* keep the latest records, except for the least recently recorded ones */
+	nevicts = hash_get_num_entries(htab) - PGCACHE_MANIFEST_MAX_ITEMS;
+	if (nevicts > 0)
+		elog(LOG, "manifest \"%s\" evicts %ld programs recorded earlier",
+			 PGCACHE_MANIFEST_FILE, nevicts);
+	index = 0;
+	foreach (lc, records)
+	{
+		curr = lfirst(lc);
+		hentry = hash_search(htab, &curr->hash, HASH_FIND, NULL);
+		Assert(hentry != NULL);
+		if (hentry->index != index++)
+			continue;
+		if (nevicts-- > 0)
+			continue;
+		program_manifest_make_record(&buf, curr->extra_flags,
+									 curr->kern_source,
+									 curr->kern_define,
+									 curr->kern_typeoids);
+		items = lappend(items, curr);
+	}
+
+	/* write back the compacted manifest */
+	snprintf(temp, sizeof(temp), "%s.tmp.%d",
+			 PGCACHE_MANIFEST_FILE, MyProcPid);
+	fdesc = OpenTransientFile(temp,
+							  O_WRONLY | O_CREAT | O_TRUNC | PG_BINARY,
+							  S_IRUSR | S_IWUSR);
+	if (fdesc < 0)
+		elog(LOG, "could not create file \"%s\": %m", temp);
+	else if (!__program_disk_cache_write(fdesc, buf.data, buf.len))
+	{
+		elog(LOG, "could not write file \"%s\": %m", temp);
+		CloseTransientFile(fdesc);
+		unlink(temp);
+	}
+	else if (CloseTransientFile(fdesc) != 0 ||
+			 rename(temp, PGCACHE_MANIFEST_FILE) != 0)
+	{
+		elog(LOG, "could not write file \"%s\": %m", PGCACHE_MANIFEST_FILE);
+		unlink(temp);
+	}
+
+	elog(LOG, "CUDA program warm-up: %d programs in the manifest",
+		 list_length(items));
+	foreach (lc, items)
+	{
+		curr = lfirst(lc);
+		if (build_worker_got_sigterm)
+			break;
+		while (!program_manifest_warmup(curr->extra_flags,
+										curr->kern_source,
+										curr->kern_define,
+										curr->kern_typeoids))
+		{
+			entry = program_build_queue_pop();
+			if (entry)
+				pgstrom_build_worker_process(entry);
+		}
+	}
+}
+
+/*
+ * pgstrom_build_worker_sigterm
+ */
+static void
+pgstrom_build_worker_sigterm(SIGNAL_ARGS)
+{
+	int			save_errno = errno;
+
+	build_worker_got_sigterm = true;
+	SetLatch(MyLatch);
+
+	errno = save_errno;
+}
+
+/*
+ * pgstrom_build_worker_exit
+ *
+ * It unregisters the build worker from the shared memory.
+ */
+static void
+pgstrom_build_worker_exit(int code, Datum arg)
+{
+	int			index = DatumGetInt32(arg);
+
+	SpinLockAcquire(&pgcache_head->build_lock);
+	pgcache_head->build_workers[index] = 0;
+	SpinLockRelease(&pgcache_head->build_lock);
+}
+
+/*
+ * pgstrom_build_worker_main
+ *
+ * Main loop of the build workers. It takes the build request with the
+ * highest priority, then builds the program unless all the waiting
+ * backends have gone.
+ * Build workers have no database connection; all the stuff which needs
+ * catalog access is already done by the requester.
+ */
+static void
+pgstrom_build_worker_main(Datum arg)
+{
+	int			index = DatumGetInt32(arg);
+	program_cache_entry *entry;
+	bool		do_replay = false;
+	int			rc;
+
+	pqsignal(SIGTERM, pgstrom_build_worker_sigterm);
+	BackgroundWorkerUnblockSignals();
+
+	/* Set up a memory context and resource owner. */
+	Assert(CurrentResourceOwner == NULL);
+	CurrentResourceOwner = ResourceOwnerCreate(NULL, "CUDA Program Builder");
+	CurrentMemoryContext = AllocSetContextCreate(TopMemoryContext,
+												 "CUDA Program Builder",
+												 ALLOCSET_DEFAULT_MINSIZE,
+												 ALLOCSET_DEFAULT_INITSIZE,
+												 ALLOCSET_DEFAULT_MAXSIZE);
+	/* register myself as a build worker */
+	SpinLockAcquire(&pgcache_head->build_lock);
+	pgcache_head->build_workers[index] = MyProc->pgprocno + 1;
+	if (index == 0 && !pgcache_head->manifest_replayed)
+	{
+		pgcache_head->manifest_replayed = true;
+		do_replay = true;
+	}
+	SpinLockRelease(&pgcache_head->build_lock);
+	on_shmem_exit(pgstrom_build_worker_exit, Int32GetDatum(index));
+
+	/* warm-up the program cache according to the manifest */
+	if (do_replay)
+	{
+		program_manifest_replay();
+		MemoryContextReset(CurrentMemoryContext);
+	}
+
+	while (!build_worker_got_sigterm)
+	{
+		ResetLatch(MyLatch);
+
+		entry = program_build_queue_pop();
+		if (!entry)
+		{
+			rc = WaitLatch(MyLatch, WL_LATCH_SET | WL_POSTMASTER_DEATH, 0);
+			if (rc & WL_POSTMASTER_DEATH)
+				proc_exit(1);
+			continue;
+		}
+
+		pgstrom_build_worker_process(entry);
+		MemoryContextReset(CurrentMemoryContext);
+	}
+	proc_exit(0);
+}
+
+/*
+ * pgstrom_cancel_cuda_program
+ *
+ * It tells the build workers the backend no longer waits for the program
+ * of the supplied GpuTaskState. The queued request will be cancelled once
+ * all the waiting backends have gone.
+ */
+void
+pgstrom_cancel_cuda_program(GpuTaskState *gts)
+{
+	program_cache_entry *entry;
+	program_cache_shard *shard;
+	dlist_head	   *hash_slot;
+	Size			kern_source_len = strlen(gts->kern_source);
+	Size			kern_define_len = strlen(gts->kern_define);
+	cl_uint			extra_flags = gts->extra_flags;
+	pg_crc32		crc;
+	uint64			hash;
+
+	INIT_LEGACY_CRC32(crc);
+	COMP_LEGACY_CRC32(crc, &extra_flags, sizeof(int32));
+	COMP_LEGACY_CRC32(crc, gts->kern_source, kern_source_len);
+	FIN_LEGACY_CRC32(crc);
+	hash = pgstrom_program_cache_hash(crc,
+									  gts->kern_source, kern_source_len,
+									  gts->kern_define, kern_define_len);
+	shard = PGCACHE_SHARD(hash);
+	hash_slot = PGCACHE_HASH_SLOT(shard, hash);
+
+	SpinLockAcquire(&shard->lock);
+	entry = pgstrom_program_cache_lookup(hash_slot, hash, extra_flags,
+										 gts->kern_source, kern_source_len,
+										 gts->kern_define, kern_define_len);
+	if (entry && !entry->bin_image)
+	{
+		Bitmapset  *waiting_backends = entry->waiting_backends;
+
+		waiting_backends->words[WORDNUM(MyProc->pgprocno)]
+			&= ~(1 << BITNUM(MyProc->pgprocno));
+	}
+	SpinLockRelease(&shard->lock);
 }
 
-static void
-pgstrom_build_cuda_program_bgw_main(Datum cuda_program)
+/*
+ * pgstrom_cancel_all_cuda_programs
+ *
+ * It tells the build workers the backend no longer waits for any programs.
+ * It is called on abort of GpuContext, when the GpuTaskStates that
+ * requested the programs may be already released with the query memory
+ * context, so the waiting bits are cleared by pgprocno on all the shards.
+ */
+void
+pgstrom_cancel_all_cuda_programs(void)
 {
-	program_cache_entry *entry = (program_cache_entry *) cuda_program;
+	program_cache_shard *shard;
+	program_cache_entry *entry;
+	dlist_iter		iter;
+	int				i, j;
 
-	/*
-	 * TODO: It is more preferable to use ParallelContext on v2.0
-	 */
-	BackgroundWorkerUnblockSignals();
-	/* Set up a memory context and resource owner. */
-	Assert(CurrentResourceOwner == NULL);
-	CurrentResourceOwner = ResourceOwnerCreate(NULL, "CUDA Async Builder");
-	CurrentMemoryContext = AllocSetContextCreate(TopMemoryContext,
-												 "CUDA Async Builder",
-												 ALLOCSET_DEFAULT_MINSIZE,
-												 ALLOCSET_DEFAULT_INITSIZE,
-												 ALLOCSET_DEFAULT_MAXSIZE);
-	/* Restore the database connection. */
-    BackgroundWorkerInitializeConnectionByOid(entry->database_oid,
-											  entry->user_oid);
-	/* Start dummy transaction */
-	StartTransactionCommand();
-	pgstrom_build_cuda_program(entry);
-	CommitTransactionCommand();
+	for (i=0; i < PGCACHE_NUM_SHARDS; i++)
+	{
+		shard = &pgcache_head->shards[i];
+
+		SpinLockAcquire(&shard->lock);
+		for (j=0; j < PGCACHE_SHARD_NSLOTS; j++)
+		{
+			dlist_foreach(iter, &shard->hash_slots[j])
+			{
+				entry = dlist_container(program_cache_entry,
+										hash_chain, iter.cur);
+				if (!entry->bin_image && entry->waiting_backends)
+				{
+					Bitmapset  *waiting_backends = entry->waiting_backends;
+
+					waiting_backends->words[WORDNUM(MyProc->pgprocno)]
+						&= ~(1 << BITNUM(MyProc->pgprocno));
+				}
+			}
+		}
+		SpinLockRelease(&shard->lock);
+	}
 }
 
 static CUmodule *
@@ -925,211 +2716,211 @@ __pgstrom_load_cuda_program(GpuContext *gcontext,
 							struct timeval *tv_build_end)
 {
 	program_cache_entry	*entry;
+	program_cache_shard *shard;
+	dlist_head	   *hash_slot;
 	Size			kern_source_len = strlen(kern_source);
 	Size			kern_define_len = strlen(kern_define);
-	Size			required;
-	Size			usage;
-	int				nwords;
-	int				hindex;
-	dlist_iter		iter;
 	pg_crc32		crc;
+	uint64			hash;
 	CUresult		rc;
 	CUmodule	   *cuda_modules = NULL;
 	int				i, num_context;
-	BackgroundWorker worker;
+	bool			disk_cache_checked = false;
+	bool			do_manifest = false;
+	char		   *kern_typeoids = NULL;
 
 	/* makes a hash value */
 	INIT_LEGACY_CRC32(crc);
 	COMP_LEGACY_CRC32(crc, &extra_flags, sizeof(int32));
 	COMP_LEGACY_CRC32(crc, kern_source, kern_source_len);
 	FIN_LEGACY_CRC32(crc);
+	hash = pgstrom_program_cache_hash(crc,
+									  kern_source, kern_source_len,
+									  kern_define, kern_define_len);
+	shard = PGCACHE_SHARD(hash);
+	hash_slot = PGCACHE_HASH_SLOT(shard, hash);
 
 retry:
-	hindex = crc % PGCACHE_HASH_SIZE;
-	SpinLockAcquire(&pgcache_head->lock);
-	dlist_foreach (iter, &pgcache_head->active_list[hindex])
+	SpinLockAcquire(&shard->lock);
+	entry = pgstrom_program_cache_lookup(hash_slot, hash, extra_flags,
+										 kern_source, kern_source_len,
+										 kern_define, kern_define_len);
+	if (entry)
 	{
-		entry = dlist_container(program_cache_entry, hash_chain, iter.cur);
+		/* Mark this entry as recently used */
+		entry->refbit = true;
 
-		if (entry->crc == crc &&
-			entry->extra_flags == extra_flags &&
-			strcmp(entry->kern_source, kern_source) == 0 &&
-			strcmp(entry->kern_define, kern_define) == 0)
+		/* This kernel build already lead an error */
+		if (entry->bin_image == CUDA_PROGRAM_BUILD_FAILURE)
+		{
+			SpinLockRelease(&shard->lock);
+			if (!is_preload)
+				elog(ERROR, "%s", entry->error_msg);
+			return NULL;
+		}
+		/* Kernel build is still in-progress */
+		if (!entry->bin_image)
 		{
-			/* Move this entry to the head of LRU list */
-			dlist_move_head(&pgcache_head->lru_list, &entry->lru_chain);
+			Bitmapset  *waiting_backends = entry->waiting_backends;
+			waiting_backends->words[WORDNUM(MyProc->pgprocno)]
+				|= (1 << BITNUM(MyProc->pgprocno));
+			/* queued request inherits priority of the waiter */
+			program_build_queue_boost(entry, gcontext->sched_class);
+			SpinLockRelease(&shard->lock);
 
-			/* This kernel build already lead an error */
-			if (entry->bin_image == CUDA_PROGRAM_BUILD_FAILURE)
-			{
-				SpinLockRelease(&pgcache_head->lock);
-				if (!is_preload)
-					elog(ERROR, "%s", entry->error_msg);
-				return NULL;
-			}
-			/* Kernel build is still in-progress */
-			if (!entry->bin_image)
-			{
-				Bitmapset  *waiting_backends = entry->waiting_backends;
-				waiting_backends->words[WORDNUM(MyProc->pgprocno)]
-					|= (1 << BITNUM(MyProc->pgprocno));
-				SpinLockRelease(&pgcache_head->lock);
+			/*
+			 * NOTE: current timestamp is an alternative of the timestamp
+			 * when build start, if somebody concurrent already kicked
+			 * the same kernel.
+			 */
+			if (tv_build_start && tv_build_start->tv_sec == 0)
+				gettimeofday(tv_build_start, NULL);
+			return NULL;
+		}
+		/* OK, this kernel is already built */
+		Assert(pg_atomic_read_u32(&entry->refcnt) > 0);
+		pg_atomic_fetch_add_u32(&entry->refcnt, 1);
 
-				/*
-				 * NOTE: current timestamp is an alternative of the timestamp
-				 * when build start, if somebody concurrent already kicked
-				 * the same kernel.
-				 */
-				if (tv_build_start && tv_build_start->tv_sec == 0)
-					gettimeofday(tv_build_start, NULL);
-				return NULL;
-			}
-			/* OK, this kernel is already built */
-			Assert(entry->refcnt > 0);
-			entry->refcnt++;
+		/* Frequently used programs are recorded to the manifest */
+		if (program_manifest_threshold > 0 && !entry->manifested &&
+			++entry->nhits >= program_manifest_threshold)
+		{
+			entry->manifested = true;
+			do_manifest = true;
+		}
 
-			if (tv_build_end && tv_build_end->tv_sec == 0)
-				*tv_build_end = entry->tv_build_end;
+		if (tv_build_end && tv_build_end->tv_sec == 0)
+			*tv_build_end = entry->tv_build_end;
 
-			SpinLockRelease(&pgcache_head->lock);
+		SpinLockRelease(&shard->lock);
 
-			/*
-			 * Let's load this module for each context
-			 */
-			num_context = gcontext->num_context;
-			PG_TRY();
+		/*
+		 * Let's load this module for each context
+		 */
+		num_context = gcontext->num_context;
+		PG_TRY();
+		{
+			if (do_manifest)
+				program_manifest_append(entry->extra_flags,
+										entry->kern_source,
+										entry->kern_define,
+										construct_kern_typeoids());
+
+			cuda_modules = MemoryContextAllocZero(gcontext->memcxt,
+												  sizeof(CUmodule) *
+												  num_context);
+			for (i=0; i < num_context; i++)
 			{
-				cuda_modules = MemoryContextAllocZero(gcontext->memcxt,
-													  sizeof(CUmodule) *
-													  num_context);
-				for (i=0; i < num_context; i++)
-				{
-					rc = cuCtxPushCurrent(gcontext->gpu[i].cuda_context);
-					if (rc != CUDA_SUCCESS)
-						elog(ERROR, "failed on cuCtxPushCurrent (%s)",
-							 errorText(rc));
-
-					rc = cuModuleLoadData(&cuda_modules[i],
-										  entry->bin_image);
-					if (rc != CUDA_SUCCESS)
-						elog(ERROR, "failed on cuModuleLoadData (%s)\n",
-							 errorText(rc));
-				}
-				rc = cuCtxPopCurrent(NULL);
+				rc = cuCtxPushCurrent(gcontext->gpu[i].cuda_context);
+				if (rc != CUDA_SUCCESS)
+					elog(ERROR, "failed on cuCtxPushCurrent (%s)",
+						 errorText(rc));
+
+				rc = cuModuleLoadData(&cuda_modules[i],
+									  entry->bin_image);
 				if (rc != CUDA_SUCCESS)
-					elog(ERROR, "failed on cuCtxPopCurrent (%s)",
+					elog(ERROR, "failed on cuModuleLoadData (%s)\n",
 						 errorText(rc));
 			}
-			PG_CATCH();
+			rc = cuCtxPopCurrent(NULL);
+			if (rc != CUDA_SUCCESS)
+				elog(ERROR, "failed on cuCtxPopCurrent (%s)",
+					 errorText(rc));
+		}
+		PG_CATCH();
+		{
+			while (cuda_modules && i > 0)
 			{
-				while (cuda_modules && i > 0)
-				{
-					rc = cuModuleUnload(cuda_modules[--i]);
-					if (rc != CUDA_SUCCESS)
-						elog(WARNING, "failed on cuModuleUnload (%s)",
-							 errorText(rc));
-				}
-				pgstrom_put_cuda_program(entry);
-				PG_RE_THROW();
+				rc = cuModuleUnload(cuda_modules[--i]);
+				if (rc != CUDA_SUCCESS)
+					elog(WARNING, "failed on cuModuleUnload (%s)",
+						 errorText(rc));
 			}
-			PG_END_TRY();
 			pgstrom_put_cuda_program(entry);
-
-			return cuda_modules;
+			PG_RE_THROW();
 		}
+		PG_END_TRY();
+		pgstrom_put_cuda_program(entry);
+
+		return cuda_modules;
 	}
+	SpinLockRelease(&shard->lock);
 
 	/*
 	 * Not found on the existing cache.
+	 * Try the on-disk cache first, then retry the lookup because someone
+	 * concurrent may make an entry during the file i/o.
+	 */
+	if (!disk_cache_checked)
+	{
+		disk_cache_checked = true;
+		program_disk_cache_load(crc, hash, extra_flags,
+								kern_source, kern_define);
+		goto retry;
+	}
+
+	/*
+	 * Not found on both of the caches.
 	 * So, create a new one then kick NVRTC
 	 */
 	if (tv_build_start && tv_build_start->tv_sec == 0)
 		gettimeofday(tv_build_start, NULL);
 
-	required = offsetof(program_cache_entry, data[0]);
-	nwords = (ProcGlobal->allProcCount +
-			  BITS_PER_BITMAPWORD - 1) / BITS_PER_BITMAPWORD;
-	required += MAXALIGN(offsetof(Bitmapset, words[nwords]));
-	required += MAXALIGN(kern_source_len + 1);
-	required += MAXALIGN(kern_define_len + 1);
-	required += 512;	/* margin for error message */
-	usage = 0;
-
-	entry = pgstrom_program_cache_alloc(required);
-	entry->crc = crc;
-	memset(&entry->tv_build_end, 0, sizeof(struct timeval));
-	/* bitmap for waiting backends */
-	entry->waiting_backends = (Bitmapset *) entry->data;
-	entry->waiting_backends->nwords = nwords;
-	memset(entry->waiting_backends->words, 0, sizeof(bitmapword) * nwords);
-	usage += MAXALIGN(offsetof(Bitmapset, words[nwords]));
-	/* session info who tries to build the program */
-	entry->database_oid = MyDatabaseId;
-	entry->user_oid = GetUserId();
-	/* device kernel source */
-	entry->extra_flags = extra_flags;
-	entry->kern_source = (char *)(entry->data + usage);
-	memcpy(entry->kern_source, kern_source, kern_source_len + 1);
-	usage += MAXALIGN(kern_source_len + 1);
-	entry->kern_define = (char *)(entry->data + usage);
-	memcpy(entry->kern_define, kern_define, kern_define_len + 1);
-	usage += MAXALIGN(kern_define_len + 1);
-	/* no cuda binary yet */
-	entry->bin_image = NULL;
-	entry->bin_length = 0;
-	/* remaining are for error message */
-	entry->error_msg = (char *)(entry->data + usage);
-
+	if (!kern_typeoids)
+		kern_typeoids = construct_kern_typeoids();
+	entry = pgstrom_program_cache_create(crc, hash, extra_flags,
+										 kern_source, kern_define,
+										 kern_typeoids);
 	/* at least, caller is waiting for build */
-	entry->waiting_backends = entry->waiting_backends;
 	entry->waiting_backends->words[WORDNUM(MyProc->pgprocno)]
 		|= (1 << BITNUM(MyProc->pgprocno));
 
+	/*
+	 * someone concurrent may make an entry for the same program during
+	 * the allocation without lock. If so, we retry the lookup.
+	 */
+	SpinLockAcquire(&shard->lock);
+	if (pgstrom_program_cache_lookup(hash_slot, hash, extra_flags,
+									 kern_source, kern_source_len,
+									 kern_define, kern_define_len))
+	{
+		SpinLockRelease(&shard->lock);
+		pgstrom_put_cuda_program(entry);
+		goto retry;
+	}
+
 	/* to be acquired by program builder */
-	dlist_push_head(&pgcache_head->active_list[hindex], &entry->hash_chain);
-	dlist_push_head(&pgcache_head->lru_list, &entry->lru_chain);
+	pgstrom_program_cache_attach(entry);
 
-	/* Kick a dynamic background worker to build */
+	/* Enqueue the build request for the build workers */
 	if (with_async_build)
 	{
-		snprintf(worker.bgw_name, sizeof(worker.bgw_name),
-				 "nvcc launcher - crc %08x", crc);
-		worker.bgw_flags = (BGWORKER_SHMEM_ACCESS |
-							BGWORKER_BACKEND_DATABASE_CONNECTION);
-		worker.bgw_start_time = BgWorkerStart_RecoveryFinished;
-		worker.bgw_restart_time = BGW_NEVER_RESTART;
-		worker.bgw_main = pgstrom_build_cuda_program_bgw_main;
-		worker.bgw_main_arg = PointerGetDatum(entry);
-
-		if (RegisterDynamicBackgroundWorker(&worker, NULL))
+		if (program_build_queue_push(entry, gcontext->sched_class))
 		{
-			SpinLockRelease(&pgcache_head->lock);
-			return NULL;	/* now bgworker building the device kernel */
+			SpinLockRelease(&shard->lock);
+			program_build_queue_wakeup();
+			return NULL;	/* now build worker will build the device kernel */
 		}
 		else if (is_preload)
 		{
 			/*
-			 * Revert the new program_cache_entry if no background worker is
-			 * available but kernel build as a preload.
+			 * Revert the new program_cache_entry if build queue is full
+			 * but kernel build as a preload.
 			 * @entry->bin_image == NULL means somebody is still in-progress
 			 * of the code build, thus other concurrent tasks will wait for
 			 * completion. Unless caller does not take this job, we cannot
 			 * leave the CUDA program entry.
 			 */
-			Assert(entry->refcnt == 1);
-			dlist_delete(&entry->hash_chain);
-			dlist_delete(&entry->lru_chain);
-			memset(&entry->hash_chain, 0, sizeof(dlist_node));
-			memset(&entry->lru_chain, 0, sizeof(dlist_node));
+			Assert(pg_atomic_read_u32(&entry->refcnt) == 1);
+			pgstrom_program_cache_detach(entry);
+			SpinLockRelease(&shard->lock);
 
-			pgstrom_program_cache_free(entry);
-
-			SpinLockRelease(&pgcache_head->lock);
+			pgstrom_put_cuda_program(entry);
 			return NULL;
 		}
-		elog(LOG, "failed to launch async NVRTC build, try sync mode");
+		elog(LOG, "CUDA program build queue is full, try sync mode");
 	}
-	SpinLockRelease(&pgcache_head->lock);
+	SpinLockRelease(&shard->lock);
 	/* build the device kernel synchronously */
 	pgstrom_build_cuda_program(entry);
 	goto retry;
@@ -1178,18 +2969,119 @@ plcuda_load_cuda_program(GpuContext *gcontext,
 									   NULL, NULL);
 }
 
+/*
+ * construct_kern_array_lookup
+ *
+ * It evaluates the array argument of the comparison function, then puts
+ * its non-NULL elements on the buffer as a kern_array_lookup; sorted by
+ * the comparison function and de-duplicated. It returns false if the
+ * array is NULL.
+ */
+typedef struct
+{
+	FmgrInfo	cmp_finfo;
+	Oid			collid;
+} array_lookup_sort_context;
+
+static int
+array_lookup_compare(const void *a, const void *b, void *arg)
+{
+	array_lookup_sort_context *scxt = arg;
+
+	return DatumGetInt32(FunctionCall2Coll(&scxt->cmp_finfo,
+										   scxt->collid,
+										   *((const Datum *) a),
+										   *((const Datum *) b)));
+}
+
+static bool
+construct_kern_array_lookup(StringInfo str, FuncExpr *fexpr,
+							ExprContext *econtext)
+{
+	array_lookup_sort_context scxt;
+	kern_array_lookup alookup;
+	ExprState  *estate;
+	ArrayType  *array;
+	Datum		datum;
+	bool		isnull;
+	Datum	   *values;
+	bool	   *nulls;
+	int			nitems;
+	int			i, j;
+	Oid			elemtype;
+	int16		typlen;
+	bool		typbyval;
+	char		typalign;
+	Size		stride;
+	char		temp[sizeof(Datum)];
+
+	Assert(list_length(fexpr->args) == 1);
+	estate = ExecInitExpr(linitial(fexpr->args), NULL);
+	datum = ExecEvalExpr(estate, econtext, &isnull, NULL);
+	if (isnull)
+		return false;
+
+	array = DatumGetArrayTypeP(datum);
+	elemtype = ARR_ELEMTYPE(array);
+	get_typlenbyvalalign(elemtype, &typlen, &typbyval, &typalign);
+	if (typlen <= 0 || !typbyval)
+		elog(ERROR, "Bug? array lookup on unexpected type: %s",
+			 format_type_be(elemtype));
+	deconstruct_array(array, elemtype, typlen, typbyval, typalign,
+					  &values, &nulls, &nitems);
+
+	/* NULL elements are never matched */
+	memset(&alookup, 0, sizeof(kern_array_lookup));
+	for (i=0, j=0; i < nitems; i++)
+	{
+		if (nulls[i])
+			alookup.has_null = true;
+		else
+			values[j++] = values[i];
+	}
+	nitems = j;
+
+	/* sort, then remove duplicated elements */
+	fmgr_info(fexpr->funcid, &scxt.cmp_finfo);
+	scxt.collid = fexpr->inputcollid;
+	qsort_arg(values, nitems, sizeof(Datum), array_lookup_compare, &scxt);
+	for (i=0, j=0; i < nitems; i++)
+	{
+		if (j == 0 || array_lookup_compare(&values[j-1],
+										   &values[i], &scxt) != 0)
+			values[j++] = values[i];
+	}
+	alookup.nitems = j;
+
+	appendBinaryStringInfo(str, (char *)&alookup,
+						   offsetof(kern_array_lookup, values));
+	stride = att_align_nominal(typlen, typalign);
+	Assert(stride <= sizeof(Datum));
+	for (i=0; i < alookup.nitems; i++)
+	{
+		memset(temp, 0, sizeof(temp));
+		store_att_byval(temp, values[i], typlen);
+		appendBinaryStringInfo(str, temp, stride);
+	}
+	return true;
+}
+
 /*
  * construct_kern_parambuf
  *
  * It construct a kernel parameter buffer to deliver Const/Param nodes.
+ * PARAM_EXEC shall be NULL unless used_params_state is supplied, because
+ * its value (e.g. result of InitPlan) is not available on executor startup.
  */
 static kern_parambuf *
-construct_kern_parambuf(List *used_params, ExprContext *econtext)
+construct_kern_parambuf(List *used_params, ExprContext *econtext,
+						List *used_params_state)
 {
 	StringInfoData	str;
 	kern_parambuf  *kparams;
 	char		padding[STROMALIGN_LEN];
 	ListCell   *cell;
+	ListCell   *lc_state = list_head(used_params_state);
 	Size		offset;
 	int			index = 0;
 	int			nparams = list_length(used_params);
@@ -1205,7 +3097,14 @@ construct_kern_parambuf(List *used_params, ExprContext *econtext)
 	/* walks on the Para/Const list */
 	foreach (cell, used_params)
 	{
-		Node   *node = lfirst(cell);
+		Node	   *node = lfirst(cell);
+		ExprState  *pstate = NULL;
+
+		if (lc_state)
+		{
+			pstate = lfirst(lc_state);
+			lc_state = lnext(lc_state);
+		}
 
 		if (IsA(node, Const))
 		{
@@ -1237,6 +3136,44 @@ construct_kern_parambuf(List *used_params, ExprContext *econtext)
 				}
 			}
 		}
+		else if (IsA(node, Param) &&
+				 ((Param *) node)->paramkind == PARAM_EXEC)
+		{
+			Param	   *param = (Param *) node;
+
+			kparams = (kern_parambuf *)str.data;
+			kparams->poffset[index] = 0;	/* null, if not evaluated yet */
+			if (pstate)
+			{
+				Datum		value;
+				bool		isnull;
+				int16		typlen;
+				bool		typbyval;
+
+				/* InitPlan shall be executed here, if not yet */
+				value = ExecEvalExpr(pstate, econtext, &isnull, NULL);
+				if (!isnull)
+				{
+					kparams = (kern_parambuf *)str.data;
+					kparams->poffset[index] = str.len;
+					get_typlenbyval(param->paramtype, &typlen, &typbyval);
+					if (typbyval)
+						appendBinaryStringInfo(&str,
+											   (char *)&value,
+											   typlen);
+					else if (typlen > 0)
+						appendBinaryStringInfo(&str,
+											   DatumGetPointer(value),
+											   typlen);
+					else
+					{
+						void   *vl_val = PG_DETOAST_DATUM(value);
+
+						appendBinaryStringInfo(&str, vl_val, VARSIZE(vl_val));
+					}
+				}
+			}
+		}
 		else if (IsA(node, Param))
 		{
 			ParamListInfo param_info = econtext->ecxt_param_list_info;
@@ -1273,6 +3210,7 @@ construct_kern_parambuf(List *used_params, ExprContext *econtext)
 					int16	typlen;
 					bool	typbyval;
 
+					kparams->poffset[index] = str.len;
 					get_typlenbyval(prm->ptype, &typlen, &typbyval);
 					if (typbyval)
 					{
@@ -1302,6 +3240,18 @@ construct_kern_parambuf(List *used_params, ExprContext *econtext)
 								param->paramid)));
 			}
 		}
+		else if (IsA(node, FuncExpr))
+		{
+			/* sorted array for ScalarArrayOpExpr; see codegen.c */
+			kparams = (kern_parambuf *)str.data;
+			kparams->poffset[index] = str.len;
+			if (!construct_kern_array_lookup(&str, (FuncExpr *) node,
+											 econtext))
+			{
+				kparams = (kern_parambuf *)str.data;
+				kparams->poffset[index] = 0;	/* null */
+			}
+		}
 		else
 			elog(ERROR, "unexpected node: %s", nodeToString(node));
 
@@ -1387,12 +3337,53 @@ pgstrom_assign_cuda_program(GpuTaskState *gts,
 	const char	   *kern_define
 		= pgstrom_build_session_info(gts, kern_source, extra_flags);
 
-	gts->kern_params = construct_kern_parambuf(used_params, econtext);
+	List		   *used_params_state = NIL;
+	ListCell	   *lc;
+
+	gts->kern_params = construct_kern_parambuf(used_params, econtext, NIL);
+	gts->used_params = used_params;
+	gts->kern_params_exec = false;
+	foreach (lc, used_params)
+	{
+		Param		   *param = lfirst(lc);
+		ExprState	   *pstate = NULL;
+
+		if (IsA(param, Param) && param->paramkind == PARAM_EXEC)
+		{
+			/* evaluated on run-time, by pgstrom_setup_kern_params */
+			pstate = ExecInitExpr((Expr *) param, &gts->css.ss.ps);
+			gts->kern_params_exec = true;
+		}
+		used_params_state = lappend(used_params_state, pstate);
+	}
+	gts->used_params_state = (gts->kern_params_exec ? used_params_state : NIL);
+	gts->kern_params_pending = gts->kern_params_exec;
 	gts->kern_source = kern_source;
 	gts->kern_define = kern_define;
 	gts->extra_flags = extra_flags;
 }
 
+/*
+ * pgstrom_setup_kern_params
+ *
+ * It re-constructs the kern_params with values of PARAM_EXEC. It shall be
+ * called prior to the first GpuTask after executor startup or rescan,
+ * because PARAM_EXEC is set by the upper node or InitPlan at run-time.
+ */
+void
+pgstrom_setup_kern_params(GpuTaskState *gts)
+{
+	ExprContext	   *econtext = gts->css.ss.ps.ps_ExprContext;
+
+	Assert(gts->kern_params_exec && gts->used_params_state != NIL);
+	/* GpuTask has its own copy, so the previous one is no longer used */
+	pfree(gts->kern_params);
+	gts->kern_params = construct_kern_parambuf(gts->used_params,
+											   econtext,
+											   gts->used_params_state);
+	gts->kern_params_pending = false;
+}
+
 /*
  * pgstrom_program_info
  *
@@ -1425,7 +3416,7 @@ __collect_program_info(void)
 
 		pinfo->addr = (int64) entry;
 		pinfo->length = (1UL << entry->shift);
-		pinfo->active = PGCACHE_ACTIVE_ENTRY(entry);
+		pinfo->active = (entry->state == PGCACHE_STATE_ACTIVE);
 		if (entry->bin_image == CUDA_PROGRAM_BUILD_FAILURE)
 			pinfo->status = "Build Failed";
 		else if (!entry->bin_image)
@@ -1478,18 +3469,26 @@ static List *
 collect_program_info(void)
 {
 	List   *results;
+	int		i;
 
+	/* lock the allocator and all the shards, to walk on the entries */
 	SpinLockAcquire(&pgcache_head->lock);
+	for (i=0; i < PGCACHE_NUM_SHARDS; i++)
+		SpinLockAcquire(&pgcache_head->shards[i].lock);
 	PG_TRY();
 	{
 		results = __collect_program_info();
 	}
 	PG_CATCH();
 	{
+		for (i=PGCACHE_NUM_SHARDS; i > 0; i--)
+			SpinLockRelease(&pgcache_head->shards[i-1].lock);
 		SpinLockRelease(&pgcache_head->lock);
 		PG_RE_THROW();
 	}
 	PG_END_TRY();
+	for (i=PGCACHE_NUM_SHARDS; i > 0; i--)
+		SpinLockRelease(&pgcache_head->shards[i-1].lock);
 	SpinLockRelease(&pgcache_head->lock);
 
 	return results;
@@ -1598,6 +3597,129 @@ pgstrom_program_info(PG_FUNCTION_ARGS)
 }
 PG_FUNCTION_INFO_V1(pgstrom_program_info);
 
+/*
+ * pgstrom_program_manifest_export
+ *
+ * It returns the image of manifest, to be imported to other nodes.
+ */
+Datum
+pgstrom_program_manifest_export(PG_FUNCTION_ARGS)
+{
+	bytea	   *result;
+	char	   *image;
+	Size		length = 0;
+
+	if (!superuser())
+		ereport(ERROR,
+				(errcode(ERRCODE_INSUFFICIENT_PRIVILEGE),
+				 errmsg("must be superuser to export the program manifest")));
+
+	image = program_manifest_read(&length);
+	result = palloc(VARHDRSZ + length);
+	SET_VARSIZE(result, VARHDRSZ + length);
+	if (image)
+		memcpy(VARDATA(result), image, length);
+
+	PG_RETURN_BYTEA_P(result);
+}
+PG_FUNCTION_INFO_V1(pgstrom_program_manifest_export);
+
+/*
+ * pgstrom_program_manifest_import
+ *
+ * It merges the supplied image of manifest to the local one, then kicks
+ * warm-up of the newly imported programs. It returns number of the
+ * programs newly imported.
+ */
+Datum
+pgstrom_program_manifest_import(PG_FUNCTION_ARGS)
+{
+	bytea	   *manifest = PG_GETARG_BYTEA_P(0);
+	char	   *image;
+	Size		length;
+	const char *pos;
+	const char *end;
+	HTAB	   *htab;
+	List	   *items = NIL;
+	ListCell   *lc;
+	StringInfoData buf;
+	program_manifest_item item;
+	program_manifest_item *curr;
+	pg_crc32	crc;
+	uint64		hash;
+	bool		found;
+
+	if (!superuser())
+		ereport(ERROR,
+				(errcode(ERRCODE_INSUFFICIENT_PRIVILEGE),
+				 errmsg("must be superuser to import the program manifest")));
+
+	/* programs already in the local manifest */
+	htab = program_manifest_hashtable();
+	image = program_manifest_read(&length);
+	if (image)
+	{
+		pos = image;
+		end = image + length;
+		while (program_manifest_next(&pos, end,
+									 &item.extra_flags,
+									 &item.kern_source,
+									 &item.kern_define,
+									 &item.kern_typeoids))
+		{
+			hash = pgstrom_program_cache_checksum(item.extra_flags,
+												  item.kern_source,
+												  item.kern_define, &crc);
+			hash_search(htab, &hash, HASH_ENTER, NULL);
+		}
+	}
+
+	/* validation of the supplied manifest */
+	initStringInfo(&buf);
+	pos = VARDATA(manifest);
+	end = pos + VARSIZE(manifest) - VARHDRSZ;
+	while (program_manifest_next(&pos, end,
+								 &item.extra_flags,
+								 &item.kern_source,
+								 &item.kern_define,
+								 &item.kern_typeoids))
+	{
+		hash = pgstrom_program_cache_checksum(item.extra_flags,
+											  item.kern_source,
+											  item.kern_define, &crc);
+		hash_search(htab, &hash, HASH_ENTER, &found);
+		if (found)
+			continue;
+		program_manifest_make_record(&buf, item.extra_flags,
+									 item.kern_source,
+									 item.kern_define,
+									 item.kern_typeoids);
+		curr = palloc(sizeof(program_manifest_item));
+		memcpy(curr, &item, sizeof(program_manifest_item));
+		items = lappend(items, curr);
+	}
+	if (pos != end)
+		ereport(ERROR,
+				(errcode(ERRCODE_DATA_CORRUPTED),
+				 errmsg("program manifest is corrupted at offset %lu",
+						(unsigned long)(pos - VARDATA(manifest)))));
+
+	program_manifest_write(buf.data, buf.len);
+
+	/* kick warm-up; the rest shall be built on the next restart */
+	foreach (lc, items)
+	{
+		curr = lfirst(lc);
+		if (!program_manifest_warmup(curr->extra_flags,
+									 curr->kern_source,
+									 curr->kern_define,
+									 curr->kern_typeoids))
+			break;
+	}
+	PG_RETURN_INT32(list_length(items));
+}
+PG_FUNCTION_INFO_V1(pgstrom_program_manifest_import);
+
 static void
 pgstrom_startup_cuda_program(void)
 {
@@ -1619,13 +3741,21 @@ pgstrom_startup_cuda_program(void)
 	/* initialize program cache header */
 	memset(pgcache_head, 0, sizeof(program_cache_head));
 	SpinLockInit(&pgcache_head->lock);
-	for (i=0; i < PGCACHE_MAX_BITS; i++)
+	SpinLockInit(&pgcache_head->build_lock);
+	for (i=0; i <= PGCACHE_MAX_BITS; i++)
 		dlist_init(&pgcache_head->free_list[i]);
-	for (i=0; i < PGCACHE_HASH_SIZE; i++)
-		dlist_init(&pgcache_head->active_list[i]);
-	dlist_init(&pgcache_head->lru_list);
+	for (i=0; i < PGCACHE_NUM_SHARDS; i++)
+	{
+		program_cache_shard *shard = &pgcache_head->shards[i];
+		int		j;
+
+		SpinLockInit(&shard->lock);
+		for (j=0; j < PGCACHE_SHARD_NSLOTS; j++)
+			dlist_init(&shard->hash_slots[j]);
+	}
 	pgcache_head->entry_begin = (program_cache_entry *)
 		BUFFERALIGN(pgcache_head->data);
+	pgcache_head->clock_hand = pgcache_head->entry_begin;
 
 	/* makes free entries */
 	curr_addr = (char *) pgcache_head->entry_begin;
@@ -1641,20 +3771,27 @@ pgstrom_startup_cuda_program(void)
 		entry = (program_cache_entry *) curr_addr;
 		memset(entry, 0, sizeof(program_cache_entry));
 		entry->shift = shift;
-		entry->refcnt = 0;
+		entry->state = PGCACHE_STATE_FREE;
+		pg_atomic_init_u32(&entry->refcnt, 0);
+		PGCACHE_MAGIC_CODE(entry) = PGCACHE_MAGIC;
 		dlist_push_tail(&pgcache_head->free_list[shift], &entry->hash_chain);
 
 		curr_addr += (1UL << shift);
 	}
 	pgcache_head->entry_end = (program_cache_entry *)curr_addr;
+
+	/* remove obsolete on-disk cache, if any */
+	program_disk_cache_cleanup();
 }
 
 void
 pgstrom_init_cuda_program(void)
 {
 	static int	__program_cache_size;
+	BackgroundWorker worker;
 	int			major;
 	int			minor;
+	int			i;
 	nvrtcResult	rc;
 
 	/*
@@ -1672,6 +3809,60 @@ pgstrom_init_cuda_program(void)
 							NULL, NULL, NULL);
 	program_cache_size = (Size)__program_cache_size * 1024L;
 
+	/*
+	 * size of the on-disk cache of the built programs
+	 */
+	DefineCustomIntVariable("pg_strom.program_disk_cache_size",
+							"size of on-disk cache of the built programs",
+							"0 disables the on-disk cache",
+							&program_disk_cache_size,
+							256 * 1024,		/* 256MB */
+							0,
+							INT_MAX,
+							PGC_SIGHUP,
+							GUC_NOT_IN_SAMPLE | GUC_UNIT_KB,
+							NULL, NULL, NULL);
+
+	/*
+	 * number of the build workers
+	 */
+	DefineCustomIntVariable("pg_strom.program_build_workers",
+							"number of workers to build CUDA programs",
+							NULL,
+							&program_build_workers,
+							4,
+							1,
+							PGCACHE_MAX_BUILD_WORKERS,
+							PGC_POSTMASTER,
+							GUC_NOT_IN_SAMPLE,
+							NULL, NULL, NULL);
+
+	/*
+	 * threshold to record programs to the manifest for warm-up
+	 */
+	DefineCustomIntVariable("pg_strom.program_manifest_threshold",
+							"number of cache hits to record programs to the manifest",
+							"0 disables recording of the manifest",
+							&program_manifest_threshold,
+							3,
+							0,
+							INT_MAX,
+							PGC_SIGHUP,
+							GUC_NOT_IN_SAMPLE,
+							NULL, NULL, NULL);
+
+	/*
+	 * alternative compiler command, for testing of the build queue
+	 */
+	DefineCustomStringVariable("pg_strom.debug_program_build_command",
+							   "command to build CUDA programs instead of NVRTC",
+							   "It is invoked with path of the source file and path of the image to be written",
+							   &program_build_command,
+							   NULL,
+							   PGC_POSTMASTER,
+							   GUC_NOT_IN_SAMPLE,
+							   NULL, NULL, NULL);
+
 	/*
 	 * turn on/off cuda coredump feature
 	 */
@@ -1702,6 +3893,22 @@ pgstrom_init_cuda_program(void)
 		elog(ERROR, "failed on nvrtcVersion: %s", nvrtcGetErrorString(rc));
 	elog(LOG, "NVRTC - CUDA Runtime Compilation vertion %d.%d",
 		 major, minor);
+	nvrtc_version_major = major;
+	nvrtc_version_minor = minor;
+
+	/* launch the build workers */
+	for (i=0; i < program_build_workers; i++)
+	{
+		memset(&worker, 0, sizeof(BackgroundWorker));
+		snprintf(worker.bgw_name, sizeof(worker.bgw_name),
+				 "PG-Strom CUDA program builder %d", i);
+		worker.bgw_flags = BGWORKER_SHMEM_ACCESS;
+		worker.bgw_start_time = BgWorkerStart_PostmasterStart;
+		worker.bgw_restart_time = 1;
+		worker.bgw_main = pgstrom_build_worker_main;
+		worker.bgw_main_arg = Int32GetDatum(i);
+		RegisterBackgroundWorker(&worker);
+	}
 
 	/* allocation of static shared memory */
 	RequestAddinShmemSpace(program_cache_size);
@@ -656,6 +656,195 @@ pgfn_texticnlike(kern_context *kcxt, pg_text_t arg1, pg_text_t arg2)
 	return result;
 }
 
+/*
+ * Specialized LIKE matchers
+ *
+ * Code generator chooses one of them instead of GenericMatchText, if LIKE
+ * pattern is a constant that consists of literal bytes and '%' only.
+ * They never backtrack, because leftmost match of each literal segment is
+ * sufficient in this case. Pattern is delivered as KPARAM as usual.
+ */
+STATIC_INLINE(cl_bool)
+__like_match_bytes(const char *s, const char *p, cl_uint len)
+{
+	cl_uint		i;
+
+	for (i=0; i < len; i++)
+	{
+		if (s[i] != p[i])
+			return false;
+	}
+	return true;
+}
+
+/* returns offset of the first occurrence of p in s, or -1 if not found */
+STATIC_INLINE(cl_int)
+__like_find_substring(const char *s, cl_uint slen,
+					  const char *p, cl_uint plen)
+{
+	cl_uint		i;
+	char		head;
+	char		tail;
+
+	if (plen == 0)
+		return 0;
+	if (slen < plen)
+		return -1;
+	head = p[0];
+	tail = p[plen - 1];
+	for (i=0; i <= slen - plen; i++)
+	{
+		/* filter by the first and last byte prior to the whole compare */
+		if (s[i] == head && s[i + plen - 1] == tail &&
+			(plen <= 2 || __like_match_bytes(s + i + 1, p + 1, plen - 2)))
+			return i;
+	}
+	return -1;
+}
+
+STATIC_INLINE(cl_bool)
+__like_match_segments(const char *s, cl_uint slen,
+					  const char *p, cl_uint plen)
+{
+	cl_uint		i, k, len;
+	cl_int		off;
+
+	/* leading segment has to match at the head */
+	for (k=0; k < plen && p[k] != '%'; k++);
+	if (k == plen)
+		return (slen == plen && __like_match_bytes(s, p, plen));
+	if (slen < k || !__like_match_bytes(s, p, k))
+		return false;
+	s += k;
+	slen -= k;
+	p += k;
+	plen -= k;
+
+	/* trailing segment has to match at the tail; p[0] is '%' here */
+	for (k=plen; p[k-1] != '%'; k--);
+	len = plen - k;
+	if (slen < len || !__like_match_bytes(s + slen - len, p + k, len))
+		return false;
+	slen -= len;
+	plen = k;
+
+	/* middle segments in order; p[plen-1] is '%' here */
+	i = 0;
+	while (i < plen)
+	{
+		if (p[i] == '%')
+		{
+			i++;
+			continue;
+		}
+		for (k=i; p[k] != '%'; k++);
+		len = k - i;
+		off = __like_find_substring(s, slen, p + i, len);
+		if (off < 0)
+			return false;
+		s += off + len;
+		slen -= off + len;
+		i = k;
+	}
+	return true;
+}
+
+/* 'abc' */
+STATIC_FUNCTION(pg_bool_t)
+pgfn_textlike_exact(kern_context *kcxt, pg_text_t arg1, pg_text_t arg2)
+{
+	pg_bool_t	result;
+
+	result.isnull = arg1.isnull | arg2.isnull;
+	if (!result.isnull)
+	{
+		char	   *s = VARDATA_ANY(arg1.value);
+		char	   *p = VARDATA_ANY(arg2.value);
+		cl_uint		slen = VARSIZE_ANY_EXHDR(arg1.value);
+		cl_uint		plen = VARSIZE_ANY_EXHDR(arg2.value);
+
+		result.value = (slen == plen && __like_match_bytes(s, p, plen));
+	}
+	return result;
+}
+
+/* 'abc%' */
+STATIC_FUNCTION(pg_bool_t)
+pgfn_textlike_prefix(kern_context *kcxt, pg_text_t arg1, pg_text_t arg2)
+{
+	pg_bool_t	result;
+
+	result.isnull = arg1.isnull | arg2.isnull;
+	if (!result.isnull)
+	{
+		char	   *s = VARDATA_ANY(arg1.value);
+		char	   *p = VARDATA_ANY(arg2.value);
+		cl_uint		slen = VARSIZE_ANY_EXHDR(arg1.value);
+		cl_uint		plen = VARSIZE_ANY_EXHDR(arg2.value) - 1;
+
+		result.value = (slen >= plen && __like_match_bytes(s, p, plen));
+	}
+	return result;
+}
+
+/* '%abc' */
+STATIC_FUNCTION(pg_bool_t)
+pgfn_textlike_suffix(kern_context *kcxt, pg_text_t arg1, pg_text_t arg2)
+{
+	pg_bool_t	result;
+
+	result.isnull = arg1.isnull | arg2.isnull;
+	if (!result.isnull)
+	{
+		char	   *s = VARDATA_ANY(arg1.value);
+		char	   *p = VARDATA_ANY(arg2.value) + 1;
+		cl_uint		slen = VARSIZE_ANY_EXHDR(arg1.value);
+		cl_uint		plen = VARSIZE_ANY_EXHDR(arg2.value) - 1;
+
+		result.value = (slen >= plen &&
+						__like_match_bytes(s + slen - plen, p, plen));
+	}
+	return result;
+}
+
+/* '%abc%' */
+STATIC_FUNCTION(pg_bool_t)
+pgfn_textlike_infix(kern_context *kcxt, pg_text_t arg1, pg_text_t arg2)
+{
+	pg_bool_t	result;
+
+	result.isnull = arg1.isnull | arg2.isnull;
+	if (!result.isnull)
+	{
+		char	   *s = VARDATA_ANY(arg1.value);
+		char	   *p = VARDATA_ANY(arg2.value) + 1;
+		cl_uint		slen = VARSIZE_ANY_EXHDR(arg1.value);
+		cl_uint		plen = VARSIZE_ANY_EXHDR(arg2.value) - 2;
+
+		result.value = (__like_find_substring(s, slen, p, plen) >= 0);
+	}
+	return result;
+}
+
+/* 'ab%cd%ef' */
+STATIC_FUNCTION(pg_bool_t)
+pgfn_textlike_segments(kern_context *kcxt, pg_text_t arg1, pg_text_t arg2)
+{
+	pg_bool_t	result;
+
+	result.isnull = arg1.isnull | arg2.isnull;
+	if (!result.isnull)
+	{
+		char	   *s = VARDATA_ANY(arg1.value);
+		char	   *p = VARDATA_ANY(arg2.value);
+		cl_uint		slen = VARSIZE_ANY_EXHDR(arg1.value);
+		cl_uint		plen = VARSIZE_ANY_EXHDR(arg2.value);
+
+		result.value = __like_match_segments(s, slen, p, plen);
+	}
+	return result;
+}
+
 #undef LIKE_TRUE
 #undef LIKE_FALSE
 #undef LIKE_ABORT
@@ -2828,7 +2828,9 @@ gpujoin_begin(CustomScanState *node, EState *estate, int eflags)
 	else
 	{
 		ExprState  *expr_state = ExecInitExpr(gj_info->outer_quals, &ss->ps);
-		gjs->outer_quals = list_make1(expr_state);
+		gjs->outer_quals = pgstrom_fixup_cpu_fallback(list_make1(expr_state),
+													  &gjs->gts,
+													  gj_info->used_params);
 	}
 	gjs->outer_ratio = gj_info->outer_ratio;
 	gjs->outer_nrows = gj_info->outer_nrows;
@@ -2990,7 +2992,10 @@ gpujoin_begin(CustomScanState *node, EState *estate, int eflags)
 		else
 		{
 			ExprState  *expr_state = ExecInitExpr(join_quals, &ss->ps);
-			istate->join_quals = list_make1(expr_state);
+			istate->join_quals =
+				pgstrom_fixup_cpu_fallback(list_make1(expr_state),
+										   &gjs->gts,
+										   gj_info->used_params);
 		}
 
 		other_quals = list_nth(gj_info->other_quals, i);
@@ -2999,7 +3004,10 @@ gpujoin_begin(CustomScanState *node, EState *estate, int eflags)
 		else
 		{
 			ExprState  *expr_state = ExecInitExpr(other_quals, &ss->ps);
-			istate->other_quals = list_make1(expr_state);
+			istate->other_quals =
+				pgstrom_fixup_cpu_fallback(list_make1(expr_state),
+										   &gjs->gts,
+										   gj_info->used_params);
 		}
 
 		hash_inner_keys = list_nth(gj_info->hash_inner_keys, i);
@@ -3733,6 +3741,8 @@ gpujoin_codegen_join_quals(StringInfo source,
 	 */
 	context->used_vars = NIL;
 	context->param_refs = NULL;
+	pgstrom_codegen_cse_prepare(context, list_concat(list_copy(join_quals),
+													 other_quals));
 	if (join_quals != NIL)
 		join_quals_code = pgstrom_codegen_expression((Node *)join_quals,
 													 context);
@@ -3758,6 +3768,7 @@ gpujoin_codegen_join_quals(StringInfo source,
 	 * variable/params declaration & initialization
 	 */
 	gpujoin_codegen_var_param_decl(source, gj_info, cur_depth, context);
+	pgstrom_codegen_cse_declarations(source, context);
 
 	/*
 	 * evaluation of other-quals and join-quals
@@ -16,8 +16,10 @@
  * GNU General Public License for more details.
  */
 #include "postgres.h"
+#include "access/hash.h"
 #include "access/sysattr.h"
 #include "access/xact.h"
+#include "catalog/pg_aggregate.h"
 #include "catalog/pg_cast.h"
 #include "catalog/pg_namespace.h"
 #include "catalog/pg_proc.h"
@@ -25,6 +27,9 @@
 #include "executor/nodeAgg.h"
 #include "executor/nodeCustom.h"
 #include "nodes/makefuncs.h"
+#if PG_VERSION_NUM >= 90600
+#include "nodes/extensible.h"
+#endif
 #include "nodes/nodeFuncs.h"
 #include "parser/parse_func.h"
 #include "optimizer/clauses.h"
@@ -32,6 +37,8 @@
 #include "optimizer/planner.h"
 #include "optimizer/var.h"
 #include "parser/parsetree.h"
+#include "storage/ipc.h"
+#include "storage/shmem.h"
 #include "utils/builtins.h"
 #include "utils/fmgroids.h"
 #include "utils/guc.h"
@@ -40,6 +47,7 @@
 #include "utils/rel.h"
 #include "utils/ruleutils.h"
 #include "utils/syscache.h"
+#include "utils/typcache.h"
 #include <math.h>
 #include "pg_strom.h"
 #include "cuda_common.h"
@@ -50,6 +58,13 @@ static CustomScanMethods		gpupreagg_scan_methods;
 static CustomExecMethods		gpupreagg_exec_methods;
 static bool						enable_gpupreagg;
 static bool						debug_force_gpupreagg;
+static bool						enable_gpupreagg_pushdown;
+static bool						gpupreagg_feedback_enabled;
+static int						gpupreagg_feedback_slots;
+static shmem_startup_hook_type	shmem_startup_next;
+#if PG_VERSION_NUM >= 90600
+static void gpupreagg_try_insert_partial(PlannedStmt *pstmt, Agg *fagg);
+#endif
 
 #if 0
 /* list of reduction mode */
@@ -57,6 +72,7 @@ static bool						debug_force_gpupreagg;
 #define GPUPREAGG_LOCAL_REDUCTION		2
 #define GPUPREAGG_GLOBAL_REDUCTION		3
 #define GPUPREAGG_FINAL_REDUCTION		4
+#define GPUPREAGG_SORTED_REDUCTION		5
 #define GPUPREAGG_ONLY_TERMINATION		99	/* used to urgent termination */
 #endif
 
@@ -75,6 +91,8 @@ typedef struct
 	const char	   *kern_source;
 	int				extra_flags;
 	List		   *used_params;	/* referenced Const/Param */
+	cl_uint			feedback_key;	/* fingerprint of grouping keys/rels */
+	bool			sorted_input;	/* input is sorted by grouping keys */
 } GpuPreAggInfo;
 
 static inline void
@@ -102,6 +120,8 @@ form_gpupreagg_info(CustomScan *cscan, GpuPreAggInfo *gpa_info)
 	privs = lappend(privs, makeString(pstrdup(gpa_info->kern_source)));
 	privs = lappend(privs, makeInteger(gpa_info->extra_flags));
 	exprs = lappend(exprs, gpa_info->used_params);
+	privs = lappend(privs, makeInteger(gpa_info->feedback_key));
+	privs = lappend(privs, makeInteger(gpa_info->sorted_input));
 
 	cscan->custom_private = privs;
 	cscan->custom_exprs = exprs;
@@ -139,6 +159,8 @@ deform_gpupreagg_info(CustomScan *cscan)
 	gpa_info->kern_source = strVal(list_nth(privs, pindex++));
 	gpa_info->extra_flags = intVal(list_nth(privs, pindex++));
 	gpa_info->used_params = list_nth(exprs, eindex++);
+	gpa_info->feedback_key = intVal(list_nth(privs, pindex++));
+	gpa_info->sorted_input = intVal(list_nth(privs, pindex++));
 
 	return gpa_info;
 }
@@ -168,6 +190,13 @@ typedef struct
 	double			stat_num_chunks;	/* # of chunks in plan/exec avg */
 	double			stat_src_nitems;	/* # of source rows in plan/exec avg */
 	double			stat_varlena_unitsz;/* unitsz of varlena buffer in plan */
+	double			stat_overflow_ngroups;/* lower bound of # of groups */
+
+	/*
+	 * Run-time statistics of the former executions, if any
+	 */
+	cl_uint			feedback_key;		/* fingerprint of this query shape */
+	cl_uint			feedback_nexecs;	/* # of executions in the history */
 } GpuPreAggState;
 
 /*
@@ -261,6 +290,15 @@ static TupleTableSlot *gpupreagg_next_tuple(GpuTaskState *gts);
 #define ALTFUNC_EXPR_PCOV_X2		108	/* PCOV_X2(X,Y) */
 #define ALTFUNC_EXPR_PCOV_Y2		109	/* PCOV_Y2(X,Y) */
 #define ALTFUNC_EXPR_PCOV_XY		110	/* PCOV_XY(X,Y) */
+#define ALTFUNC_EXPR_PSUM_FIXED		111	/* PSUM(int8(X * 10^scale)) */
+#define ALTFUNC_EXPR_FIXED_SCALE	112	/* scale of PSUM_FIXED, as Const */
+
+/*
+ * Numeric with typmod bounded precision can be accumulated as a fixed-
+ * scale integer; device kernel reduces it as int8 and the host side
+ * accumulates the partial sums using 128-bit integer.
+ */
+#define GPUPREAGG_FIXED_NUMERIC_MAX_PRECISION	18
 
 /*
  * XXX - GpuPreAgg with Numeric arguments are problematic because
@@ -314,6 +352,11 @@ static aggfunc_catalog_t  aggfunc_catalog[] = {
 	  {ALTFUNC_EXPR_NROWS, ALTFUNC_EXPR_PSUM}, 0, INT_MAX
 	},
 #ifdef GPUPREAGG_SUPPORT_NUMERIC
+	{ "avg",	1, {NUMERICOID},
+	  "s:avg_numeric_fixed",	3, {INT4OID, INT8OID, INT4OID},
+	  {ALTFUNC_EXPR_NROWS, ALTFUNC_EXPR_PSUM_FIXED, ALTFUNC_EXPR_FIXED_SCALE},
+	  DEVKERNEL_NEEDS_NUMERIC, INT_MAX
+	},
 	{ "avg",	1, {NUMERICOID},
 	  "s:avg_numeric",	2, {INT4OID, NUMERICOID},
 	  {ALTFUNC_EXPR_NROWS, ALTFUNC_EXPR_PSUM},
@@ -447,6 +490,11 @@ static aggfunc_catalog_t  aggfunc_catalog[] = {
 	  {ALTFUNC_EXPR_PSUM}, 0, INT_MAX
 	},
 #ifdef GPUPREAGG_SUPPORT_NUMERIC
+	{ "sum", 1, {NUMERICOID},
+	  "s:sum_numeric_fixed", 3, {INT4OID, INT8OID, INT4OID},
+	  {ALTFUNC_EXPR_NROWS, ALTFUNC_EXPR_PSUM_FIXED, ALTFUNC_EXPR_FIXED_SCALE},
+	  DEVKERNEL_NEEDS_NUMERIC, INT_MAX
+	},
 	{ "sum", 1, {NUMERICOID},
 	  "c:sum", 1, {NUMERICOID},
 	  {ALTFUNC_EXPR_PSUM}, DEVKERNEL_NEEDS_NUMERIC, 100
@@ -706,11 +754,11 @@ static aggfunc_catalog_t  aggfunc_catalog[] = {
 };
 
 static const aggfunc_catalog_t *
-aggfunc_lookup_by_oid(Oid aggfnoid)
+aggfunc_lookup_by_oid(Oid aggfnoid, int fixed_scale)
 {
 	Form_pg_proc	proform;
 	HeapTuple		htup;
-	int				i;
+	int				i, j;
 
 	htup = SearchSysCache1(PROCOID, ObjectIdGetDatum(aggfnoid));
 	if (!HeapTupleIsValid(htup))
@@ -727,6 +775,14 @@ aggfunc_lookup_by_oid(Oid aggfnoid)
 				   proform->proargtypes.values,
 				   sizeof(Oid) * catalog->aggfn_nargs) == 0)
 		{
+			/* fixed-scale variant needs typmod bounded numeric */
+			for (j=0; j < catalog->altfn_nargs; j++)
+			{
+				if (catalog->altfn_argexprs[j] == ALTFUNC_EXPR_PSUM_FIXED)
+					break;
+			}
+			if (j < catalog->altfn_nargs && fixed_scale < 0)
+				continue;
 			ReleaseSysCache(htup);
 			return catalog;
 		}
@@ -1191,6 +1247,79 @@ make_altfunc_pcov_expr(Aggref *aggref, const char *func_name)
 							 list_make3(filter, tle_1->expr, tle_2->expr));
 }
 
+/*
+ * get_fixed_numeric_scale - returns scale of the numeric argument of the
+ * supplied aggregate, if its precision is bounded by typmod enough small
+ * to represent as a fixed-scale int8 value. Elsewhere, -1 is returned.
+ */
+static int
+get_fixed_numeric_scale(Aggref *aggref)
+{
+	TargetEntry *tle;
+	int32		typmod;
+	int			precision;
+
+	if (list_length(aggref->args) != 1)
+		return -1;
+	tle = linitial(aggref->args);
+	Assert(IsA(tle, TargetEntry));
+	if (exprType((Node *) tle->expr) != NUMERICOID)
+		return -1;
+	typmod = exprTypmod((Node *) tle->expr);
+	if (typmod < (int32) VARHDRSZ)
+		return -1;
+	precision = ((typmod - VARHDRSZ) >> 16) & 0xffff;
+	if (precision > GPUPREAGG_FIXED_NUMERIC_MAX_PRECISION)
+		return -1;
+	return ((typmod - VARHDRSZ) & 0xffff);
+}
+
+/*
+ * make_altfunc_psum_fixed_expr - constructs an expression node of partial
+ * sum on the fixed-scale integer; PSUM(int8(X * 10^scale))
+ */
+static Expr *
+make_altfunc_psum_fixed_expr(Aggref *aggref, int fixed_scale)
+{
+	TargetEntry *tle = linitial(aggref->args);
+	Expr	   *expr;
+	Const	   *scale_const;
+	char		temp[40];
+
+	Assert(IsA(tle, TargetEntry) && fixed_scale >= 0);
+	snprintf(temp, sizeof(temp), "1e%d", fixed_scale);
+	scale_const = makeConst(NUMERICOID,
+							-1,
+							InvalidOid,
+							-1,
+							DirectFunctionCall3(numeric_in,
+												CStringGetDatum(temp),
+												ObjectIdGetDatum(InvalidOid),
+												Int32GetDatum(-1)),
+							false,
+							false);
+	expr = (Expr *) makeFuncExpr(F_NUMERIC_MUL,
+								 NUMERICOID,
+								 list_make2(copyObject(tle->expr),
+											scale_const),
+								 InvalidOid,
+								 InvalidOid,
+								 COERCE_EXPLICIT_CALL);
+	expr = (Expr *) makeFuncExpr(F_NUMERIC_INT8,
+								 INT8OID,
+								 list_make1(expr),
+								 InvalidOid,
+								 InvalidOid,
+								 COERCE_EXPLICIT_CAST);
+	if (aggref->aggfilter)
+	{
+		Expr   *defresult = (Expr *) makeZeroConst(INT8OID, -1, InvalidOid);
+
+		expr = make_expr_conditional(expr, aggref->aggfilter, defresult);
+	}
+	return make_altfunc_expr("psum", list_make1(expr));
+}
+
 /*
  * make_gpupreagg_refnode
  *
@@ -1209,6 +1338,10 @@ make_gpupreagg_refnode(Aggref *aggref, List **prep_tlist,
 	Oid			namespace_oid;
 	HeapTuple	tuple;
 	Form_pg_proc proc_form;
+#if PG_VERSION_NUM >= 90600
+	Form_pg_aggregate agg_form;
+#endif
+	int			fixed_scale;
 	int			i;
 
 	/*
@@ -1219,7 +1352,8 @@ make_gpupreagg_refnode(Aggref *aggref, List **prep_tlist,
 		return NULL;
 
 	/* Only aggregated functions listed on the catalog above is supported. */
-	aggfn_cat = aggfunc_lookup_by_oid(aggref->aggfnoid);
+	fixed_scale = get_fixed_numeric_scale(aggref);
+	aggfn_cat = aggfunc_lookup_by_oid(aggref->aggfnoid, fixed_scale);
 	if (!aggfn_cat)
 		return NULL;
 
@@ -1293,6 +1427,15 @@ make_gpupreagg_refnode(Aggref *aggref, List **prep_tlist,
 	proc_form = (Form_pg_proc) GETSTRUCT(tuple);
 
 	/* sanity checks */
+#if PG_VERSION_NUM >= 90600
+	/* partial aggregate returns transition state, not a final result */
+	if (DO_AGGSPLIT_SKIPFINAL(aggref->aggsplit))
+	{
+		if (proc_form->prorettype != get_func_rettype(aggref->aggfnoid))
+			elog(ERROR, "bug? alternative function has different result type");
+	}
+	else
+#endif
 	if (proc_form->prorettype != aggref->aggtype)
 		elog(ERROR, "bug? alternative function has different result type");
 
@@ -1318,6 +1461,45 @@ make_gpupreagg_refnode(Aggref *aggref, List **prep_tlist,
 
 	ReleaseSysCache(tuple);
 
+#if PG_VERSION_NUM >= 90600
+	/*
+	 * Aggregate of v9.6 also needs the transition type and argument types.
+	 * If GpuPreAgg works under the partial aggregate (beneath Gather),
+	 * the alternative function has to be able to combine the partial
+	 * results; the transition state is returned instead of final result.
+	 */
+	altnode->aggsplit      = aggref->aggsplit;
+	for (i=0; i < aggfn_cat->altfn_nargs; i++)
+		altnode->aggargtypes = lappend_oid(altnode->aggargtypes,
+										   aggfn_cat->altfn_argtypes[i]);
+	tuple = SearchSysCache1(AGGFNOID, ObjectIdGetDatum(altnode->aggfnoid));
+	if (!HeapTupleIsValid(tuple))
+		elog(ERROR, "cache lookup failed for aggregate %u",
+			 altnode->aggfnoid);
+	agg_form = (Form_pg_aggregate) GETSTRUCT(tuple);
+	altnode->aggtranstype = agg_form->aggtranstype;
+	if (DO_AGGSPLIT_SKIPFINAL(aggref->aggsplit))
+	{
+		if (!OidIsValid(agg_form->aggcombinefn) ||
+			(agg_form->aggtranstype == INTERNALOID &&
+			 DO_AGGSPLIT_SERIALIZE(aggref->aggsplit) &&
+			 (!OidIsValid(agg_form->aggserialfn) ||
+			  !OidIsValid(agg_form->aggdeserialfn))))
+		{
+			elog(DEBUG1, "alternative aggregate %s has no combine function",
+				 format_procedure(altnode->aggfnoid));
+			ReleaseSysCache(tuple);
+			return NULL;
+		}
+		if (agg_form->aggtranstype == INTERNALOID &&
+			DO_AGGSPLIT_SERIALIZE(aggref->aggsplit))
+			altnode->aggtype = BYTEAOID;
+		else
+			altnode->aggtype = agg_form->aggtranstype;
+	}
+	ReleaseSysCache(tuple);
+#endif
+
 	/*
 	 * construct arguments of alternative aggregate function. It references
 	 * an entry of prep_tlist, so we put expression node on the tlist on
@@ -1391,6 +1573,27 @@ make_gpupreagg_refnode(Aggref *aggref, List **prep_tlist,
 				}
 				expr = make_altfunc_expr("psum_x2", list_make1(expr));
 				break;
+			case ALTFUNC_EXPR_PSUM_FIXED:
+				expr = make_altfunc_psum_fixed_expr(aggref, fixed_scale);
+				break;
+			case ALTFUNC_EXPR_FIXED_SCALE:
+				/*
+				 * scale is a constant argument of the alternative aggregate
+				 * function, so we don't need to put it on the prep_tlist.
+				 */
+				expr = (Expr *) makeConst(INT4OID,
+										  -1,
+										  InvalidOid,
+										  sizeof(int32),
+										  Int32GetDatum(fixed_scale),
+										  false,
+										  true);
+				tle = makeTargetEntry(expr,
+									  list_length(altnode->args) + 1,
+									  NULL,
+									  false);
+				altnode->args = lappend(altnode->args, tle);
+				continue;
 			case ALTFUNC_EXPR_PCOV_X:
 				expr = make_altfunc_pcov_expr(aggref, "pcov_x");
 				break;
@@ -2779,6 +2982,7 @@ gpupreagg_codegen_projection(GpuPreAggInfo *gpa_info,
 		Relation		outer_baserel = heap_open(rte->relid, NoLock);
 		TupleDesc		tupdesc = RelationGetDescr(outer_baserel);
 		const char	   *var_label_saved;
+		List		   *exprs;
 
 		for (i=0; i < tupdesc->natts; i++)
 		{
@@ -2867,6 +3071,18 @@ gpupreagg_codegen_projection(GpuPreAggInfo *gpa_info,
 		 */
 		var_label_saved = context->var_label;
 		context->var_label = "OVAR";
+		exprs = NIL;
+		foreach (lc, tlist_dev)
+		{
+			TargetEntry *tle = lfirst(lc);
+
+			k = tle->resno - FirstLowInvalidHeapAttributeNumber;
+			if (bms_is_member(k, varattnos) && varremaps[tle->resno - 1] == 0)
+				exprs = lappend(exprs, tle->expr);
+		}
+		pgstrom_codegen_cse_prepare(context, exprs);
+
+		resetStringInfo(&temp);
 		foreach (lc, tlist_dev)
 		{
 			TargetEntry *tle = lfirst(lc);
@@ -2882,12 +3098,15 @@ gpupreagg_codegen_projection(GpuPreAggInfo *gpa_info,
 						 format_type_be(exprType((Node *) tle->expr)));
 
 				appendStringInfo(
-					&body,
+					&temp,
 					"  KVAR_%u = %s;\n",
 					tle->resno,
 					pgstrom_codegen_expression((Node *)tle->expr, context));
 			}
 		}
+		/* common sub-expressions have to be evaluated first */
+		pgstrom_codegen_cse_declarations(&body, context);
+		appendStringInfoString(&body, temp.data);
 		context->var_label = var_label_saved;
 		heap_close(outer_baserel, NoLock);
 	}
@@ -3093,13 +3312,301 @@ indexvar_fixup_by_tlist(Node *node, List *tlist_dev)
 }
 
 /*
- * pgstrom_try_insert_gpupreagg
+ * Run-time feedback of GpuPreAgg
  *
- * Entrypoint of the gpupreagg. It checks whether the supplied Aggregate node
- * is consists of all supported expressions.
+ * GpuPreAggState sizes the final reduction buffer according to the planner
+ * estimation at the beginning, then adjusts it by the run-time statistics
+ * but only within a particular execution. It often leads undersized final
+ * buffer and CPU fallback on every run of the recurring query.
+ * So, we record the observed number of groups, chunks and unit size of
+ * varlena buffer on the shared memory, keyed by the fingerprint of the
+ * grouping keys and the relations scanned underlying, then the later
+ * execution of the same query shape begins with the history.
  */
-void
-pgstrom_try_insert_gpupreagg(PlannedStmt *pstmt, Agg *agg)
+#define GPUPREAGG_FEEDBACK_NPROBES		8
+#define GPUPREAGG_FEEDBACK_WEIGHT		4
+
+typedef struct
+{
+	Oid			database_oid;	/* InvalidOid, if free entry */
+	cl_uint		feedback_key;	/* fingerprint of grouping keys/relations */
+	cl_uint		num_execs;		/* # of executions recorded */
+	cl_ulong	generation;		/* generation counter on the last update */
+	double		num_groups;		/* # of groups per segment */
+	double		num_chunks;		/* # of chunks per segment */
+	double		src_nitems;		/* # of source rows per segment */
+	double		varlena_unitsz;	/* unit size of varlena buffer per group */
+} gpupreagg_feedback_entry;
+
+typedef struct
+{
+	slock_t		lock;
+	cl_ulong	generation;
+	gpupreagg_feedback_entry entries[FLEXIBLE_ARRAY_MEMBER];
+} gpupreagg_feedback_head;
+
+static gpupreagg_feedback_head *gpa_feedback = NULL;
+
+/*
+ * gpupreagg_feedback_collect_relids
+ *
+ * It collects OID of the relations scanned under the supplied plan node.
+ */
+static void
+gpupreagg_feedback_collect_relids(Plan *plan, List *rtable, List **p_relids)
+{
+	ListCell   *lc;
+
+	if (!plan)
+		return;
+
+	switch (nodeTag(plan))
+	{
+		case T_SeqScan:
+		case T_SampleScan:
+		case T_IndexScan:
+		case T_IndexOnlyScan:
+		case T_BitmapHeapScan:
+		case T_TidScan:
+		case T_ForeignScan:
+		case T_CustomScan:
+			{
+				Index	scanrelid = ((Scan *) plan)->scanrelid;
+
+				if (scanrelid > 0)
+				{
+					RangeTblEntry  *rte = rt_fetch(scanrelid, rtable);
+
+					if (rte->rtekind == RTE_RELATION)
+						*p_relids = list_append_unique_oid(*p_relids,
+														   rte->relid);
+				}
+				if (IsA(plan, CustomScan))
+				{
+					foreach (lc, ((CustomScan *) plan)->custom_plans)
+						gpupreagg_feedback_collect_relids(lfirst(lc),
+														  rtable, p_relids);
+				}
+			}
+			break;
+		case T_Append:
+			foreach (lc, ((Append *) plan)->appendplans)
+				gpupreagg_feedback_collect_relids(lfirst(lc),
+												  rtable, p_relids);
+			break;
+		case T_SubqueryScan:
+			gpupreagg_feedback_collect_relids(((SubqueryScan *)plan)->subplan,
+											  rtable, p_relids);
+			break;
+		default:
+			break;
+	}
+	gpupreagg_feedback_collect_relids(plan->lefttree, rtable, p_relids);
+	gpupreagg_feedback_collect_relids(plan->righttree, rtable, p_relids);
+}
+
+/*
+ * gpupreagg_feedback_fingerprint
+ *
+ * It makes a fingerprint of the query shape; a set of grouping keys and
+ * relations underlying. Zero is never returned because it means no
+ * fingerprint is assigned.
+ */
+static cl_uint
+gpupreagg_feedback_fingerprint(PlannedStmt *pstmt, Agg *agg,
+							   Sort *sort_node, Plan *outer_node)
+{
+	List	   *relids = NIL;
+	cl_uint		relids_hash = 0;
+	pg_crc32	crc;
+	ListCell   *lc;
+	int			i;
+
+	INIT_LEGACY_CRC32(crc);
+	for (i=0; i < agg->numCols; i++)
+	{
+		TargetEntry	   *tle;
+		char		   *temp;
+
+		tle = list_nth(outerPlan(agg)->targetlist, agg->grpColIdx[i] - 1);
+		/* Sort node just references the underlying outer node */
+		if (sort_node && IsA(tle->expr, Var) &&
+			((Var *) tle->expr)->varno == OUTER_VAR)
+			tle = list_nth(outer_node->targetlist,
+						   ((Var *) tle->expr)->varattno - 1);
+		temp = nodeToString(tle->expr);
+		COMP_LEGACY_CRC32(crc, temp, strlen(temp));
+		pfree(temp);
+	}
+
+	/*
+	 * Relations are mixed regardless of the order of appearance, because
+	 * join order may change according to the statistics.
+	 */
+	gpupreagg_feedback_collect_relids(outer_node, pstmt->rtable, &relids);
+	foreach (lc, relids)
+		relids_hash ^= DatumGetUInt32(hash_uint32(lfirst_oid(lc)));
+	COMP_LEGACY_CRC32(crc, &relids_hash, sizeof(cl_uint));
+	FIN_LEGACY_CRC32(crc);
+
+	return (crc != 0 ? crc : 1);
+}
+
+/*
+ * gpupreagg_feedback_lookup
+ *
+ * It seeds the run-time statistics of GpuPreAggState by the history of
+ * the former executions, if any.
+ */
+static void
+gpupreagg_feedback_lookup(GpuPreAggState *gpas)
+{
+	gpupreagg_feedback_entry *entry;
+	int			nprobes = Min(GPUPREAGG_FEEDBACK_NPROBES,
+							  gpupreagg_feedback_slots);
+	int			hindex;
+	int			i;
+
+	if (!gpa_feedback || !gpupreagg_feedback_enabled ||
+		gpas->feedback_key == 0)
+		return;
+
+	hindex = (gpas->feedback_key ^ MyDatabaseId) % gpupreagg_feedback_slots;
+	SpinLockAcquire(&gpa_feedback->lock);
+	for (i=0; i < nprobes; i++)
+	{
+		entry = &gpa_feedback->entries[(hindex + i) %
+									   gpupreagg_feedback_slots];
+		if (entry->database_oid == MyDatabaseId &&
+			entry->feedback_key == gpas->feedback_key)
+		{
+			gpas->stat_num_groups = entry->num_groups;
+			gpas->stat_num_chunks = entry->num_chunks;
+			gpas->stat_src_nitems = entry->src_nitems;
+			gpas->stat_varlena_unitsz = entry->varlena_unitsz;
+			gpas->feedback_nexecs = entry->num_execs;
+			break;
+		}
+	}
+	SpinLockRelease(&gpa_feedback->lock);
+}
+
+/*
+ * gpupreagg_feedback_update
+ *
+ * It records the run-time statistics of this execution. Number of groups
+ * and unit size of varlena grows immediately, but shrinks gradually,
+ * because undersized final buffer is much more expensive than oversized
+ * one.
+ */
+static void
+gpupreagg_feedback_update(GpuPreAggState *gpas)
+{
+	gpupreagg_feedback_entry *entry;
+	gpupreagg_feedback_entry *victim = NULL;
+	int			nprobes = Min(GPUPREAGG_FEEDBACK_NPROBES,
+							  gpupreagg_feedback_slots);
+	double		num_groups;
+	double		n;
+	int			hindex;
+	int			i;
+
+	if (!gpa_feedback || !gpupreagg_feedback_enabled ||
+		gpas->feedback_key == 0)
+		return;
+	/* nothing to record, if no segment was completed */
+	if (gpas->stat_num_segments == 0 && gpas->stat_overflow_ngroups == 0.0)
+		return;
+	/*
+	 * Segment that required CPU fallback tells us the final buffer was
+	 * too small to store all the groups, so it is a lower bound.
+	 */
+	num_groups = Max(gpas->stat_num_groups, gpas->stat_overflow_ngroups);
+
+	hindex = (gpas->feedback_key ^ MyDatabaseId) % gpupreagg_feedback_slots;
+	SpinLockAcquire(&gpa_feedback->lock);
+	for (i=0; i < nprobes; i++)
+	{
+		entry = &gpa_feedback->entries[(hindex + i) %
+									   gpupreagg_feedback_slots];
+		if (entry->database_oid == MyDatabaseId &&
+			entry->feedback_key == gpas->feedback_key)
+		{
+			victim = entry;
+			break;
+		}
+		/* free entry has generation == 0, so it shall be chosen first */
+		if (!victim || entry->generation < victim->generation)
+			victim = entry;
+	}
+	Assert(victim != NULL);
+
+	if (victim->database_oid != MyDatabaseId ||
+		victim->feedback_key != gpas->feedback_key ||
+		victim->num_execs == 0)
+	{
+		victim->database_oid = MyDatabaseId;
+		victim->feedback_key = gpas->feedback_key;
+		victim->num_execs = 0;
+		victim->num_groups = num_groups;
+		victim->num_chunks = gpas->stat_num_chunks;
+		victim->src_nitems = gpas->stat_src_nitems;
+		victim->varlena_unitsz = gpas->stat_varlena_unitsz;
+	}
+	else
+	{
+		n = (double) Min(victim->num_execs, GPUPREAGG_FEEDBACK_WEIGHT);
+
+		victim->num_groups = Max(num_groups,
+								 (victim->num_groups * n +
+								  num_groups) / (n + 1.0));
+		victim->num_chunks = ((victim->num_chunks * n +
+							   gpas->stat_num_chunks) / (n + 1.0));
+		victim->src_nitems = ((victim->src_nitems * n +
+							   gpas->stat_src_nitems) / (n + 1.0));
+		victim->varlena_unitsz = Max(gpas->stat_varlena_unitsz,
+									 (victim->varlena_unitsz * n +
+									  gpas->stat_varlena_unitsz) / (n + 1.0));
+	}
+	victim->num_execs++;
+	victim->generation = ++gpa_feedback->generation;
+	SpinLockRelease(&gpa_feedback->lock);
+}
+
+/*
+ * gpupreagg_startup_feedback
+ *
+ * It allocates shared memory segment to save the run-time feedback.
+ */
+static void
+gpupreagg_startup_feedback(void)
+{
+	Size		length;
+	bool		found;
+
+	if (shmem_startup_next)
+		(*shmem_startup_next)();
+
+	length = offsetof(gpupreagg_feedback_head,
+					  entries[gpupreagg_feedback_slots]);
+	gpa_feedback = ShmemInitStruct("PG-Strom GpuPreAgg Feedback",
+								   length, &found);
+	if (found)
+		elog(ERROR, "Bug? shared memory for GpuPreAgg feedback already exists");
+
+	memset(gpa_feedback, 0, length);
+	SpinLockInit(&gpa_feedback->lock);
+}
+
+/*
+ * __pgstrom_try_insert_gpupreagg
+ *
+ * It checks whether the supplied Aggregate node is consists of all supported
+ * expressions. 'is_partial' shall be true only when the caller already
+ * checked the partial aggregate beneath the Gather can be replaced.
+ */
+static void
+__pgstrom_try_insert_gpupreagg(PlannedStmt *pstmt, Agg *agg, bool is_partial)
 {
 	CustomScan	   *cscan;
 	GpuPreAggInfo	gpa_info;
@@ -3120,6 +3627,8 @@ pgstrom_try_insert_gpupreagg(PlannedStmt *pstmt, Agg *agg)
 	cl_int			key_dist_salt;
 	double			num_groups;
 	cl_int			num_chunks;
+	cl_uint			feedback_key;
+	bool			sorted_input = false;
 	ListCell	   *lc;
 	int				i;
 	AggStrategy		new_agg_strategy;
@@ -3134,6 +3643,21 @@ pgstrom_try_insert_gpupreagg(PlannedStmt *pstmt, Agg *agg)
 	if (!pgstrom_enabled || !enable_gpupreagg)
 		return;
 
+#if PG_VERSION_NUM >= 90600
+	/*
+	 * Partial aggregate beneath the Gather is processed together with the
+	 * finalize aggregate above, because the combine step also has to take
+	 * the alternative aggregate functions.
+	 */
+	if (DO_AGGSPLIT_COMBINE(agg->aggsplit))
+	{
+		gpupreagg_try_insert_partial(pstmt, agg);
+		return;
+	}
+	if (agg->aggsplit != AGGSPLIT_SIMPLE && !is_partial)
+		return;
+#endif
+
 	/* Try to construct target-list of both Agg and GpuPreAgg node.
 	 * If unavailable to construct, it indicates this aggregation
 	 * does not support partial aggregation.
@@ -3197,10 +3721,14 @@ pgstrom_try_insert_gpupreagg(PlannedStmt *pstmt, Agg *agg)
 		 * input stream). In this case, we try to replace this Agg by
 		 * alternative Agg with AGG_HASHED strategy that takes underlying
 		 * GpuPreAgg node.
+		 * Because the outer-plan delivers rows ordered by the grouping
+		 * keys, GpuPreAgg can reduce runs of the adjacent rows with same
+		 * keys, instead of the hash-based reduction.
 		 */
 		sort_node = NULL;
 		outer_node = outerPlan(agg);
 		new_agg_strategy = AGG_HASHED;
+		sorted_input = (agg->numCols > 0);
 
 		/*
 		 * NOTE: all the supported aggregate functions are available to
@@ -3266,6 +3794,10 @@ pgstrom_try_insert_gpupreagg(PlannedStmt *pstmt, Agg *agg)
 
 	/* OK, let's construct GpuPreAgg node here */
 
+	/* fingerprint for run-time feedback, prior to pull-up of outer node */
+	feedback_key = gpupreagg_feedback_fingerprint(pstmt, agg,
+												  sort_node, outer_node);
+
 	/* Pulls-up outer node if it is a simple SeqScan or GpuScan */
 	if (!pgstrom_pullup_outer_scan(outer_node, true, &outer_quals))
 	{
@@ -3344,6 +3876,8 @@ pgstrom_try_insert_gpupreagg(PlannedStmt *pstmt, Agg *agg)
 	gpa_info.key_dist_salt  = key_dist_salt;
 	gpa_info.outer_quals	= outer_quals;
 	gpa_info.outer_nitems	= outer_nitems;
+	gpa_info.feedback_key	= feedback_key;
+	gpa_info.sorted_input	= sorted_input;
 
 	/*
 	 * construction of the kernel code according to the target-list
@@ -3432,6 +3966,677 @@ pgstrom_try_insert_gpupreagg(PlannedStmt *pstmt, Agg *agg)
 	}
 }
 
+/*
+ * pgstrom_try_insert_gpupreagg
+ *
+ * Entrypoint of the gpupreagg. It tries to inject GpuPreAgg under the
+ * supplied Aggregate node.
+ */
+void
+pgstrom_try_insert_gpupreagg(PlannedStmt *pstmt, Agg *agg)
+{
+	__pgstrom_try_insert_gpupreagg(pstmt, agg, false);
+}
+
+#if PG_VERSION_NUM >= 90600
+/*
+ * gpupreagg_collect_aggrefs - it collects Aggref nodes in the expression
+ */
+static bool
+gpupreagg_collect_aggrefs(Node *node, List **p_aggrefs)
+{
+	if (!node)
+		return false;
+	if (IsA(node, Aggref))
+	{
+		*p_aggrefs = lappend(*p_aggrefs, node);
+		return false;
+	}
+	return expression_tree_walker(node, gpupreagg_collect_aggrefs,
+								  (void *) p_aggrefs);
+}
+
+/*
+ * gpupreagg_partial_source - it walks down the Sort/Gather node from the
+ * combining Aggref to the partial Aggref being combined.
+ */
+static Aggref *
+gpupreagg_partial_source(Plan *plan, Aggref *aggref, List **p_vars)
+{
+	TargetEntry	   *tle;
+	Var			   *var;
+
+	if (list_length(aggref->args) != 1)
+		return NULL;
+	tle = linitial(aggref->args);
+	if (!IsA(tle->expr, Var))
+		return NULL;
+	var = (Var *) tle->expr;
+	for (;;)
+	{
+		if (var->varno != OUTER_VAR ||
+			var->varattno < 1 ||
+			var->varattno > list_length(plan->targetlist))
+			return NULL;
+		if (p_vars)
+			*p_vars = lappend(*p_vars, var);
+		tle = list_nth(plan->targetlist, var->varattno - 1);
+		if (IsA(plan, Agg))
+			break;
+		if (!IsA(tle->expr, Var))
+			return NULL;
+		var = (Var *) tle->expr;
+		plan = outerPlan(plan);
+	}
+	if (!IsA(tle->expr, Aggref))
+		return NULL;
+	return (Aggref *) tle->expr;
+}
+
+/*
+ * gpupreagg_try_insert_partial
+ *
+ * It tries to inject GpuPreAgg under the partial aggregate beneath the
+ * Gather node, to run GpuPreAgg on the parallel workers. Then, combining
+ * aggregate above the Gather shall take the alternative aggregate functions
+ * to combine the partial states of the alternative ones.
+ */
+static void
+gpupreagg_try_insert_partial(PlannedStmt *pstmt, Agg *fagg)
+{
+	Plan	   *subplan = outerPlan(fagg);
+	Agg		   *pagg;
+	List	   *aggrefs = NIL;
+	ListCell   *lc;
+	ListCell   *cell;
+
+	if (IsA(subplan, Sort))
+		subplan = outerPlan(subplan);
+	if (!IsA(subplan, Gather))
+		return;
+	subplan = outerPlan(subplan);
+	if (!IsA(subplan, Agg) ||
+		!DO_AGGSPLIT_SKIPFINAL(((Agg *) subplan)->aggsplit))
+		return;
+	pagg = (Agg *) subplan;
+
+	/* all the combining Aggref has to reference partial Aggref */
+	gpupreagg_collect_aggrefs((Node *) fagg->plan.targetlist, &aggrefs);
+	gpupreagg_collect_aggrefs((Node *) fagg->plan.qual, &aggrefs);
+	foreach (lc, aggrefs)
+	{
+		if (!gpupreagg_partial_source(outerPlan(fagg), lfirst(lc), NULL))
+			return;
+	}
+
+	/* try to inject GpuPreAgg under the partial aggregate */
+	__pgstrom_try_insert_gpupreagg(pstmt, pagg, true);
+
+	subplan = outerPlan(pagg);
+	if (IsA(subplan, Sort))
+		subplan = outerPlan(subplan);
+	if (!pgstrom_plan_is_gpupreagg(subplan))
+		return;
+
+	/*
+	 * OK, partial aggregate now takes alternative aggregate functions.
+	 * Combining Aggref also has to take them, and Var-nodes between them
+	 * have to be the transition type of the alternative ones.
+	 */
+	foreach (lc, aggrefs)
+	{
+		Aggref	   *aggref = lfirst(lc);
+		Aggref	   *altref;
+		List	   *vars = NIL;
+
+		altref = gpupreagg_partial_source(outerPlan(fagg), aggref, &vars);
+		if (!altref)
+			elog(ERROR, "Bug? partial Aggref was not found");
+		aggref->aggfnoid     = altref->aggfnoid;
+		aggref->aggtranstype = altref->aggtranstype;
+		aggref->aggargtypes  = list_copy(altref->aggargtypes);
+		foreach (cell, vars)
+		{
+			Var	   *var = lfirst(cell);
+
+			var->vartype   = altref->aggtype;
+			var->vartypmod = -1;
+			var->varcollid = InvalidOid;
+		}
+	}
+}
+#endif	/* PG_VERSION_NUM >= 90600 */
+
+/*
+ * Partial aggregation beneath the join has to reduce the outer rows at
+ * least to 1/GPUPREAGG_PUSHDOWN_MIN_REDUCTION, unless it is forced.
+ */
+#define GPUPREAGG_PUSHDOWN_MIN_REDUCTION	4.0
+
+/*
+ * pgstrom_try_pushdown_gpupreagg
+ *
+ * It tries to push down partial aggregation beneath the HashJoin that
+ * is located just under the Agg node (eager aggregation). If all the
+ * aggregate functions take arguments from the outer side of the join,
+ * GpuPreAgg can reduce the outer rows grouped by the join keys (and by
+ * the outer columns referenced out of aggregate functions) prior to the
+ * join, then the upper Agg combines the partial results using the
+ * alternative functions in aggfunc_catalog[].
+ * It is valid for inner join only, because a partial result joins to
+ * exactly the same inner rows that individual rows in the group would
+ * join to.
+ *
+ * NOTE: GpuJoin is not a target of this rewrite, because its device code
+ * is already constructed according to the outer columns at the path
+ * construction stage.
+ */
+typedef struct
+{
+	List	   *join_tlist;		/* target-list of the join node */
+	Bitmapset  *join_refs;		/* join resnos referenced out of Aggref */
+	List	   *aggrefs;		/* original Aggref nodes */
+	List	   *aggrefs_new;	/* Aggref nodes translated to outer side */
+	List	   *aggrefs_alt;	/* alternative Aggref nodes */
+	bool		not_available;
+} gpupreagg_pushdown_context;
+
+static bool
+gpupreagg_pushdown_pull_vars(Node *node, List **p_vars)
+{
+	if (!node)
+		return false;
+	if (IsA(node, Var))
+	{
+		*p_vars = lappend(*p_vars, node);
+		return false;
+	}
+	return expression_tree_walker(node, gpupreagg_pushdown_pull_vars,
+								  (void *) p_vars);
+}
+
+static Node *
+gpupreagg_pushdown_translate_mutator(Node *node, List *join_tlist)
+{
+	if (!node)
+		return NULL;
+	if (IsA(node, Var))
+	{
+		Var		   *var = (Var *) node;
+		TargetEntry *tle;
+
+		if (var->varno != OUTER_VAR ||
+			var->varattno < 1 ||
+			var->varattno > list_length(join_tlist))
+			elog(ERROR, "Bug? Agg references unexpected Var: %s",
+				 nodeToString(var));
+		tle = list_nth(join_tlist, var->varattno - 1);
+		return copyObject(tle->expr);
+	}
+	return expression_tree_mutator(node,
+								   gpupreagg_pushdown_translate_mutator,
+								   (void *) join_tlist);
+}
+
+static bool
+gpupreagg_pushdown_agg_walker(Node *node, gpupreagg_pushdown_context *context)
+{
+	if (!node)
+		return false;
+	if (IsA(node, Aggref))
+	{
+		Aggref	   *aggref = (Aggref *) node;
+		Aggref	   *newref;
+		List	   *vars = NIL;
+		ListCell   *lc;
+
+		if (list_member(context->aggrefs, aggref))
+			return false;
+
+		/* arguments have to reference only outer side of the join */
+		newref = (Aggref *)
+			gpupreagg_pushdown_translate_mutator((Node *) aggref,
+												 context->join_tlist);
+		gpupreagg_pushdown_pull_vars((Node *) newref, &vars);
+		foreach (lc, vars)
+		{
+			if (((Var *) lfirst(lc))->varno != OUTER_VAR)
+				context->not_available = true;
+		}
+		context->aggrefs = lappend(context->aggrefs, aggref);
+		context->aggrefs_new = lappend(context->aggrefs_new, newref);
+		return false;
+	}
+	else if (IsA(node, Var))
+	{
+		Var		   *var = (Var *) node;
+
+		if (var->varno != OUTER_VAR)
+			context->not_available = true;
+		else
+			context->join_refs = bms_add_member(context->join_refs,
+												var->varattno);
+		return false;
+	}
+	return expression_tree_walker(node, gpupreagg_pushdown_agg_walker,
+								  (void *) context);
+}
+
+static Node *
+gpupreagg_pushdown_remap_mutator(Node *node, AttrNumber *key_maps)
+{
+	if (!node)
+		return NULL;
+	if (IsA(node, Var))
+	{
+		Var		   *var = (Var *) node;
+
+		if (var->varno == OUTER_VAR)
+		{
+			var = copyObject(var);
+			if (key_maps[var->varattno] == 0)
+				elog(ERROR, "Bug? join references non-grouping key: %s",
+					 nodeToString(var));
+			var->varattno = key_maps[var->varattno];
+			return (Node *) var;
+		}
+	}
+	return expression_tree_mutator(node, gpupreagg_pushdown_remap_mutator,
+								   (void *) key_maps);
+}
+
+/*
+ * gpupreagg_pushdown_renumber_mutator
+ *
+ * It renumbers the Vars of upper Agg out of aggregate functions according
+ * to the rewritten join target-list. Aggref nodes are kept as is, because
+ * they are replaced by the alternative ones later.
+ */
+static Node *
+gpupreagg_pushdown_renumber_mutator(Node *node, AttrNumber *resno_maps)
+{
+	if (!node)
+		return NULL;
+	if (IsA(node, Aggref))
+		return node;
+	if (IsA(node, Var))
+	{
+		Var		   *var = (Var *) node;
+
+		if (var->varno == OUTER_VAR)
+		{
+			var = copyObject(var);
+			if (resno_maps[var->varattno] == 0)
+				elog(ERROR, "Bug? Agg references removed join entry: %s",
+					 nodeToString(var));
+			var->varattno = resno_maps[var->varattno];
+			return (Node *) var;
+		}
+	}
+	return expression_tree_mutator(node, gpupreagg_pushdown_renumber_mutator,
+								   (void *) resno_maps);
+}
+
+static Node *
+gpupreagg_pushdown_replace_mutator(Node *node,
+								   gpupreagg_pushdown_context *context)
+{
+	if (!node)
+		return NULL;
+	if (IsA(node, Aggref))
+	{
+		ListCell   *lc1, *lc2;
+
+		forboth (lc1, context->aggrefs,
+				 lc2, context->aggrefs_alt)
+		{
+			if (equal(node, lfirst(lc1)))
+				return copyObject(lfirst(lc2));
+		}
+		elog(ERROR, "Bug? Aggref not found: %s", nodeToString(node));
+	}
+	return expression_tree_mutator(node, gpupreagg_pushdown_replace_mutator,
+								   (void *) context);
+}
+
+bool
+pgstrom_try_pushdown_gpupreagg(PlannedStmt *pstmt, Agg *agg)
+{
+	gpupreagg_pushdown_context context;
+	HashJoin	   *hjoin;
+	Plan		   *outer_plan;
+	Plan		   *inner_plan;
+	Plan		   *gpreagg;
+	Agg			   *fagg;
+	List		   *join_tlist;
+	List		   *join_tlist_new = NIL;
+	List		   *tlist_fagg = NIL;
+	List		   *vars = NIL;
+	Bitmapset	   *grouping_keys = NULL;
+	Bitmapset	   *hash_keys = NULL;
+	AttrNumber	   *key_maps;
+	AttrNumber	   *resno_maps;
+	AggClauseCosts	agg_clause_costs;
+	Path			dummy;
+	Cost			join_cost;
+	double			outer_nrows;
+	double			num_groups;
+	ListCell	   *lc;
+	ListCell	   *cell;
+	int				i, j;
+
+	/* nothing to do, if feature is turned off */
+	if (!pgstrom_enabled || !enable_gpupreagg || !enable_gpupreagg_pushdown)
+		return false;
+
+	/*
+	 * Right now, we handle only inner HashJoin just under the Agg node
+	 * without grouping sets. MergeJoin expects sorted input, and NestLoop
+	 * gives us no reasonable estimation of the number of join keys.
+	 */
+	if (agg->aggstrategy == AGG_SORTED || agg->chain != NIL)
+		return false;
+#if PG_VERSION_NUM >= 90600
+	if (agg->aggsplit != AGGSPLIT_SIMPLE)
+		return false;
+#endif
+	if (!IsA(outerPlan(agg), HashJoin))
+		return false;
+	hjoin = (HashJoin *) outerPlan(agg);
+	if (hjoin->join.jointype != JOIN_INNER)
+		return false;
+	outer_plan = outerPlan(hjoin);
+	inner_plan = innerPlan(hjoin);
+	join_tlist = hjoin->join.plan.targetlist;
+
+	/*
+	 * All the arguments of aggregate functions must come from the outer
+	 * side. Also, pick up the join resnos referenced out of aggregates.
+	 */
+	memset(&context, 0, sizeof(gpupreagg_pushdown_context));
+	context.join_tlist = join_tlist;
+	gpupreagg_pushdown_agg_walker((Node *) agg->plan.targetlist, &context);
+	gpupreagg_pushdown_agg_walker((Node *) agg->plan.qual, &context);
+	if (context.not_available || context.aggrefs == NIL)
+		return false;
+	/* grouping keys of the upper Agg are referenced, even if not projected */
+	for (i=0; i < agg->numCols; i++)
+		context.join_refs = bms_add_member(context.join_refs,
+										   agg->grpColIdx[i]);
+
+	/*
+	 * Grouping keys of the partial aggregation are outer columns used by
+	 * the join clauses, and ones referenced by the upper Agg out of the
+	 * aggregate functions.
+	 */
+	gpupreagg_pushdown_pull_vars((Node *) hjoin->hashclauses, &vars);
+	foreach (lc, vars)
+	{
+		Var	   *var = lfirst(lc);
+
+		if (var->varno == OUTER_VAR)
+			hash_keys = bms_add_member(hash_keys, var->varattno);
+	}
+	i = -1;
+	while ((i = bms_next_member(context.join_refs, i)) >= 0)
+	{
+		TargetEntry	   *tle = list_nth(join_tlist, i - 1);
+
+		gpupreagg_pushdown_pull_vars((Node *) tle->expr, &vars);
+	}
+	gpupreagg_pushdown_pull_vars((Node *) hjoin->join.joinqual, &vars);
+	gpupreagg_pushdown_pull_vars((Node *) hjoin->join.plan.qual, &vars);
+	foreach (lc, vars)
+	{
+		Var	   *var = lfirst(lc);
+
+		if (var->varno == OUTER_VAR)
+			grouping_keys = bms_add_member(grouping_keys, var->varattno);
+	}
+	if (bms_is_empty(grouping_keys))
+		return false;
+
+	/*
+	 * Estimation of the number of groups. The number of distinct join keys
+	 * is at most the number of inner rows. If other outer columns are
+	 * also grouping keys, the upper Agg's estimation multiplies it.
+	 */
+	outer_nrows = Max(outer_plan->plan_rows, 1.0);
+	num_groups = Max(inner_plan->plan_rows, 1.0);
+	if (!bms_is_subset(grouping_keys, hash_keys))
+		num_groups *= Max(agg->plan.plan_rows, 1.0);
+	num_groups = Min(num_groups, outer_nrows);
+	if (!debug_force_gpupreagg &&
+		num_groups * GPUPREAGG_PUSHDOWN_MIN_REDUCTION > outer_nrows)
+	{
+		elog(DEBUG1, "GpuPreAgg pushdown makes no sense (%.0f -> %.0f rows)",
+			 outer_nrows, num_groups);
+		return false;
+	}
+
+	/*
+	 * Construct a pseudo Agg node on the outer side of the join, then
+	 * try to inject GpuPreAgg under the node as usual.
+	 */
+	fagg = makeNode(Agg);
+	fagg->aggstrategy = AGG_HASHED;
+	fagg->numCols = bms_num_members(grouping_keys);
+	fagg->grpColIdx = palloc0(sizeof(AttrNumber) * fagg->numCols);
+	fagg->grpOperators = palloc0(sizeof(Oid) * fagg->numCols);
+	fagg->numGroups = (long) num_groups;
+
+	i = -1;
+	j = 0;
+	while ((i = bms_next_member(grouping_keys, i)) >= 0)
+	{
+		TargetEntry	   *tle = list_nth(outer_plan->targetlist, i - 1);
+		Oid				type_oid = exprType((Node *) tle->expr);
+		TypeCacheEntry *tcache;
+		Var			   *var;
+
+		tcache = lookup_type_cache(type_oid, TYPECACHE_EQ_OPR);
+		if (!OidIsValid(tcache->eq_opr))
+			return false;
+		fagg->grpColIdx[j] = i;
+		fagg->grpOperators[j] = tcache->eq_opr;
+		j++;
+
+		var = makeVar(OUTER_VAR,
+					  i,
+					  type_oid,
+					  exprTypmod((Node *) tle->expr),
+					  exprCollation((Node *) tle->expr),
+					  0);
+		tlist_fagg = lappend(tlist_fagg,
+							 makeTargetEntry((Expr *) var,
+											 list_length(tlist_fagg) + 1,
+											 tle->resname,
+											 false));
+	}
+	foreach (lc, context.aggrefs_new)
+	{
+		tlist_fagg = lappend(tlist_fagg,
+							 makeTargetEntry((Expr *) lfirst(lc),
+											 list_length(tlist_fagg) + 1,
+											 NULL,
+											 false));
+	}
+	fagg->plan.targetlist = tlist_fagg;
+	fagg->plan.qual = NIL;
+	fagg->plan.lefttree = outer_plan;
+	fagg->plan.plan_rows = num_groups;
+	fagg->plan.plan_width = agg->plan.plan_width;
+
+	/*
+	 * Baseline cost the GpuPreAgg has to beat; the outer plan and the cost
+	 * that the join would spend for the rows to be reduced.
+	 */
+	memset(&agg_clause_costs, 0, sizeof(AggClauseCosts));
+	count_agg_clauses(NULL, (Node *) tlist_fagg, &agg_clause_costs);
+	cost_agg(&dummy,
+			 NULL,		/* PlannerInfo is not referenced! */
+			 AGG_HASHED,
+			 &agg_clause_costs,
+			 fagg->numCols,
+			 num_groups,
+			 outer_plan->startup_cost,
+			 outer_plan->total_cost,
+			 outer_plan->plan_rows);
+	join_cost = (hjoin->join.plan.total_cost -
+				 outer_plan->total_cost -
+				 inner_plan->total_cost);
+	fagg->plan.startup_cost = dummy.startup_cost;
+	fagg->plan.total_cost = (outer_plan->total_cost +
+							 Max(join_cost, 0.0) *
+							 (1.0 - num_groups / outer_nrows));
+
+	pgstrom_try_insert_gpupreagg(pstmt, fagg);
+	gpreagg = outerPlan(fagg);
+	if (!pgstrom_plan_is_gpupreagg(gpreagg))
+		return false;
+
+	/*
+	 * OK, GpuPreAgg is now constructed. Grouping keys of the pseudo Agg
+	 * were rewritten to reference the GpuPreAgg, so we make a map from
+	 * the outer resno to the GpuPreAgg resno.
+	 */
+	key_maps = palloc0(sizeof(AttrNumber) *
+					   (list_length(outer_plan->targetlist) + 1));
+	for (j=0; j < fagg->numCols; j++)
+	{
+		TargetEntry	   *tle = list_nth(fagg->plan.targetlist, j);
+
+		if (!IsA(tle->expr, Var))
+			elog(ERROR, "Bug? grouping key is not a Var: %s",
+				 nodeToString(tle->expr));
+		key_maps[fagg->grpColIdx[j]] = ((Var *) tle->expr)->varattno;
+	}
+
+	/*
+	 * Rewrite the target-list of the join. Entries that reference
+	 * non-grouping keys are only used by aggregate functions that shall
+	 * be replaced, so they are removed, and the upper Agg references
+	 * the remaining entries by the new resno. If any entry referenced
+	 * out of the aggregate functions is not remappable, we give up the
+	 * pushdown; the join node is not modified yet.
+	 */
+	resno_maps = palloc0(sizeof(AttrNumber) * (list_length(join_tlist) + 1));
+	foreach (lc, join_tlist)
+	{
+		TargetEntry	   *tle = lfirst(lc);
+		TargetEntry	   *tle_new;
+		bool			remappable = true;
+
+		vars = NIL;
+		gpupreagg_pushdown_pull_vars((Node *) tle->expr, &vars);
+		foreach (cell, vars)
+		{
+			Var	   *var = lfirst(cell);
+
+			if (var->varno == OUTER_VAR && key_maps[var->varattno] == 0)
+				remappable = false;
+		}
+		if (!remappable)
+		{
+			if (bms_is_member(tle->resno, context.join_refs))
+			{
+				elog(DEBUG1, "GpuPreAgg pushdown gave up; join target-list "
+					 "entry %d is not remappable", tle->resno);
+				return false;
+			}
+			continue;
+		}
+		tle_new = flatCopyTargetEntry(tle);
+		tle_new->expr = (Expr *)
+			gpupreagg_pushdown_remap_mutator((Node *) tle->expr,
+											 key_maps);
+		tle_new->resno = list_length(join_tlist_new) + 1;
+		join_tlist_new = lappend(join_tlist_new, tle_new);
+		resno_maps[tle->resno] = tle_new->resno;
+	}
+
+	/*
+	 * Partial results of GpuPreAgg go through the join, then alternative
+	 * aggregate functions reference them.
+	 */
+	foreach (cell, fagg->plan.targetlist)
+	{
+		TargetEntry	   *tle = lfirst(cell);
+		Aggref		   *altref;
+
+		/* skip grouping keys */
+		if (tle->resno <= fagg->numCols)
+			continue;
+		altref = (Aggref *) copyObject(tle->expr);
+		Assert(IsA(altref, Aggref));
+		foreach (lc, altref->args)
+		{
+			TargetEntry	   *arg = lfirst(lc);
+			TargetEntry	   *tle_new = NULL;
+			Var			   *var;
+			ListCell	   *lc2;
+
+			if (!IsA(arg->expr, Var))
+				continue;
+			var = (Var *) arg->expr;
+			Assert(var->varno == OUTER_VAR);
+			foreach (lc2, join_tlist_new)
+			{
+				tle_new = lfirst(lc2);
+				if (equal(tle_new->expr, var))
+					break;
+			}
+			if (!lc2)
+			{
+				tle_new = makeTargetEntry((Expr *) copyObject(var),
+										  list_length(join_tlist_new) + 1,
+										  NULL,
+										  false);
+				join_tlist_new = lappend(join_tlist_new, tle_new);
+			}
+			var->varattno = tle_new->resno;
+		}
+		context.aggrefs_alt = lappend(context.aggrefs_alt, altref);
+	}
+
+	hjoin->join.plan.targetlist = join_tlist_new;
+	hjoin->join.plan.qual = (List *)
+		gpupreagg_pushdown_remap_mutator((Node *) hjoin->join.plan.qual,
+										 key_maps);
+	hjoin->join.joinqual = (List *)
+		gpupreagg_pushdown_remap_mutator((Node *) hjoin->join.joinqual,
+										 key_maps);
+	hjoin->hashclauses = (List *)
+		gpupreagg_pushdown_remap_mutator((Node *) hjoin->hashclauses,
+										 key_maps);
+	hjoin->join.plan.plan_rows = Max(hjoin->join.plan.plan_rows *
+									 num_groups / outer_nrows, 1.0);
+	outerPlan(hjoin) = gpreagg;
+
+	/*
+	 * Agg node references the join target-list by the new resno, and
+	 * takes alternative aggregate functions.
+	 */
+	for (i=0; i < agg->numCols; i++)
+	{
+		Assert(resno_maps[agg->grpColIdx[i]] > 0);
+		agg->grpColIdx[i] = resno_maps[agg->grpColIdx[i]];
+	}
+	agg->plan.targetlist = (List *)
+		gpupreagg_pushdown_renumber_mutator((Node *) agg->plan.targetlist,
+											resno_maps);
+	agg->plan.qual = (List *)
+		gpupreagg_pushdown_renumber_mutator((Node *) agg->plan.qual,
+											resno_maps);
+	agg->plan.targetlist = (List *)
+		gpupreagg_pushdown_replace_mutator((Node *) agg->plan.targetlist,
+										   &context);
+	agg->plan.qual = (List *)
+		gpupreagg_pushdown_replace_mutator((Node *) agg->plan.qual,
+										   &context);
+	return true;
+}
+
 bool
 pgstrom_plan_is_gpupreagg(const Plan *plan)
 {
@@ -3524,6 +4729,8 @@ gpupreagg_begin(CustomScanState *node, EState *estate, int eflags)
 
 	if (gpa_info->numCols == 0)
 		gpas->reduction_mode = GPUPREAGG_NOGROUP_REDUCTION;
+	else if (gpa_info->sorted_input)
+		gpas->reduction_mode = GPUPREAGG_SORTED_REDUCTION;
 	else if (gpa_info->num_groups < (gpuMaxThreadsPerBlock() / 4))
 		gpas->reduction_mode = GPUPREAGG_LOCAL_REDUCTION;
 	else if (gpa_info->num_groups < (outer_nitems / gpa_info->num_chunks) / 4)
@@ -3549,6 +4756,11 @@ gpupreagg_begin(CustomScanState *node, EState *estate, int eflags)
 	gpas->stat_num_chunks = gpa_info->num_chunks;
 	gpas->stat_src_nitems = outer_nitems;
 	gpas->stat_varlena_unitsz = gpa_info->varlena_unitsz;
+	gpas->stat_overflow_ngroups = 0.0;
+	/* run-time feedback from the former executions, if any */
+	gpas->feedback_key = gpa_info->feedback_key;
+	gpas->feedback_nexecs = 0;
+	gpupreagg_feedback_lookup(gpas);
 	/* init perfmon */
 	pgstrom_init_perfmon(&gpas->gts);
 }
@@ -3654,9 +4866,25 @@ gpupreagg_create_segment(GpuPreAggState *gpas)
 	pgstrom_data_store *pds_final;
 	gpupreagg_segment  *segment;
 
+	/*
+	 * FIXME: At this moment, we have a hard limit (2GB) for temporary
+	 * consumption by pds_src[] chunks. It shall be configurable and
+	 * controled under GpuContext.
+	 */
+	num_chunks = 0x80000000UL / pgstrom_chunk_size();
+	reduction_ratio = Max(gpas->stat_src_nitems /
+						  gpas->stat_num_chunks, 1.0) /* nrows per chunk */
+		/ (gpas->stat_num_groups * gpas->key_dist_salt);
+	num_chunks = Min(num_chunks, reduction_ratio * gpas->safety_limit);
+	num_chunks = Max(num_chunks, 1);	/* at least one chunk */
+
 	/*
 	 * (50% + plan/exec avg) x configured margin is scale of the final
 	 * reduction buffer.
+	 * In case of sorted reduction, every workgroup writes out a partial
+	 * result of the run across its boundary, so the final buffer has to
+	 * store (# of workgroups per chunk) x (# of chunks) rows in addition
+	 * to the estimated number of groups.
 	 *
 	 * NOTE: We ensure the final buffer has at least 2039 rooms to store
 	 * the reduction results, because planner often estimate Ngroups
@@ -3667,8 +4895,20 @@ gpupreagg_create_segment(GpuPreAggState *gpas)
 	 * NOTE: We also guarantee at least 1/2 of chunk size for minimum
 	 * allocation size of the final result buffer.
 	 */
-	f_nrooms = (Size)(1.5 * gpas->stat_num_groups *
-					  pgstrom_chunk_size_margin);
+	if (gpas->reduction_mode == GPUPREAGG_SORTED_REDUCTION)
+	{
+		double	nrows_per_chunk = Max(gpas->stat_src_nitems /
+									  gpas->stat_num_chunks, 1.0);
+		Size	nworkgroups = (Size)
+			ceil(nrows_per_chunk / (double) gpuMaxThreadsPerBlock());
+
+		f_nrooms = (Size)(((double)(nworkgroups * num_chunks) +
+						   gpas->stat_num_groups) *
+						  pgstrom_chunk_size_margin);
+	}
+	else
+		f_nrooms = (Size)(1.5 * gpas->stat_num_groups *
+						  pgstrom_chunk_size_margin);
 	/* minimum available nrooms? */
 	f_nrooms = Max(f_nrooms, 2039);
 	varlena_length = (Size)(gpas->stat_varlena_unitsz * (double) f_nrooms);
@@ -3690,18 +4930,6 @@ gpupreagg_create_segment(GpuPreAggState *gpas)
 		varlena_length = (Size)(gpas->stat_varlena_unitsz * (double) f_nrooms);
 	}
 
-	/*
-	 * FIXME: At this moment, we have a hard limit (2GB) for temporary
-	 * consumption by pds_src[] chunks. It shall be configurable and
-	 * controled under GpuContext.
-	 */
-	num_chunks = 0x80000000UL / pgstrom_chunk_size();
-	reduction_ratio = Max(gpas->stat_src_nitems /
-						  gpas->stat_num_chunks, 1.0) /* nrows per chunk */
-		/ (gpas->stat_num_groups * gpas->key_dist_salt);
-	num_chunks = Min(num_chunks, reduction_ratio * gpas->safety_limit);
-	num_chunks = Max(num_chunks, 1);	/* at least one chunk */
-
 	/*
 	 * Any tasks that share same segment has to be kicked on the same
 	 * GPU device. At this moment, we don't support multiple device
@@ -3729,8 +4957,14 @@ gpupreagg_create_segment(GpuPreAggState *gpas)
 	/*
 	 * FIXME: f_hashsize is nroom of the pds_final. It is not a reasonable
 	 * estimation, thus needs to be revised.
+	 *
+	 * NOTE: sorted reduction writes out the results to kds_final without
+	 * final hash table, so we don't need to allocate large hash slots.
 	 */
-	segment->f_hashsize = f_nrooms;
+	if (gpas->reduction_mode == GPUPREAGG_SORTED_REDUCTION)
+		segment->f_hashsize = 1;
+	else
+		segment->f_hashsize = f_nrooms;
 	segment->num_chunks = num_chunks;
 	segment->idx_chunks = 0;
 	segment->refcnt = 1;
@@ -3843,6 +5077,16 @@ gpupreagg_put_segment(gpupreagg_segment *segment)
 					 (double)segment->total_ngroups) / n;
 			}
 		}
+		else
+		{
+			/*
+			 * CPU fallback usually means final buffer was too small, so
+			 * its capacity is a lower bound of the number of groups.
+			 */
+			gpas->stat_overflow_ngroups =
+				Max(gpas->stat_overflow_ngroups,
+					(double) segment->allocated_nrooms);
+		}
 		/* unless error path or fallback, it shall be released already */
 		gpupreagg_cleanup_segment(segment);
 
@@ -4005,7 +5249,11 @@ gpupreagg_task_create(GpuPreAggState *gpas,
 	gpreagg->kern.reduction_mode = gpas->reduction_mode;
 	memset(&gpreagg->kern.kerror, 0, sizeof(kern_errorbuf));
 	gpreagg->kern.key_dist_salt = gpas->key_dist_salt;
-	gpreagg->kern.hash_size = nitems;
+	/* sorted reduction does not use global hash slot */
+	if (gpas->reduction_mode == GPUPREAGG_SORTED_REDUCTION)
+		gpreagg->kern.hash_size = 1;
+	else
+		gpreagg->kern.hash_size = nitems;
 	memcpy(gpreagg->kern.pg_crc32_table,
 		   pg_crc32_table,
 		   sizeof(uint32) * 256);
@@ -4294,6 +5542,8 @@ gpupreagg_end(CustomScanState *node)
 		ExecEndNode(outerPlanState(node));
 	/* Cleanup and relase any concurrent tasks */
 	pgstrom_release_gputaskstate(&gpas->gts);
+	/* Save the run-time statistics for the later executions */
+	gpupreagg_feedback_update(gpas);
 }
 
 static void
@@ -4332,6 +5582,8 @@ gpupreagg_explain(CustomScanState *node, List *ancestors, ExplainState *es)
 		policy = "Global";
 	else if (gpas->reduction_mode == GPUPREAGG_FINAL_REDUCTION)
 		policy = "Only Final";
+	else if (gpas->reduction_mode == GPUPREAGG_SORTED_REDUCTION)
+		policy = "Sorted Run";
 	else
 		policy = "Unknown";
 	ExplainPropertyText("Reduction", policy, es);
@@ -4361,6 +5613,16 @@ gpupreagg_explain(CustomScanState *node, List *ancestors, ExplainState *es)
 				 gpas->safety_limit,
 				 gpas->key_dist_salt);
 		ExplainPropertyText("Logic Parameter", temp, es);
+
+		if (gpas->feedback_nexecs > 0)
+		{
+			snprintf(temp, sizeof(temp),
+					 "%u executions, NumGroups: %.0f, NumChunks: %.0f",
+					 gpas->feedback_nexecs,
+					 gpas->stat_num_groups,
+					 gpas->stat_num_chunks);
+			ExplainPropertyText("Feedback", temp, es);
+		}
 	}
 	pgstrom_explain_gputaskstate(&gpas->gts, es);
 }
@@ -5012,6 +6274,15 @@ pgstrom_init_gpupreagg(void)
 							 PGC_USERSET,
 							 GUC_NOT_IN_SAMPLE,
 							 NULL, NULL, NULL);
+	/* pg_strom.enable_gpupreagg_pushdown */
+	DefineCustomBoolVariable("pg_strom.enable_gpupreagg_pushdown",
+							 "Enables GpuPreAgg to be pushed down beneath the join",
+							 NULL,
+							 &enable_gpupreagg_pushdown,
+							 true,
+							 PGC_USERSET,
+							 GUC_NOT_IN_SAMPLE,
+							 NULL, NULL, NULL);
 	/* pg_strom.debug_force_gpupreagg */
 	DefineCustomBoolVariable("pg_strom.debug_force_gpupreagg",
 							 "Force GpuPreAgg regardless of the cost (debug)",
@@ -5021,12 +6292,42 @@ pgstrom_init_gpupreagg(void)
 							 PGC_USERSET,
                              GUC_NOT_IN_SAMPLE,
                              NULL, NULL, NULL);
+	/* pg_strom.gpupreagg_feedback */
+	DefineCustomBoolVariable("pg_strom.gpupreagg_feedback",
+							 "Enables run-time feedback of GpuPreAgg statistics",
+							 NULL,
+							 &gpupreagg_feedback_enabled,
+							 true,
+							 PGC_USERSET,
+							 GUC_NOT_IN_SAMPLE,
+							 NULL, NULL, NULL);
+	/* pg_strom.gpupreagg_feedback_slots */
+	DefineCustomIntVariable("pg_strom.gpupreagg_feedback_slots",
+							"Number of slots to save GpuPreAgg feedback",
+							NULL,
+							&gpupreagg_feedback_slots,
+							1024,
+							16,
+							INT_MAX / sizeof(gpupreagg_feedback_entry),
+							PGC_POSTMASTER,
+							GUC_NOT_IN_SAMPLE,
+							NULL, NULL, NULL);
+
+	/* shared memory for run-time feedback */
+	RequestAddinShmemSpace(MAXALIGN(offsetof(gpupreagg_feedback_head,
+									entries[gpupreagg_feedback_slots])));
+	shmem_startup_next = shmem_startup_hook;
+	shmem_startup_hook = gpupreagg_startup_feedback;
 
 	/* initialization of plan method table */
 	memset(&gpupreagg_scan_methods, 0, sizeof(CustomScanMethods));
 	gpupreagg_scan_methods.CustomName          = "GpuPreAgg";
 	gpupreagg_scan_methods.CreateCustomScanState
 		= gpupreagg_create_scan_state;
+#if PG_VERSION_NUM >= 90600
+	/* parallel workers look up the methods by name */
+	RegisterCustomScanMethods(&gpupreagg_scan_methods);
+#endif
 
 	/* initialization of exec method table */
 	memset(&gpupreagg_exec_methods, 0, sizeof(CustomExecMethods));
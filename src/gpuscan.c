@@ -490,6 +490,11 @@ pgstrom_pullup_outer_scan(Plan *plannode,
 
 	if (!enable_pullup_outer_scan)
 		return false;
+#if PG_VERSION_NUM >= 90600
+	/* parallel aware scan must be run by itself */
+	if (plannode->parallel_aware)
+		return false;
+#endif
 
 	if (IsA(plannode, SeqScan))
 	{
@@ -568,6 +573,7 @@ gpuscan_codegen_exec_quals(codegen_context *context, List *dev_quals)
 		return GPUSCAN_KERN_SOURCE_NO_DEVQUAL;
 
 	/* Let's walk on the device expression tree */
+	pgstrom_codegen_cse_prepare(context, dev_quals);
 	expr_code = pgstrom_codegen_expression((Node *)dev_quals, context);
 
 	initStringInfo(&body);
@@ -582,6 +588,8 @@ gpuscan_codegen_exec_quals(codegen_context *context, List *dev_quals)
 	pgstrom_codegen_param_declarations(&body, context);
 	/* add variables declarations */
 	pgstrom_codegen_var_declarations(&body, context);
+	/* add common sub-expressions */
+	pgstrom_codegen_cse_declarations(&body, context);
 
 	appendStringInfo(
 		&body,
@@ -710,6 +718,7 @@ codegen_device_projection(StringInfo source,
 {
 	AttrNumber	   *varremaps;
 	Bitmapset	   *varattnos;
+	List		   *exprs;
 	ListCell	   *lc;
 	int				prev;
 	int				i, j, k;
@@ -936,6 +945,17 @@ codegen_device_projection(StringInfo source,
 	/*
 	 * step.3 - execute expression node, then store the result onto KVAR_xx
 	 */
+	exprs = NIL;
+	foreach (lc, tlist_dev)
+	{
+		TargetEntry    *tle = lfirst(lc);
+
+		if (!IsA(tle->expr, Var))
+			exprs = lappend(exprs, tle->expr);
+	}
+	pgstrom_codegen_cse_prepare(context, exprs);
+
+	resetStringInfo(&temp);
     foreach (lc, tlist_dev)
     {
         TargetEntry    *tle = lfirst(lc);
@@ -955,11 +975,14 @@ codegen_device_projection(StringInfo source,
 			dtype->type_name,
 			tle->resno);
 		appendStringInfo(
-			&body,
+			&temp,
 			"    temp_%u_v = %s;\n",
 			tle->resno,
 			pgstrom_codegen_expression((Node *) tle->expr, context));
 	}
+	/* common sub-expressions have to be evaluated first */
+	pgstrom_codegen_cse_declarations(&body, context);
+	appendStringInfoString(&body, temp.data);
 
 	appendStringInfo(
 		&body,
@@ -1772,12 +1795,22 @@ gpuscan_begin(CustomScanState *node, EState *estate, int eflags)
 	if (gs_info->force_row_format)
 		gss->gts.be_row_format = true;
 
+	/*
+	 * Chunks can be processed by the CPU fallback path while the kernel
+	 * is being built, because it evaluates dev_quals and the projection
+	 * on the source data-store by itself.
+	 */
+	gss->gts.speculative_exec = true;
+
 	/* initialize device tlist for CPU fallback */
 	gss->dev_tlist = (List *)
 		ExecInitExpr((Expr *) cscan->custom_scan_tlist, &gss->gts.css.ss.ps);
 	/* initialize device qualifiers also, for fallback */
 	gss->dev_quals = (List *)
 		ExecInitExpr((Expr *) gs_info->dev_quals, &gss->gts.css.ss.ps);
+	gss->dev_quals = pgstrom_fixup_cpu_fallback(gss->dev_quals,
+												&gss->gts,
+												gs_info->used_params);
 	/* true, if device projection is needed */
 	gss->dev_projection = (cscan->custom_scan_tlist != NIL);
 	/* device projection related resource consumption */
@@ -16,21 +16,29 @@
  * GNU General Public License for more details.
  */
 #include "postgres.h"
+#include "access/htup_details.h"
 #include "access/xact.h"
 #include "catalog/pg_type.h"
 #include "commands/dbcommands.h"
 #include "executor/nodeCustom.h"
+#include "executor/nodeSubplan.h"
 #include "nodes/nodeFuncs.h"
 #include "nodes/makefuncs.h"
 #include "optimizer/cost.h"
 #include "parser/parsetree.h"
 #include "postmaster/bgworker.h"
+#include "storage/buffile.h"
 #include "storage/dsm.h"
 #include "utils/guc.h"
 #include "utils/lsyscache.h"
+#include "utils/builtins.h"
+#include "utils/datum.h"
 #include "utils/memutils.h"
+#include "utils/pg_locale.h"
 #include "utils/ruleutils.h"
 #include "utils/snapmgr.h"
+#include "utils/typcache.h"
+#include <math.h>
 #include "pg_strom.h"
 #include "cuda_gpusort.h"
 
@@ -51,6 +59,11 @@ typedef struct
 	Oid		   *collations;		/* OIDs of collations */
 	bool	   *nullsFirst;		/* NULLS FIRST/LAST directions */
 	bool		varlena_keys;	/* True, if here are varlena keys */
+	/* delivered from the upper Limit */
+	int64		bound;			/* number of required rows, or 0 if unbounded */
+	/* parameters to identify the sorted result for rescan */
+	List	   *cache_params;	/* list of PARAM_EXEC ids, or NIL */
+	List	   *cache_ptypes;	/* list of their type OIDs */
 } GpuSortInfo;
 
 static inline void
@@ -87,6 +100,11 @@ form_gpusort_info(CustomScan *cscan, GpuSortInfo *gs_info)
 	privs = lappend(privs, temp);
 	/* varlena_keys */
 	privs = lappend(privs, makeInteger(gs_info->varlena_keys));
+	/* bound */
+	privs = lappend(privs, makeInteger(gs_info->bound));
+	/* cache_params / cache_ptypes */
+	privs = lappend(privs, gs_info->cache_params);
+	privs = lappend(privs, gs_info->cache_ptypes);
 
 	cscan->custom_private = privs;
 }
@@ -143,6 +161,11 @@ deform_gpusort_info(CustomScan *cscan)
 		gs_info->nullsFirst[i++] = lfirst_int(cell);
 	/* varlena_keys */
 	gs_info->varlena_keys = intVal(list_nth(privs, pindex++));
+	/* bound */
+	gs_info->bound = intVal(list_nth(privs, pindex++));
+	/* cache_params / cache_ptypes */
+	gs_info->cache_params = list_nth(privs, pindex++);
+	gs_info->cache_ptypes = list_nth(privs, pindex++);
 
 	return gs_info;
 }
@@ -162,6 +185,7 @@ typedef struct
 	cl_uint				nitems_total;
 	cl_bool				has_terminator;
 	cl_bool				cpu_fallback;
+	cl_ulong		   *nkeys;				/* normalized key prefix */
 	pgstrom_data_store *pds_slot;
 	kern_resultbuf		kresults;
 } gpusort_segment;
@@ -185,6 +209,64 @@ typedef struct
 } pgstrom_gpusort;
 
 
+/*
+ * gpusort_run - a sorted segment spilled out to the temporary file
+ *
+ * Each row is written as a gpusort_run_item header followed by its
+ * MinimalTuple, both MAXALIGN'ed, in the sorted order.
+ */
+typedef struct
+{
+	cl_uint		t_len;		/* length of the MinimalTuple */
+	cl_uint		__padding;
+	cl_ulong	nkey;		/* normalized key prefix, if any */
+} gpusort_run_item;
+
+typedef struct
+{
+	BufFile	   *file;
+	Size		file_len;	/* total length of the run */
+	cl_uint		nitems;		/* number of rows in the run */
+	bool		has_nkey;	/* true, if nkey is valid */
+	/* read-ahead buffer */
+	char	   *rbuf;
+	Size		rbuf_size;	/* allocated length of rbuf */
+	Size		rbuf_ofs;	/* file offset of the head of rbuf */
+	Size		rbuf_len;	/* valid length in rbuf */
+	Size		rbuf_pos;	/* current read position in rbuf */
+	/* current head row */
+	cl_uint		head_pos;	/* position of the head row */
+	Size		head_ofs;	/* file offset of the head row */
+	cl_ulong	head_nkey;
+	HeapTupleData head_tuple;
+	Datum	   *head_values;
+	bool	   *head_isnull;
+	/* mark/restore */
+	cl_uint		mark_pos;
+	Size		mark_ofs;
+} gpusort_run;
+
+/*
+ * gpusort_cache_entry - sorted result kept for the rescan with parameters
+ * that were already seen. It owns the segments until it is restored.
+ */
+typedef struct
+{
+	dlist_node	chain;		/* link to GpuSortState->cache_lru */
+	Datum	   *key_values;	/* parameter values of the result */
+	bool	   *key_isnull;
+	cl_uint		num_segments;
+	cl_uint		num_segments_limit;
+	pgstrom_data_store **seg_slots;
+	kern_resultbuf **seg_results;
+	cl_ulong  **seg_nkeys;
+	gpusort_run **seg_runs;
+	Size		resident_size;
+	bool		nkey_has_null;
+	cl_uint		num_runs;
+	Size		spill_size;
+} gpusort_cache_entry;
+
 typedef struct
 {
 	GpuTaskState	gts;
@@ -194,6 +276,12 @@ typedef struct
 	cl_uint			num_segments_limit;
 	pgstrom_data_store **seg_slots;		/* copy of kern_data_store (SLOT) */
 	kern_resultbuf **seg_results;	/* copy of kern_resultbuf */
+	cl_ulong	  **seg_nkeys;		/* normalized key prefix, if any */
+	gpusort_run	  **seg_runs;		/* spilled run, or NULL if resident */
+	Size			resident_size;	/* host memory consumed by segments */
+	Size			memory_limit;	/* threshold to spill segments, or 0 */
+	cl_uint			num_runs;		/* number of spilled segments */
+	Size			spill_size;		/* total length of spilled runs */
 	cl_uint		   *seg_curpos;	/* current position to fetch */
 	cl_uint		  **seg_lstree;	/* large-small tree */
 	cl_uint			seg_lstree_depth;	/* depth of lstree */
@@ -210,9 +298,46 @@ typedef struct
 	bool		   *nullsFirst;		/* NULLS FIRST/LAST directions */
 	bool			varlena_keys;	/* True, if varlena sorting key exists */
 	SortSupportData *ssup_keys;		/* XXX - used by fallback function */
+	Oid				nkey_typeid;	/* type of normalized key prefix, or
+									 * InvalidOid if not available */
+	bool			nkey_exact;		/* true, if prefix fully represents
+									 * the sorting key (except for NULL) */
+	bool			nkey_has_null;	/* true, if any NULL sorting key */
+
+	/* bounded sort (ORDER BY ... LIMIT n) */
+	int64			bound;			/* number of required rows, or 0 */
+	int64			bound_nfetched;	/* number of rows already fetched */
+	cl_int			bound_segid;	/* segment that has the running K-th key */
+	cl_uint			bound_index;	/* row index of the K-th key in the KDS */
+	cl_ulong		bound_npruned;	/* number of rows pruned by the bound */
+
+	/* parallel merge */
+	bool			pmerge_enabled;	/* true, if parallel merge is running */
+	struct gpusort_mergeitem *pmerge_buf;	/* merged rows of the round */
+	cl_uint			pmerge_nitems;	/* number of rows in the round */
+	cl_uint			pmerge_nrooms;	/* length of pmerge_buf */
+	cl_uint			pmerge_curpos;	/* current position in the round */
+
+	/* sort-result cache for rescan */
+	bool			sort_done;		/* true, if sorted result is ready */
+	int				cache_nparams;	/* number of parameters in the key */
+	int			   *cache_paramids;	/* PARAM_EXEC ids in the key */
+	int16		   *cache_typlen;
+	bool		   *cache_typbyval;
+	Datum		   *cache_curr_values;	/* key of the current result */
+	bool		   *cache_curr_isnull;
+	bool			cache_curr_valid;	/* true, if the above is valid */
+	dlist_head		cache_lru;		/* LRU list of gpusort_cache_entry */
+	Size			cache_size;		/* total size of the cached results,
+									 * including the spilled runs */
+	Size			cache_limit;	/* upper limit of the cache_size */
+	cl_uint			cache_nhits;
+	cl_uint			cache_nmisses;
 
 	/* misc stuff */
+	bool			need_mark;		/* true, if mark/restore is required */
 	cl_uint		   *markpos_buf;
+	int64			markpos_nfetched;
 	TupleTableSlot *overflow_slot;
 	pgstrom_data_store *overflow_pds;
 } GpuSortState;
@@ -224,16 +349,25 @@ static CustomScanMethods	gpusort_scan_methods;
 static CustomExecMethods	gpusort_exec_methods;
 static bool					enable_gpusort;
 static bool					debug_force_gpusort;
+static int					gpusort_host_workers;
+static int					gpusort_memory_limit;
+static int					gpusort_rescan_cache_size;
 
 static GpuTask *gpusort_next_chunk(GpuTaskState *gts);
 static TupleTableSlot *gpusort_next_tuple(GpuTaskState *gts);
 static bool gpusort_task_process(GpuTask *gtask);
 static bool gpusort_task_complete(GpuTask *gtask);
 static void gpusort_task_release(GpuTask *gtask);
-static void gpusort_fallback_quicksort(GpuSortState *gss,
-									   kern_resultbuf *kresults,
-									   kern_data_store *kds_slot,
-									   cl_int lbound, cl_int rbound);
+static Oid gpusort_nkey_typeid(GpuSortState *gss, TupleDesc tupdesc);
+static void gpusort_run_close(gpusort_run *run);
+static void gpusort_run_seek(GpuSortState *gss, gpusort_run *run,
+							 cl_uint head_pos, Size head_ofs);
+static void gpusort_launch_workers(void *workers, Size unitsz, int nworkers,
+								   void *(*worker_func)(void *));
+static void gpusort_host_sort(GpuSortState *gss,
+							  kern_resultbuf *kresults,
+							  kern_data_store *kds_slot,
+							  cl_ulong *nkeys);
 
 /*
  * cost_gpusort
@@ -243,13 +377,14 @@ static void gpusort_fallback_quicksort(GpuSortState *gss,
 #define LOG2(x)		(log(x) / 0.693147180559945)
 
 static void
-cost_gpusort(PlannedStmt *pstmt, Sort *sort,
+cost_gpusort(PlannedStmt *pstmt, Sort *sort, int64 bound,
 			 Cost *p_startup_cost, Cost *p_total_cost,
 			 cl_uint *p_num_segments,
 			 Size *p_segment_nrooms, Size *p_segment_extra)
 {
 	Plan	   *outer_plan = outerPlan(sort);
 	double		ntuples = outer_plan->plan_rows;
+	double		ntuples_output;
 	double		ntuples_per_chunk;
 	int			plan_width = outer_plan->plan_width;
 	int			nattrs = list_length(outer_plan->targetlist);
@@ -270,6 +405,10 @@ cost_gpusort(PlannedStmt *pstmt, Sort *sort,
 
 	if (ntuples < 2.0)
 		ntuples = 2.0;
+	/* number of rows to be merged and returned by CPU */
+	ntuples_output = ntuples;
+	if (bound > 0 && (double) bound < ntuples)
+		ntuples_output = (double) bound;
 
 	/* Cost come from outer-plan and sub-plans */
 	startup_cost = outer_plan->total_cost;
@@ -399,7 +538,8 @@ cost_gpusort(PlannedStmt *pstmt, Sort *sort,
 		 * Also, CPU has to merge the individual sorted segments. Its cost
 		 * depends on number of segments and number of tuples per segment.
 		 * If we have k-segments, CPU has to compare (k-1) times to return
-		 * a tuple.
+		 * a tuple. In case of bounded sort, merge stops once the required
+		 * number of rows are returned.
 		 */
 		cost_others = (cost_load_segment + cost_gpu_sorting + cost_dma_recv) -
 			Max3(cost_load_segment, cost_gpu_sorting, cost_dma_recv);
@@ -408,7 +548,7 @@ cost_gpusort(PlannedStmt *pstmt, Sort *sort,
 						 cost_gpu_sorting,
 						 cost_dma_recv) * (double) k + cost_others;
 		/* fine grained segmentation also makes CPU busy... */
-		tentative += cpu_comp_cost * (k-1) * ntuples;
+		tentative += cpu_comp_cost * (k-1) * ntuples_output;
 
 		if (tentative < sorting_cost)
 		{
@@ -422,7 +562,27 @@ cost_gpusort(PlannedStmt *pstmt, Sort *sort,
 		break;
 	}
 	startup_cost += sorting_cost;
-	run_cost += cpu_operator_cost * ntuples;
+	run_cost += cpu_operator_cost * ntuples_output;
+
+	/*
+	 * If sorted segments are expected to overflow the memory limit, they
+	 * shall be written out to the temporary file then read back.
+	 */
+	if (gpusort_memory_limit != 0)
+	{
+		double	limit = (gpusort_memory_limit < 0
+						 ? (double) work_mem
+						 : (double) gpusort_memory_limit) * 1024.0;
+		double	nbytes = (double)(sizeof(cl_uint) + unitsz_fmt_slot) * ntuples;
+
+		if (nbytes > limit)
+		{
+			double	npages = ceil((nbytes - limit) / BLCKSZ);
+
+			startup_cost += seq_page_cost * npages;
+			run_cost += seq_page_cost * npages;
+		}
+	}
 
 	/* result */
 	*p_startup_cost = startup_cost;
@@ -558,8 +718,226 @@ pgstrom_gpusort_codegen(Sort *sort, codegen_context *context)
 	return kern.data;
 }
 
+/*
+ * gpusort_collect_params
+ *
+ * It collects PARAM_EXEC parameters referenced in the sub-plan tree with
+ * their data types, to construct the key of sort-result cache on rescan.
+ * If sub-plan contains a node we cannot walk on, it gives up.
+ */
+typedef struct
+{
+	PlannedStmt *pstmt;
+	List	   *param_ids;
+	List	   *param_types;
+	bool		not_available;
+} gpusort_params_context;
+
+static void gpusort_collect_params_plan(Plan *plan,
+										gpusort_params_context *context);
+
+static bool
+gpusort_collect_params_walker(Node *node, gpusort_params_context *context)
+{
+	if (!node)
+		return false;
+	if (IsA(node, Param))
+	{
+		Param	   *param = (Param *) node;
+
+		if (param->paramkind == PARAM_EXEC &&
+			!list_member_int(context->param_ids, param->paramid))
+		{
+			context->param_ids = lappend_int(context->param_ids,
+											 param->paramid);
+			context->param_types = lappend_oid(context->param_types,
+											   param->paramtype);
+		}
+		return false;
+	}
+	if (IsA(node, SubPlan))
+	{
+		SubPlan	   *subplan = (SubPlan *) node;
+
+		gpusort_collect_params_plan(list_nth(context->pstmt->subplans,
+											 subplan->plan_id - 1),
+									context);
+	}
+	return expression_tree_walker(node, gpusort_collect_params_walker,
+								  (void *) context);
+}
+
+static void
+gpusort_collect_params_plan(Plan *plan, gpusort_params_context *context)
+{
+	ListCell   *lc;
+
+	if (!plan || context->not_available)
+		return;
+
+	gpusort_collect_params_walker((Node *) plan->targetlist, context);
+	gpusort_collect_params_walker((Node *) plan->qual, context);
+	gpusort_collect_params_walker((Node *) plan->initPlan, context);
+
+	switch (nodeTag(plan))
+	{
+		case T_SeqScan:
+		case T_Material:
+		case T_Sort:
+		case T_Hash:
+		case T_Unique:
+		case T_Agg:
+		case T_Group:
+		case T_SetOp:
+			break;
+		case T_IndexScan:
+			gpusort_collect_params_walker((Node *)
+				((IndexScan *) plan)->indexqual, context);
+			gpusort_collect_params_walker((Node *)
+				((IndexScan *) plan)->indexorderby, context);
+			break;
+		case T_IndexOnlyScan:
+			gpusort_collect_params_walker((Node *)
+				((IndexOnlyScan *) plan)->indexqual, context);
+			gpusort_collect_params_walker((Node *)
+				((IndexOnlyScan *) plan)->indexorderby, context);
+			break;
+		case T_BitmapIndexScan:
+			gpusort_collect_params_walker((Node *)
+				((BitmapIndexScan *) plan)->indexqual, context);
+			break;
+		case T_BitmapHeapScan:
+			gpusort_collect_params_walker((Node *)
+				((BitmapHeapScan *) plan)->bitmapqualorig, context);
+			break;
+		case T_BitmapAnd:
+			foreach (lc, ((BitmapAnd *) plan)->bitmapplans)
+				gpusort_collect_params_plan(lfirst(lc), context);
+			break;
+		case T_BitmapOr:
+			foreach (lc, ((BitmapOr *) plan)->bitmapplans)
+				gpusort_collect_params_plan(lfirst(lc), context);
+			break;
+		case T_TidScan:
+			gpusort_collect_params_walker((Node *)
+				((TidScan *) plan)->tidquals, context);
+			break;
+		case T_FunctionScan:
+			gpusort_collect_params_walker((Node *)
+				((FunctionScan *) plan)->functions, context);
+			break;
+		case T_ValuesScan:
+			gpusort_collect_params_walker((Node *)
+				((ValuesScan *) plan)->values_lists, context);
+			break;
+		case T_SubqueryScan:
+			gpusort_collect_params_plan(((SubqueryScan *) plan)->subplan,
+										context);
+			break;
+		case T_Append:
+			foreach (lc, ((Append *) plan)->appendplans)
+				gpusort_collect_params_plan(lfirst(lc), context);
+			break;
+		case T_MergeAppend:
+			foreach (lc, ((MergeAppend *) plan)->mergeplans)
+				gpusort_collect_params_plan(lfirst(lc), context);
+			break;
+		case T_NestLoop:
+			gpusort_collect_params_walker((Node *)
+				((Join *) plan)->joinqual, context);
+			break;
+		case T_MergeJoin:
+			gpusort_collect_params_walker((Node *)
+				((Join *) plan)->joinqual, context);
+			gpusort_collect_params_walker((Node *)
+				((MergeJoin *) plan)->mergeclauses, context);
+			break;
+		case T_HashJoin:
+			gpusort_collect_params_walker((Node *)
+				((Join *) plan)->joinqual, context);
+			gpusort_collect_params_walker((Node *)
+				((HashJoin *) plan)->hashclauses, context);
+			break;
+		case T_Result:
+			gpusort_collect_params_walker((Node *)
+				((Result *) plan)->resconstantqual, context);
+			break;
+		case T_Limit:
+			gpusort_collect_params_walker((Node *)
+				((Limit *) plan)->limitOffset, context);
+			gpusort_collect_params_walker((Node *)
+				((Limit *) plan)->limitCount, context);
+			break;
+		case T_CustomScan:
+			gpusort_collect_params_walker((Node *)
+				((CustomScan *) plan)->custom_exprs, context);
+			foreach (lc, ((CustomScan *) plan)->custom_plans)
+				gpusort_collect_params_plan(lfirst(lc), context);
+			break;
+		default:
+			/* unable to walk on, so give up */
+			context->not_available = true;
+			return;
+	}
+	gpusort_collect_params_plan(plan->lefttree, context);
+	gpusort_collect_params_plan(plan->righttree, context);
+}
+
+/*
+ * gpusort_get_limit_bound
+ *
+ * It picks up the number of rows required by the Limit node just above
+ * the Sort node. Only constant LIMIT/OFFSET clauses are supported because
+ * nodeLimit.c does not pass down the bound to CustomScan node at run-time.
+ * It returns false if we cannot determine the bound on the planning stage.
+ */
+static bool
+gpusort_get_limit_bound(Limit *limit, int64 *p_bound)
+{
+	Const	   *con;
+	int64		count;
+	int64		offset = 0;
+
+	/* LIMIT clause */
+	if (!limit->limitCount)
+	{
+		*p_bound = 0;	/* unbounded */
+		return true;
+	}
+	if (!IsA(limit->limitCount, Const))
+		return false;
+	con = (Const *) limit->limitCount;
+	if (con->constisnull)
+	{
+		*p_bound = 0;	/* LIMIT ALL, thus unbounded */
+		return true;
+	}
+	count = DatumGetInt64(con->constvalue);
+	if (count < 0)
+		return false;	/* Limit node shall raise an error */
+
+	/* OFFSET clause */
+	if (limit->limitOffset)
+	{
+		if (!IsA(limit->limitOffset, Const))
+			return false;
+		con = (Const *) limit->limitOffset;
+		if (!con->constisnull)
+			offset = DatumGetInt64(con->constvalue);
+		if (offset < 0)
+			return false;	/* Limit node shall raise an error */
+	}
+
+	/* kern_resultbuf cannot have more than UINT_MAX items anyway */
+	if (count > (int64) UINT_MAX - offset)
+		*p_bound = 0;
+	else
+		*p_bound = Max(count + offset, 1);
+	return true;
+}
+
 void
-pgstrom_try_insert_gpusort(PlannedStmt *pstmt, Plan **p_plan)
+pgstrom_try_insert_gpusort(PlannedStmt *pstmt, Plan *parent, Plan **p_plan)
 {
 	Sort	   *sort = (Sort *)(*p_plan);
 	List	   *tlist = sort->plan.targetlist;
@@ -574,12 +952,23 @@ pgstrom_try_insert_gpusort(PlannedStmt *pstmt, Plan **p_plan)
 	GpuSortInfo	gs_info;
 	codegen_context context;
 	bool		varlena_keys = false;
+	int64		bound = 0;
 	int			i;
 
 	/* nothing to do, if feature is turned off */
 	if (!pgstrom_enabled || !enable_gpusort)
 	  return;
 
+	/*
+	 * Limit node informs the Sort node minimum required number of rows,
+	 * then Sort node takes top-N heapsort. GpuSort also runs in bounded
+	 * mode, if the bound is determined on the planning stage. Elsewhere,
+	 * it is not easy to win against the top-N heapsort.
+	 */
+	if (parent && IsA(parent, Limit) &&
+		!gpusort_get_limit_bound((Limit *) parent, &bound))
+		return;
+
 	/* ensure the plan is Sort */
 	Assert(IsA(sort, Sort));
 	Assert(sort->plan.qual == NIL);
@@ -619,7 +1008,7 @@ pgstrom_try_insert_gpusort(PlannedStmt *pstmt, Plan **p_plan)
 	/*
 	 * OK, cost estimation with GpuSort
 	 */
-	cost_gpusort(pstmt, sort,
+	cost_gpusort(pstmt, sort, bound,
 				 &startup_cost, &total_cost,
 				 &num_segments, &segment_nrooms, &segment_extra);
 
@@ -691,6 +1080,8 @@ pgstrom_try_insert_gpusort(PlannedStmt *pstmt, Plan **p_plan)
 	}
 	outerPlan(cscan) = subplan;
 	cscan->scan.plan.initPlan = sort->plan.initPlan;
+	cscan->scan.plan.extParam = bms_copy(sort->plan.extParam);
+	cscan->scan.plan.allParam = bms_copy(sort->plan.allParam);
 
 	pgstrom_init_codegen_context(&context);
 	gs_info.startup_cost = startup_cost;
@@ -708,6 +1099,53 @@ pgstrom_try_insert_gpusort(PlannedStmt *pstmt, Plan **p_plan)
 	gs_info.collations = sort->collations;
 	gs_info.nullsFirst = sort->nullsFirst;
 	gs_info.varlena_keys = varlena_keys;	// still used?
+	gs_info.bound = bound;
+
+	/*
+	 * Sort-result cache for rescan is keyed by the PARAM_EXEC parameters
+	 * on which the sub-plan depends. All of them must have known types.
+	 */
+	gs_info.cache_params = NIL;
+	gs_info.cache_ptypes = NIL;
+	if (!bms_is_empty(sort->plan.extParam))
+	{
+		gpusort_params_context pcontext;
+		Bitmapset  *tempset = bms_copy(sort->plan.extParam);
+		int			paramid;
+
+		memset(&pcontext, 0, sizeof(gpusort_params_context));
+		pcontext.pstmt = pstmt;
+		gpusort_collect_params_plan(subplan, &pcontext);
+		gpusort_collect_params_walker((Node *) sort->plan.initPlan,
+									  &pcontext);
+
+		while (!pcontext.not_available &&
+			   (paramid = bms_first_member(tempset)) >= 0)
+		{
+			ListCell   *lc1, *lc2;
+
+			forboth (lc1, pcontext.param_ids,
+					 lc2, pcontext.param_types)
+			{
+				if (lfirst_int(lc1) == paramid)
+				{
+					gs_info.cache_params = lappend_int(gs_info.cache_params,
+													   paramid);
+					gs_info.cache_ptypes = lappend_oid(gs_info.cache_ptypes,
+													   lfirst_oid(lc2));
+					break;
+				}
+			}
+			if (!lc1)
+				pcontext.not_available = true;
+		}
+		if (pcontext.not_available)
+		{
+			gs_info.cache_params = NIL;
+			gs_info.cache_ptypes = NIL;
+		}
+		bms_free(tempset);
+	}
 	form_gpusort_info(cscan, &gs_info);
 
 	*p_plan = &cscan->scan.plan;
@@ -776,6 +1214,7 @@ gpusort_begin(CustomScanState *node, EState *estate, int eflags)
 	 * a materialized output, so it is unconditionally possible to run
 	 * backward scan, random accesses and rewind the position.
 	 */
+	gss->need_mark = ((eflags & EXEC_FLAG_MARK) != 0);
 	eflags &= ~(EXEC_FLAG_REWIND | EXEC_FLAG_BACKWARD | EXEC_FLAG_MARK);
 
 	gss->markpos_buf = NULL;	/* to be set later */
@@ -805,6 +1244,17 @@ gpusort_begin(CustomScanState *node, EState *estate, int eflags)
 							 gss->num_segments_limit);
 	gss->seg_results = palloc0(sizeof(kern_resultbuf *) *
 							   gss->num_segments_limit);
+	gss->seg_nkeys = palloc0(sizeof(cl_ulong *) *
+							 gss->num_segments_limit);
+	gss->seg_runs = palloc0(sizeof(gpusort_run *) *
+							gss->num_segments_limit);
+	gss->resident_size = 0;
+	if (gpusort_memory_limit < 0)
+		gss->memory_limit = (Size) work_mem * 1024L;
+	else
+		gss->memory_limit = (Size) gpusort_memory_limit * 1024L;
+	gss->num_runs = 0;
+	gss->spill_size = 0;
 	gss->seg_curpos = NULL;	/* to be set later */
 	gss->seg_lstree = NULL;	/* to be set later */
 	gss->segment_nrooms = gs_info->segment_nrooms;
@@ -817,6 +1267,13 @@ gpusort_begin(CustomScanState *node, EState *estate, int eflags)
 	gss->collations = gs_info->collations;
 	gss->nullsFirst = gs_info->nullsFirst;
 
+	/* bounded sort */
+	gss->bound = gs_info->bound;
+	gss->bound_nfetched = 0;
+	gss->bound_segid = -1;
+	gss->bound_index = 0;
+	gss->bound_npruned = 0;
+
 	gss->ssup_keys = palloc0(sizeof(SortSupportData) * gss->numCols);
 	for (i=0; i < gss->numCols; i++)
 	{
@@ -828,14 +1285,316 @@ gpusort_begin(CustomScanState *node, EState *estate, int eflags)
 		ssup->ssup_attno = gss->sortColIdx[i];
 		PrepareSortSupportFromOrderingOp(gss->sortOperators[i], ssup);
 	}
+	/* normalized key prefix of the first sorting key, if available */
+	gss->nkey_typeid = gpusort_nkey_typeid(gss, tupdesc);
+	gss->nkey_exact = false;
+	if (gss->numCols == 1)
+	{
+		switch (gss->nkey_typeid)
+		{
+			case BOOLOID:
+			case INT2OID:
+			case INT4OID:
+			case INT8OID:
+			case FLOAT4OID:
+			case FLOAT8OID:
+			case DATEOID:
+			case TIMESTAMPOID:
+			case TIMESTAMPTZOID:
+				gss->nkey_exact = true;
+				break;
+			default:
+				break;
+		}
+	}
+	gss->nkey_has_null = false;
+
+	/* parallel merge */
+	gss->pmerge_enabled = false;
+	gss->pmerge_buf = NULL;
+	gss->pmerge_nitems = 0;
+	gss->pmerge_nrooms = 0;
+	gss->pmerge_curpos = 0;
+
+	/* sort-result cache for rescan */
+	gss->sort_done = false;
+	gss->cache_nparams = list_length(gs_info->cache_params);
+	gss->cache_curr_valid = false;
+	dlist_init(&gss->cache_lru);
+	gss->cache_size = 0;
+	gss->cache_limit = (Size) gpusort_rescan_cache_size * 1024L;
+	gss->cache_nhits = 0;
+	gss->cache_nmisses = 0;
+	if (gss->cache_limit == 0)
+		gss->cache_nparams = 0;
+	if (gss->cache_nparams > 0)
+	{
+		ListCell   *lc1, *lc2;
+
+		gss->cache_paramids = palloc(sizeof(int) * gss->cache_nparams);
+		gss->cache_typlen = palloc(sizeof(int16) * gss->cache_nparams);
+		gss->cache_typbyval = palloc(sizeof(bool) * gss->cache_nparams);
+		gss->cache_curr_values = palloc0(sizeof(Datum) * gss->cache_nparams);
+		gss->cache_curr_isnull = palloc0(sizeof(bool) * gss->cache_nparams);
+		i = 0;
+		forboth (lc1, gs_info->cache_params,
+				 lc2, gs_info->cache_ptypes)
+		{
+			gss->cache_paramids[i] = lfirst_int(lc1);
+			get_typlenbyval(lfirst_oid(lc2),
+							&gss->cache_typlen[i],
+							&gss->cache_typbyval[i]);
+			i++;
+		}
+	}
 
 	/* init perfmon */
 	pgstrom_init_perfmon(&gss->gts);
 }
 
+/*
+ * gpusort_release_segments
+ *
+ * It releases the sorted segments on the supplied arrays
+ */
+static void
+gpusort_release_segments(cl_uint num_segments,
+						 pgstrom_data_store **seg_slots,
+						 kern_resultbuf **seg_results,
+						 cl_ulong **seg_nkeys,
+						 gpusort_run **seg_runs)
+{
+	cl_uint		i;
+
+	for (i=0; i < num_segments; i++)
+	{
+		gpusort_segment	   *segment = (gpusort_segment *)
+			((char *)seg_results[i] - offsetof(gpusort_segment, kresults));
+
+		Assert(seg_slots[i] == segment->pds_slot);
+		if (seg_slots[i])
+			PDS_release(seg_slots[i]);
+		if (seg_runs[i])
+			gpusort_run_close(seg_runs[i]);
+		if (segment->nkeys)
+			pfree(segment->nkeys);
+		pfree(segment);
+		seg_slots[i] = NULL;
+		seg_results[i] = NULL;
+		seg_nkeys[i] = NULL;
+		seg_runs[i] = NULL;
+	}
+}
+
+/*
+ * gpusort_cache_release
+ *
+ * It releases a cache entry and the segments owned by the entry
+ */
+static void
+gpusort_cache_release(GpuSortState *gss, gpusort_cache_entry *entry)
+{
+	int		i;
+
+	dlist_delete(&entry->chain);
+	gss->cache_size -= entry->resident_size + entry->spill_size;
+
+	gpusort_release_segments(entry->num_segments,
+							 entry->seg_slots,
+							 entry->seg_results,
+							 entry->seg_nkeys,
+							 entry->seg_runs);
+	for (i=0; i < gss->cache_nparams; i++)
+	{
+		if (!gss->cache_typbyval[i] && !entry->key_isnull[i])
+			pfree(DatumGetPointer(entry->key_values[i]));
+	}
+	pfree(entry->key_values);
+	pfree(entry->key_isnull);
+	pfree(entry->seg_slots);
+	pfree(entry->seg_results);
+	pfree(entry->seg_nkeys);
+	pfree(entry->seg_runs);
+	pfree(entry);
+}
+
+/*
+ * gpusort_cache_capture
+ *
+ * It saves the current parameter values being the key of sorted result.
+ * Parameters by InitPlan are evaluated here, if not yet.
+ */
+static void
+gpusort_cache_capture(GpuSortState *gss)
+{
+	ExprContext	   *econtext = gss->gts.css.ss.ps.ps_ExprContext;
+	EState		   *estate = gss->gts.css.ss.ps.state;
+	MemoryContext	oldcxt;
+	int				i;
+
+	Assert(gss->cache_nparams > 0 && !gss->cache_curr_valid);
+	oldcxt = MemoryContextSwitchTo(estate->es_query_cxt);
+	for (i=0; i < gss->cache_nparams; i++)
+	{
+		ParamExecData  *prm =
+			&econtext->ecxt_param_exec_vals[gss->cache_paramids[i]];
+
+		if (prm->execPlan != NULL)
+		{
+			/* parameter not evaluated yet, so go do it */
+			ExecSetParamPlan(prm->execPlan, econtext);
+			Assert(prm->execPlan == NULL);
+		}
+		gss->cache_curr_isnull[i] = prm->isnull;
+		if (prm->isnull)
+			gss->cache_curr_values[i] = (Datum) 0;
+		else
+			gss->cache_curr_values[i] = datumCopy(prm->value,
+												  gss->cache_typbyval[i],
+												  gss->cache_typlen[i]);
+	}
+	MemoryContextSwitchTo(oldcxt);
+	gss->cache_curr_valid = true;
+}
+
+/*
+ * gpusort_cache_stash
+ *
+ * It moves the current sorted result into the head of LRU list, then
+ * evicts the older entries if total size exceeds the limit.
+ */
+static void
+gpusort_cache_stash(GpuSortState *gss)
+{
+	EState		   *estate = gss->gts.css.ss.ps.state;
+	MemoryContext	oldcxt;
+	gpusort_cache_entry *entry;
+	dlist_node	   *dnode;
+
+	Assert(gss->sort_done && gss->cache_curr_valid);
+	oldcxt = MemoryContextSwitchTo(estate->es_query_cxt);
+	entry = palloc0(sizeof(gpusort_cache_entry));
+	/* ownership of the key and segments moves to the entry */
+	entry->key_values = gss->cache_curr_values;
+	entry->key_isnull = gss->cache_curr_isnull;
+	entry->num_segments = gss->num_segments;
+	entry->num_segments_limit = gss->num_segments_limit;
+	entry->seg_slots = gss->seg_slots;
+	entry->seg_results = gss->seg_results;
+	entry->seg_nkeys = gss->seg_nkeys;
+	entry->seg_runs = gss->seg_runs;
+	entry->resident_size = gss->resident_size;
+	entry->nkey_has_null = gss->nkey_has_null;
+	entry->num_runs = gss->num_runs;
+	entry->spill_size = gss->spill_size;
+	dlist_push_head(&gss->cache_lru, &entry->chain);
+	/* spilled runs also consume the temporary file space */
+	gss->cache_size += entry->resident_size + entry->spill_size;
+
+	/* fresh arrays for the next sorting */
+	gss->cache_curr_values = palloc0(sizeof(Datum) * gss->cache_nparams);
+	gss->cache_curr_isnull = palloc0(sizeof(bool) * gss->cache_nparams);
+	gss->cache_curr_valid = false;
+	gss->num_segments = 0;
+	gss->seg_slots = palloc0(sizeof(pgstrom_data_store *) *
+							 gss->num_segments_limit);
+	gss->seg_results = palloc0(sizeof(kern_resultbuf *) *
+							   gss->num_segments_limit);
+	gss->seg_nkeys = palloc0(sizeof(cl_ulong *) *
+							 gss->num_segments_limit);
+	gss->seg_runs = palloc0(sizeof(gpusort_run *) *
+							gss->num_segments_limit);
+	MemoryContextSwitchTo(oldcxt);
+
+	/* evict the least recently used entries, but the latest one */
+	while (gss->cache_size > gss->cache_limit)
+	{
+		dnode = dlist_tail_node(&gss->cache_lru);
+		if (dnode == &entry->chain)
+			break;
+		gpusort_cache_release(gss, dlist_container(gpusort_cache_entry,
+												   chain, dnode));
+	}
+	if (gss->cache_size > gss->cache_limit)
+		gpusort_cache_release(gss, entry);
+}
+
+/*
+ * gpusort_cache_lookup
+ *
+ * It looks up the sorted result for the current parameters, then restores
+ * the segments if any. Returns true, if found.
+ */
+static bool
+gpusort_cache_lookup(GpuSortState *gss)
+{
+	dlist_mutable_iter iter;
+	int			i;
+
+	Assert(gss->cache_curr_valid && gss->num_segments == 0);
+	dlist_foreach_modify(iter, &gss->cache_lru)
+	{
+		gpusort_cache_entry *entry
+			= dlist_container(gpusort_cache_entry, chain, iter.cur);
+
+		for (i=0; i < gss->cache_nparams; i++)
+		{
+			if (entry->key_isnull[i] != gss->cache_curr_isnull[i])
+				break;
+			if (!entry->key_isnull[i] &&
+				!datumIsEqual(entry->key_values[i],
+							  gss->cache_curr_values[i],
+							  gss->cache_typbyval[i],
+							  gss->cache_typlen[i]))
+				break;
+		}
+		if (i < gss->cache_nparams)
+			continue;
+
+		/* OK, restore the sorted result */
+		dlist_delete(&entry->chain);
+		gss->cache_size -= entry->resident_size + entry->spill_size;
+
+		pfree(gss->seg_slots);
+		pfree(gss->seg_results);
+		pfree(gss->seg_nkeys);
+		pfree(gss->seg_runs);
+		gss->num_segments = entry->num_segments;
+		gss->num_segments_limit = entry->num_segments_limit;
+		gss->seg_slots = entry->seg_slots;
+		gss->seg_results = entry->seg_results;
+		gss->seg_nkeys = entry->seg_nkeys;
+		gss->seg_runs = entry->seg_runs;
+		gss->resident_size = entry->resident_size;
+		gss->nkey_has_null = entry->nkey_has_null;
+		gss->num_runs = entry->num_runs;
+		gss->spill_size = entry->spill_size;
+
+		for (i=0; i < gss->cache_nparams; i++)
+		{
+			if (!gss->cache_typbyval[i] && !entry->key_isnull[i])
+				pfree(DatumGetPointer(entry->key_values[i]));
+		}
+		pfree(entry->key_values);
+		pfree(entry->key_isnull);
+		pfree(entry);
+		return true;
+	}
+	return false;
+}
+
 static TupleTableSlot *
 gpusort_exec(CustomScanState *node)
 {
+	GpuSortState   *gss = (GpuSortState *) node;
+
+	/* sorted result is already materialized */
+	if (gss->sort_done)
+		return gpusort_next_tuple(&gss->gts);
+	/* save the parameters being the key of the sorted result */
+	if (gss->cache_nparams > 0 && !gss->cache_curr_valid)
+		gpusort_cache_capture(gss);
+
 	return pgstrom_exec_gputask((GpuTaskState *) node);
 }
 
@@ -843,21 +1602,27 @@ static void
 gpusort_end(CustomScanState *node)
 {
 	GpuSortState	   *gss = (GpuSortState *) node;
-	pgstrom_data_store *pds_slot;
-	gpusort_segment	   *segment;
-	cl_int				i;
+	dlist_mutable_iter	iter;
 
 	/* Clean up subtree */
 	ExecEndNode(outerPlanState(node));
 
-	for (i=0; i < gss->num_segments; i++)
-	{
-		pds_slot = gss->seg_slots[i];
-		PDS_release(pds_slot);
+	/*
+	 * Concurrent tasks still hold the segments, so they have to be
+	 * synchronized prior to release of the segments.
+	 */
+	pgstrom_cleanup_gputaskstate(&gss->gts);
 
-		segment = (gpusort_segment *)((char *)gss->seg_results[i] -
-									  offsetof(gpusort_segment, kresults));
-		pfree(segment);
+	gpusort_release_segments(gss->num_segments,
+							 gss->seg_slots,
+							 gss->seg_results,
+							 gss->seg_nkeys,
+							 gss->seg_runs);
+	gss->num_segments = 0;
+	dlist_foreach_modify(iter, &gss->cache_lru)
+	{
+		gpusort_cache_release(gss, dlist_container(gpusort_cache_entry,
+												   chain, iter.cur));
 	}
 
 	/*
@@ -866,6 +1631,46 @@ gpusort_end(CustomScanState *node)
 	pgstrom_release_gputaskstate(&gss->gts);
 }
 
+/*
+ * gpusort_reset_tasks
+ *
+ * It synchronizes and releases the concurrent tasks which may still hold
+ * the segments. GpuTaskState is deactivated once the sorting is completed,
+ * so it has to be activated again for the next sorting.
+ */
+static void
+gpusort_reset_tasks(GpuSortState *gss)
+{
+	pgstrom_activate_gputaskstate(&gss->gts);
+	pgstrom_cleanup_gputaskstate(&gss->gts);
+}
+
+/*
+ * gpusort_reset_sort_state
+ *
+ * It resets the state of the sorting, after the segments are released or
+ * moved to elsewhere.
+ */
+static void
+gpusort_reset_sort_state(GpuSortState *gss)
+{
+	Assert(gss->num_segments == 0);
+	gss->sort_done = false;
+	gss->curr_segment = NULL;
+	/* the chunk not moved to any segments yet is also released */
+	if (gss->overflow_pds)
+		PDS_release(gss->overflow_pds);
+	gss->overflow_pds = NULL;
+	gss->overflow_slot = NULL;
+	/* running K-th key was also released */
+	gss->bound_segid = -1;
+	gss->bound_index = 0;
+	gss->nkey_has_null = false;
+	gss->resident_size = 0;
+	gss->num_runs = 0;
+	gss->spill_size = 0;
+}
+
 static void
 gpusort_rescan(CustomScanState *node)
 {
@@ -888,6 +1693,14 @@ gpusort_rescan(CustomScanState *node)
 			pfree(gss->seg_lstree[i]);
 		pfree(gss->seg_lstree);
 		gss->seg_lstree = NULL;
+
+		if (gss->pmerge_buf)
+			pfree(gss->pmerge_buf);
+		gss->pmerge_enabled = false;
+		gss->pmerge_buf = NULL;
+		gss->pmerge_nitems = 0;
+		gss->pmerge_nrooms = 0;
+		gss->pmerge_curpos = 0;
 	}
 
 	/*
@@ -897,23 +1710,41 @@ gpusort_rescan(CustomScanState *node)
 	 */
 	if (outerPlanState(gss)->chgParam != NULL)
 	{
-		cl_uint		i;
+		gpusort_reset_tasks(gss);
 
-		/* cleanup and release any concurrent tasks */
-		pgstrom_cleanup_gputaskstate(&gss->gts);
+		/*
+		 * The sorted result is kept for the later rescan with the same
+		 * parameters, if it was completed.
+		 */
+		if (gss->sort_done && gss->cache_curr_valid)
+			gpusort_cache_stash(gss);
+		else
+		{
+			gpusort_release_segments(gss->num_segments,
+									 gss->seg_slots,
+									 gss->seg_results,
+									 gss->seg_nkeys,
+									 gss->seg_runs);
+			gss->num_segments = 0;
+		}
+		gss->cache_curr_valid = false;
+		gpusort_reset_sort_state(gss);
 
-		for (i=0; i < gss->num_segments; i++)
+		/* try to reuse the sorted result for the new parameters */
+		if (gss->cache_nparams > 0)
 		{
-			gpusort_segment	   *segment = (gpusort_segment *)
-				((char *)gss->seg_results[i] - offsetof(gpusort_segment,
-														kresults));
-			Assert(gss->seg_slots[i] == segment->pds_slot);
-			PDS_release(gss->seg_slots[i]);
-			pfree(segment);
+			gpusort_cache_capture(gss);
+			if (gpusort_cache_lookup(gss))
+			{
+				gss->sort_done = true;
+				pgstrom_deactivate_gputaskstate(&gss->gts);
+				gss->cache_nhits++;
+			}
+			else
+				gss->cache_nmisses++;
 		}
-		gss->curr_segment = NULL;
-		gss->num_segments = 0;
 	}
+	gss->bound_nfetched = 0;
 }
 
 static void
@@ -923,10 +1754,23 @@ gpusort_mark_pos(CustomScanState *node)
 
 	if (gss->seg_curpos)
 	{
+		cl_uint		i;
+
 		Assert(gss->markpos_buf != NULL);
 		memcpy(gss->markpos_buf,
 			   gss->seg_curpos,
 			   sizeof(cl_uint) * gss->num_segments);
+		gss->markpos_nfetched = gss->bound_nfetched;
+		for (i=0; i < gss->num_segments; i++)
+		{
+			gpusort_run	   *run = gss->seg_runs[i];
+
+			if (run)
+			{
+				run->mark_pos = run->head_pos;
+				run->mark_ofs = run->head_ofs;
+			}
+		}
 	}
 }
 
@@ -937,10 +1781,20 @@ gpusort_restore_pos(CustomScanState *node)
 
 	if (gss->seg_curpos)
 	{
-		Assert(gss->seg_curpos != NULL);
+		cl_uint		i;
+
+		Assert(gss->markpos_buf != NULL);
 		memcpy(gss->seg_curpos,
 			   gss->markpos_buf,
 			   sizeof(cl_uint) * gss->num_segments);
+		gss->bound_nfetched = gss->markpos_nfetched;
+		for (i=0; i < gss->num_segments; i++)
+		{
+			gpusort_run	   *run = gss->seg_runs[i];
+
+			if (run && run->head_pos != run->mark_pos)
+				gpusort_run_seek(gss, run, run->mark_pos, run->mark_ofs);
+		}
 	}
 }
 
@@ -996,6 +1850,8 @@ gpusort_explain(CustomScanState *node, List *ancestors, ExplainState *es)
 	}
 	if (sort_keys != NIL)
 		ExplainPropertyList("Sort Key", sort_keys, es);
+	if (gs_info->bound > 0)
+		ExplainPropertyLong("Sort Bound", gs_info->bound, es);
 
 	/*
 	 * shows resource consumption, if executed and have more than zero
@@ -1006,7 +1862,13 @@ gpusort_explain(CustomScanState *node, List *ancestors, ExplainState *es)
 		const char *sort_method;
 		Size		total_consumption = 0UL;
 
-		if (gss->num_segments > 1)
+		if (gss->bound > 0)
+			sort_method = (gss->num_segments > 1
+						   ? "GPU/Bitonic + CPU/Merge (top-N)"
+						   : "GPU/Bitonic (top-N)");
+		else if (gss->pmerge_enabled)
+			sort_method = "GPU/Bitonic + CPU/Parallel Merge";
+		else if (gss->num_segments > 1)
 			sort_method = "GPU/Bitonic + CPU/Merge";
 		else
 			sort_method = "GPU/Bitonic";
@@ -1016,7 +1878,9 @@ gpusort_explain(CustomScanState *node, List *ancestors, ExplainState *es)
 			pgstrom_data_store *pds = gss->seg_slots[i];
 			kern_resultbuf	   *kresults = gss->seg_results[i];
 
-			total_consumption += GPUMEMALIGN(pds->kds_length) +
+			if (pds)
+				total_consumption += GPUMEMALIGN(pds->kds_length);
+			total_consumption +=
 				GPUMEMALIGN(offsetof(gpusort_segment, kresults) +
 							offsetof(kern_resultbuf, results) +
 							sizeof(cl_uint) * kresults->nrooms);
@@ -1036,6 +1900,44 @@ gpusort_explain(CustomScanState *node, List *ancestors, ExplainState *es)
 		}
 		/* number of segments */
 		ExplainPropertyInteger("Number of segments", gss->num_segments, es);
+		/* spilled runs, if any */
+		if (gss->num_runs > 0)
+		{
+			if (es->format == EXPLAIN_FORMAT_TEXT)
+			{
+				appendStringInfoSpaces(es->str, es->indent * 2);
+				appendStringInfo(es->str, "Spilled runs: %u  Disk: %s\n",
+								 gss->num_runs,
+								 format_bytesz(gss->spill_size));
+			}
+			else
+			{
+				ExplainPropertyInteger("Spilled runs", gss->num_runs, es);
+				ExplainPropertyLong("Sort Space Disk", gss->spill_size, es);
+			}
+		}
+		/* number of rows pruned by the bound */
+		if (gss->bound > 0)
+			ExplainPropertyLong("Rows pruned by bound",
+								gss->bound_npruned, es);
+		/* sort-result cache for rescan */
+		if (gss->cache_nparams > 0)
+		{
+			if (es->format == EXPLAIN_FORMAT_TEXT)
+			{
+				appendStringInfoSpaces(es->str, es->indent * 2);
+				appendStringInfo(es->str, "Rescan cache: hits=%u misses=%u\n",
+								 gss->cache_nhits,
+								 gss->cache_nmisses);
+			}
+			else
+			{
+				ExplainPropertyLong("Rescan cache hits",
+									gss->cache_nhits, es);
+				ExplainPropertyLong("Rescan cache misses",
+									gss->cache_nmisses, es);
+			}
+		}
 	}
 	pgstrom_explain_gputaskstate(&gss->gts, es);
 }
@@ -1070,6 +1972,7 @@ gpusort_create_segment(GpuSortState *gss)
 	segment->max_chunks = seg_nchunks;
 	segment->nitems_total = 0;
 	segment->has_terminator = false;
+	segment->nkeys = NULL;
 	segment->ev_setup_segment = NULL;
 	segment->ev_kern_proj = (CUevent *)
 		((char *)kresults + STROMALIGN(offsetof(kern_resultbuf,
@@ -1109,8 +2012,9 @@ gpusort_put_segment(gpusort_segment *segment)
 		Assert(segment->m_kds_slot == 0UL);
 		Assert(segment->m_kresults == 0UL);
 
-		/* release the data store */
-		PDS_release(segment->pds_slot);
+		/* release the data store, unless it was already spilled out */
+		if (segment->pds_slot)
+			PDS_release(segment->pds_slot);
 
 		/* event objects also */
 		rc = cuEventDestroy(segment->ev_setup_segment);
@@ -1127,6 +2031,8 @@ gpusort_put_segment(gpusort_segment *segment)
 			}
 		}
 		/* release itself */
+		if (segment->nkeys)
+			pfree(segment->nkeys);
 		pfree(segment);
 	}
 }
@@ -1186,6 +2092,18 @@ gpusort_create_task(GpuSortState *gss, pgstrom_data_store *pds_in,
 				gss->seg_results = repalloc(gss->seg_results,
 											sizeof(kern_resultbuf *) *
 											gss->num_segments_limit);
+				gss->seg_nkeys = repalloc(gss->seg_nkeys,
+										  sizeof(cl_ulong *) *
+										  gss->num_segments_limit);
+				memset(gss->seg_nkeys + gss->num_segments, 0,
+					   sizeof(cl_ulong *) *
+					   (gss->num_segments_limit - gss->num_segments));
+				gss->seg_runs = repalloc(gss->seg_runs,
+										 sizeof(gpusort_run *) *
+										 gss->num_segments_limit);
+				memset(gss->seg_runs + gss->num_segments, 0,
+					   sizeof(gpusort_run *) *
+					   (gss->num_segments_limit - gss->num_segments));
 			}
 			segment->segid = gss->num_segments;
 			gss->seg_slots[gss->num_segments] = segment->pds_slot;
@@ -1320,11 +2238,519 @@ gpusort_cpu_keycomp(GpuSortState *gss,
 	return 0;
 }
 
-static inline void
-gpusort_update_lstree(GpuSortState *gss, cl_uint depth, cl_uint index)
-{
-	cl_int		x_segid;
-	cl_int		y_segid;
+/*
+ * Normalized key prefix
+ *
+ * For the first sorting key of well-known data types, we construct a 64bit
+ * key prefix per row once the segment gets sorted. Its byte-order (big-
+ * endian) representation is comparable by memcmp(), so we compare the key
+ * prefix as an unsigned integer, then only ties are compared by the full
+ * comparator. The encoding never reverses the order of the original sort
+ * operator, but may map different values into the same prefix.
+ */
+#define NKEY_SIGN_BIT		(1UL << 63)
+
+static Oid
+gpusort_nkey_typeid(GpuSortState *gss, TupleDesc tupdesc)
+{
+	Form_pg_attribute attr;
+	TypeCacheEntry *tcache;
+
+	if (gss->numCols < 1)
+		return InvalidOid;
+	attr = tupdesc->attrs[gss->sortColIdx[0] - 1];
+
+	/* only the default ordering of the data type is supported */
+	tcache = lookup_type_cache(attr->atttypid,
+							   TYPECACHE_LT_OPR | TYPECACHE_GT_OPR);
+	if (gss->sortOperators[0] != tcache->lt_opr &&
+		gss->sortOperators[0] != tcache->gt_opr)
+		return InvalidOid;
+
+	switch (attr->atttypid)
+	{
+		case BOOLOID:
+		case INT2OID:
+		case INT4OID:
+		case INT8OID:
+		case FLOAT4OID:
+		case FLOAT8OID:
+		case NUMERICOID:
+		case DATEOID:
+		case TIMESTAMPOID:
+		case TIMESTAMPTZOID:
+			return attr->atttypid;
+
+		case TEXTOID:
+		case VARCHAROID:
+		case BPCHAROID:
+			/* byte-wise prefix is consistent only with "C" collation */
+			if (lc_collate_is_c(gss->collations[0]))
+				return attr->atttypid;
+			break;
+
+		default:
+			break;
+	}
+	return InvalidOid;
+}
+
+static inline cl_ulong
+gpusort_nkey_float8(float8 fval)
+{
+	union {
+		float8		fval;
+		cl_ulong	ival;
+	} u;
+
+	/* NaN is larger than any other values */
+	if (isnan(fval))
+		return ~0UL;
+	/* -0.0 is equivalent to +0.0 */
+	if (fval == 0.0)
+		fval = 0.0;
+	u.fval = fval;
+	if (u.ival & NKEY_SIGN_BIT)
+		return ~u.ival;
+	return u.ival | NKEY_SIGN_BIT;
+}
+
+static cl_ulong
+gpusort_nkey_encode(GpuSortState *gss, Datum value, bool isnull)
+{
+	SortSupport	ssup = gss->ssup_keys;
+	cl_ulong	nkey;
+
+	if (isnull)
+		return (ssup->ssup_nulls_first ? 0UL : ~0UL);
+
+	switch (gss->nkey_typeid)
+	{
+		case BOOLOID:
+			nkey = (DatumGetBool(value) ? 1UL : 0UL);
+			break;
+		case INT2OID:
+			nkey = (cl_ulong)((int64) DatumGetInt16(value)) ^ NKEY_SIGN_BIT;
+			break;
+		case INT4OID:
+		case DATEOID:
+			nkey = (cl_ulong)((int64) DatumGetInt32(value)) ^ NKEY_SIGN_BIT;
+			break;
+		case INT8OID:
+			nkey = (cl_ulong) DatumGetInt64(value) ^ NKEY_SIGN_BIT;
+			break;
+		case TIMESTAMPOID:
+		case TIMESTAMPTZOID:
+#ifdef HAVE_INT64_TIMESTAMP
+			nkey = (cl_ulong) DatumGetInt64(value) ^ NKEY_SIGN_BIT;
+#else
+			nkey = gpusort_nkey_float8(DatumGetFloat8(value));
+#endif
+			break;
+		case FLOAT4OID:
+			nkey = gpusort_nkey_float8((float8) DatumGetFloat4(value));
+			break;
+		case FLOAT8OID:
+			nkey = gpusort_nkey_float8(DatumGetFloat8(value));
+			break;
+		case NUMERICOID:
+			value = DirectFunctionCall1(numeric_float8_no_overflow, value);
+			nkey = gpusort_nkey_float8(DatumGetFloat8(value));
+			break;
+		case TEXTOID:
+		case VARCHAROID:
+		case BPCHAROID:
+			{
+				struct varlena *vl = (struct varlena *)
+					pg_detoast_datum_packed((struct varlena *)
+											DatumGetPointer(value));
+				unsigned char  *str = (unsigned char *) VARDATA_ANY(vl);
+				int				len = VARSIZE_ANY_EXHDR(vl);
+				int				i;
+
+				/* trailing spaces are insignificant on bpchar */
+				if (gss->nkey_typeid == BPCHAROID)
+				{
+					while (len > 0 && str[len - 1] == ' ')
+						len--;
+				}
+				nkey = 0;
+				for (i=0; i < sizeof(cl_ulong); i++)
+					nkey = (nkey << 8) | (i < len ? str[i] : 0);
+				if ((Pointer) vl != DatumGetPointer(value))
+					pfree(vl);
+			}
+			break;
+		default:
+			elog(ERROR, "unexpected type for normalized key: %s",
+				 format_type_be(gss->nkey_typeid));
+	}
+	return (ssup->ssup_reverse ? ~nkey : nkey);
+}
+
+/*
+ * gpusort_nkey_build
+ *
+ * It constructs an array of normalized key prefix for the rows on
+ * the segment. The array is indexed by the row index of kds_slot.
+ */
+static cl_ulong *
+gpusort_nkey_build(GpuSortState *gss, gpusort_segment *segment)
+{
+	GpuContext		   *gcontext = gss->gts.gcontext;
+	kern_data_store	   *kds_slot = segment->pds_slot->kds;
+	AttrNumber			anum = gss->sortColIdx[0] - 1;
+	cl_uint				nitems = segment->kresults.nitems;
+	cl_ulong		   *nkeys;
+	cl_uint				i;
+
+	nkeys = MemoryContextAlloc(gcontext->memcxt,
+							   sizeof(cl_ulong) * Max(nitems, 1));
+	for (i=0; i < nitems; i++)
+	{
+		Datum  *values = KERN_DATA_STORE_VALUES(kds_slot, i);
+		bool   *isnull = KERN_DATA_STORE_ISNULL(kds_slot, i);
+
+		nkeys[i] = gpusort_nkey_encode(gss, values[anum], isnull[anum]);
+		if (isnull[anum])
+			gss->nkey_has_null = true;
+	}
+	return nkeys;
+}
+
+/*
+ * gpusort_cpu_rowcomp
+ *
+ * It compares two rows by the normalized key prefix first, if any, then
+ * compares them by the full comparator only when prefix is a tie.
+ */
+static inline int
+gpusort_cpu_rowcomp(GpuSortState *gss,
+					kern_data_store *x_kds, cl_ulong *x_nkeys, cl_uint x_index,
+					kern_data_store *y_kds, cl_ulong *y_nkeys, cl_uint y_index)
+{
+	if (x_nkeys && y_nkeys)
+	{
+		cl_ulong	x_nkey = x_nkeys[x_index];
+		cl_ulong	y_nkey = y_nkeys[y_index];
+
+		if (x_nkey < y_nkey)
+			return -1;
+		if (x_nkey > y_nkey)
+			return 1;
+	}
+	return gpusort_cpu_keycomp(gss,
+							   KERN_DATA_STORE_VALUES(x_kds, x_index),
+							   KERN_DATA_STORE_ISNULL(x_kds, x_index),
+							   KERN_DATA_STORE_VALUES(y_kds, y_index),
+							   KERN_DATA_STORE_ISNULL(y_kds, y_index));
+}
+
+/*
+ * External sorting
+ *
+ * Once host memory consumed by the sorted segments exceeds the memory
+ * limit, the segment just sorted is written out to the temporary file as
+ * a compact sorted run, then its data store is released. The final merge
+ * reads the runs back through the read-ahead buffer.
+ */
+#define GPUSORT_RUN_READAHEAD		(256 * 1024)
+
+static void
+gpusort_run_close(gpusort_run *run)
+{
+	BufFileClose(run->file);
+	if (run->rbuf)
+		pfree(run->rbuf);
+	pfree(run->head_values);
+	pfree(run->head_isnull);
+	pfree(run);
+}
+
+static void
+gpusort_run_write(gpusort_run *run, void *data, Size length)
+{
+	if (BufFileWrite(run->file, data, length) != length)
+		ereport(ERROR,
+				(errcode_for_file_access(),
+				 errmsg("could not write to GpuSort temporary file: %m")));
+	run->file_len += length;
+}
+
+static void
+gpusort_spill_segment(GpuSortState *gss, gpusort_segment *segment)
+{
+	EState		   *estate = gss->gts.css.ss.ps.state;
+	TupleDesc		tupdesc = GTS_GET_RESULT_TUPDESC(gss);
+	kern_resultbuf *kresults = &segment->kresults;
+	kern_data_store *kds_slot = segment->pds_slot->kds;
+	cl_int			segid = segment->segid;
+	gpusort_run	   *run;
+	MemoryContext	oldcxt;
+	char			padding[MAXIMUM_ALIGNOF];
+	cl_uint			i;
+
+	oldcxt = MemoryContextSwitchTo(estate->es_query_cxt);
+	run = palloc0(sizeof(gpusort_run));
+	run->file = BufFileCreateTemp(false);
+	run->nitems = kresults->nitems;
+	run->has_nkey = (segment->nkeys != NULL);
+	run->head_values = palloc0(sizeof(Datum) * tupdesc->natts);
+	run->head_isnull = palloc0(sizeof(bool) * tupdesc->natts);
+	MemoryContextSwitchTo(oldcxt);
+
+	memset(padding, 0, sizeof(padding));
+	for (i=0; i < kresults->nitems; i++)
+	{
+		cl_uint			index = kresults->results[i];
+		MinimalTuple	mtup;
+		gpusort_run_item item;
+
+		mtup = heap_form_minimal_tuple(tupdesc,
+									   KERN_DATA_STORE_VALUES(kds_slot, index),
+									   KERN_DATA_STORE_ISNULL(kds_slot, index));
+		memset(&item, 0, sizeof(gpusort_run_item));
+		item.t_len = mtup->t_len;
+		item.nkey = (segment->nkeys ? segment->nkeys[index] : 0UL);
+		gpusort_run_write(run, &item, MAXALIGN(sizeof(gpusort_run_item)));
+		gpusort_run_write(run, mtup, mtup->t_len);
+		if (MAXALIGN(mtup->t_len) > mtup->t_len)
+			gpusort_run_write(run, padding,
+							  MAXALIGN(mtup->t_len) - mtup->t_len);
+		pfree(mtup);
+	}
+
+	/* release the data store and normalized keys */
+	gss->resident_size -= segment->pds_slot->kds_length;
+	PDS_release(segment->pds_slot);
+	segment->pds_slot = NULL;
+	gss->seg_slots[segid] = NULL;
+	if (segment->nkeys)
+	{
+		pfree(segment->nkeys);
+		segment->nkeys = NULL;
+		gss->seg_nkeys[segid] = NULL;
+	}
+	gss->seg_runs[segid] = run;
+	gss->num_runs++;
+	gss->spill_size += run->file_len;
+}
+
+/*
+ * gpusort_run_fill - ensure 'required' bytes are loaded on the rbuf
+ */
+static void
+gpusort_run_fill(gpusort_run *run, Size required)
+{
+	size_t		nbytes;
+
+	if (run->rbuf_len - run->rbuf_pos >= required)
+		return;
+
+	/* move the remaining portion to the head */
+	if (run->rbuf_pos > 0)
+	{
+		memmove(run->rbuf, run->rbuf + run->rbuf_pos,
+				run->rbuf_len - run->rbuf_pos);
+		run->rbuf_ofs += run->rbuf_pos;
+		run->rbuf_len -= run->rbuf_pos;
+		run->rbuf_pos = 0;
+	}
+	/* expand the buffer, if too large row */
+	if (required > run->rbuf_size)
+	{
+		run->rbuf_size = Max(required, GPUSORT_RUN_READAHEAD);
+		run->rbuf = repalloc(run->rbuf, run->rbuf_size);
+	}
+	nbytes = BufFileRead(run->file, run->rbuf + run->rbuf_len,
+						 run->rbuf_size - run->rbuf_len);
+	run->rbuf_len += nbytes;
+	if (run->rbuf_len < required)
+		ereport(ERROR,
+				(errcode_for_file_access(),
+				 errmsg("unexpected end of GpuSort temporary file")));
+}
+
+/*
+ * gpusort_run_load - load the next row as the head of the run
+ */
+static void
+gpusort_run_load(GpuSortState *gss, gpusort_run *run)
+{
+	TupleDesc		tupdesc = GTS_GET_RESULT_TUPDESC(gss);
+	gpusort_run_item *item;
+	MinimalTuple	mtup;
+	Size			head_sz = MAXALIGN(sizeof(gpusort_run_item));
+
+	run->head_pos++;
+	run->head_ofs = run->rbuf_ofs + run->rbuf_pos;
+	if (run->head_pos >= run->nitems)
+		return;		/* no more rows */
+
+	gpusort_run_fill(run, head_sz);
+	item = (gpusort_run_item *)(run->rbuf + run->rbuf_pos);
+	gpusort_run_fill(run, head_sz + MAXALIGN(item->t_len));
+	item = (gpusort_run_item *)(run->rbuf + run->rbuf_pos);
+	mtup = (MinimalTuple)((char *)item + head_sz);
+
+	run->head_nkey = item->nkey;
+	run->head_tuple.t_len = mtup->t_len + MINIMAL_TUPLE_OFFSET;
+	run->head_tuple.t_data = (HeapTupleHeader)
+		((char *) mtup - MINIMAL_TUPLE_OFFSET);
+	heap_deform_tuple(&run->head_tuple, tupdesc,
+					  run->head_values, run->head_isnull);
+	run->rbuf_pos += head_sz + MAXALIGN(item->t_len);
+}
+
+/*
+ * gpusort_run_seek - move the head of the run to the supplied position
+ */
+static void
+gpusort_run_seek(GpuSortState *gss, gpusort_run *run,
+				 cl_uint head_pos, Size head_ofs)
+{
+	if (!run->rbuf)
+	{
+		run->rbuf_size = GPUSORT_RUN_READAHEAD;
+		run->rbuf = MemoryContextAlloc(gss->gts.css.ss.ps.state->es_query_cxt,
+									   run->rbuf_size);
+	}
+	if (BufFileSeekBlock(run->file, head_ofs / BLCKSZ) != 0)
+		ereport(ERROR,
+				(errcode_for_file_access(),
+				 errmsg("could not seek GpuSort temporary file: %m")));
+	run->rbuf_ofs = (head_ofs / BLCKSZ) * BLCKSZ;
+	run->rbuf_len = 0;
+	run->rbuf_pos = 0;
+	gpusort_run_fill(run, head_ofs % BLCKSZ);
+	run->rbuf_pos = head_ofs % BLCKSZ;
+	/* gpusort_run_load() increments head_pos */
+	run->head_pos = head_pos - 1;
+	gpusort_run_load(gss, run);
+}
+
+/*
+ * gpusort_segment_head
+ *
+ * It returns the current row of the segment, regardless of whether the
+ * segment is resident or spilled out.
+ */
+static inline void
+gpusort_segment_head(GpuSortState *gss, cl_uint segid,
+					 Datum **p_values, bool **p_isnull, cl_ulong **p_nkey)
+{
+	gpusort_run	   *run = gss->seg_runs[segid];
+
+	if (!run)
+	{
+		kern_data_store *kds_slot = gss->seg_slots[segid]->kds;
+		kern_resultbuf *kresults = gss->seg_results[segid];
+		cl_uint		index = kresults->results[gss->seg_curpos[segid]];
+
+		*p_values = KERN_DATA_STORE_VALUES(kds_slot, index);
+		*p_isnull = KERN_DATA_STORE_ISNULL(kds_slot, index);
+		*p_nkey = (gss->seg_nkeys[segid]
+				   ? gss->seg_nkeys[segid] + index
+				   : NULL);
+	}
+	else
+	{
+		Assert(run->head_pos == gss->seg_curpos[segid]);
+		*p_values = run->head_values;
+		*p_isnull = run->head_isnull;
+		*p_nkey = (run->has_nkey ? &run->head_nkey : NULL);
+	}
+}
+
+/*
+ * gpusort_bound_cutoff
+ *
+ * It returns number of rows in the sorted segment to be kept in bounded
+ * mode. No more than 'bound' rows are needed from a particular segment,
+ * and rows larger than the running K-th key are never returned because
+ * we already have K rows smaller than or equal to the key.
+ */
+static cl_uint
+gpusort_bound_cutoff(GpuSortState *gss,
+					 kern_resultbuf *kresults,
+					 kern_data_store *kds_slot,
+					 cl_ulong *nkeys)
+{
+	cl_uint		nitems = kresults->nitems;
+
+	Assert(gss->bound > 0);
+	if ((int64) nitems > gss->bound)
+		nitems = (cl_uint) gss->bound;
+
+	if (gss->bound_segid >= 0 && nitems > 0)
+	{
+		kern_data_store *kds_k = gss->seg_slots[gss->bound_segid]->kds;
+		cl_ulong   *nkeys_k = gss->seg_nkeys[gss->bound_segid];
+		cl_uint		lbound = 0;
+		cl_uint		rbound = nitems;
+
+		/* binary search for the first row larger than the K-th key */
+		while (lbound < rbound)
+		{
+			cl_uint		curr = (lbound + rbound) / 2;
+			cl_uint		index = kresults->results[curr];
+
+			if (gpusort_cpu_rowcomp(gss,
+									kds_slot, nkeys, index,
+									kds_k, nkeys_k, gss->bound_index) <= 0)
+				lbound = curr + 1;
+			else
+				rbound = curr;
+		}
+		nitems = lbound;
+	}
+	return nitems;
+}
+
+/*
+ * gpusort_bound_prune_segment
+ *
+ * It truncates the sorted segment according to the bound, then updates
+ * the running K-th key if this segment has a tighter one.
+ */
+static void
+gpusort_bound_prune_segment(GpuSortState *gss, gpusort_segment *segment)
+{
+	kern_resultbuf	   *kresults = &segment->kresults;
+	kern_data_store	   *kds_slot = segment->pds_slot->kds;
+	cl_uint				nitems;
+
+	nitems = gpusort_bound_cutoff(gss, kresults, kds_slot, segment->nkeys);
+	if ((int64) nitems == gss->bound)
+	{
+		cl_uint		index = kresults->results[nitems - 1];
+		bool		tighter = true;
+
+		if (gss->bound_segid >= 0)
+		{
+			kern_data_store *kds_k = gss->seg_slots[gss->bound_segid]->kds;
+			cl_ulong   *nkeys_k = gss->seg_nkeys[gss->bound_segid];
+
+			tighter = (gpusort_cpu_rowcomp(gss,
+										   kds_slot, segment->nkeys, index,
+										   kds_k, nkeys_k,
+										   gss->bound_index) < 0);
+		}
+		if (tighter)
+		{
+			gss->bound_segid = segment->segid;
+			gss->bound_index = index;
+		}
+	}
+	gss->bound_npruned += kresults->nitems - nitems;
+	kresults->nitems = nitems;
+}
+
+static inline void
+gpusort_update_lstree(GpuSortState *gss, cl_uint depth, cl_uint index)
+{
+	cl_int		x_segid;
+	cl_int		y_segid;
 	cl_int		r_segid;
 
 	Assert(depth < gss->seg_lstree_depth);
@@ -1334,8 +2760,6 @@ gpusort_update_lstree(GpuSortState *gss, cl_uint depth, cl_uint index)
 	y_segid = gss->seg_lstree[depth+1][2 * index + 1];
 	if (x_segid < gss->num_segments && y_segid < gss->num_segments)
 	{
-		pgstrom_data_store *x_pds = gss->seg_slots[x_segid];
-		pgstrom_data_store *y_pds = gss->seg_slots[y_segid];
 		kern_resultbuf	   *x_kresults = gss->seg_results[x_segid];
 		kern_resultbuf	   *y_kresults = gss->seg_results[y_segid];
 		cl_uint				x_curpos = gss->seg_curpos[x_segid];
@@ -1344,16 +2768,23 @@ gpusort_update_lstree(GpuSortState *gss, cl_uint depth, cl_uint index)
 		if (x_curpos < x_kresults->nitems &&
 			y_curpos < y_kresults->nitems)
 		{
-			cl_uint		x_index = x_kresults->results[x_curpos];
-			cl_uint		y_index = y_kresults->results[y_curpos];
-			Datum	   *x_values = KERN_DATA_STORE_VALUES(x_pds->kds, x_index);
-			bool	   *x_isnull = KERN_DATA_STORE_ISNULL(x_pds->kds, x_index);
-			Datum	   *y_values = KERN_DATA_STORE_VALUES(y_pds->kds, y_index);
-			bool	   *y_isnull = KERN_DATA_STORE_ISNULL(y_pds->kds, y_index);
-
-			if (gpusort_cpu_keycomp(gss,
-									x_values, x_isnull,
-									y_values, y_isnull) < 0)
+			Datum	   *x_values;
+			Datum	   *y_values;
+			bool	   *x_isnull;
+			bool	   *y_isnull;
+			cl_ulong   *x_nkey;
+			cl_ulong   *y_nkey;
+			int			comp;
+
+			gpusort_segment_head(gss, x_segid, &x_values, &x_isnull, &x_nkey);
+			gpusort_segment_head(gss, y_segid, &y_values, &y_isnull, &y_nkey);
+			if (x_nkey && y_nkey && *x_nkey != *y_nkey)
+				comp = (*x_nkey < *y_nkey ? -1 : 1);
+			else
+				comp = gpusort_cpu_keycomp(gss,
+										   x_values, x_isnull,
+										   y_values, y_isnull);
+			if (comp < 0)
 				r_segid = x_segid;
 			else
 				r_segid = y_segid;
@@ -1385,6 +2816,338 @@ gpusort_update_lstree(GpuSortState *gss, cl_uint depth, cl_uint index)
 	gss->seg_lstree[depth][index] = r_segid;
 }
 
+/*
+ * Parallel merge of the sorted segments
+ *
+ * If normalized key prefix fully represents the sorting key, comparison
+ * of two rows does not need the full comparator, thus, merge can run on
+ * multiple threads. Rows are merged round by round. Each round picks up
+ * splitter keys by sampling from the head of the segments, then partitions
+ * the segments into key-ranges by binary search. Each worker merges its
+ * own key-range into the output buffer, then gpusort_next_tuple() fetches
+ * rows from the buffer in order.
+ * Ties of the key prefix are ordered by (segid, position) for determinism.
+ */
+#define GPUSORT_PMERGE_BATCH_SZ			(64 * 1024)
+#define GPUSORT_PMERGE_NSAMPLES			16
+
+typedef struct gpusort_mergeitem
+{
+	cl_uint		segid;
+	cl_uint		index;		/* row index on the kds_slot */
+} gpusort_mergeitem;
+
+typedef struct
+{
+	cl_ulong	nkey;
+	cl_uint		segid;
+	cl_uint		pos;		/* position on the kresults */
+} gpusort_mergekey;
+
+typedef struct
+{
+	cl_uint		num_segments;
+	cl_ulong  **seg_nkeys;
+	kern_resultbuf **seg_results;
+	cl_uint	   *lpos;		/* start position for each segment */
+	cl_uint	   *rpos;		/* end position for each segment */
+	cl_uint	   *heap;		/* binary heap of segid */
+	gpusort_mergeitem *output;
+} gpusort_pmerge_worker;
+
+#define PMERGE_NKEY(seg_nkeys,seg_results,segid,pos)				\
+	((seg_nkeys)[(segid)][(seg_results)[(segid)]->results[(pos)]])
+
+static inline int
+gpusort_mergekey_comp(const gpusort_mergekey *x, const gpusort_mergekey *y)
+{
+	if (x->nkey != y->nkey)
+		return (x->nkey < y->nkey ? -1 : 1);
+	if (x->segid != y->segid)
+		return (x->segid < y->segid ? -1 : 1);
+	if (x->pos != y->pos)
+		return (x->pos < y->pos ? -1 : 1);
+	return 0;
+}
+
+static int
+gpusort_mergekey_qsort_comp(const void *x, const void *y)
+{
+	return gpusort_mergekey_comp((const gpusort_mergekey *) x,
+								 (const gpusort_mergekey *) y);
+}
+
+/*
+ * gpusort_pmerge_rank - number of rows on the segment not larger than
+ * the splitter key.
+ */
+static cl_uint
+gpusort_pmerge_rank(GpuSortState *gss, cl_uint segid,
+					const gpusort_mergekey *split)
+{
+	cl_uint		lbound = gss->seg_curpos[segid];
+	cl_uint		rbound = gss->seg_results[segid]->nitems;
+
+	while (lbound < rbound)
+	{
+		gpusort_mergekey curr;
+
+		curr.pos = (lbound + rbound) / 2;
+		curr.segid = segid;
+		curr.nkey = PMERGE_NKEY(gss->seg_nkeys, gss->seg_results,
+								segid, curr.pos);
+		if (gpusort_mergekey_comp(&curr, split) <= 0)
+			lbound = curr.pos + 1;
+		else
+			rbound = curr.pos;
+	}
+	return lbound;
+}
+
+static inline bool
+gpusort_pmerge_less(gpusort_pmerge_worker *pw, cl_uint x_segid, cl_uint y_segid)
+{
+	cl_ulong	x_nkey = PMERGE_NKEY(pw->seg_nkeys, pw->seg_results,
+									 x_segid, pw->lpos[x_segid]);
+	cl_ulong	y_nkey = PMERGE_NKEY(pw->seg_nkeys, pw->seg_results,
+									 y_segid, pw->lpos[y_segid]);
+	if (x_nkey != y_nkey)
+		return x_nkey < y_nkey;
+	return x_segid < y_segid;
+}
+
+static void
+gpusort_pmerge_sift(gpusort_pmerge_worker *pw, cl_uint root, cl_uint nheap)
+{
+	cl_uint	   *heap = pw->heap;
+
+	for (;;)
+	{
+		cl_uint		child = 2 * root + 1;
+		cl_uint		temp;
+
+		if (child >= nheap)
+			break;
+		if (child + 1 < nheap && gpusort_pmerge_less(pw, heap[child + 1],
+													 heap[child]))
+			child++;
+		if (!gpusort_pmerge_less(pw, heap[child], heap[root]))
+			break;
+		temp = heap[root];
+		heap[root] = heap[child];
+		heap[child] = temp;
+		root = child;
+	}
+}
+
+static void *
+gpusort_pmerge_exec(void *arg)
+{
+	gpusort_pmerge_worker *pw = arg;
+	gpusort_mergeitem *output = pw->output;
+	cl_uint		nheap = 0;
+	cl_uint		i;
+
+	for (i=0; i < pw->num_segments; i++)
+	{
+		if (pw->lpos[i] < pw->rpos[i])
+			pw->heap[nheap++] = i;
+	}
+	for (i = nheap / 2; i > 0; i--)
+		gpusort_pmerge_sift(pw, i - 1, nheap);
+
+	while (nheap > 0)
+	{
+		cl_uint		segid = pw->heap[0];
+		cl_uint		pos = pw->lpos[segid]++;
+
+		output->segid = segid;
+		output->index = pw->seg_results[segid]->results[pos];
+		output++;
+
+		if (pw->lpos[segid] >= pw->rpos[segid])
+			pw->heap[0] = pw->heap[--nheap];
+		gpusort_pmerge_sift(pw, 0, nheap);
+	}
+	return NULL;
+}
+
+/*
+ * gpusort_pmerge_next_round
+ *
+ * It merges the next bunch of rows into gss->pmerge_buf. It returns false
+ * if no more rows are remained.
+ */
+static bool
+gpusort_pmerge_next_round(GpuSortState *gss)
+{
+	EState		   *estate = gss->gts.css.ss.ps.state;
+	cl_uint			num_segments = gss->num_segments;
+	int				nworkers = gpusort_host_workers;
+	gpusort_pmerge_worker *workers;
+	gpusort_mergekey *samples;
+	gpusort_mergekey *splits;
+	cl_uint			nsamples = 0;
+	cl_uint			max_samples = 0;
+	Size			nremains = 0;
+	cl_uint			ntargets;
+	cl_uint			unitsz;
+	cl_uint			step;
+	cl_uint			total;
+	cl_uint		   *positions;
+	cl_uint		   *bounds;
+	cl_uint			i, j;
+	int				k;
+
+	for (i=0; i < num_segments; i++)
+		nremains += gss->seg_results[i]->nitems - gss->seg_curpos[i];
+	if (nremains == 0)
+		return false;
+
+	ntargets = Min(nremains, (Size) nworkers * GPUSORT_PMERGE_BATCH_SZ);
+	unitsz = (ntargets + nworkers - 1) / nworkers;
+	step = Max(unitsz / GPUSORT_PMERGE_NSAMPLES, 1);
+
+	/* sampling from the head of the segments */
+	for (i=0; i < num_segments; i++)
+	{
+		cl_uint		curpos = gss->seg_curpos[i];
+		cl_uint		endpos = Min(gss->seg_results[i]->nitems,
+								 curpos + ntargets);
+
+		max_samples += (endpos - curpos) / step;
+	}
+	samples = palloc(sizeof(gpusort_mergekey) * Max(max_samples, 1));
+	for (i=0; i < num_segments; i++)
+	{
+		cl_uint		curpos = gss->seg_curpos[i];
+		cl_uint		endpos = Min(gss->seg_results[i]->nitems,
+								 curpos + ntargets);
+		cl_uint		pos;
+
+		for (pos = curpos + step - 1; pos < endpos; pos += step)
+		{
+			samples[nsamples].nkey = PMERGE_NKEY(gss->seg_nkeys,
+												 gss->seg_results, i, pos);
+			samples[nsamples].segid = i;
+			samples[nsamples].pos = pos;
+			nsamples++;
+		}
+	}
+	Assert(nsamples <= max_samples);
+	qsort(samples, nsamples, sizeof(gpusort_mergekey),
+		  gpusort_mergekey_qsort_comp);
+
+	/*
+	 * Choice of the splitters. Each sample represents 'step' rows. Last
+	 * splitter is infinite if all the remaining rows can be merged in
+	 * this round.
+	 */
+	splits = palloc(sizeof(gpusort_mergekey) * nworkers);
+	for (k=0, j=0; k < nworkers; k++)
+	{
+		if (k == nworkers - 1 && nremains <= ntargets)
+		{
+			splits[k].nkey = ~0UL;
+			splits[k].segid = UINT_MAX;
+			splits[k].pos = UINT_MAX;
+			continue;
+		}
+		while (j < nsamples && (Size)(j + 1) * step < (Size)(k + 1) * unitsz)
+			j++;
+		if (j < nsamples)
+			splits[k] = samples[j];
+		else if (nsamples > 0)
+			splits[k] = samples[nsamples - 1];
+		else
+		{
+			/* no samples; all the rows shall be merged by the last one */
+			splits[k].nkey = ~0UL;
+			splits[k].segid = UINT_MAX;
+			splits[k].pos = UINT_MAX;
+		}
+	}
+
+	/* partitioning of the segments by the splitters */
+	positions = palloc(sizeof(cl_uint) * num_segments * (nworkers + 1));
+	memcpy(positions, gss->seg_curpos, sizeof(cl_uint) * num_segments);
+	total = 0;
+	for (k=0; k < nworkers; k++)
+	{
+		cl_uint	   *lbound = positions + num_segments * k;
+		cl_uint	   *ubound = positions + num_segments * (k + 1);
+
+		for (i=0; i < num_segments; i++)
+		{
+			ubound[i] = gpusort_pmerge_rank(gss, i, &splits[k]);
+			if (ubound[i] < lbound[i])
+				ubound[i] = lbound[i];
+			total += ubound[i] - lbound[i];
+		}
+	}
+	Assert(total > 0);
+
+	/*
+	 * Each worker advances its lpos during the merge, so it takes private
+	 * copies of the bounds; the upper bound of a worker is the lower bound
+	 * of the next one.
+	 */
+	workers = palloc0(sizeof(gpusort_pmerge_worker) * nworkers);
+	bounds = palloc(sizeof(cl_uint) * 2 * num_segments * nworkers);
+	for (k=0; k < nworkers; k++)
+	{
+		gpusort_pmerge_worker *pw = &workers[k];
+
+		pw->num_segments = num_segments;
+		pw->seg_nkeys = gss->seg_nkeys;
+		pw->seg_results = gss->seg_results;
+		pw->lpos = bounds + 2 * num_segments * k;
+		pw->rpos = pw->lpos + num_segments;
+		memcpy(pw->lpos, positions + num_segments * k,
+			   sizeof(cl_uint) * num_segments);
+		memcpy(pw->rpos, positions + num_segments * (k + 1),
+			   sizeof(cl_uint) * num_segments);
+		pw->heap = palloc(sizeof(cl_uint) * num_segments);
+	}
+
+	/* output buffer */
+	if (total > gss->pmerge_nrooms)
+	{
+		if (gss->pmerge_buf)
+			pfree(gss->pmerge_buf);
+		gss->pmerge_buf = MemoryContextAllocHuge(estate->es_query_cxt,
+												 sizeof(gpusort_mergeitem) *
+												 total);
+		gss->pmerge_nrooms = total;
+	}
+	for (k=0, j=0; k < nworkers; k++)
+	{
+		workers[k].output = gss->pmerge_buf + j;
+		for (i=0; i < num_segments; i++)
+			j += workers[k].rpos[i] - workers[k].lpos[i];
+	}
+	/* next round begins from the tail of this round */
+	memcpy(gss->seg_curpos, workers[nworkers - 1].rpos,
+		   sizeof(cl_uint) * num_segments);
+
+	gpusort_launch_workers(workers, sizeof(gpusort_pmerge_worker),
+						   nworkers, gpusort_pmerge_exec);
+
+	gss->pmerge_nitems = total;
+	gss->pmerge_curpos = 0;
+
+	for (k=0; k < nworkers; k++)
+		pfree(workers[k].heap);
+	pfree(workers);
+	pfree(bounds);
+	pfree(positions);
+	pfree(splits);
+	pfree(samples);
+
+	return true;
+}
+#undef PMERGE_NKEY
+
 static TupleTableSlot *
 gpusort_next_tuple(GpuTaskState *gts)
 {
@@ -1393,19 +3156,25 @@ gpusort_next_tuple(GpuTaskState *gts)
 	TupleTableSlot	   *slot = gss->gts.css.ss.ps.ps_ResultTupleSlot;
 	AttrNumber			natts = slot->tts_tupleDescriptor->natts;
 	pgstrom_data_store *pds;
-	kern_resultbuf	   *kresults;
 	cl_uint				segid;
-	cl_uint				curpos;
 	cl_uint				index;
+	cl_ulong		   *nkey;
 	Datum			   *values;
 	bool			   *isnull;
 	struct timeval		tv1, tv2, tv3;
 
-	if (!pgsort)
-		return NULL;
-
+	if (!gss->sort_done)
+	{
+		if (!pgsort)
+			return NULL;
+		gss->sort_done = true;
+	}
 	ExecClearTuple(slot);
 
+	/* bounded sort stops merging once K rows are returned */
+	if (gss->bound > 0 && gss->bound_nfetched >= gss->bound)
+		return NULL;
+
 	PERFMON_BEGIN(&gss->gts.pfm, &tv1);
 	if (!gss->seg_curpos)
 	{
@@ -1426,15 +3195,69 @@ gpusort_next_tuple(GpuTaskState *gts)
 		gss->seg_lstree_depth = depth;
 		MemoryContextSwitchTo(oldcxt);
 
-		for (i=0, k = (1 << depth); i < k; i++)
-			gss->seg_lstree[depth][i] = i;	/* last depth */
-		for (i=gss->seg_lstree_depth-1; i >= 0; i--)
+		/*
+		 * The running K-th key might be tightened after the earlier
+		 * segments were pruned, so cut them off again prior to merge.
+		 */
+		if (gss->bound > 0)
 		{
-			for (j=0, k=(1 << i); j < k; j++)
-				gpusort_update_lstree(gss, i, j);
+			for (i=0; i < gss->num_segments; i++)
+			{
+				kern_resultbuf *kresults = gss->seg_results[i];
+				cl_uint		nitems;
+
+				/* spilled runs were already pruned on write */
+				if (gss->seg_runs[i])
+					continue;
+				nitems = gpusort_bound_cutoff(gss, kresults,
+											  gss->seg_slots[i]->kds,
+											  gss->seg_nkeys[i]);
+				gss->bound_npruned += kresults->nitems - nitems;
+				kresults->nitems = nitems;
+			}
+		}
+
+		/*
+		 * Parallel merge is available only if normalized key prefix fully
+		 * represents the sorting key, and mark/restore is not required.
+		 */
+		if (gss->nkey_exact && !gss->nkey_has_null &&
+			!gss->need_mark &&
+			gpusort_host_workers > 1 &&
+			gss->num_segments > 1)
+		{
+			Size	nitems_total = 0;
+
+			gss->pmerge_enabled = true;
+			for (i=0; i < gss->num_segments; i++)
+			{
+				if (!gss->seg_nkeys[i] || gss->seg_runs[i])
+					gss->pmerge_enabled = false;
+				nitems_total += gss->seg_results[i]->nitems;
+			}
+			if (nitems_total < 2 * GPUSORT_PMERGE_BATCH_SZ)
+				gss->pmerge_enabled = false;
+		}
+
+		/* rewind the spilled runs */
+		for (i=0; i < gss->num_segments; i++)
+		{
+			if (gss->seg_runs[i])
+				gpusort_run_seek(gss, gss->seg_runs[i], 0, 0);
+		}
+
+		if (!gss->pmerge_enabled)
+		{
+			for (i=0, k = (1 << depth); i < k; i++)
+				gss->seg_lstree[depth][i] = i;	/* last depth */
+			for (i=gss->seg_lstree_depth-1; i >= 0; i--)
+			{
+				for (j=0, k=(1 << i); j < k; j++)
+					gpusort_update_lstree(gss, i, j);
+			}
 		}
 	}
-	else
+	else if (!gss->pmerge_enabled)
 	{
 		/*
 		 * increment the current position of the last segment and update
@@ -1448,6 +3271,8 @@ gpusort_next_tuple(GpuTaskState *gts)
 
 		Assert(last_segid >= 0 && last_segid < gss->num_segments);
 		gss->seg_curpos[last_segid]++;
+		if (gss->seg_runs[last_segid])
+			gpusort_run_load(gss, gss->seg_runs[last_segid]);
 
 		for (i=gss->seg_lstree_depth-1; i >= 0; i--)
 		{
@@ -1458,25 +3283,41 @@ gpusort_next_tuple(GpuTaskState *gts)
 			gpusort_update_lstree(gss, i, j);
 		}
 	}
-	PERFMON_END(&gss->gts.pfm, gsort.tv_cpu_sort, &tv1, &tv2);
 
-	/*
-	 * Fetch the next tuple
-	 */
-	segid = gss->seg_lstree[0][0];
-	if (segid < 0 || segid >= gss->num_segments)
-		return NULL;	/* end of the scan */
+	if (gss->pmerge_enabled)
+	{
+		gpusort_mergeitem *item;
+
+		if (gss->pmerge_curpos >= gss->pmerge_nitems &&
+			!gpusort_pmerge_next_round(gss))
+			return NULL;	/* end of the scan */
+		PERFMON_END(&gss->gts.pfm, gsort.tv_cpu_sort, &tv1, &tv2);
+
+		item = &gss->pmerge_buf[gss->pmerge_curpos++];
+		segid = item->segid;
+		index = item->index;
+		pds = gss->seg_slots[segid];
+		values = KERN_DATA_STORE_VALUES(pds->kds, index);
+		isnull = KERN_DATA_STORE_ISNULL(pds->kds, index);
+	}
+	else
+	{
+		PERFMON_END(&gss->gts.pfm, gsort.tv_cpu_sort, &tv1, &tv2);
 
-	pds = gss->seg_slots[segid];
-	kresults = gss->seg_results[segid];
-	curpos = gss->seg_curpos[segid];
-	index = kresults->results[curpos];
-	values = KERN_DATA_STORE_VALUES(pds->kds, index);
-	isnull = KERN_DATA_STORE_ISNULL(pds->kds, index);
+		/*
+		 * Fetch the next tuple
+		 */
+		segid = gss->seg_lstree[0][0];
+		if (segid < 0 || segid >= gss->num_segments)
+			return NULL;	/* end of the scan */
+
+		gpusort_segment_head(gss, segid, &values, &isnull, &nkey);
+	}
 
 	memcpy(slot->tts_values, values, sizeof(Datum) * natts);
 	memcpy(slot->tts_isnull, isnull, sizeof(bool) * natts);
 	ExecStoreVirtualTuple(slot);
+	gss->bound_nfetched++;
 
 	PERFMON_END(&gss->gts.pfm, time_materialize, &tv2, &tv3);
 
@@ -1599,6 +3440,16 @@ skip:
 	if (pgsort->task.kerror.errcode != StromError_Success)
 		return true;
 
+	/*
+	 * Construction of the normalized key prefix, to reduce invocation of
+	 * the full comparator on CPU fallback and merge stage.
+	 */
+	if (pgsort->is_terminator && OidIsValid(gss->nkey_typeid))
+	{
+		segment->nkeys = gpusort_nkey_build(gss, segment);
+		gss->seg_nkeys[segment->segid] = segment->nkeys;
+	}
+
 	/*
 	 * StromError_CpuReCheck informs gpusort_keycomp could not compare
 	 * the key variables on GPU side. So, segment needs to be processed
@@ -1614,13 +3465,34 @@ skip:
 		for (i=0; i < segment->kresults.nitems; i++)
 			segment->kresults.results[i] = i;
 
-		gpusort_fallback_quicksort(gss,
-								   &segment->kresults,
-								   segment->pds_slot->kds,
-								   0, segment->kresults.nitems - 1);
+		gpusort_host_sort(gss,
+						  &segment->kresults,
+						  segment->pds_slot->kds,
+						  segment->nkeys);
 		segment->cpu_fallback = false;
 	}
 
+	/*
+	 * In bounded mode, rows of the sorted segment beyond the bound or
+	 * larger than the running K-th key shall never be returned.
+	 */
+	if (gss->bound > 0 && pgsort->is_terminator)
+		gpusort_bound_prune_segment(gss, segment);
+
+	/*
+	 * Once sorted segments consume host memory more than the limit, this
+	 * segment shall be written out to the temporary file. The segment that
+	 * has the running K-th key must be kept because pruning refers it.
+	 */
+	if (pgsort->is_terminator)
+	{
+		gss->resident_size += segment->pds_slot->kds_length;
+		if (gss->memory_limit > 0 &&
+			gss->resident_size > gss->memory_limit &&
+			gss->bound_segid != segment->segid)
+			gpusort_spill_segment(gss, segment);
+	}
+
 	/*
 	 * StromError_DataStoreNoSpace implies this gpusort task could not
 	 * move all the tuples on kds_in into the kds_slot of the segment
@@ -2175,67 +4047,525 @@ gpusort_task_process(GpuTask *gtask)
 
 
 /*
- * gpusort_fallback_quicksort
+ * Host-side sorting engine
  *
  * Fallback routine to a particular GpuSort Segment, if GPU device gave up
  * sorting on device side. We assume kds_slot is successfully set up by
  * gpusort_projection() stage. This fallback routine will construct the
- * kern_resultbuf array using CPU quicksort algorithm.
+ * kern_resultbuf array using CPU sorting algorithm.
+ *
+ * If normalized key prefix is available, rows are sorted by LSD radix sort
+ * on the prefix first, then each run of equal prefix is sorted by introsort
+ * with the full comparator. Elsewhere, entire segment is sorted by introsort.
+ * Radix sort does not touch any PostgreSQL facility, so it is partitioned
+ * to multiple threads. On the other hands, the full comparator has to run
+ * on the backend thread because fmgr is not thread-safe.
+ */
+#define GPUSORT_RADIX_BITS				8
+#define GPUSORT_RADIX_NBUCKETS			(1 << GPUSORT_RADIX_BITS)
+#define GPUSORT_RADIX_MIN_NITEMS_PER_WORKER	(64 * 1024)
+#define GPUSORT_INSERTION_THRESHOLD		16
+
+typedef struct
+{
+	cl_ulong	nkey;
+	cl_uint		index;
+} gpusort_sortitem;
+
+typedef struct
+{
+	gpusort_sortitem *src;
+	gpusort_sortitem *dst;
+	cl_uint		start;
+	cl_uint		end;
+	cl_uint		shift;
+	cl_uint		hist[GPUSORT_RADIX_NBUCKETS];	/* histogram, then offset */
+} gpusort_radix_worker;
+
+static void *
+gpusort_radix_histogram(void *arg)
+{
+	gpusort_radix_worker *rw = arg;
+	cl_uint		i;
+
+	memset(rw->hist, 0, sizeof(rw->hist));
+	for (i = rw->start; i < rw->end; i++)
+	{
+		cl_uint	digit = ((rw->src[i].nkey >> rw->shift) &
+						 (GPUSORT_RADIX_NBUCKETS - 1));
+		rw->hist[digit]++;
+	}
+	return NULL;
+}
+
+static void *
+gpusort_radix_scatter(void *arg)
+{
+	gpusort_radix_worker *rw = arg;
+	cl_uint		i;
+
+	for (i = rw->start; i < rw->end; i++)
+	{
+		cl_uint	digit = ((rw->src[i].nkey >> rw->shift) &
+						 (GPUSORT_RADIX_NBUCKETS - 1));
+		rw->dst[rw->hist[digit]++] = rw->src[i];
+	}
+	return NULL;
+}
+
+/*
+ * gpusort_worker_pool
+ *
+ * Threads to run a function on every worker. They are kept during multiple
+ * rounds (e.g, passes of radix sort), to avoid thread creation per round.
+ * The first worker is processed by the current thread. If we cannot launch
+ * a thread, the current thread also processes the job instead.
+ * Worker function must not touch any PostgreSQL facility.
+ */
+typedef struct gpusort_worker_pool	gpusort_worker_pool;
+
+typedef struct
+{
+	gpusort_worker_pool *pool;
+	int			index;
+	bool		launched;
+	pthread_t	thread;
+} gpusort_worker_thread;
+
+struct gpusort_worker_pool
+{
+	void	   *workers;
+	Size		unitsz;
+	int			nworkers;
+	pthread_mutex_t	lock;
+	pthread_cond_t	cond_start;		/* signaled on dispatch */
+	pthread_cond_t	cond_done;		/* signaled when all threads are done */
+	cl_uint		generation;			/* incremented on dispatch */
+	int			nrunning;			/* number of threads still running */
+	void	 *(*worker_func)(void *);	/* NULL, to terminate threads */
+	gpusort_worker_thread threads[FLEXIBLE_ARRAY_MEMBER];
+};
+
+static void *
+gpusort_worker_main(void *arg)
+{
+	gpusort_worker_thread *wthread = arg;
+	gpusort_worker_pool *pool = wthread->pool;
+	cl_uint		generation = 0;
+	void	 *(*worker_func)(void *);
+
+	for (;;)
+	{
+		pthread_mutex_lock(&pool->lock);
+		while (pool->generation == generation)
+			pthread_cond_wait(&pool->cond_start, &pool->lock);
+		generation = pool->generation;
+		worker_func = pool->worker_func;
+		pthread_mutex_unlock(&pool->lock);
+
+		if (!worker_func)
+			break;
+		(void) worker_func((char *)pool->workers +
+						   pool->unitsz * wthread->index);
+
+		pthread_mutex_lock(&pool->lock);
+		if (--pool->nrunning == 0)
+			pthread_cond_signal(&pool->cond_done);
+		pthread_mutex_unlock(&pool->lock);
+	}
+	return NULL;
+}
+
+static gpusort_worker_pool *
+gpusort_start_workers(void *workers, Size unitsz, int nworkers)
+{
+	gpusort_worker_pool *pool;
+	int			i;
+
+	pool = palloc0(offsetof(gpusort_worker_pool, threads[nworkers]));
+	pool->workers = workers;
+	pool->unitsz = unitsz;
+	pool->nworkers = nworkers;
+	pthread_mutex_init(&pool->lock, NULL);
+	pthread_cond_init(&pool->cond_start, NULL);
+	pthread_cond_init(&pool->cond_done, NULL);
+	for (i=1; i < nworkers; i++)
+	{
+		gpusort_worker_thread *wthread = &pool->threads[i];
+
+		wthread->pool = pool;
+		wthread->index = i;
+		wthread->launched = (pthread_create(&wthread->thread, NULL,
+											gpusort_worker_main,
+											wthread) == 0);
+	}
+	return pool;
+}
+
+static void
+gpusort_dispatch_workers(gpusort_worker_pool *pool,
+						 void *(*worker_func)(void *))
+{
+	int			nlaunched = 0;
+	int			i;
+
+	for (i=1; i < pool->nworkers; i++)
+	{
+		if (pool->threads[i].launched)
+			nlaunched++;
+	}
+	pthread_mutex_lock(&pool->lock);
+	pool->worker_func = worker_func;
+	pool->nrunning = nlaunched;
+	pool->generation++;
+	pthread_cond_broadcast(&pool->cond_start);
+	pthread_mutex_unlock(&pool->lock);
+
+	if (!worker_func)
+		return;
+	(void) worker_func(pool->workers);
+	for (i=1; i < pool->nworkers; i++)
+	{
+		if (!pool->threads[i].launched)
+			(void) worker_func((char *)pool->workers + pool->unitsz * i);
+	}
+
+	pthread_mutex_lock(&pool->lock);
+	while (pool->nrunning > 0)
+		pthread_cond_wait(&pool->cond_done, &pool->lock);
+	pthread_mutex_unlock(&pool->lock);
+}
+
+static void
+gpusort_stop_workers(gpusort_worker_pool *pool)
+{
+	int			i;
+
+	gpusort_dispatch_workers(pool, NULL);
+	for (i=1; i < pool->nworkers; i++)
+	{
+		if (pool->threads[i].launched)
+			pthread_join(pool->threads[i].thread, NULL);
+	}
+	pthread_cond_destroy(&pool->cond_done);
+	pthread_cond_destroy(&pool->cond_start);
+	pthread_mutex_destroy(&pool->lock);
+	pfree(pool);
+}
+
+/*
+ * gpusort_launch_workers
+ *
+ * It runs the supplied function on every worker, just once.
  */
 static void
-gpusort_fallback_quicksort(GpuSortState *gss,
-						   kern_resultbuf *kresults,
-						   kern_data_store *kds_slot,
-						   cl_int l_bound, cl_int r_bound)
+gpusort_launch_workers(void *workers, Size unitsz, int nworkers,
+					   void *(*worker_func)(void *))
 {
-	if (l_bound <= r_bound)
+	gpusort_worker_pool *pool;
+
+	pool = gpusort_start_workers(workers, unitsz, nworkers);
+	gpusort_dispatch_workers(pool, worker_func);
+	gpusort_stop_workers(pool);
+}
+
+static gpusort_sortitem *
+gpusort_radix_sort(gpusort_sortitem *items, gpusort_sortitem *temp,
+				   cl_uint nitems)
+{
+	gpusort_radix_worker *workers;
+	gpusort_worker_pool *pool;
+	int			nworkers;
+	cl_uint		unitsz;
+	cl_uint		shift;
+	int			i, j;
+
+	nworkers = Min(gpusort_host_workers,
+				   nitems / GPUSORT_RADIX_MIN_NITEMS_PER_WORKER);
+	nworkers = Max(nworkers, 1);
+	unitsz = (nitems + nworkers - 1) / nworkers;
+	workers = palloc(sizeof(gpusort_radix_worker) * nworkers);
+	for (i=0; i < nworkers; i++)
+	{
+		workers[i].start = Min(unitsz * i, nitems);
+		workers[i].end = Min(unitsz * (i+1), nitems);
+	}
+
+	/* threads are launched once, then run all the passes */
+	pool = gpusort_start_workers(workers, sizeof(gpusort_radix_worker),
+								 nworkers);
+	for (shift = 0; shift < 64; shift += GPUSORT_RADIX_BITS)
 	{
-		cl_int	l_index = l_bound;
-		cl_int	r_index = r_bound;
-		cl_int	p_index = kresults->results[(l_index + r_index) / 2];
-		Datum  *p_values = (Datum *) KERN_DATA_STORE_VALUES(kds_slot, p_index);
-		bool   *p_isnull = (bool *) KERN_DATA_STORE_ISNULL(kds_slot, p_index);
+		cl_uint		offset = 0;
+		bool		is_trivial = false;
 
-		while (l_index <= r_index)
+		for (i=0; i < nworkers; i++)
 		{
-			while (l_index <= r_bound)
-			{
-				cl_uint	x_index = kresults->results[l_index];
-				Datum  *x_values = KERN_DATA_STORE_VALUES(kds_slot, x_index);
-				bool   *x_isnull = KERN_DATA_STORE_ISNULL(kds_slot, x_index);
+			workers[i].src = items;
+			workers[i].dst = temp;
+			workers[i].shift = shift;
+		}
+		gpusort_dispatch_workers(pool, gpusort_radix_histogram);
 
-				if (gpusort_cpu_keycomp(gss,
-										x_values, x_isnull,
-										p_values, p_isnull) >= 0)
-					break;
-				l_index++;
-			}
-			while (r_index >= l_bound)
+		/*
+		 * Prefix sum of the histogram. Bucket 'j' of worker 'i' is written
+		 * next to the bucket 'j' of worker 'i-1', to keep stability.
+		 */
+		for (j=0; j < GPUSORT_RADIX_NBUCKETS; j++)
+		{
+			cl_uint		count = 0;
+
+			for (i=0; i < nworkers; i++)
 			{
-				cl_uint	y_index = kresults->results[l_index];
-				Datum  *y_values = KERN_DATA_STORE_VALUES(kds_slot, y_index);
-				bool   *y_isnull = KERN_DATA_STORE_ISNULL(kds_slot, y_index);
+				cl_uint		temp_count = workers[i].hist[j];
 
-				if (gpusort_cpu_keycomp(gss,
-										y_values, y_isnull,
-										p_values, p_isnull) <= 0)
-					break;
-				r_index--;
+				workers[i].hist[j] = offset;
+				offset += temp_count;
+				count += temp_count;
 			}
+			/* all the items have same digit; no need to move them */
+			if (count == nitems)
+				is_trivial = true;
+		}
+		Assert(offset == nitems);
+		if (is_trivial)
+			continue;
 
-			if (l_index <= r_index)
-			{
-				cl_int	l_prev = kresults->results[l_index];
-				cl_int	r_prev = kresults->results[r_index];
+		gpusort_dispatch_workers(pool, gpusort_radix_scatter);
+		/* swap the buffers */
+		{
+			gpusort_sortitem *swap = items;
+
+			items = temp;
+			temp = swap;
+		}
+	}
+	gpusort_stop_workers(pool);
+	pfree(workers);
+
+	return items;
+}
+
+#define HOSTSORT_COMP(x,y)									\
+	gpusort_cpu_rowcomp(gss, kds_slot, nkeys, (x), kds_slot, nkeys, (y))
+
+static void
+gpusort_heapsort_sift(GpuSortState *gss,
+					  kern_data_store *kds_slot, cl_ulong *nkeys,
+					  cl_uint *results, cl_uint root, cl_uint nitems)
+{
+	for (;;)
+	{
+		cl_uint		child = 2 * root + 1;
+		cl_uint		temp;
+
+		if (child >= nitems)
+			break;
+		if (child + 1 < nitems &&
+			HOSTSORT_COMP(results[child], results[child + 1]) < 0)
+			child++;
+		if (HOSTSORT_COMP(results[root], results[child]) >= 0)
+			break;
+		temp = results[root];
+		results[root] = results[child];
+		results[child] = temp;
+		root = child;
+	}
+}
+
+static void
+gpusort_heapsort(GpuSortState *gss,
+				 kern_data_store *kds_slot, cl_ulong *nkeys,
+				 cl_uint *results, cl_uint nitems)
+{
+	cl_uint		i;
+
+	for (i = nitems / 2; i > 0; i--)
+		gpusort_heapsort_sift(gss, kds_slot, nkeys, results, i - 1, nitems);
+	for (i = nitems - 1; i > 0; i--)
+	{
+		cl_uint		temp = results[0];
+
+		results[0] = results[i];
+		results[i] = temp;
+		gpusort_heapsort_sift(gss, kds_slot, nkeys, results, 0, i);
+	}
+}
+
+/*
+ * gpusort_median3 - sort 3 items at the position in-place
+ */
+static inline void
+gpusort_median3(GpuSortState *gss,
+				kern_data_store *kds_slot, cl_ulong *nkeys,
+				cl_uint *results, cl_uint a, cl_uint b, cl_uint c)
+{
+	cl_uint		temp;
+
+	if (HOSTSORT_COMP(results[b], results[a]) < 0)
+	{
+		temp = results[a]; results[a] = results[b]; results[b] = temp;
+	}
+	if (HOSTSORT_COMP(results[c], results[b]) < 0)
+	{
+		temp = results[b]; results[b] = results[c]; results[c] = temp;
+		if (HOSTSORT_COMP(results[b], results[a]) < 0)
+		{
+			temp = results[a]; results[a] = results[b]; results[b] = temp;
+		}
+	}
+}
+
+/*
+ * gpusort_introsort
+ *
+ * Quicksort with median-of-three (or ninther for larger array) pivot,
+ * being switched to heapsort once recursion goes too deep, to avoid
+ * worst-case inputs. Small partitions are sorted by insertion sort.
+ */
+static void
+gpusort_introsort(GpuSortState *gss,
+				  kern_data_store *kds_slot, cl_ulong *nkeys,
+				  cl_uint *results, cl_uint nitems, int depth_limit)
+{
+	while (nitems > GPUSORT_INSERTION_THRESHOLD)
+	{
+		cl_uint		mid = nitems / 2;
+		cl_uint		p_index;
+		cl_int		l_index;
+		cl_int		r_index;
+
+		if (depth_limit-- <= 0)
+		{
+			gpusort_heapsort(gss, kds_slot, nkeys, results, nitems);
+			return;
+		}
+
+		/* choose the pivot; results[0] <= results[mid] <= results[n-1] */
+		if (nitems > 128)
+		{
+			cl_uint		step = nitems / 8;
+
+			gpusort_median3(gss, kds_slot, nkeys, results,
+							step, 2 * step, 3 * step);
+			gpusort_median3(gss, kds_slot, nkeys, results,
+							mid - step, mid, mid + step);
+			gpusort_median3(gss, kds_slot, nkeys, results,
+							nitems - 1 - 3 * step,
+							nitems - 1 - 2 * step,
+							nitems - 1 - step);
+			gpusort_median3(gss, kds_slot, nkeys, results,
+							2 * step, mid, nitems - 1 - 2 * step);
+		}
+		gpusort_median3(gss, kds_slot, nkeys, results, 0, mid, nitems - 1);
+		p_index = results[mid];
+
+		/* Hoare partitioning */
+		l_index = -1;
+		r_index = nitems;
+		for (;;)
+		{
+			cl_uint		temp;
 
-				kresults->results[l_index] = r_prev;
-				kresults->results[r_index] = l_prev;
+			do {
 				l_index++;
+			} while (HOSTSORT_COMP(results[l_index], p_index) < 0);
+			do {
 				r_index--;
-			}
+			} while (HOSTSORT_COMP(results[r_index], p_index) > 0);
+			if (l_index >= r_index)
+				break;
+			temp = results[l_index];
+			results[l_index] = results[r_index];
+			results[r_index] = temp;
+		}
+
+		/* recursion to the smaller one, then loop for the larger one */
+		if (r_index + 1 < nitems - (r_index + 1))
+		{
+			gpusort_introsort(gss, kds_slot, nkeys,
+							  results, r_index + 1, depth_limit);
+			results += r_index + 1;
+			nitems -= r_index + 1;
+		}
+		else
+		{
+			gpusort_introsort(gss, kds_slot, nkeys,
+							  results + r_index + 1,
+							  nitems - (r_index + 1), depth_limit);
+			nitems = r_index + 1;
+		}
+	}
+
+	/* insertion sort for small partitions */
+	if (nitems > 1)
+	{
+		cl_uint		i, j;
+
+		for (i=1; i < nitems; i++)
+		{
+			cl_uint		temp = results[i];
+
+			for (j = i; j > 0 && HOSTSORT_COMP(temp, results[j-1]) < 0; j--)
+				results[j] = results[j-1];
+			results[j] = temp;
 		}
-		gpusort_fallback_quicksort(gss, kresults, kds_slot, l_bound, r_index);
-		gpusort_fallback_quicksort(gss, kresults, kds_slot, l_index, r_bound);
+	}
+}
+#undef HOSTSORT_COMP
+
+/*
+ * gpusort_host_sort
+ *
+ * It sorts kresults->results[] according to the sorting keys, on CPU.
+ */
+static void
+gpusort_host_sort(GpuSortState *gss,
+				  kern_resultbuf *kresults,
+				  kern_data_store *kds_slot,
+				  cl_ulong *nkeys)
+{
+	cl_uint	   *results = kresults->results;
+	cl_uint		nitems = kresults->nitems;
+	cl_uint		i, j;
+
+	if (nitems < 2)
+		return;
+
+	if (nkeys)
+	{
+		gpusort_sortitem *items;
+		gpusort_sortitem *temp;
+		gpusort_sortitem *sorted;
+
+		items = MemoryContextAllocHuge(CurrentMemoryContext,
+									   sizeof(gpusort_sortitem) * nitems);
+		temp = MemoryContextAllocHuge(CurrentMemoryContext,
+									  sizeof(gpusort_sortitem) * nitems);
+		for (i=0; i < nitems; i++)
+		{
+			items[i].nkey = nkeys[results[i]];
+			items[i].index = results[i];
+		}
+		sorted = gpusort_radix_sort(items, temp, nitems);
+
+		/* run of equal key prefix is sorted by the full comparator */
+		for (i=0; i < nitems; i = j)
+		{
+			results[i] = sorted[i].index;
+			for (j = i + 1; j < nitems && sorted[j].nkey == sorted[i].nkey; j++)
+				results[j] = sorted[j].index;
+			if (j - i > 1)
+				gpusort_introsort(gss, kds_slot, nkeys, results + i, j - i,
+								  2 * get_next_log2(j - i));
+		}
+		pfree(items);
+		pfree(temp);
+	}
+	else
+	{
+		gpusort_introsort(gss, kds_slot, nkeys, results, nitems,
+						  2 * get_next_log2(nitems));
 	}
 }
 
@@ -2263,6 +4593,39 @@ pgstrom_init_gpusort(void)
 							 PGC_USERSET,
 							 GUC_NOT_IN_SAMPLE,
 							 NULL, NULL, NULL);
+	/* pg_strom.gpusort_host_workers */
+	DefineCustomIntVariable("pg_strom.gpusort_host_workers",
+							"Number of threads for host-side radix sort",
+							NULL,
+							&gpusort_host_workers,
+							4,
+							1,
+							64,
+							PGC_USERSET,
+							GUC_NOT_IN_SAMPLE,
+							NULL, NULL, NULL);
+	/* pg_strom.gpusort_memory_limit */
+	DefineCustomIntVariable("pg_strom.gpusort_memory_limit",
+							"Host memory for sorted segments before spilling to temporary files",
+							"-1 means work_mem, and 0 means unlimited",
+							&gpusort_memory_limit,
+							0,
+							-1,
+							MAX_KILOBYTES,
+							PGC_USERSET,
+							GUC_NOT_IN_SAMPLE | GUC_UNIT_KB,
+							NULL, NULL, NULL);
+
+	DefineCustomIntVariable("pg_strom.gpusort_rescan_cache_size",
+							"Memory and temporary file space to keep sorted results for rescan",
+							"0 disables reuse of the sorted results",
+							&gpusort_rescan_cache_size,
+							262144,
+							0,
+							MAX_KILOBYTES,
+							PGC_USERSET,
+							GUC_NOT_IN_SAMPLE | GUC_UNIT_KB,
+							NULL, NULL, NULL);
 
 	/* initialize the plan method table */
 	memset(&gpusort_scan_methods, 0, sizeof(CustomScanMethods));
@@ -50,6 +50,7 @@ bool		pgstrom_perfmon_enabled;
 static bool	pgstrom_debug_kernel_source;
 bool		pgstrom_bulkexec_enabled;
 bool		pgstrom_cpu_fallback_enabled;
+bool		pgstrom_speculative_exec_enabled;
 int			pgstrom_max_async_tasks;
 double		pgstrom_num_threads_margin;
 double		pgstrom_chunk_size_margin;
@@ -99,6 +100,15 @@ pgstrom_init_misc_guc(void)
 							 PGC_USERSET,
 							 GUC_NOT_IN_SAMPLE,
 							 NULL, NULL, NULL);
+	/* turn on/off CPU execution of chunks during the kernel build */
+	DefineCustomBoolVariable("pg_strom.speculative_exec",
+							 "Enables CPU execution of chunks while GPU kernel is being built",
+							 NULL,
+							 &pgstrom_speculative_exec_enabled,
+							 true,
+							 PGC_USERSET,
+							 GUC_NOT_IN_SAMPLE,
+							 NULL, NULL, NULL);
 	/* turn on/off cuda kernel source saving */
 	DefineCustomBoolVariable("pg_strom.debug_kernel_source",
 							 "Turn on/off to display the kernel source path",
@@ -111,7 +121,7 @@ pgstrom_init_misc_guc(void)
 	/* maximum number of GpuTask can concurrently executed */
 	DefineCustomIntVariable("pg_strom.max_async_tasks",
 							"max number of GPU tasks to be run asynchronously",
-							NULL,
+							"It is shared by all the GPU nodes in a query",
 							&pgstrom_max_async_tasks,
 							32,
 							4,
@@ -207,8 +217,11 @@ pgstrom_recursive_grafter(PlannedStmt *pstmt, Plan *parent, Plan **p_curr_plan)
 			/*
 			 * Try to inject GpuPreAgg plan if cost of the aggregate plan
 			 * is enough expensive to justify preprocess by GPU.
+			 * If partial aggregation can be pushed down beneath the join,
+			 * it is more preferable because it also reduces join input.
 			 */
-			pgstrom_try_insert_gpupreagg(pstmt, (Agg *) plan);
+			if (!pgstrom_try_pushdown_gpupreagg(pstmt, (Agg *) plan))
+				pgstrom_try_insert_gpupreagg(pstmt, (Agg *) plan);
 			break;
 
 		case T_SubqueryScan:
@@ -298,20 +311,13 @@ pgstrom_recursive_grafter(PlannedStmt *pstmt, Plan *parent, Plan **p_curr_plan)
 	switch (nodeTag(plan))
 	{
 		case T_Sort:
-			/*
-			 * Heuristically, we should avoid to replace Sort-node just
-			 * below the Limit-node, because Limit-node informs Sort-node
-			 * minimum required number of rows then Sort-node takes special
-			 * optimization. It is not easy to win with GpuSort...
-			 */
-			if (parent && IsA(parent, Limit))
-				break;
-
 			/*
 			 * Try to replace Sort node by GpuSort node if cost of
 			 * the alternative plan is enough reasonable to replace.
+			 * If Sort-node is just below the Limit-node, GpuSort takes
+			 * the bound of Limit-node to run top-N sorting.
 			 */
-			pgstrom_try_insert_gpusort(pstmt, p_curr_plan);
+			pgstrom_try_insert_gpusort(pstmt, parent, p_curr_plan);
 			break;
 
 		case T_CustomScan:
@@ -388,6 +394,7 @@ _PG_init(void)
 	/* initialization of CUDA related stuff */
 	pgstrom_init_cuda_control();
 	pgstrom_init_cuda_program();
+	pgstrom_init_cuda_mmgr();
 	/* initialization of data store support */
 	pgstrom_init_datastore();
 
@@ -1008,6 +1015,18 @@ pgstrom_explain_gputaskstate(GpuTaskState *gts, ExplainState *es)
 		ExplainPropertyText("Kernel Source", cuda_source, es);
 	}
 
+	/*
+	 * Show number of the chunks processed by GPU and CPU, if chunks may be
+	 * processed by CPU speculatively during the kernel build
+	 */
+	if (es->analyze && gts->speculative_exec)
+	{
+		ExplainPropertyInteger("Chunks by GPU",
+							   gts->num_device_tasks, es);
+		ExplainPropertyInteger("Chunks by CPU (speculative)",
+							   gts->num_speculative_tasks, es);
+	}
+
 	/*
 	 * Show performance information
 	 */
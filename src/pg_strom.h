@@ -209,14 +209,28 @@ typedef struct {
  *
  *
  */
+#define GPUMEM_SL_SHIFT		4
+#define GPUMEM_SL_COUNT		(1 << GPUMEM_SL_SHIFT)
+#define GPUMEM_FL_COUNT		28
+
 struct GpuMemBlock;
+struct HTAB;
 typedef struct
 {
-	struct GpuMemBlock *empty_block;
+	struct GpuMemBlock *empty_block;	/* cached empty block, if any */
 	dlist_head		active_blocks;
 	dlist_head		unused_chunks;	/* cache for GpuMemChunk entries */
 	dlist_head		unused_blocks;	/* cache for GpuMemBlock entries */
-	dlist_head		hash_slots[59];	/* hash to find out GpuMemChunk */
+	struct HTAB	   *chunk_htab;		/* to find out active GpuMemChunk */
+	/* two-level segregated free lists */
+	cl_uint			fl_bitmap;
+	cl_uint			sl_bitmap[GPUMEM_FL_COUNT];
+	dlist_head		free_lists[GPUMEM_FL_COUNT][GPUMEM_SL_COUNT];
+	/* statistics */
+	size_t			total_size;		/* total size of the active blocks */
+	size_t			active_size;	/* total size of the active chunks */
+	cl_uint			num_active_chunks;
+	cl_uint			num_free_chunks;
 } GpuMemHead;
 
 typedef struct
@@ -226,6 +240,8 @@ typedef struct
 	ResourceOwner	resowner;		/* ResourceOwner owns this GpuContext */
 	MemoryContext	memcxt;			/* Memory context for host pinned mem */
 	cl_int		   *p_keep_freemem;	/* flag to control memory cache policy */
+	cl_int			sched_class;	/* priority class of device scheduler */
+	cl_uint			sched_weight;	/* weight of device scheduler */
 	/*
 	 * Performance statistics
 	 */
@@ -240,6 +256,8 @@ typedef struct
 
 
 	dlist_head		pds_list;		/* list of pgstrom_data_store */
+	dlist_head		gts_list;		/* list of GpuTaskState; they share
+									 * the budget of asynchronous tasks */
 	cl_int			num_context;	/* number of CUDA context */
 	cl_int			next_context;
 	struct {
@@ -247,6 +265,7 @@ typedef struct
 		CUcontext	cuda_context;
 		GpuMemHead	cuda_memory;	/* wrapper of device memory allocation */
 		size_t		gmem_used;		/* device memory allocated */
+		cl_uint		num_admitted;	/* tasks admitted by device scheduler */
 	} gpu[FLEXIBLE_ARRAY_MEMBER];
 } GpuContext;
 
@@ -257,7 +276,14 @@ struct GpuTaskState
 {
 	CustomScanState	css;
 	GpuContext	   *gcontext;
+	dlist_node		gts_chain;		/* link to GpuContext->gts_list */
 	kern_parambuf  *kern_params;	/* Const/Param buffer */
+	List		   *used_params;	/* Const/Param in the kern_params */
+	List		   *used_params_state;	/* ExprState for each PARAM_EXEC in
+										 * the used_params, or NULL */
+	bool			kern_params_exec;	/* true, if PARAM_EXEC is in use */
+	bool			kern_params_pending;/* true, if PARAM_EXEC is not
+										 * evaluated yet */
 	const char	   *kern_define;	/* per session definition */
 	const char	   *kern_source;	/* GPU kernel source on the fly */
 	cl_uint			extra_flags;	/* flags for static inclusion */
@@ -266,6 +292,11 @@ struct GpuTaskState
 	bool			scan_done;		/* no rows to read, if true */
 	bool			be_row_format;	/* true, if KDS_FORMAT_ROW is required */
 	bool			outer_bulk_exec;/* true, if it bulk-exec on outer-node */
+	bool			speculative_exec;/* true, if pending tasks can be run by
+									  * CPU fallback during the kernel build */
+	cl_uint			num_device_tasks;	/* # of tasks launched on GPU */
+	cl_uint			num_speculative_tasks;	/* # of tasks run by CPU during
+											 * the kernel build */
 	Instrumentation	outer_instrument; /* run time statistics */
 	TupleTableSlot *scan_overflow;	/* temp buffer, if unable to load */
 	cl_long			curr_index;		/* current position on the curr_task */
@@ -306,6 +337,8 @@ struct GpuTask
 	bool			no_cuda_setup;	/* true, if no need to set up stream */
 	bool			cpu_fallback;	/* true, if task needs CPU fallback */
 	cl_uint			cuda_index;		/* index of the cuda_context */
+	cl_int			sched_index;	/* device admitted by the scheduler,
+									 * or -1 if not admitted */
 	CUcontext		cuda_context;	/* just reference, no cleanup needed */
 	CUdevice		cuda_device;	/* just reference, no cleanup needed */
 	CUstream		cuda_stream;	/* owned for each GpuTask */
@@ -397,6 +430,8 @@ typedef struct pgstrom_data_store
  * cuda_mmgr.c
  */
 extern void cudaHostMemAssert(void *pointer);
+extern void HostPinMemPoolUnpin(CUcontext cuda_context,
+								CUcontext alt_context);
 
 extern MemoryContext
 HostPinMemContextCreate(MemoryContext parent,
@@ -409,6 +444,7 @@ HostPinMemContextCreate(MemoryContext parent,
 						cl_int **pp_num_host_mfree,
 						struct timeval **pp_tv_host_malloc,
 						struct timeval **pp_tv_host_mfree);
+extern void pgstrom_init_cuda_mmgr(void);
 /*
  * cuda_control.c
  */
@@ -433,6 +469,9 @@ extern void pgstrom_activate_gputaskstate(GpuTaskState *gts);
 extern void pgstrom_deactivate_gputaskstate(GpuTaskState *gts);
 extern void pgstrom_init_gputask(GpuTaskState *gts, GpuTask *gtask);
 extern void pgstrom_release_gputask(GpuTask *gtask);
+extern cl_uint pgstrom_async_task_limit(cl_uint budget,
+										cl_uint num_others,
+										cl_uint num_active);
 extern GpuTask *pgstrom_fetch_gputask(GpuTaskState *gts);
 extern pgstrom_data_store *pgstrom_exec_chunk_gputask(GpuTaskState *gts,
 													  size_t chunk_size);
@@ -465,8 +504,17 @@ extern Datum pgstrom_device_info(PG_FUNCTION_ARGS);
 /*
  * cuda_program.c
  */
+typedef bool (*pgstrom_build_program_hook_type)(const char *source,
+												cl_uint extra_flags,
+												void **p_bin_image,
+												size_t *p_bin_length,
+												char **p_build_log);
+extern pgstrom_build_program_hook_type pgstrom_build_program_hook;
+
 extern const char *pgstrom_cuda_source_file(GpuTaskState *gts);
 extern bool pgstrom_load_cuda_program(GpuTaskState *gts, bool is_preload);
+extern void pgstrom_cancel_cuda_program(GpuTaskState *gts);
+extern void pgstrom_cancel_all_cuda_programs(void);
 extern CUmodule *plcuda_load_cuda_program(GpuContext *gcontext,
 										  const char *kern_source,
 										  cl_uint extra_flags);
@@ -477,8 +525,11 @@ extern void pgstrom_assign_cuda_program(GpuTaskState *gts,
 										List *used_params,
 										const char *kern_source,
 										int extra_flags);
+extern void pgstrom_setup_kern_params(GpuTaskState *gts);
 extern void pgstrom_init_cuda_program(void);
 extern Datum pgstrom_program_info(PG_FUNCTION_ARGS);
+extern Datum pgstrom_program_manifest_export(PG_FUNCTION_ARGS);
+extern Datum pgstrom_program_manifest_import(PG_FUNCTION_ARGS);
 
 /*
  * codegen.c
@@ -496,6 +547,10 @@ typedef struct {
 	const char *kds_index_label; /* label to reference kds_index, if exist */
 	List	   *pseudo_tlist;/* pseudo tlist expression, if any */
 	int			extra_flags;/* external libraries to be included */
+	List	   *cse_exprs;	/* common sub-expressions in the function */
+	List	   *cse_decls;	/* declarations of KEXP_n already generated */
+	Bitmapset  *cse_refs;	/* KEXP_n already generated */
+	Node	   *cse_bypass;	/* KEXP_n under code generation */
 } codegen_context;
 
 extern void pgstrom_codegen_typeoid_declarations(StringInfo buf);
@@ -516,8 +571,15 @@ extern void pgstrom_codegen_param_declarations(StringInfo buf,
 											   codegen_context *context);
 extern void pgstrom_codegen_var_declarations(StringInfo buf,
 											 codegen_context *context);
+extern void pgstrom_codegen_cse_prepare(codegen_context *context,
+										List *exprs);
+extern void pgstrom_codegen_cse_declarations(StringInfo buf,
+											 codegen_context *context);
 extern void codegen_tempvar_declaration(StringInfo buf, const char *varname);
 extern bool pgstrom_device_expression(Expr *expr);
+extern List *pgstrom_fixup_cpu_fallback(List *exprstates,
+										GpuTaskState *gts,
+										List *used_params);
 extern void pgstrom_init_codegen_context(codegen_context *context);
 extern void pgstrom_init_codegen(void);
 
@@ -606,13 +668,15 @@ extern void	pgstrom_init_gpujoin(void);
  * gpupreagg.c
  */
 extern void pgstrom_try_insert_gpupreagg(PlannedStmt *pstmt, Agg *agg);
+extern bool pgstrom_try_pushdown_gpupreagg(PlannedStmt *pstmt, Agg *agg);
 extern bool pgstrom_plan_is_gpupreagg(const Plan *plan);
 extern void pgstrom_init_gpupreagg(void);
 
 /*
  * gpusort.c
  */
-extern void pgstrom_try_insert_gpusort(PlannedStmt *pstmt, Plan **p_plan);
+extern void pgstrom_try_insert_gpusort(PlannedStmt *pstmt, Plan *parent,
+									   Plan **p_plan);
 extern bool pgstrom_plan_is_gpusort(const Plan *plan);
 extern void assign_gpusort_session_info(StringInfo buf, GpuTaskState *gts);
 extern void pgstrom_init_gpusort(void);
@@ -632,6 +696,7 @@ extern bool		pgstrom_enabled;
 extern bool		pgstrom_perfmon_enabled;
 extern bool		pgstrom_bulkexec_enabled;
 extern bool		pgstrom_cpu_fallback_enabled;
+extern bool		pgstrom_speculative_exec_enabled;
 extern int		pgstrom_max_async_tasks;
 extern double	pgstrom_gpu_setup_cost;
 extern double	pgstrom_gpu_dma_cost;
@@ -0,0 +1,41 @@
+--#
+--#       Gpu Scan TestCases with common sub-expressions
+--#
+
+set enable_seqscan to off;
+set enable_bitmapscan to off;
+set enable_indexscan to off;
+set random_page_cost=1000000;   --# force off index_scan.
+set pg_strom.enable_gpuhashjoin to off;
+set pg_strom.enable_gpupreagg to off;
+set pg_strom.enable_gpusort to off;
+set client_min_messages to warning;
+
+DROP TABLE IF EXISTS strom_cse_gs;
+CREATE TABLE strom_cse_gs (id int, price numeric, qty int);
+INSERT INTO strom_cse_gs
+  SELECT id, (id % 97) + 0.25,
+         case when id % 101 = 0 then null else id % 13 end
+    FROM generate_series(1,20000) id;
+ANALYZE strom_cse_gs;
+
+-- same expression in the qualifiers and the projection
+select id, price * qty as amount, price * qty * 2 as twice
+  from strom_cse_gs
+ where price * qty > 1000 and id % 20 = 1 order by id;
+
+-- same CASE expression in the qualifiers and the projection, with NULLs
+select id, case when qty > 6 then price * qty else price - qty end as v,
+       case when qty > 6 then price * qty else price - qty end +
+       case when qty > 6 then price * qty else price - qty end as v2
+  from strom_cse_gs
+ where case when qty > 6 then price * qty else price - qty end < -5
+    or (id % 101 = 0 and id < 1000)
+ order by id limit 15;
+
+-- same expression in the qualifiers and the aggregate arguments
+select count(*), sum(price * qty), max(price * qty), min(price * qty)
+  from strom_cse_gs
+ where price * qty between 100 and 200;
+
+DROP TABLE strom_cse_gs;
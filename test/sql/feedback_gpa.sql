@@ -0,0 +1,51 @@
+--#
+--#       Gpu PreAggregate TestCases with the run-time feedback
+--#
+--#   The statistics are taken on a small part of the table, so the planner
+--#   underestimates the number of groups. The later executions size the
+--#   buffers from the feedback of the earlier ones.
+--#
+
+set pg_strom.debug_force_gpupreagg to on;
+set pg_strom.enable_gpusort to off;
+set pg_strom.gpupreagg_feedback to on;
+set client_min_messages to warning;
+
+DROP TABLE IF EXISTS strom_feedback_gpa;
+CREATE TABLE strom_feedback_gpa (id int, key int, tag text, v int)
+  WITH (autovacuum_enabled = off);
+INSERT INTO strom_feedback_gpa
+  SELECT id, id % 40000, 'tag-' || (id % 30000), (id * 7) % 1000
+    FROM generate_series(1,100) id;
+ANALYZE strom_feedback_gpa;
+INSERT INTO strom_feedback_gpa
+  SELECT id, id % 40000, 'tag-' || (id % 30000), (id * 7) % 1000
+    FROM generate_series(101,200000) id;
+
+-- the first execution sizes the buffers from the planner estimation,
+-- then the following ones from the feedback
+select count(*), sum(c), sum(s), max(c), min(s)
+  from (select key, count(*) c, sum(v) s
+          from strom_feedback_gpa group by key) t;
+select count(*), sum(c), sum(s), max(c), min(s)
+  from (select key, count(*) c, sum(v) s
+          from strom_feedback_gpa group by key) t;
+select count(*), sum(c), sum(s), max(c), min(s)
+  from (select key, count(*) c, sum(v) s
+          from strom_feedback_gpa group by key) t;
+select tag, count(*), sum(v) from strom_feedback_gpa
+ group by tag having tag like 'tag-2999%' order by tag;
+select tag, count(*), sum(v) from strom_feedback_gpa
+ group by tag having tag like 'tag-2999%' order by tag;
+select tag, count(*), sum(v) from strom_feedback_gpa
+ group by tag having tag like 'tag-2999%' order by tag;
+
+-- same results without the feedback
+set pg_strom.gpupreagg_feedback to off;
+select count(*), sum(c), sum(s), max(c), min(s)
+  from (select key, count(*) c, sum(v) s
+          from strom_feedback_gpa group by key) t;
+select tag, count(*), sum(v) from strom_feedback_gpa
+ group by tag having tag like 'tag-2999%' order by tag;
+
+DROP TABLE strom_feedback_gpa;
@@ -0,0 +1,65 @@
+--#
+--#       Gpu Scan TestCases with large IN-list (= ANY / <> ALL)
+--#
+
+set enable_seqscan to off;
+set enable_bitmapscan to off;
+set enable_indexscan to off;
+set random_page_cost=1000000;   --# force off index_scan.
+set pg_strom.gpu_setup_cost=0;
+set pg_strom.enable_gpuhashjoin to off;
+set pg_strom.enable_gpupreagg to off;
+set pg_strom.enable_gpusort to off;
+set client_min_messages to warning;
+
+DROP TABLE IF EXISTS strom_inlist_test;
+CREATE TABLE strom_inlist_test (id integer, ival integer, bval bigint,
+                                fval float8, nval numeric);
+INSERT INTO strom_inlist_test SELECT id, x, x * 1000003, x / 8.0, x
+  FROM (SELECT id, case when id % 50 = 0 then null
+                        else (id * 37) % 1000 end x
+          FROM generate_series(1,10000) id) t;
+ANALYZE strom_inlist_test;
+
+-- = ANY and <> ALL with 16 or more items
+select count(*) from strom_inlist_test where ival = any(array[3,999,17,500,3,42,1001,256,77,128,640,17,911,0,333,-5,808,64,720,15]);
+select count(*) from strom_inlist_test where ival <> all(array[3,999,17,500,3,42,1001,256,77,128,640,17,911,0,333,-5,808,64,720,15]);
+select id from strom_inlist_test where ival = any(array[3,999,17,500,3,42,1001,256,77,128,640,17,911,0,333,-5,808,64,720,15]) and id <= 1000 order by id;
+select count(*) from strom_inlist_test where bval = any(array[1000003,2000006,4000012,8000024,16000048,32000096,64000192,128000384,256000768,512001536,3000009,5000015,7000021,11000033,13000039,19000057,23000069]::bigint[]);
+select count(*) from strom_inlist_test where fval <> all(array[0.125,0.25,0.5,1.0,2.0,4.0,8.0,16.0,32.0,64.0,0.375,0.625,0.875,1.375,1.625,2.375,2.875]::float8[]);
+
+-- array containing NULL
+select count(*) from strom_inlist_test where ival = any(array[3,999,17,500,3,42,1001,256,null,77,128,640,17,911,0,333,-5,808,64,720,15]);
+select count(*) from strom_inlist_test where ival <> all(array[3,999,17,500,3,42,1001,256,null,77,128,640,17,911,0,333,-5,808,64,720,15]);
+select count(*) from strom_inlist_test where (ival <> all(array[3,999,17,500,3,42,1001,256,null,77,128,640,17,911,0,333,-5,808,64,720,15])) is null;
+
+-- empty array
+select count(*) from strom_inlist_test where ival = any('{}'::int[]);
+select count(*) from strom_inlist_test where ival <> all('{}'::int[]);
+
+-- NULL array
+select count(*) from strom_inlist_test where ival = any(null::int[]);
+select count(*) from strom_inlist_test where (ival <> all(null::int[])) is null;
+
+-- PARAM_EXTERN array; 1e+1000 is not supported on the device,
+-- so the rows are rechecked by the CPU fallback
+prepare p1(int[]) as select count(*) from strom_inlist_test
+  where ival = any($1) and nval < 1e+1000;
+prepare p2(int[]) as select count(*) from strom_inlist_test
+  where ival <> all($1) and nval < 1e+1000;
+execute p1(array[3,999,17,500,3,42,1001,256,77,128,640,17,911,0,333,-5,808,64,720,15]);
+execute p1(array[3,999,17,500,3,42,1001,256,null,77,128,640,17,911,0,333,-5,808,64,720,15]);
+execute p1(array[1,2,4,8,16,32,64,128,256,512,3,5,7,11,13,19,23]);
+execute p1('{}');
+execute p1(null);
+execute p1(array[3,999,17,500,3,42,1001,256,77,128,640,17,911,0,333,-5,808,64,720,15]);
+execute p2(array[3,999,17,500,3,42,1001,256,77,128,640,17,911,0,333,-5,808,64,720,15]);
+execute p2(array[3,999,17,500,3,42,1001,256,null,77,128,640,17,911,0,333,-5,808,64,720,15]);
+execute p2(array[1,2,4,8,16,32,64,128,256,512,3,5,7,11,13,19,23]);
+execute p2('{}');
+execute p2(null);
+execute p2(array[3,999,17,500,3,42,1001,256,77,128,640,17,911,0,333,-5,808,64,720,15]);
+deallocate p1;
+deallocate p2;
+
+DROP TABLE strom_inlist_test;
@@ -0,0 +1,101 @@
+--#
+--#       Gpu Scan TestCases with LIKE operator
+--#
+
+set enable_seqscan to off;
+set enable_bitmapscan to off;
+set enable_indexscan to off;
+set random_page_cost=1000000;   --# force off index_scan.
+set pg_strom.gpu_setup_cost=0;
+set pg_strom.enable_gpuhashjoin to off;
+set pg_strom.enable_gpupreagg to off;
+set pg_strom.enable_gpusort to off;
+set client_min_messages to warning;
+
+DROP TABLE IF EXISTS strom_like_test;
+CREATE TABLE strom_like_test (id integer, s text);
+INSERT INTO strom_like_test SELECT id,
+       case when id % 97 = 0 then null
+            else 'k' || (id % 13) || '/' || md5(id::text) end
+  FROM generate_series(1,10000) id;
+INSERT INTO strom_like_test VALUES
+  (20001, ''),
+  (20002, 'a'),
+  (20003, 'aa'),
+  (20004, 'aba'),
+  (20005, 'abc'),
+  (20006, 'abca'),
+  (20007, 'xabcx'),
+  (20008, 'abcabc'),
+  (20009, 'a%c'),
+  (20010, 'a_c'),
+  (20011, 'a\c'),
+  (20012, 'aXc'),
+  (20013, '%'),
+  (20014, 'ab%cd'),
+  (20015, null);
+ANALYZE strom_like_test;
+
+-- exact
+select count(*) from strom_like_test where s like 'abc';
+select id from strom_like_test where s like 'abc' and id > 20000 order by id;
+select count(*) from strom_like_test where s like 'k3/eccbc87e4b5ce2fe28308fd9f2a7baf3';
+select count(*) from strom_like_test where s like '';
+select id from strom_like_test where s like '' and id > 20000 order by id;
+
+-- prefix%
+select count(*) from strom_like_test where s like 'k1%';
+select count(*) from strom_like_test where s like 'k12/a%';
+select count(*) from strom_like_test where s like 'ab%';
+select id from strom_like_test where s like 'ab%' and id > 20000 order by id;
+
+-- %suffix
+select count(*) from strom_like_test where s like '%a';
+select id from strom_like_test where s like '%a' and id > 20000 order by id;
+select count(*) from strom_like_test where s like '%00';
+
+-- %infix%
+select count(*) from strom_like_test where s like '%abc%';
+select id from strom_like_test where s like '%abc%' and id > 20000 order by id;
+select count(*) from strom_like_test where s like '%dead%';
+
+-- multiple segments
+select count(*) from strom_like_test where s like 'k1%a%f';
+select count(*) from strom_like_test where s like 'a%b%c';
+select id from strom_like_test where s like 'a%b%c' and id > 20000 order by id;
+select count(*) from strom_like_test where s like '%ab%cd%';
+select id from strom_like_test where s like '%ab%cd%' and id > 20000 order by id;
+
+-- edge patterns
+select count(*) from strom_like_test where s like '%';
+select id from strom_like_test where s like '%' and id > 20000 order by id;
+select count(*) from strom_like_test where s like '%%';
+select id from strom_like_test where s like '%%' and id > 20000 order by id;
+select count(*) from strom_like_test where s like 'a%a';
+select id from strom_like_test where s like 'a%a' and id > 20000 order by id;
+
+-- NOT LIKE
+select count(*) from strom_like_test where s not like 'k1%';
+select count(*) from strom_like_test where s not like '%abc%';
+select id from strom_like_test where s not like 'a%a' and id > 20000 order by id;
+
+-- NULL input
+select count(*) from strom_like_test where (s like 'k1%') is null;
+select count(*) from strom_like_test where (s not like '%abc%') is null;
+
+-- '_' and escape keep using GenericMatchText
+select count(*) from strom_like_test where s like 'k1_/%';
+select count(*) from strom_like_test where s like 'a_c';
+select id from strom_like_test where s like 'a_c' and id > 20000 order by id;
+select count(*) from strom_like_test where s like '%a_c%';
+select id from strom_like_test where s like '%a_c%' and id > 20000 order by id;
+select count(*) from strom_like_test where s like 'a\%c';
+select id from strom_like_test where s like 'a\%c' and id > 20000 order by id;
+select count(*) from strom_like_test where s like 'a\_c';
+select id from strom_like_test where s like 'a\_c' and id > 20000 order by id;
+select count(*) from strom_like_test where s like '%\\%';
+select id from strom_like_test where s like '%\\%' and id > 20000 order by id;
+select count(*) from strom_like_test where s like 'a!%c' escape '!';
+select id from strom_like_test where s like 'a!%c' escape '!' and id > 20000 order by id;
+
+DROP TABLE strom_like_test;
@@ -0,0 +1,51 @@
+--#
+--#       Gpu Hash Join TestCases over GpuScan, sharing a GpuContext
+--#
+
+set pg_strom.gpu_setup_cost=0;
+set pg_strom.enable_gpupreagg to off;
+set pg_strom.enable_gpusort to off;
+set pg_strom.pullup_outer_scan to off;
+set enable_mergejoin to off;
+set enable_nestloop to off;
+set random_page_cost=1000000;   --# force off index_scan.
+set client_min_messages to warning;
+
+DROP TABLE IF EXISTS strom_mt_outer;
+DROP TABLE IF EXISTS strom_mt_inner;
+CREATE TABLE strom_mt_outer (id int, k int, v int);
+CREATE TABLE strom_mt_inner (k int, w int);
+INSERT INTO strom_mt_outer
+  SELECT id, id % 1000, id % 97 FROM generate_series(1,100000) id;
+INSERT INTO strom_mt_inner
+  SELECT k, k % 13 FROM generate_series(0,999) k;
+ANALYZE strom_mt_outer;
+ANALYZE strom_mt_inner;
+
+-- GpuJoin and GpuScan run their tasks concurrently
+select count(*), sum(o.v), sum(i.w) from strom_mt_outer o
+  join strom_mt_inner i on o.k = i.k where o.v < 50;
+select i.w, count(*), sum(o.v) from strom_mt_outer o
+  join strom_mt_inner i on o.k = i.k
+ where o.v between 10 and 60 and i.w < 5 group by i.w order by i.w;
+
+-- async tasks shared by both of them are tightly limited
+set pg_strom.max_async_tasks to 2;
+select count(*), sum(o.v), sum(i.w) from strom_mt_outer o
+  join strom_mt_inner i on o.k = i.k where o.v < 50;
+select i.w, count(*), sum(o.v) from strom_mt_outer o
+  join strom_mt_inner i on o.k = i.k
+ where o.v between 10 and 60 and i.w < 5 group by i.w order by i.w;
+
+-- GpuScan does not hand over the chunks in bulk
+set pg_strom.bulkexec to off;
+select count(*), sum(o.v), sum(i.w) from strom_mt_outer o
+  join strom_mt_inner i on o.k = i.k where o.v < 50;
+select i.w, count(*), sum(o.v) from strom_mt_outer o
+  join strom_mt_inner i on o.k = i.k
+ where o.v between 10 and 60 and i.w < 5 group by i.w order by i.w;
+reset pg_strom.bulkexec;
+reset pg_strom.max_async_tasks;
+
+DROP TABLE strom_mt_outer;
+DROP TABLE strom_mt_inner;
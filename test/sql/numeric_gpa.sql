@@ -0,0 +1,42 @@
+--#
+--#       Gpu PreAggregate TestCases of SUM/AVG over numeric with typmod
+--#
+--#   sum/avg on numeric(18,4) and numeric(12,2) are accumulated on the
+--#   fixed-scale integer. Partial sums of the maximum values overflow int8,
+--#   then they are re-checked on CPU.
+--#
+
+set pg_strom.debug_force_gpupreagg to on;
+set pg_strom.enable_gpusort to off;
+set client_min_messages to warning;
+
+DROP TABLE IF EXISTS strom_numeric_gpa;
+CREATE TABLE strom_numeric_gpa (id int, key int, a numeric(18,4), b numeric(12,2));
+INSERT INTO strom_numeric_gpa
+  SELECT id, id % 5,
+         case id % 5
+         when 0 then 99999999999999.9999
+         when 1 then -99999999999999.9999
+         when 2 then case when id % 4 = 2 then 99999999999999.9999
+                          else -99999999999999.9999 end
+         when 3 then (id % 10007) * 0.0001 - 0.5
+         else case when id % 3 = 0 then null else id * 0.0003 end
+         end,
+         ((id * 37) % 100000) * 0.01 - 500
+    FROM generate_series(1,200000) id;
+ANALYZE strom_numeric_gpa;
+
+-- partial sums beyond int8, negative values and NULLs
+select key, sum(a), avg(a), count(a) from strom_numeric_gpa group by key order by key;
+select key, sum(b), avg(b), count(b) from strom_numeric_gpa group by key order by key;
+
+-- without GROUP BY
+select sum(a), avg(a), sum(b), avg(b) from strom_numeric_gpa;
+select sum(a), avg(a) from strom_numeric_gpa where key in (0, 2);
+
+-- same results as numeric without typmod
+select key, sum(a) = sum(a::numeric) as sum_a, avg(a) = avg(a::numeric) as avg_a,
+       sum(b) = sum(b::numeric) as sum_b, avg(b) = avg(b::numeric) as avg_b
+  from strom_numeric_gpa group by key order by key;
+
+DROP TABLE strom_numeric_gpa;
@@ -0,0 +1,40 @@
+--#
+--#       Gpu PreAggregate TestCases beneath Gather
+--#
+--#   GpuPreAgg runs on the parallel workers under the partial aggregate,
+--#   then the transition states are combined above Gather. Parallel query
+--#   is available on v9.6 or later, so v9.5 runs the same queries without
+--#   the parallel workers.
+--#
+
+set pg_strom.debug_force_gpupreagg to on;
+set pg_strom.enable_gpusort to off;
+set client_min_messages to warning;
+DO $$
+BEGIN
+  PERFORM set_config('max_parallel_workers_per_gather', '4', false);
+  PERFORM set_config('parallel_setup_cost', '0', false);
+  PERFORM set_config('parallel_tuple_cost', '0', false);
+  PERFORM set_config('min_parallel_relation_size', '0', false);
+EXCEPTION WHEN undefined_object THEN
+  NULL;
+END;
+$$;
+
+DROP TABLE IF EXISTS strom_parallel_gpa;
+CREATE TABLE strom_parallel_gpa (id int, key int, i4 int, i8 bigint,
+                                 n numeric(18,4), u numeric);
+INSERT INTO strom_parallel_gpa
+  SELECT id, id % 6, (id * 17) % 10000 - 5000, id::bigint * 100003,
+         (id % 9973) * 0.0125, id % 1000 + 0.333
+    FROM generate_series(1,400000) id;
+ANALYZE strom_parallel_gpa;
+
+-- combine functions of int8[], numeric and fixed-scale numeric states
+select key, count(*), sum(i4), avg(i4), min(i4), max(i4)
+  from strom_parallel_gpa group by key order by key;
+select key, sum(i8), avg(i8), sum(n), avg(n)
+  from strom_parallel_gpa group by key order by key;
+select count(*), sum(u), avg(u), max(n), min(i8) from strom_parallel_gpa;
+
+DROP TABLE strom_parallel_gpa;
@@ -0,0 +1,38 @@
+--#
+--#       Gpu Scan TestCases with the run-time parameters
+--#
+
+set enable_seqscan to off;
+set enable_bitmapscan to off;
+set enable_indexscan to off;
+set random_page_cost=1000000;   --# force off index_scan.
+set pg_strom.enable_gpuhashjoin to off;
+set pg_strom.enable_gpupreagg to off;
+set pg_strom.enable_gpusort to off;
+set client_min_messages to warning;
+
+DROP TABLE IF EXISTS strom_param_gs;
+CREATE TABLE strom_param_gs (id int, ts timestamp, grp int, v int);
+INSERT INTO strom_param_gs
+  SELECT id, '2016-01-01 00:00:00'::timestamp + id * interval '1 minute',
+         id % 10, (id * 37) % 1000
+    FROM generate_series(1,20000) id;
+ANALYZE strom_param_gs;
+
+-- PARAM_EXEC by InitPlan
+select count(*), sum(v) from strom_param_gs
+ where ts > (select max(ts) - interval '1 hour' from strom_param_gs
+              where grp = 3);
+select id, v from strom_param_gs
+ where v > (select max(v) - 3 from strom_param_gs where grp = 7)
+   and grp = 1 order by id limit 10;
+
+-- PARAM_EXEC by the outer query, rescanned with various values
+select g.n, g.grp, g.lim,
+       (select count(*) from strom_param_gs t
+         where t.grp = g.grp and t.v > g.lim) as cnt
+  from (values (1, 1, 900), (2, 2, 500), (3, 1, 100), (4, 3, 999),
+               (5, 1, 900), (6, 4, null), (7, 2, 500)) g(n, grp, lim)
+ order by g.n;
+
+DROP TABLE strom_param_gs;
@@ -0,0 +1,51 @@
+--#
+--#       Gpu Sort TestCases on the parallel merge of the sorted segments
+--#
+--#   A single sorting key of fixed-length type without NULLs is merged
+--#   by multiple threads.
+--#
+
+set pg_strom.debug_force_gpusort to on;
+set pg_strom.gpu_setup_cost=0;
+set random_page_cost=1000000;   --# force off index_scan.
+set pg_strom.enable_gpusort to on;
+set client_min_messages to warning;
+
+DROP TABLE IF EXISTS strom_pmerge_gso;
+CREATE TABLE strom_pmerge_gso (id int, k int, f float8, ts timestamp);
+INSERT INTO strom_pmerge_gso
+  SELECT id, (id * 7919) % 100003 - 50000,
+         ((id * 104729) % 1000003) * 0.5 - 250000,
+         '2016-01-01 00:00:00'::timestamp + ((id * 31) % 500009) * interval '1 second'
+    FROM generate_series(1,400000) id;
+ANALYZE strom_pmerge_gso;
+set pg_strom.gpusort_host_workers to 4;
+
+-- int4, float8 and timestamp
+select rowid, k from (select row_number() over (order by k) as rowid, *
+  from strom_pmerge_gso) t where t.rowid % 39999 = 0 order by rowid;
+select rowid, f from (select row_number() over (order by f desc) as rowid, *
+  from strom_pmerge_gso) t where t.rowid % 39999 = 0 order by rowid;
+select rowid, to_char(ts, 'YYYY-MM-DD HH24:MI:SS') as ts from (select row_number() over (order by ts) as rowid, *
+  from strom_pmerge_gso) t where t.rowid % 39999 = 0 order by rowid;
+
+-- every row is merged in order
+select count(*), sum(k), sum(case when k < p then 1 else 0 end) as inversions
+  from (select k, lag(k) over () as p
+          from (select k from strom_pmerge_gso order by k) s) t;
+select count(*), sum(f), sum(case when f > p then 1 else 0 end) as inversions
+  from (select f, lag(f) over () as p
+          from (select f from strom_pmerge_gso order by f desc) s) t;
+select count(*), extract(epoch from max(ts) - min(ts)) as range, sum(case when ts < p then 1 else 0 end) as inversions
+  from (select ts, lag(ts) over () as p
+          from (select ts from strom_pmerge_gso order by ts) s) t;
+
+-- many threads on a descending key
+set pg_strom.gpusort_host_workers to 32;
+select count(*), sum(k), sum(case when k > p then 1 else 0 end) as inversions
+  from (select k, lag(k) over () as p
+          from (select k from strom_pmerge_gso order by k desc) s) t;
+select rowid, k from (select row_number() over (order by k desc) as rowid, *
+  from strom_pmerge_gso) t where t.rowid % 39999 = 0 order by rowid;
+
+DROP TABLE strom_pmerge_gso;
@@ -0,0 +1,62 @@
+--#
+--#       Gpu Sort TestCases on the normalized key prefix
+--#
+--#   Special values of the first sort key are mixed in the rows, then
+--#   sorted with the other rows. Ties of the key prefix are resolved by
+--#   the comparator of the data type.
+--#
+
+set pg_strom.debug_force_gpusort to on;
+set pg_strom.gpu_setup_cost=0;
+set random_page_cost=1000000;   --# force off index_scan.
+set pg_strom.enable_gpusort to on;
+set client_min_messages to warning;
+
+DROP TABLE IF EXISTS strom_prefix_gso;
+CREATE TABLE strom_prefix_gso (id int, f float8, n numeric, t text, c char(10));
+INSERT INTO strom_prefix_gso
+  SELECT id,
+         case when id % 1000 < 12
+              then (array['-Infinity', '-1e300', '-2.25', '-0', '0', '1e-300',
+                          '0.5', '3', '1e300', 'Infinity', 'NaN',
+                          null])::float8[])[id % 1000 + 1]
+              else ((id * 7919) % 200001 - 100000) * 0.25 end,
+         case when id % 1000 < 12
+              then (array['-1e400', '-1e320', '-1.00000000000000002',
+                          '-1.00000000000000001', '0', '1.00000000000000001',
+                          '1.000000000000000015', '1.00000000000000002',
+                          '1e320', '1e400', 'NaN', null])::numeric[])[id % 1000 + 1]
+              else ((id * 7919) % 200001 - 100000) * 0.001 end,
+         case when id % 1000 < 12
+              then (array['', 'a', 'aaaaaaaa', 'aaaaaaaaa', 'aaaaaaaab',
+                          'aaaaaaab', 'ZZZZZZZZZ', 'zzzzzzzzzzzz0',
+                          'zzzzzzzzzzzz', 'Aaaaaaaaa1', 'Aaaaaaaaa0',
+                          null])[id % 1000 + 1]
+              else 'f' || lpad(((id * 7919) % 200001)::text, 7, '0') end,
+         case when id % 1000 < 12
+              then (array['ab', 'ab!', 'a', 'ab ', 'abcdefghij', 'abcdefgh',
+                          'abcdefgha', 'abcdefgh !', 'A', 'ab  !', '  ',
+                          null])[id % 1000 + 1]
+              else 'f' || lpad(((id * 7919) % 200001)::text, 7, '0') end
+    FROM generate_series(1,200000) id;
+ANALYZE strom_prefix_gso;
+
+-- float8 with infinity, NaN, -0.0 and NULL
+select rowid, id, f from (select row_number() over (order by f, id) as rowid, *
+  from strom_prefix_gso) t where id % 1000 < 12 and id < 3000 order by rowid;
+select rowid, id, f from (select row_number() over (order by f desc, id) as rowid, *
+  from strom_prefix_gso) t where id % 1000 < 12 and id < 3000 order by rowid;
+
+-- numeric beyond the range or the precision of float8
+select rowid, id from (select row_number() over (order by n, id) as rowid, *
+  from strom_prefix_gso) t where id % 1000 < 12 and id < 3000 order by rowid;
+select rowid, id from (select row_number() over (order by n desc nulls last, id) as rowid, *
+  from strom_prefix_gso) t where id % 1000 < 12 and id < 3000 order by rowid;
+
+-- text and bpchar longer than the key prefix, on "C" collation
+select rowid, id, t from (select row_number() over (order by t collate "C", id) as rowid, *
+  from strom_prefix_gso) t where id % 1000 < 12 and id < 3000 order by rowid;
+select rowid, length(c), id from (select row_number() over (order by c collate "C" desc, id) as rowid, *
+  from strom_prefix_gso) t where id % 1000 < 12 and id < 3000 order by rowid;
+
+DROP TABLE strom_prefix_gso;
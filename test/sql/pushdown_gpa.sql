@@ -0,0 +1,47 @@
+--#
+--#       Gpu PreAggregate TestCases pushed down beneath the join
+--#
+
+set pg_strom.debug_force_gpupreagg to on;
+set pg_strom.enable_gpupreagg_pushdown to on;
+set pg_strom.enable_gpuhashjoin to off;
+set pg_strom.enable_gpusort to off;
+set enable_mergejoin to off;
+set enable_nestloop to off;
+set client_min_messages to warning;
+
+DROP TABLE IF EXISTS strom_pushdown_outer;
+DROP TABLE IF EXISTS strom_pushdown_inner;
+CREATE TABLE strom_pushdown_outer (id int, jk int, cat int, v int);
+CREATE TABLE strom_pushdown_inner (jk int, grp int);
+INSERT INTO strom_pushdown_outer
+  SELECT id, id % 200 + 1, id % 7, id % 1000
+    FROM generate_series(1,20000) id;
+INSERT INTO strom_pushdown_inner
+  SELECT jk, jk % 5 FROM generate_series(1,200) jk;
+ANALYZE strom_pushdown_outer;
+ANALYZE strom_pushdown_inner;
+
+-- GROUP BY a non-join-key outer column that is not projected
+select sum(o.v) from strom_pushdown_outer o
+  join strom_pushdown_inner i on o.jk = i.jk
+ group by o.cat order by 1;
+select o.cat, sum(o.v), count(*) from strom_pushdown_outer o
+  join strom_pushdown_inner i on o.jk = i.jk
+ group by o.cat order by o.cat;
+
+-- GROUP BY an inner column, and by the join key
+select i.grp, sum(o.v), max(o.v) from strom_pushdown_outer o
+  join strom_pushdown_inner i on o.jk = i.jk
+ group by i.grp order by i.grp;
+select sum(o.v) from strom_pushdown_outer o
+  join strom_pushdown_inner i on o.jk = i.jk
+ where i.jk <= 10 group by o.jk order by 1;
+
+-- GROUP BY an expression on a non-projected outer column
+select count(*), sum(o.v) from strom_pushdown_outer o
+  join strom_pushdown_inner i on o.jk = i.jk
+ group by o.cat % 3 order by 1, 2;
+
+DROP TABLE strom_pushdown_outer;
+DROP TABLE strom_pushdown_inner;
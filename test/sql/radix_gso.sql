@@ -0,0 +1,36 @@
+--#
+--#       Gpu Sort TestCases on the host-side radix sort
+--#
+
+set pg_strom.debug_force_gpusort to on;
+set pg_strom.gpu_setup_cost=0;
+set random_page_cost=1000000;   --# force off index_scan.
+set pg_strom.enable_gpusort to on;
+set client_min_messages to warning;
+
+DROP TABLE IF EXISTS strom_radix_gso;
+CREATE TABLE strom_radix_gso (id int, a int, b int, n numeric);
+INSERT INTO strom_radix_gso
+  SELECT id, (id * 7919) % 1000,
+         case when id % 11 = 0 then null else (id * 104729) % 100003 end,
+         case when id % 13 = 0 then null
+              else (id * 31) % 5000 + 0.1234567890123456789012345 end
+    FROM generate_series(1,200000) id;
+ANALYZE strom_radix_gso;
+
+-- multiple keys, NULL and DESC
+select rowid, a, b, id from (select row_number() over (order by a, b desc, id) as rowid, *
+  from strom_radix_gso) t where t.rowid % 19997 = 0 order by rowid;
+select rowid, b, a, id from (select row_number() over (order by b nulls first, a desc, id) as rowid, *
+  from strom_radix_gso) t where t.rowid % 19997 = 0 order by rowid;
+select rowid, b, id from (select row_number() over (order by b desc nulls last, id desc) as rowid, *
+  from strom_radix_gso) t where t.rowid % 19997 = 0 order by rowid;
+
+-- numeric with long digits is re-checked on CPU, then sorted by radix sort
+-- on the normalized key prefix with multiple threads
+select rowid, n, a, id from (select row_number() over (order by n desc, a, id) as rowid, *
+  from strom_radix_gso) t where t.rowid % 19997 = 0 order by rowid;
+select rowid, a, n, b, id from (select row_number() over (order by a desc, n nulls first, b desc nulls last, id desc) as rowid, *
+  from strom_radix_gso) t where t.rowid % 19997 = 0 order by rowid;
+
+DROP TABLE strom_radix_gso;
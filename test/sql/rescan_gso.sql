@@ -0,0 +1,48 @@
+--#
+--#       Gpu Sort TestCases with the parameterized rescan
+--#
+
+set pg_strom.debug_force_gpusort to on;
+set pg_strom.gpu_setup_cost=0;
+set random_page_cost=1000000;   --# force off index_scan.
+set pg_strom.enable_gpusort to on;
+set client_min_messages to warning;
+
+DROP TABLE IF EXISTS strom_rescan_gso;
+CREATE TABLE strom_rescan_gso (k int, v int);
+INSERT INTO strom_rescan_gso
+  SELECT id % 5, (id * 7919) % 10007 FROM generate_series(1,20000) id;
+ANALYZE strom_rescan_gso;
+
+-- rescan with the parameter values already seen reuses the sorted result
+select o.n, o.k,
+       (select v from strom_rescan_gso t where t.k = o.k
+         order by v desc offset 2 limit 1) as v
+  from (select n, n % 3 as k from generate_series(1,9) n) o order by o.n;
+
+-- same query without the reuse
+set pg_strom.gpusort_rescan_cache_size = 0;
+select o.n, o.k,
+       (select v from strom_rescan_gso t where t.k = o.k
+         order by v desc offset 2 limit 1) as v
+  from (select n, n % 3 as k from generate_series(1,9) n) o order by o.n;
+reset pg_strom.gpusort_rescan_cache_size;
+
+-- sorted results spilled out to the temporary file, and the cache which
+-- cannot keep all of them
+set pg_strom.gpusort_memory_limit = 64;
+select o.n, o.k,
+       (select sum(v * r) from
+          (select v, row_number() over (order by v) r
+             from strom_rescan_gso t where t.k = o.k) s) as wsum
+  from (select n, n % 4 as k from generate_series(1,12) n) o order by o.n;
+set pg_strom.gpusort_rescan_cache_size = 64;
+select o.n, o.k,
+       (select sum(v * r) from
+          (select v, row_number() over (order by v) r
+             from strom_rescan_gso t where t.k = o.k) s) as wsum
+  from (select n, n % 4 as k from generate_series(1,12) n) o order by o.n;
+reset pg_strom.gpusort_rescan_cache_size;
+reset pg_strom.gpusort_memory_limit;
+
+DROP TABLE strom_rescan_gso;
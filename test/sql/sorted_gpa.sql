@@ -0,0 +1,50 @@
+--#
+--#       Gpu PreAggregate TestCases on the input sorted by grouping keys
+--#
+--#   Index scan delivers rows ordered by the grouping keys, so GpuPreAgg
+--#   reduces runs of the adjacent rows. Long runs cross the boundary of
+--#   workgroups and chunks.
+--#
+
+set pg_strom.debug_force_gpupreagg to on;
+set pg_strom.enable_gpusort to off;
+set enable_seqscan to off;
+set enable_bitmapscan to off;
+set enable_hashagg to off;
+set enable_sort to off;
+set client_min_messages to warning;
+
+DROP TABLE IF EXISTS strom_sorted_gpa;
+CREATE TABLE strom_sorted_gpa (id int, k1 int, k2 int, v int);
+INSERT INTO strom_sorted_gpa
+  SELECT id, case when id % 30000 = 0 then null else id / 3000 end,
+         id % 7, (id * 13) % 1000
+    FROM generate_series(1,300000) id;
+CREATE INDEX strom_sorted_gpa_id ON strom_sorted_gpa (id);
+CREATE INDEX strom_sorted_gpa_k1k2 ON strom_sorted_gpa (k1, k2);
+ANALYZE strom_sorted_gpa;
+
+-- long runs, and NULL as a grouping key
+select count(*), sum(c), min(c), max(c), sum(s), max(s)
+  from (select k1, count(*) c, sum(v) s
+          from strom_sorted_gpa group by k1) t;
+select k1, c, s
+  from (select k1, count(*) c, sum(v) s
+          from strom_sorted_gpa group by k1) t
+ where c < 3000 or k1 is null order by c, k1;
+
+-- multiple grouping keys
+select count(*), sum(c), min(c), max(c), sum(s), max(s)
+  from (select k1, k2, count(*) c, sum(v) s
+          from strom_sorted_gpa group by k1, k2) t;
+select k1, k2, c, mn, mx
+  from (select k1, k2, count(*) c, min(v) mn, max(v) mx
+          from strom_sorted_gpa where k1 between 29 and 31 group by k1, k2) t
+ order by mx, k1, k2;
+
+-- every run has only one row
+select count(*), sum(c), max(c), sum(s), max(s)
+  from (select id, count(*) c, sum(v) s
+          from strom_sorted_gpa group by id) t;
+
+DROP TABLE strom_sorted_gpa;
@@ -0,0 +1,44 @@
+--#
+--#       Gpu Sort TestCases with sorted runs spilled to temporary files
+--#
+
+set pg_strom.debug_force_gpusort to on;
+set pg_strom.gpu_setup_cost=0;
+set random_page_cost=1000000;   --# force off index_scan.
+set pg_strom.enable_gpusort to on;
+set pg_strom.gpusort_memory_limit to '1MB';
+set client_min_messages to warning;
+
+DROP TABLE IF EXISTS strom_spill_gso;
+DROP TABLE IF EXISTS strom_spill_inner_gso;
+CREATE TABLE strom_spill_gso (id int, a int, b text, pad text);
+CREATE TABLE strom_spill_inner_gso (id int, a int, pad text);
+INSERT INTO strom_spill_gso
+  SELECT id, (id * 7919) % 100000, 'b' || lpad(((id * 31) % 1000)::text, 4, '0'),
+         repeat('x', 40)
+    FROM generate_series(1,300000) id;
+INSERT INTO strom_spill_inner_gso
+  SELECT id, (id * 3) % 20000, repeat('y', 40)
+    FROM generate_series(1,50000) id;
+ANALYZE strom_spill_gso;
+ANALYZE strom_spill_inner_gso;
+
+-- multiple keys merged from the sorted runs
+select rowid, a, b, id from (select row_number() over (order by a, b desc, id) as rowid, *
+  from strom_spill_gso) t where t.rowid % 29999 = 0 order by rowid;
+select rowid, b, a, id from (select row_number() over (order by b, a desc, id desc) as rowid, *
+  from strom_spill_gso) t where t.rowid % 29999 = 0 order by rowid;
+
+-- bounded sort
+select id, a, b from strom_spill_gso order by a desc, id limit 10;
+
+-- mark and restore on the sorted runs by merge join
+set enable_hashjoin to off;
+set enable_nestloop to off;
+set pg_strom.enable_gpuhashjoin to off;
+set pg_strom.enable_gpunestloop to off;
+select count(*), sum(o.id), sum(i.id)
+  from strom_spill_gso o join strom_spill_inner_gso i on o.a = i.a;
+
+DROP TABLE strom_spill_gso;
+DROP TABLE strom_spill_inner_gso;
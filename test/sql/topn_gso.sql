@@ -0,0 +1,41 @@
+--#
+--#       Gpu Sort TestCases beneath LIMIT
+--#
+
+set pg_strom.debug_force_gpusort to on;
+set pg_strom.gpu_setup_cost=0;
+set random_page_cost=1000000;   --# force off index_scan.
+set pg_strom.enable_gpusort to on;
+set client_min_messages to warning;
+
+DROP TABLE IF EXISTS strom_topn_gso;
+CREATE TABLE strom_topn_gso (id int, a int, b int, t text);
+INSERT INTO strom_topn_gso
+  SELECT id, (id * 7919) % 100000,
+         case when id % 17 = 0 then null else (id * 104729) % 50000 end,
+         'k' || lpad(((id * 31) % 99991)::text, 6, '0')
+    FROM generate_series(1,200000) id;
+ANALYZE strom_topn_gso;
+
+-- LIMIT and OFFSET with duplicated keys
+select id, a from strom_topn_gso order by a, id limit 10;
+select id, a from strom_topn_gso order by a desc, id desc limit 10 offset 5;
+
+-- NULLs at the boundary of the bound
+select id, b from strom_topn_gso order by b desc nulls last, id limit 12;
+select id, b from strom_topn_gso order by b nulls first, id limit 6 offset 11761;
+
+-- varlena key
+select t, id from strom_topn_gso order by t desc, id limit 10;
+
+-- bound larger than the segments, or than the relation
+select count(*), min(a), max(a), sum(id) from
+  (select * from strom_topn_gso order by a desc, id limit 1000) t;
+select count(*), sum(id) from
+  (select * from strom_topn_gso order by a, id limit 300000) t;
+
+-- no bound
+select id, a from strom_topn_gso order by a, id limit 0;
+select id, a from strom_topn_gso order by a, id limit all offset 199995;
+
+DROP TABLE strom_topn_gso;